@@ -3,429 +3,357 @@
 
 //==============================================================================
 JC303::JC303()
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       ),
-       parameters (*this, nullptr, juce::Identifier("APVTS"), {
-            std::make_unique<juce::AudioParameterFloat> ("waveform",
-                                                        "Waveform",
+     : AudioProcessor (createBusesProperties()),
+       parameters (*this, nullptr, juce::Identifier("APVTS"), createParameterLayout())
+{
+    // assign the parameters of the first line and force initial user values (some hosts migth
+    // not do it using value tree state) - the lines of the rack follow once it is switched on
+    lines[0] = std::make_unique<JC303Line>();
+    lines[0]->attachParameters(parameters, getLineParameterPrefix(0));
+    numCreatedLines = 1;
+    // nullptr in builds without the rack
+    rackMode = parameters.getRawParameterValue("rackMode");
+    overdriveNativeRate = parameters.getRawParameterValue("overdriveNativeRate");
+    loopCache = parameters.getRawParameterValue("loopCache");
+
+    // presets and overdrive models: the models folder is created and indexed in the background
+    overdriveModelLibrary->setFolder(userAppDataDirectory_tones);
+    overdriveModelLibrary->addChangeListener(this);
+    //installTones();
+    // Sort jsonFiles alphabetically
+    /* std::sort(jsonFiles.begin(), jsonFiles.end());
+    if (jsonFiles.size() > 0) {
+        loadConfig(jsonFiles[current_model_index]);
+    } */
+
+    // Add parameter listeners
+    for (int i = 0; i < numLines; i++)
+        for (auto* parameterID : open303ParameterIDs)
+            parameters.addParameterListener(getLineParameterPrefix(i) + parameterID, this);
+
+    startTimerHz(10);
+}
+
+JC303::~JC303()
+{
+    stopTimer();
+    overdriveModelLibrary->removeChangeListener(this);
+    workerPool.reset();
+
+    for (int i = 0; i < numLines; i++)
+        for (auto* parameterID : open303ParameterIDs)
+            parameters.removeParameterListener(getLineParameterPrefix(i) + parameterID, this);
+}
+
+JC303::BusesProperties JC303::createBusesProperties()
+{
+    BusesProperties buses;
+   #if ! JucePlugin_IsMidiEffect
+    #if ! JucePlugin_IsSynth
+    buses = buses.withInput  ("Input",  juce::AudioChannelSet::stereo(), true);
+    #endif
+    buses = buses.withOutput ("Output", juce::AudioChannelSet::stereo(), true);
+    // rack mode: optional outputs for the lines of channels 2...16 (when disabled, the line is
+    // mixed into the main output)
+    for (int i = 1; i < numLines; i++)
+        buses = buses.withOutput ("Line " + juce::String(i + 1), juce::AudioChannelSet::stereo(), false);
+   #endif
+    return buses;
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout JC303::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    // one full parameter set per line - the first line keeps the original ids
+    for (int i = 0; i < numLines; i++)
+    {
+        const auto prefix = getLineParameterPrefix(i);
+        const auto namePrefix = i == 0 ? juce::String() : "Line " + juce::String(i + 1) + " ";
+        layout.add(
+            std::make_unique<juce::AudioParameterFloat> (prefix + "waveform",
+                                                        namePrefix + "Waveform",
                                                         0.0f,
                                                         1.0f,
                                                         1.0f),
-            std::make_unique<juce::AudioParameterFloat> ("tuning",
-                                                        "Tuning",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "tuning",
+                                                        namePrefix + "Tuning",
                                                         0.0f,
                                                         1.0f,
                                                         0.5f),
-            std::make_unique<juce::AudioParameterFloat> ("cutoff",
-                                                        "Cutoff",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "cutoff",
+                                                        namePrefix + "Cutoff",
                                                         0.0f,
                                                         1.0f,
                                                         0.0f),
-            std::make_unique<juce::AudioParameterFloat> ("resonance",
-                                                        "Resonance",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "resonance",
+                                                        namePrefix + "Resonance",
                                                         0.0f,
                                                         1.0f,
                                                         0.92f),
-            std::make_unique<juce::AudioParameterFloat> ("envmod",
-                                                        "EnvMod",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "envmod",
+                                                        namePrefix + "EnvMod",
                                                         0.0f,
                                                         1.0f,
                                                         0.0f),
-            std::make_unique<juce::AudioParameterFloat> ("decay",
-                                                        "Decay",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "decay",
+                                                        namePrefix + "Decay",
                                                         0.0f,
                                                         1.0f,
                                                         0.29f),
-            std::make_unique<juce::AudioParameterFloat> ("accent",
-                                                        "Accent",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "accent",
+                                                        namePrefix + "Accent",
                                                         0.0f,
                                                         1.0f,
                                                         0.78f),
-            std::make_unique<juce::AudioParameterFloat> ("volume",
-                                                        "Volume",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "volume",
+                                                        namePrefix + "Volume",
                                                         0.0f,
                                                         1.0f,
                                                         0.75f),
             // MODs parameters
-            std::make_unique<juce::AudioParameterFloat> ("normalDecay",
-                                                        "Normal Decay",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "normalDecay",
+                                                        namePrefix + "Normal Decay",
                                                         0.0f,
                                                         1.0f,
                                                         0.3f),
-            std::make_unique<juce::AudioParameterFloat> ("accentDecay",
-                                                        "Accent Decay",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "accentDecay",
+                                                        namePrefix + "Accent Decay",
                                                         0.0f,
                                                         1.0f,
                                                         0.03f),
-            std::make_unique<juce::AudioParameterFloat> ("feedbackFilter",
-                                                        "Filt. FeedBack",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "feedbackFilter",
+                                                        namePrefix + "Filt. FeedBack",
                                                         0.0f,
                                                         1.0f,
                                                         0.63f),
-            std::make_unique<juce::AudioParameterFloat> ("softAttack",
-                                                        "Soft Attack",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "softAttack",
+                                                        namePrefix + "Soft Attack",
                                                         0.0f,
                                                         1.0f,
                                                         0.26f),
-            std::make_unique<juce::AudioParameterFloat> ("slideTime",
-                                                        "Slide time",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "slideTime",
+                                                        namePrefix + "Slide time",
                                                         0.0f,
                                                         1.0f,
                                                         0.33f),
-            std::make_unique<juce::AudioParameterFloat> ("sqrDriver",
-                                                        "Square Driver",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "sqrDriver",
+                                                        namePrefix + "Square Driver",
                                                         0.0f,
                                                         1.0f,
                                                         0.25f),
-            std::make_unique<juce::AudioParameterBool> ("switchModState",
-                                                        "Switch Mod",
+            std::make_unique<juce::AudioParameterBool> (prefix + "switchModState",
+                                                        namePrefix + "Switch Mod",
                                                         false),
             // overdrive
-            std::make_unique<juce::AudioParameterInt> ("overdriveModelIndex",
-                                                        "Overdrive Model Index",
+            std::make_unique<juce::AudioParameterInt> (prefix + "overdriveModelIndex",
+                                                        namePrefix + "Overdrive Model Index",
                                                         0,
-                                                        loadOverdriveTones() - 1,
+                                                        RONNTags::numBuiltInModels + maxUserOverdriveModels - 1,
                                                         0),
-            std::make_unique<juce::AudioParameterFloat> ("overdriveLevel",
-                                                        "Drive",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "overdriveLevel",
+                                                        namePrefix + "Drive",
                                                         0.0f,
                                                         1.0f,
                                                         0.25f),
-            std::make_unique<juce::AudioParameterFloat> ("overdriveDryWet",
-                                                        "Dry/Wet",
+            std::make_unique<juce::AudioParameterFloat> (prefix + "overdriveDryWet",
+                                                        namePrefix + "Dry/Wet",
                                                         0.0f,
                                                         1.0f,
                                                         0.25f),
-            std::make_unique<juce::AudioParameterBool> ("switchOverdriveState",
-                                                        "Switch Overdrive Mod",
-                                                        false)
-       })
-{
-    // assign a pointer to use it around for each parameter
-    waveForm = parameters.getRawParameterValue("waveform");
-    tuning = parameters.getRawParameterValue("tuning");
-    cutoffFreq = parameters.getRawParameterValue("cutoff");
-    resonance = parameters.getRawParameterValue("resonance");
-    envelopMod = parameters.getRawParameterValue("envmod");
-    decay = parameters.getRawParameterValue("decay");
-    accent = parameters.getRawParameterValue("accent");
-    volume = parameters.getRawParameterValue("volume");
-    // MODs parameters
-    switchModState = parameters.getRawParameterValue("switchModState");
-    normalDecay = parameters.getRawParameterValue("normalDecay");
-    accentDecay = parameters.getRawParameterValue("accentDecay");
-    feedbackFilter = parameters.getRawParameterValue("feedbackFilter");
-    softAttack = parameters.getRawParameterValue("softAttack");
-    slideTime = parameters.getRawParameterValue("slideTime");
-    sqrDriver = parameters.getRawParameterValue("sqrDriver");
-    // overdrive parameters
-    overdriveModelIndex = parameters.getRawParameterValue("overdriveModelIndex");
-    switchOverdriveState = parameters.getRawParameterValue("switchOverdriveState");
-    overdriveLevel = parameters.getRawParameterValue("overdriveLevel");
-    overdriveDryWet = parameters.getRawParameterValue("overdriveDryWet");
-
-    // force initial user values(some hosts migth not do it using value tree state)
-    setParameter(WAVEFORM, *waveForm);
-    setParameter(TUNING, *tuning);
-    setParameter(CUTOFF, *cutoffFreq);
-    setParameter(RESONANCE, *resonance);
-    setParameter(ENVMOD, *envelopMod);
-    setParameter(DECAY, *decay);
-    setParameter(ACCENT, *accent);
-    setParameter(VOLUME, *volume);
-    setDevilMod(*switchModState);
-    setParameter(NORMAL_DECAY, *normalDecay);
-    setParameter(ACCENT_DECAY, *accentDecay);
-    setParameter(FEEDBACK_HPF, *feedbackFilter);
-    setParameter(SOFT_ATTACK, *softAttack);
-    setParameter(SLIDE_TIME, *slideTime);
-    setParameter(TANH_SHAPER_DRIVE, *sqrDriver);
-    setParameter(OVERDRIVE_LEVEL, *overdriveLevel);
-    setParameter(OVERDRIVE_DRY_WET, *overdriveDryWet);
-    setParameter(OVERDRIVE_MODEL_INDEX, *overdriveModelIndex);
-
-    // presets and overdrive models
-    setupDataDirectories();
-    //installTones();
-    //loadOverdriveTones();
-    // Sort jsonFiles alphabetically
-    /* std::sort(jsonFiles.begin(), jsonFiles.end());
-    if (jsonFiles.size() > 0) {
-        loadConfig(jsonFiles[current_model_index]);
-    } */
+            std::make_unique<juce::AudioParameterBool> (prefix + "switchOverdriveState",
+                                                        namePrefix + "Switch Overdrive Mod",
+                                                        false),
+            // filter (choices in the order of TeeBeeFilter::modes)
+            std::make_unique<juce::AudioParameterChoice> (prefix + "filterMode",
+                                                        namePrefix + "Filter Mode",
+                                                        juce::StringArray { "Flat",
+                                                            "LP 6", "LP 12", "LP 18", "LP 24",
+                                                            "HP 6", "HP 12", "HP 18", "HP 24",
+                                                            "BP 12/12", "BP 6/18", "BP 18/6",
+                                                            "BP 6/12", "BP 12/6", "BP 6/6",
+                                                            "TB-303" },
+                                                        TeeBeeFilter::TB_303)
+        );
+    }
 
-    // Add parameter listeners
-    parameters.addParameterListener("waveform", this);
-    parameters.addParameterListener("tuning", this);
-    parameters.addParameterListener("cutoff", this);
-    parameters.addParameterListener("resonance", this);
-    parameters.addParameterListener("envmod", this);
-    parameters.addParameterListener("decay", this);
-    parameters.addParameterListener("accent", this);
-    parameters.addParameterListener("volume", this);
-    parameters.addParameterListener("normalDecay", this);
-    parameters.addParameterListener("accentDecay", this);
-    parameters.addParameterListener("feedbackFilter", this);
-    parameters.addParameterListener("softAttack", this);
-    parameters.addParameterListener("slideTime", this);
-    parameters.addParameterListener("sqrDriver", this);
-    parameters.addParameterListener("switchModState", this);
-    parameters.addParameterListener("overdriveLevel", this);
-    parameters.addParameterListener("overdriveDryWet", this);
-    parameters.addParameterListener("overdriveModelIndex", this);
-    parameters.addParameterListener("switchOverdriveState", this);
+   #if JC303_RACK_MODE
+    // rack mode: one line per MIDI channel instead of the first line playing all channels
+    layout.add(std::make_unique<juce::AudioParameterBool> ("rackMode",
+                                                           "Rack Mode",
+                                                           false));
+   #endif
+
+    // run the overdrive models at their own sample rate when the host runs at a higher one
+    layout.add(std::make_unique<juce::AudioParameterBool> ("overdriveNativeRate",
+                                                           "Overdrive Native Rate",
+                                                           false));
+
+    // play the loops of the sequencer back from memory while nothing changes (see
+    // Open303::setLoopCacheEnabled)
+    layout.add(std::make_unique<juce::AudioParameterBool> ("loopCache",
+                                                           "Loop Cache",
+                                                           false));
+    return layout;
 }
 
-JC303::~JC303()
+juce::String JC303::getLineParameterPrefix(int lineIndex)
 {
-    parameters.removeParameterListener("waveform", this);
-    parameters.removeParameterListener("tuning", this);
-    parameters.removeParameterListener("cutoff", this);
-    parameters.removeParameterListener("resonance", this);
-    parameters.removeParameterListener("envmod", this);
-    parameters.removeParameterListener("decay", this);
-    parameters.removeParameterListener("accent", this);
-    parameters.removeParameterListener("volume", this);
-    parameters.removeParameterListener("normalDecay", this);
-    parameters.removeParameterListener("accentDecay", this);
-    parameters.removeParameterListener("feedbackFilter", this);
-    parameters.removeParameterListener("softAttack", this);
-    parameters.removeParameterListener("slideTime", this);
-    parameters.removeParameterListener("sqrDriver", this);
-    parameters.removeParameterListener("switchModState", this);
-    parameters.removeParameterListener("overdriveLevel", this);
-    parameters.removeParameterListener("overdriveDryWet", this);
-    parameters.removeParameterListener("overdriveModelIndex", this);
-    parameters.removeParameterListener("switchOverdriveState", this);
+    return lineIndex == 0 ? juce::String() : "line" + juce::String(lineIndex + 1) + "_";
 }
 
 // Parameter change callback
 void JC303::parameterChanged(const juce::String& parameterID, float newValue)
 {
-    // Map parameter ID to enum and update immediately or set flag
-    if (parameterID == "waveform") {
-        setParameter(WAVEFORM, newValue);
-    }
-    else if (parameterID == "tuning") {
-        setParameter(TUNING, newValue);
-    }
-    else if (parameterID == "cutoff") {
-        setParameter(CUTOFF, newValue);
-    }
-    else if (parameterID == "resonance") {
-        setParameter(RESONANCE, newValue);
-    }
-    else if (parameterID == "envmod") {
-        setParameter(ENVMOD, newValue);
-    }
-    else if (parameterID == "decay") {
-        setParameter(DECAY, newValue);
-    }
-    else if (parameterID == "accent") {
-        setParameter(ACCENT, newValue);
-    }
-    else if (parameterID == "volume") {
-        setParameter(VOLUME, newValue);
+    // find the line from the id prefix
+    auto lineIndex = 0;
+    auto id = parameterID;
+    if (id.startsWith("line") && id.containsChar('_')) {
+        lineIndex = id.substring(4).getIntValue() - 1;
+        id = id.fromFirstOccurrenceOf("_", false, false);
     }
-    else if (parameterID == "switchModState") {
-        setDevilMod(newValue > 0.5f);
-    }
-    else if (parameterID == "normalDecay" && *switchModState) {
-        setParameter(NORMAL_DECAY, newValue);
-    }
-    else if (parameterID == "accentDecay" && *switchModState) {
-        setParameter(ACCENT_DECAY, newValue);
-    }
-    else if (parameterID == "feedbackFilter" && *switchModState) {
-        setParameter(FEEDBACK_HPF, newValue);
-    }
-    else if (parameterID == "softAttack" && *switchModState) {
-        setParameter(SOFT_ATTACK, newValue);
-    }
-    else if (parameterID == "slideTime" && *switchModState) {
-        setParameter(SLIDE_TIME, newValue);
-    }
-    else if (parameterID == "sqrDriver" && *switchModState) {
-        setParameter(TANH_SHAPER_DRIVE, newValue);
-    }
-    else if (parameterID == "overdriveLevel") {
-        setParameter(OVERDRIVE_LEVEL, newValue);
+    if (id == open303ParameterIDs[OVERDRIVE_MODEL_INDEX] && juce::isPositiveAndBelow(lineIndex, numLines))
+        rememberOverdriveModelFile(lineIndex, juce::roundToInt(newValue));
+    // the lines of the rack take up their values when they are created
+    if (lineIndex < 0 || lineIndex >= numCreatedLines.load())
+        return;
+
+    // map parameter ID to enum
+    auto index = 0;
+    while (index < OPEN303_NUM_PARAMETERS && id != open303ParameterIDs[index])
+        index++;
+    if (index == OPEN303_NUM_PARAMETERS)
+        return;
+
+    lines[(size_t) lineIndex]->parameterChanged((Open303Parameters) index, newValue);
+}
+
+void JC303::timerCallback()
+{
+    if (rackMode != nullptr && *rackMode > 0.5f)
+        createRackLines();
+
+    // switching the overdrive rate reloads the models, which is too heavy for the audio thread
+    const auto numLinesToUpdate = numCreatedLines.load();
+    for (int i = 0; i < numLinesToUpdate; i++)
+        lines[(size_t) i]->guitarML.setNativeRateProcessing(*overdriveNativeRate > 0.5f);
+
+    // the loop cache allocates its buffer here when it is first switched on, the audio thread
+    // only takes up the switch with its next block
+    const auto loopCacheEnabled = *loopCache > 0.5f;
+    for (int i = 0; i < numLinesToUpdate; i++)
+    {
+        auto& line = *lines[(size_t) i];
+        if (line.open303Core.isLoopCacheEnabled() != loopCacheEnabled)
+            line.open303Core.setLoopCacheEnabled(loopCacheEnabled);
     }
-    else if (parameterID == "overdriveDryWet") {
-        setParameter(OVERDRIVE_DRY_WET, newValue);
+
+    // renders the pre-blended wavetable once the waveform knob stays where it is for a tick, the
+    // oscillator reads both wavetables until then
+    for (int i = 0; i < numLinesToUpdate; i++)
+        lines[(size_t) i]->open303Core.updatePreBlendedWaveform();
+
+    updateLatency();
+}
+
+void JC303::createRackLines()
+{
+    const juce::ScopedLock lineCreationScope(lineCreationLock);
+    if (numCreatedLines.load() == numLines)
+        return;
+
+    for (int i = 1; i < numLines; i++)
+    {
+        auto line = std::make_unique<JC303Line>();
+        line->attachParameters(parameters, getLineParameterPrefix(i));
+        if (preparedBlockSize > 0)
+        {
+            line->prepareToPlay(preparedSampleRate, preparedBlockSize);
+            lineBuffers[(size_t) i].setSize(1, preparedBlockSize);
+        }
+        lines[(size_t) i] = std::move(line);
     }
-    else if (parameterID == "overdriveModelIndex") {
-        setParameter(OVERDRIVE_MODEL_INDEX, newValue);
+
+    // the audio thread renders one line itself, so one worker less than lines or cores is enough
+    const auto numWorkers = juce::jlimit(0, numLines - 1, juce::SystemStats::getNumCpus() - 1);
+    workerPool = std::make_unique<RackWorkerPool>(*this, numWorkers);
+
+    // the audio thread plays the rack from here on
+    numCreatedLines.store(numLines);
+
+    // the parameter callbacks skipped the new lines until now, so catch up with what changed
+    // since they were created
+    for (int i = 1; i < numLines; i++)
+        lines[(size_t) i]->applyChangedParameters();
+}
+
+void JC303::updateLatency()
+{
+    // while the overdrive runs at the model rate, the latency covers the longest delay of the
+    // built-in models whether any overdrive is on or not, and the lines delay their output to
+    // match - so switching the overdrive or its model doesn't make the host redo its delay
+    // compensation. Only a user model below the rate of the built-in ones can raise it.
+    auto latency = *overdriveNativeRate > 0.5f ? GuitarMLAmp::getNativeRateLatencySamples(preparedSampleRate) : 0;
+    const auto numPlayingLines = rackMode != nullptr && *rackMode > 0.5f ? numCreatedLines.load() : 1;
+    for (int i = 0; i < numPlayingLines; i++)
+    {
+        const auto& line = *lines[(size_t) i];
+        if (line.getParameterValue(OVERDRIVE_SWITCH) > 0.5f)
+            latency = juce::jmax(latency, line.guitarML.getLatencySamples());
     }
+    latency = juce::jmin(latency, JC303Line::maxOverdriveLatencySamples);
+
+    const auto numLinesToUpdate = numCreatedLines.load();
+    for (int i = 0; i < numLinesToUpdate; i++)
+        lines[(size_t) i]->setOutputLatency(latency);
+
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 
-void JC303::setParameter (Open303Parameters index, float value)
+void JC303::changeListenerCallback(juce::ChangeBroadcaster*)
 {
-  if( index < 0 || index >= OPEN303_NUM_PARAMETERS )
-    return;
+    followOverdriveModelFiles();
+}
 
-	switch(index)
-	{
-    case WAVEFORM:
-        open303Core.setWaveform(
-            linToLin(value, 0.0, 1.0,   0.0,      1.0)
-        );
-        break;
-    case TUNING:
-        open303Core.setTuning(
-            linToLin(value, 0.0, 1.0,  400.0,    480.0)
-        );
-        break;
-    case CUTOFF:
-        open303Core.setCutoff(
-            linToExp(value, 0.0, 1.0, 314.0,    2394.0)
-        );
-        break;
-    case RESONANCE:
-        open303Core.setResonance(
-            linToLin(value, 0.0, 1.0,   0.0,    100.0)
-        );
-        break;
-    case ENVMOD:
-        open303Core.setEnvMod(
-            linToLin(value, 0.0, 1.0,    0.0,   100.0)
-        );
-        break;
-    case DECAY:
-        open303Core.setDecay(
-            linToExp(value, 0.0, 1.0,  decayMin,  decayMax)
-        );
-        break;
-    case ACCENT:
-        open303Core.setAccent(
-            linToLin(value, 0.0, 1.0,   0.0,    100.0)
-        );
-        break;
-    case VOLUME:
-        open303Core.setVolume(
-            linToLin(value, 0.0, 1.0, -60.0,      0.0)
-        );
-        break;
-
-    // Overdrive - By GuitarML BYOD implementation
-    case OVERDRIVE_LEVEL:
-        // conditioned param or gain if model is not conditioned
-        guitarML.setDriver(value);
-        break;
-    case OVERDRIVE_DRY_WET:
-        overdriveMix.setWetMixProportion(value);
-        break;
-    case OVERDRIVE_MODEL_INDEX:
-        // load new model
-        //guitarML.loadModel(value);
-        guitarML.loadUserModel(value);
-        break;
-
-    //
-    // MODS (mostly based on devilfish mod)
-    // BUT DONT! dont expect a devilfish clone sound or mail me about!
-    // https://www.firstpr.com.au/rwi/dfish/Devil-Fish-Manual.pdf
-    //
-    case NORMAL_DECAY:
-        /*
-        On non-accented notes, the TB-303’s Main Envelope Generator (MEG) had a decay time
-        between 200 ms and 2 seconds – as controlled by the Decay pot. On accented notes, the
-        decay time was fixed to 200 ms. In the Devil Fish, there are two new pots for MEG decay –
-        Normal Decay and Accent Decay. Both have a range between 30 ms and 3 seconds.
-        */
-        open303Core.setAmpDecay(
-            linToLin(value, 0.0, 1.0, 30.0,      3000.0)
-        );
-        break;
-    case ACCENT_DECAY:
-        // setAmpDecay 16 > 3000
-        open303Core.setAccentDecay(
-            linToLin(value, 0.0, 1.0, 30.0,      3000.0)
-        );
-        break;
-    case FEEDBACK_HPF:
-        // this one is expresive only on higher reesonances
-        open303Core.setFeedbackHighpass(
-            //linToExp(value, 0.0, 1.0,  10.0,    500.0)
-            linToExp(value, 0.0, 1.0,  350.0,    100.0)
-        );
-        break;
-    case SOFT_ATTACK:
-        /*
-        The Soft Attack pot varies the attack time of non-accented notes between 0.3 ms and 30 ms.
-        In the TB-303 there was a (typical) 4 ms delay and then a 3 ms attack time.
-        */
-        open303Core.setNormalAttack(
-            linToExp(value, 0.0, 1.0,  0.3,    3000.0)
-        );
-        break;
-    case SLIDE_TIME:
-        /*
-        The Slide Time pot. Normally the slide time is 60 ms (milliseconds). In the Devil Fish, the
-        Slide Time pot varies the time from 60 to 360 ms, when running from the internal sequencer.
-        When running from an external CV, the time is between 2 and 300 ms.
-        */
-        open303Core.setSlideTime(
-            //linToLin(value, 0.0, 1.0, 0.0, 60.0)
-            linToLin(value, 0.0, 1.0, 2.0, 360.0)
-        );
-        break;
-    case TANH_SHAPER_DRIVE:
-        open303Core.setTanhShaperDrive(
-            //linToLin(value, 0.0, 1.0,   0.0,     60.0)
-            linToLin(value, 0.0, 1.0,   25.0,     80.0)
-            //linToLin(value, 0.0, 1.0,   36.9,     90.0)
-        );
-        break;
-	}
-}
-
-// toogle/restore 303 original and mod modes
-void JC303::setDevilMod(bool mode)
-{
-    if (mode == true) {
-        // fixed internal tunning, mostly based on devil fish
-        // setAccentAttack(3) 3ms devil vs ?? original
-        ////open303Core.setAccentAttack(3.0);
-        // devilfish extended decay range
-        decayMin = 30.0;
-        decayMax = 3000.0;
-        setParameter(NORMAL_DECAY, *normalDecay);
-        setParameter(ACCENT_DECAY, *accentDecay);
-        setParameter(FEEDBACK_HPF, *feedbackFilter);
-        setParameter(SOFT_ATTACK, *softAttack);
-        setParameter(SLIDE_TIME, *slideTime);
-        setParameter(TANH_SHAPER_DRIVE, *sqrDriver);
-    } else if (mode == false) {
-        // restore original 303 values and block devilfish mod knobs to operate
-        // original tb303 decay range
-        decayMin = 200.0;
-        decayMax = 2000.0;
-        // NORMAL_DECAY
-        open303Core.setAmpDecay(1230.0);
-        // ACCENT_DECAY
-        open303Core.setAccentDecay(200.0);
-        // FEEDBACK_HPF
-        open303Core.setFeedbackHighpass(150.0);
-        // SOFT_ATTACK
-        open303Core.setNormalAttack(3.0);
-        // SLIDE_TIME
-        open303Core.setSlideTime(60.0); // 60.0;
-        // TANH_SHAPER_DRIVE
-        open303Core.setTanhShaperDrive(36.9); // dB2amp(36.9);
-        //open303Core.setAmpSustain(-6.02); // dB2amp(newSustain) = 0.5 ~ -6.0205 or -8.68589?
-        //open303Core.setAmpRelease(1.0); // 1.0
-        // fixed parameters restore
-        ////open303Core.setAccentAttack(3.0); // 3.0?
+void JC303::followOverdriveModelFiles()
+{
+    const auto folder = overdriveModelLibrary->getFolder();
+    for (int i = 0; i < numLines; i++)
+    {
+        juce::String modelFile;
+        {
+            const juce::ScopedLock modelFilesScope(overdriveModelFilesLock);
+            modelFile = overdriveModelFiles[(size_t) i];
+        }
+        // a model that has been removed leaves the index where it is
+        const auto libraryIndex = modelFile.isEmpty() ? -1 : overdriveModelLibrary->indexOf(folder.getChildFile(modelFile));
+        if (libraryIndex < 0)
+            continue;
+
+        auto* parameter = parameters.getParameter(getLineParameterPrefix(i) + open303ParameterIDs[OVERDRIVE_MODEL_INDEX]);
+        const auto modelIndex = RONNTags::numBuiltInModels + libraryIndex;
+        if (juce::roundToInt(parameter->convertFrom0to1(parameter->getValue())) != modelIndex)
+            parameter->setValueNotifyingHost(parameter->convertTo0to1((float) modelIndex));
     }
 }
 
+void JC303::rememberOverdriveModelFile(int lineIndex, int modelIndex)
+{
+    // a user model index the library doesn't know (yet) keeps the file that was selected before
+    juce::String modelFile;
+    if (modelIndex >= RONNTags::numBuiltInModels)
+    {
+        const auto entry = overdriveModelLibrary->getEntry(modelIndex - RONNTags::numBuiltInModels);
+        if (! entry.has_value())
+            return;
+        modelFile = entry->file.getRelativePathFrom(overdriveModelLibrary->getFolder());
+    }
+
+    const juce::ScopedLock modelFilesScope(overdriveModelFilesLock);
+    overdriveModelFiles[(size_t) lineIndex] = modelFile;
+}
+
 //==============================================================================
 const juce::String JC303::getName() const
 {
@@ -495,13 +423,18 @@ void JC303::changeProgramName (int index, const juce::String& newName)
 //==============================================================================
 void JC303::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // init open303
-    open303Core.setSampleRate(sampleRate);
-    // init guitarML
-    guitarML.prepareProcessing(sampleRate, samplesPerBlock);
-    // init overdrive dry/wet processor
-    overdriveMix.prepare ({ sampleRate, (uint32_t) samplesPerBlock, 2 });
-    overdriveMix.setMixingRule (juce::dsp::DryWetMixingRule::sin3dB);
+    const juce::ScopedLock lineCreationScope(lineCreationLock);
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+
+    const auto numLinesToPrepare = numCreatedLines.load();
+    for (int i = 0; i < numLinesToPrepare; i++)
+    {
+        lines[(size_t) i]->prepareToPlay(sampleRate, samplesPerBlock);
+        // rack mode renders each line into its own mono buffer
+        lineBuffers[(size_t) i].setSize(1, samplesPerBlock);
+    }
+    updateLatency();
 }
 
 void JC303::releaseResources()
@@ -524,6 +457,16 @@ bool JC303::isBusesLayoutSupported (const BusesLayout& layouts) const
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
+    // the rack's line outputs can be disabled, mono or stereo
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        const auto& channelSet = layouts.outputBuses.getReference(bus);
+        if (! channelSet.isDisabled()
+         && channelSet != juce::AudioChannelSet::mono()
+         && channelSet != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
@@ -534,19 +477,10 @@ bool JC303::isBusesLayoutSupported (const BusesLayout& layouts) const
   #endif
 }
 
-void JC303::render303(juce::AudioBuffer<float>& buffer, int beginSample, int endSample)
-{
-    auto* monoChannel = buffer.getWritePointer(0);
-    for (auto sample = beginSample; sample < endSample; ++sample)
-        // processing open303
-        monoChannel[sample] = (float) open303Core.getSample();
-}
-
 void JC303::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
-    auto currentSample = 0;
     const auto numSamples = buffer.getNumSamples();
     
     // clear buffer
@@ -555,102 +489,120 @@ void JC303::processBlock (juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, numSamples);
 
-    // handle MIDI messages
-    for (const auto midiMetadata : midiMessages)
+    // switching the mode hands the notes over to other lines, so silence the old ones - the first
+    // line keeps playing all channels until the lines of the rack exist
+    const bool rackModeOn = rackMode != nullptr && *rackMode > 0.5f && numCreatedLines.load() == numLines;
+    if (rackModeOn != rackModeActive)
     {
-        const auto message = midiMetadata.getMessage();
-        const auto samplePosition = midiMetadata.samplePosition;
-        
-        // validate sample position
-        if (samplePosition < currentSample || samplePosition >= numSamples)
-            continue;
+        for (auto& line : lines)
+            line->open303Core.allNotesOff();
+        rackModeActive = rackModeOn;
+    }
 
-        // render audio up to this MIDI event
-        render303(buffer, currentSample, samplePosition);
+    if (! rackModeOn)
+    {
+        // the first line plays all MIDI channels
+        auto mainBuffer = getBusBuffer(buffer, false, 0);
+        lines[0]->processBlock(mainBuffer, midiMessages, 0);
+
+        // copy mono channel to stereo
+        for (int ch = 1; ch < mainBuffer.getNumChannels(); ++ch)
+            mainBuffer.copyFrom(ch, 0, mainBuffer, 0, 0, numSamples);
+        return;
+    }
 
-        // process MIDI event
-        if (message.isNoteOn())
-        {
-            open303Core.noteOn(message.getNoteNumber(), message.getVelocity(), 0);
-        }
-        else if (message.isNoteOff())
+    // rack mode: lines that never played a note just output silence, so only the others are
+    // rendered - in parallel, each into its own buffer
+    auto numActiveLines = 0;
+    for (int i = 0; i < numLines; i++)
+    {
+        auto& line = *lines[(size_t) i];
+        auto hasEvents = false;
+        for (const auto midiMetadata : midiMessages)
+            hasEvents = hasEvents || midiMetadata.getMessage().isForChannel(i + 1);
+        if (! line.isIdle() || hasEvents)
         {
-            open303Core.noteOn(message.getNoteNumber(), 0, 0);
+            lineBuffers[(size_t) i].setSize(1, numSamples, false, false, true);
+            activeLines[(size_t) numActiveLines++] = i;
         }
-        else if (message.isAllNotesOff())
+    }
+    rackMidiMessages = &midiMessages;
+    workerPool->run(numActiveLines);
+    rackMidiMessages = nullptr;
+
+    // the overdrives of lines running the same model step together, which loads the weights of
+    // the model once per sample for the whole batch. Only the lines of this instance can batch:
+    // other plugin instances run from their own host callbacks, possibly on other threads and at
+    // other times, and waiting for them in here would stall the audio thread.
+    std::array<const void*, numLines> batchKeys {};
+    auto numOverdriveBatches = 0;
+    for (int j = 0; j < numActiveLines; j++)
+    {
+        const auto i = activeLines[(size_t) j];
+        auto& line = *lines[(size_t) i];
+        if (! line.isOverdriveActive())
+            continue;
+
+        const auto* batchKey = line.guitarML.getBatchKey();
+        auto batch = 0;
+        while (batch < numOverdriveBatches
+               && (batchKey == nullptr || batchKeys[(size_t) batch] != batchKey
+                   || overdriveBatchSizes[(size_t) batch] == GuitarMLAmp::maxBatchSize))
+            batch++;
+        if (batch == numOverdriveBatches)
         {
-            for (int i = 0; i <= 127; i++)
-                open303Core.noteOn(i, 0, 0);
+            batchKeys[(size_t) batch] = batchKey;
+            overdriveBatchSizes[(size_t) batch] = 0;
+            numOverdriveBatches++;
         }
-
-        currentSample = samplePosition;
+        overdriveBatches[(size_t) batch][(size_t) overdriveBatchSizes[(size_t) batch]++] = i;
     }
+    rackPhase = RackPhase::processOverdrives;
+    workerPool->run(numOverdriveBatches);
+    rackPhase = RackPhase::renderLines;
 
-    // render remaining samples
-    render303(buffer, currentSample, numSamples);
-
-    // render GuitarML overdrive
-    if (*switchOverdriveState) {
-        // preparing dry/wet signal
-        overdriveMix.pushDrySamples(buffer);
-        // processing distortion: guitarML - from BYOD
-        guitarML.processAudioBlock(buffer);
-        // processing dry/wet signal
-        overdriveMix.mixWetSamples(buffer);
+    // each line goes to its own output when that is enabled, otherwise to the main output
+    for (int j = 0; j < numActiveLines; j++)
+    {
+        const auto i = activeLines[(size_t) j];
+        lines[(size_t) i]->alignLatency(lineBuffers[(size_t) i]);
+        auto* lineBus = i > 0 ? getBus(false, i) : nullptr;
+        auto target = getBusBuffer(buffer, false, lineBus != nullptr && lineBus->isEnabled() ? i : 0);
+        for (int ch = 0; ch < target.getNumChannels(); ++ch)
+            target.addFrom(ch, 0, lineBuffers[(size_t) i], 0, 0, numSamples);
     }
-
-    // copy mono channel to stereo
-    for (int ch = 1; ch < buffer.getNumChannels(); ++ch)
-        buffer.copyFrom(ch, 0, buffer, 0, 0, numSamples);
 }
 
-int JC303::loadOverdriveTones()
+void JC303::runJob(int jobIndex)
 {
-    setupDataDirectories();
-    if (userAppDataDirectory_tones.isDirectory())
+    juce::ScopedNoDenormals noDenormals;
+    if (rackPhase == RackPhase::processOverdrives)
     {
-        juce::Array<juce::File> results;
-        juce::Array<juce::File> modelFileList;
-        juce::StringArray modelListNames;
-        userAppDataDirectory_tones.findChildFiles(results, juce::File::findFiles, true, "*.json");
-        // TODO: sort by 1.file name and 2.fodler name alphabetically
-        for (int i = 0; i < results.size(); i++) {
-            modelFileList.add(results.getReference(i).getFullPathName());
-            // Get the file name without extension
-            juce::String fileName = modelFileList[i].getFileNameWithoutExtension();
-            // Replace underscores with spaces
-            fileName = fileName.replace("_", " ");
-            // Add the modified file name to modelListNames
-            modelListNames.add(fileName);
-        }
-        guitarML.setModelList(modelFileList, modelListNames);
-        return guitarML.getModelListSize();
+        runOverdriveBatch(jobIndex);
+        return;
     }
-    return 1; // to avoid -1 at overdrive indexes startup
+
+    const auto i = activeLines[(size_t) jobIndex];
+    lineBuffers[(size_t) i].clear();
+    lines[(size_t) i]->renderBlock(lineBuffers[(size_t) i], *rackMidiMessages, i + 1);
 }
 
-void JC303::setupDataDirectories()
+void JC303::runOverdriveBatch(int batchIndex)
 {
-    // User app data directory
-    File userAppDataTempFile = userAppDataDirectory.getChildFile("tmp.pdl");
-
-    File userAppDataTempFile_tones = userAppDataDirectory_tones.getChildFile("tmp.pdl");
+    const auto& batch = overdriveBatches[(size_t) batchIndex];
+    const auto batchSize = (size_t) overdriveBatchSizes[(size_t) batchIndex];
 
-    // Create (and delete) temp file if necessary, so that user doesn't have
-    // to manually create directories
-    if (!userAppDataDirectory.exists()) {
-        userAppDataTempFile.create();
-    }
-    if (userAppDataTempFile.existsAsFile()) {
-        userAppDataTempFile.deleteFile();
+    std::array<GuitarMLAmp*, GuitarMLAmp::maxBatchSize> amps {};
+    std::array<juce::AudioBuffer<float>*, GuitarMLAmp::maxBatchSize> buffers {};
+    for (size_t b = 0; b < batchSize; b++)
+    {
+        amps[b] = &lines[(size_t) batch[b]]->guitarML;
+        buffers[b] = &lineBuffers[(size_t) batch[b]];
     }
+    GuitarMLAmp::processAudioBatch({ amps.data(), batchSize }, { buffers.data(), batchSize });
 
-    if (!userAppDataDirectory_tones.exists()) {
-        userAppDataTempFile_tones.create();
-    }
-    if (userAppDataTempFile_tones.existsAsFile()) {
-        userAppDataTempFile_tones.deleteFile();
-    }
+    for (size_t b = 0; b < batchSize; b++)
+        lines[(size_t) batch[b]]->mixOverdrive(*buffers[b]);
 }
 
 void JC303::installTones()
@@ -718,6 +670,19 @@ void JC303::getStateInformation (juce::MemoryBlock& destData)
 {
     // for host save functionality
     auto state = parameters.copyState();
+    {
+        // the user overdrive models by file as well, the index alone may select another one by
+        // the time the state is loaded
+        const juce::ScopedLock modelFilesScope(overdriveModelFilesLock);
+        for (int i = 0; i < numLines; i++)
+        {
+            const auto property = getLineParameterPrefix(i) + overdriveModelFileProperty;
+            if (overdriveModelFiles[(size_t) i].isNotEmpty())
+                state.setProperty(property, overdriveModelFiles[(size_t) i], nullptr);
+            else
+                state.removeProperty(property, nullptr);
+        }
+    }
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -728,7 +693,24 @@ void JC303::setStateInformation (const void* data, int sizeInBytes)
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName (parameters.state.getType()))
-            parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
+        {
+            const auto state = juce::ValueTree::fromXml (*xmlState);
+            parameters.replaceState (state);
+
+            // the index parameters go to the user models saved by file, now or once the library
+            // has indexed the folder (states saved without the files keep the indices)
+            {
+                const juce::ScopedLock modelFilesScope(overdriveModelFilesLock);
+                for (int i = 0; i < numLines; i++)
+                {
+                    const auto property = getLineParameterPrefix(i) + overdriveModelFileProperty;
+                    if (state.hasProperty(property))
+                        overdriveModelFiles[(size_t) i] = state.getProperty(property).toString();
+                }
+            }
+            if (overdriveModelLibrary->isIndexed())
+                followOverdriveModelFiles();
+        }
 }
 
 //==============================================================================
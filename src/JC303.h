@@ -2,43 +2,16 @@
 
 #include <JuceHeader.h>
 
-// Open303
-#include "dsp/open303/rosic_Open303.h"
-using namespace rosic;
-
-// GuitarML BYOD implementation
-#include "dsp/guitarml-byod/processors/drive/GuitarMLAmp.h"
-
-enum Open303Parameters
-{
-  WAVEFORM = 0,
-  TUNING,
-  CUTOFF,
-  RESONANCE,
-  ENVMOD,
-  DECAY,
-  ACCENT,
-  VOLUME,
-  // MODs
-  SWITCH_MOD,
-  NORMAL_DECAY,
-  ACCENT_DECAY,
-  FEEDBACK_HPF,
-  SOFT_ATTACK,
-  SLIDE_TIME,
-  TANH_SHAPER_DRIVE,
-  // Overdrive
-  OVERDRIVE_SWITCH,
-  OVERDRIVE_LEVEL,
-  OVERDRIVE_DRY_WET,
-  OVERDRIVE_MODEL_INDEX,
-
-  OPEN303_NUM_PARAMETERS
-};
+// one Open303 voice with its overdrive
+#include "JC303Line.h"
+#include "RackWorkerPool.h"
 
 //==============================================================================
 class JC303  :  public juce::AudioProcessor,
-                public juce::AudioProcessorValueTreeState::Listener
+                public juce::AudioProcessorValueTreeState::Listener,
+                private juce::Timer,
+                private juce::ChangeListener,
+                private RackWorkerPool::Client
 {
 public:
     //==============================================================================
@@ -54,8 +27,6 @@ public:
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
     using AudioProcessor::processBlock;
 
-    void setDevilMod(bool mode);
-
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -82,54 +53,90 @@ public:
     //==============================================================================
     void parameterChanged(const juce::String& parameterID, float newValue) override;
 
-    juce::StringArray getModelListNames() { return guitarML.getModelListNames(); }
+    juce::StringArray getModelListNames() { return lines[0]->guitarML.getModelListNames(); }
+    ModelLibrary& getOverdriveModelLibrary() { return *overdriveModelLibrary; }
+
+    // the overdrive model index parameter leaves room for this many user models, so its range
+    // doesn't depend on the models folder (the library indexes it after the parameters exist)
+    static constexpr int maxUserOverdriveModels = 1024;
+
+    // in rack mode, every MIDI channel plays its own line with its own parameters (builds with
+    // JC303_RACK_MODE only, see CMakeLists.txt)
+   #if JC303_RACK_MODE
+    static constexpr int numLines = 16;
+   #else
+    static constexpr int numLines = 1;
+   #endif
 
 private:
-    void render303(juce::AudioBuffer<float>& buffer, int beginSample, int endSample);
-    void setParameter (Open303Parameters index, float value);
+    static BusesProperties createBusesProperties();
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    static juce::String getLineParameterPrefix(int lineIndex);
+
+    // creates the lines of the rack and its workers the first time rack mode is switched on, so
+    // an instance not using it holds a single line (message thread)
+    void createRackLines();
+
+    // renders one line of the rack into its own buffer, or runs one batch of overdrives (called
+    // from the worker pool)
+    void runJob(int jobIndex) override;
+    void runOverdriveBatch(int batchIndex);
+
+    // creates the rack lines and applies the settings that are too heavy for the audio thread
+    void timerCallback() override;
+
+    // reports the delay of the resampled overdrive models to the host
+    void updateLatency();
+
+    // the overdrive model index parameters follow the user models they select by file when the
+    // models folder changes (message thread), see overdriveModelFiles
+    void changeListenerCallback(juce::ChangeBroadcaster*) override;
+    void followOverdriveModelFiles();
+    void rememberOverdriveModelFile(int lineIndex, int modelIndex);
 
     // presets and overdrive models user data management
-    void setupDataDirectories();
     void installTones();
-    int loadOverdriveTones();
 
-    // embedded core dsp objects
-    // Open303
-    Open303 open303Core;
-    // GuitarML - BYOD
-    GuitarMLAmp guitarML;
-    juce::dsp::DryWetMixer<float> overdriveMix;
+    // embedded core dsp objects: the first line plays all channels unless rack mode is on, the
+    // lines [0, numCreatedLines) exist and have their parameters attached
+    std::array<std::unique_ptr<JC303Line>, numLines> lines;
+    std::atomic<int> numCreatedLines { 0 };
+    // held while the lines are created or prepared, which both happen off the audio thread
+    juce::CriticalSection lineCreationLock;
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
 
     // presets storage: user documents folder
     File userAppDataDirectory = File::getSpecialLocation(File::userDocumentsDirectory).getChildFile(JucePlugin_Manufacturer).getChildFile(JucePlugin_Name);
     File userAppDataDirectory_tones = userAppDataDirectory.getFullPathName() + "/overdrive_models";
+    // one index of the user overdrive models for all the instances of the process
+    juce::SharedResourcePointer<ModelLibrary> overdriveModelLibrary;
+    // the user overdrive model of each line, relative to the models folder (empty for the built-in
+    // ones): the index of a user model moves when files are added to the folder, so the state
+    // keeps the file along with the index
+    static constexpr const char* overdriveModelFileProperty = "overdriveModelFile";
+    juce::CriticalSection overdriveModelFilesLock;
+    std::array<juce::String, numLines> overdriveModelFiles;
 
     //==============================================================================
     juce::AudioProcessorValueTreeState parameters;
-    std::atomic<float>* waveForm = nullptr;
-    std::atomic<float>* tuning = nullptr;
-    std::atomic<float>* cutoffFreq = nullptr;
-    std::atomic<float>* resonance = nullptr;
-    std::atomic<float>* envelopMod = nullptr;
-    std::atomic<float>* decay = nullptr;
-    std::atomic<float>* accent = nullptr;
-    std::atomic<float>* volume = nullptr;
-    // MODs
-    std::atomic<float>* switchModState = nullptr;
-    std::atomic<float>* normalDecay = nullptr;
-    std::atomic<float>* accentDecay = nullptr;
-    std::atomic<float>* feedbackFilter = nullptr;
-    std::atomic<float>* softAttack = nullptr;
-    std::atomic<float>* slideTime = nullptr;
-    std::atomic<float>* sqrDriver = nullptr;
-    // overdrive
-    std::atomic<float>* overdriveModelIndex = nullptr;
-    std::atomic<float>* switchOverdriveState = nullptr;
-    std::atomic<float>* overdriveLevel = nullptr;
-    std::atomic<float>* overdriveDryWet = nullptr;
-
-    double decayMin = 200;
-    double decayMax = 2000;
+    std::atomic<float>* rackMode = nullptr;
+    std::atomic<float>* overdriveNativeRate = nullptr;
+    std::atomic<float>* loopCache = nullptr;
+    bool rackModeActive = false;
+
+    // rack mode rendering
+    std::array<juce::AudioBuffer<float>, numLines> lineBuffers;
+    std::array<int, numLines> activeLines {};
+    const juce::MidiBuffer* rackMidiMessages = nullptr;
+
+    // the lines are rendered first, then the overdrives of the lines running the same model
+    // process in batches of up to GuitarMLAmp::maxBatchSize
+    enum class RackPhase { renderLines, processOverdrives };
+    RackPhase rackPhase = RackPhase::renderLines;
+    std::array<std::array<int, GuitarMLAmp::maxBatchSize>, numLines> overdriveBatches {};
+    std::array<int, numLines> overdriveBatchSizes {};
+    std::unique_ptr<RackWorkerPool> workerPool;
 
     // Flag to track if any parameter has changed
     std::atomic<bool> parametersNeedUpdate { false };
@@ -0,0 +1,344 @@
+#include "JC303Line.h"
+
+//==============================================================================
+void JC303Line::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // init open303
+    open303Core.setSampleRate(sampleRate);
+    // init guitarML
+    guitarML.prepareProcessing(sampleRate, samplesPerBlock);
+    // init overdrive dry/wet processor
+    overdriveMix.prepare ({ sampleRate, (uint32_t) samplesPerBlock, 2 });
+    overdriveMix.setMixingRule (juce::dsp::DryWetMixingRule::sin3dB);
+    // init the delay of the line output
+    outputDelay.prepare ({ sampleRate, (uint32_t) samplesPerBlock, 1 });
+}
+
+void JC303Line::attachParameters (juce::AudioProcessorValueTreeState& parameters, const juce::String& idPrefix)
+{
+    // assign a pointer to use it around for each parameter
+    for (int i = 0; i < OPEN303_NUM_PARAMETERS; i++)
+        values[(size_t) i] = parameters.getRawParameterValue(idPrefix + open303ParameterIDs[i]);
+
+    // keep the values applied here, see applyChangedParameters
+    for (int i = 0; i < OPEN303_NUM_PARAMETERS; i++)
+        attachedValues[(size_t) i] = *values[(size_t) i];
+
+    // force initial user values(some hosts migth not do it using value tree state)
+    setParameter(WAVEFORM, *values[WAVEFORM]);
+    setParameter(TUNING, *values[TUNING]);
+    setParameter(CUTOFF, *values[CUTOFF]);
+    setParameter(RESONANCE, *values[RESONANCE]);
+    setParameter(ENVMOD, *values[ENVMOD]);
+    setParameter(DECAY, *values[DECAY]);
+    setParameter(ACCENT, *values[ACCENT]);
+    setParameter(VOLUME, *values[VOLUME]);
+    setDevilMod(*values[SWITCH_MOD]);
+    setParameter(NORMAL_DECAY, *values[NORMAL_DECAY]);
+    setParameter(ACCENT_DECAY, *values[ACCENT_DECAY]);
+    setParameter(FEEDBACK_HPF, *values[FEEDBACK_HPF]);
+    setParameter(SOFT_ATTACK, *values[SOFT_ATTACK]);
+    setParameter(SLIDE_TIME, *values[SLIDE_TIME]);
+    setParameter(TANH_SHAPER_DRIVE, *values[TANH_SHAPER_DRIVE]);
+    setParameter(OVERDRIVE_LEVEL, *values[OVERDRIVE_LEVEL]);
+    setParameter(OVERDRIVE_DRY_WET, *values[OVERDRIVE_DRY_WET]);
+    setParameter(OVERDRIVE_MODEL_INDEX, *values[OVERDRIVE_MODEL_INDEX]);
+    setParameter(FILTER_MODE, *values[FILTER_MODE]);
+}
+
+void JC303Line::applyChangedParameters()
+{
+    for (int i = 0; i < OPEN303_NUM_PARAMETERS; i++)
+    {
+        const float value = *values[(size_t) i];
+        if (value != attachedValues[(size_t) i])
+            parameterChanged((Open303Parameters) i, value);
+    }
+}
+
+void JC303Line::parameterChanged (Open303Parameters index, float value)
+{
+    switch (index)
+    {
+    case SWITCH_MOD:
+        setDevilMod(value > 0.5f);
+        break;
+    // mods only operate when the switch is on
+    case NORMAL_DECAY:
+    case ACCENT_DECAY:
+    case FEEDBACK_HPF:
+    case SOFT_ATTACK:
+    case SLIDE_TIME:
+    case TANH_SHAPER_DRIVE:
+        if (getParameterValue(SWITCH_MOD) > 0.5f)
+            setParameter(index, value);
+        break;
+    // read directly in renderBlock
+    case OVERDRIVE_SWITCH:
+        break;
+    default:
+        setParameter(index, value);
+        break;
+    }
+}
+
+void JC303Line::setParameter (Open303Parameters index, float value)
+{
+  if( index < 0 || index >= OPEN303_NUM_PARAMETERS )
+    return;
+
+	switch(index)
+	{
+    case WAVEFORM:
+        open303Core.setWaveform(
+            linToLin(value, 0.0, 1.0,   0.0,      1.0)
+        );
+        break;
+    case TUNING:
+        open303Core.setTuning(
+            linToLin(value, 0.0, 1.0,  400.0,    480.0)
+        );
+        break;
+    case CUTOFF:
+        open303Core.setCutoff(
+            linToExp(value, 0.0, 1.0, 314.0,    2394.0)
+        );
+        break;
+    case RESONANCE:
+        open303Core.setResonance(
+            linToLin(value, 0.0, 1.0,   0.0,    100.0)
+        );
+        break;
+    case ENVMOD:
+        open303Core.setEnvMod(
+            linToLin(value, 0.0, 1.0,    0.0,   100.0)
+        );
+        break;
+    case DECAY:
+        open303Core.setDecay(
+            linToExp(value, 0.0, 1.0,  decayMin,  decayMax)
+        );
+        break;
+    case ACCENT:
+        open303Core.setAccent(
+            linToLin(value, 0.0, 1.0,   0.0,    100.0)
+        );
+        break;
+    case VOLUME:
+        open303Core.setVolume(
+            linToLin(value, 0.0, 1.0, -60.0,      0.0)
+        );
+        break;
+
+    // Overdrive - By GuitarML BYOD implementation
+    case OVERDRIVE_LEVEL:
+        // conditioned param or gain if model is not conditioned
+        guitarML.setDriver(value);
+        break;
+    case OVERDRIVE_DRY_WET:
+        overdriveMix.setWetMixProportion(value);
+        break;
+    case OVERDRIVE_MODEL_INDEX:
+        // load new model
+        //guitarML.loadModel(value);
+        guitarML.loadUserModel(value);
+        break;
+
+    // Filter - each mode runs its own specialised voice loop, see Open303::setFilterMode
+    case FILTER_MODE:
+        open303Core.setFilterMode(juce::roundToInt(value));
+        break;
+
+    //
+    // MODS (mostly based on devilfish mod)
+    // BUT DONT! dont expect a devilfish clone sound or mail me about!
+    // https://www.firstpr.com.au/rwi/dfish/Devil-Fish-Manual.pdf
+    //
+    case NORMAL_DECAY:
+        /*
+        On non-accented notes, the TB-303’s Main Envelope Generator (MEG) had a decay time
+        between 200 ms and 2 seconds – as controlled by the Decay pot. On accented notes, the
+        decay time was fixed to 200 ms. In the Devil Fish, there are two new pots for MEG decay –
+        Normal Decay and Accent Decay. Both have a range between 30 ms and 3 seconds.
+        */
+        open303Core.setAmpDecay(
+            linToLin(value, 0.0, 1.0, 30.0,      3000.0)
+        );
+        break;
+    case ACCENT_DECAY:
+        // setAmpDecay 16 > 3000
+        open303Core.setAccentDecay(
+            linToLin(value, 0.0, 1.0, 30.0,      3000.0)
+        );
+        break;
+    case FEEDBACK_HPF:
+        // this one is expresive only on higher reesonances
+        open303Core.setFeedbackHighpass(
+            //linToExp(value, 0.0, 1.0,  10.0,    500.0)
+            linToExp(value, 0.0, 1.0,  350.0,    100.0)
+        );
+        break;
+    case SOFT_ATTACK:
+        /*
+        The Soft Attack pot varies the attack time of non-accented notes between 0.3 ms and 30 ms.
+        In the TB-303 there was a (typical) 4 ms delay and then a 3 ms attack time.
+        */
+        open303Core.setNormalAttack(
+            linToExp(value, 0.0, 1.0,  0.3,    3000.0)
+        );
+        break;
+    case SLIDE_TIME:
+        /*
+        The Slide Time pot. Normally the slide time is 60 ms (milliseconds). In the Devil Fish, the
+        Slide Time pot varies the time from 60 to 360 ms, when running from the internal sequencer.
+        When running from an external CV, the time is between 2 and 300 ms.
+        */
+        open303Core.setSlideTime(
+            //linToLin(value, 0.0, 1.0, 0.0, 60.0)
+            linToLin(value, 0.0, 1.0, 2.0, 360.0)
+        );
+        break;
+    case TANH_SHAPER_DRIVE:
+        open303Core.setTanhShaperDrive(
+            //linToLin(value, 0.0, 1.0,   0.0,     60.0)
+            linToLin(value, 0.0, 1.0,   25.0,     80.0)
+            //linToLin(value, 0.0, 1.0,   36.9,     90.0)
+        );
+        break;
+	}
+}
+
+// toogle/restore 303 original and mod modes
+void JC303Line::setDevilMod(bool mode)
+{
+    if (mode == true) {
+        // fixed internal tunning, mostly based on devil fish
+        // setAccentAttack(3) 3ms devil vs ?? original
+        ////open303Core.setAccentAttack(3.0);
+        // devilfish extended decay range
+        decayMin = 30.0;
+        decayMax = 3000.0;
+        setParameter(NORMAL_DECAY, *values[NORMAL_DECAY]);
+        setParameter(ACCENT_DECAY, *values[ACCENT_DECAY]);
+        setParameter(FEEDBACK_HPF, *values[FEEDBACK_HPF]);
+        setParameter(SOFT_ATTACK, *values[SOFT_ATTACK]);
+        setParameter(SLIDE_TIME, *values[SLIDE_TIME]);
+        setParameter(TANH_SHAPER_DRIVE, *values[TANH_SHAPER_DRIVE]);
+    } else if (mode == false) {
+        // restore original 303 values and block devilfish mod knobs to operate
+        // original tb303 decay range
+        decayMin = 200.0;
+        decayMax = 2000.0;
+        // NORMAL_DECAY
+        open303Core.setAmpDecay(1230.0);
+        // ACCENT_DECAY
+        open303Core.setAccentDecay(200.0);
+        // FEEDBACK_HPF
+        open303Core.setFeedbackHighpass(150.0);
+        // SOFT_ATTACK
+        open303Core.setNormalAttack(3.0);
+        // SLIDE_TIME
+        open303Core.setSlideTime(60.0); // 60.0;
+        // TANH_SHAPER_DRIVE
+        open303Core.setTanhShaperDrive(36.9); // dB2amp(36.9);
+        //open303Core.setAmpSustain(-6.02); // dB2amp(newSustain) = 0.5 ~ -6.0205 or -8.68589?
+        //open303Core.setAmpRelease(1.0); // 1.0
+        // fixed parameters restore
+        ////open303Core.setAccentAttack(3.0); // 3.0?
+    }
+}
+
+//==============================================================================
+void JC303Line::render303(juce::AudioBuffer<float>& buffer, int beginSample, int endSample)
+{
+    // processing open303
+    open303Core.processBlock(buffer.getWritePointer(0, beginSample), endSample - beginSample);
+}
+
+void JC303Line::processBlock (juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int midiChannel)
+{
+    renderBlock(buffer, midiMessages, midiChannel);
+
+    // processing distortion: guitarML - from BYOD
+    if (overdriveActive) {
+        guitarML.processAudioBlock(buffer);
+        mixOverdrive(buffer);
+    }
+
+    alignLatency(buffer);
+}
+
+void JC303Line::renderBlock (juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int midiChannel)
+{
+    auto currentSample = 0;
+    const auto numSamples = buffer.getNumSamples();
+
+    // handle MIDI messages
+    for (const auto midiMetadata : midiMessages)
+    {
+        const auto message = midiMetadata.getMessage();
+        const auto samplePosition = midiMetadata.samplePosition;
+
+        // in rack mode, each line only listens to its own channel
+        if (midiChannel > 0 && ! message.isForChannel(midiChannel))
+            continue;
+
+        // validate sample position
+        if (samplePosition < currentSample || samplePosition >= numSamples)
+            continue;
+
+        // render audio up to this MIDI event
+        render303(buffer, currentSample, samplePosition);
+
+        // process MIDI event
+        if (message.isNoteOn())
+        {
+            open303Core.noteOn(message.getNoteNumber(), message.getVelocity(), 0);
+        }
+        else if (message.isNoteOff())
+        {
+            open303Core.noteOn(message.getNoteNumber(), 0, 0);
+        }
+        else if (message.isAllNotesOff())
+        {
+            for (int i = 0; i <= 127; i++)
+                open303Core.noteOn(i, 0, 0);
+        }
+
+        currentSample = samplePosition;
+    }
+
+    // render remaining samples
+    render303(buffer, currentSample, numSamples);
+
+    // render GuitarML overdrive
+    overdriveActive = *values[OVERDRIVE_SWITCH] > 0.5f;
+    if (overdriveActive) {
+        // preparing dry/wet signal, delayed like the wet one
+        overdriveMix.setWetLatency((float) guitarML.getLatencySamples());
+        overdriveMix.pushDrySamples(buffer);
+    }
+}
+
+void JC303Line::mixOverdrive (juce::AudioBuffer<float>& buffer)
+{
+    // processing dry/wet signal
+    overdriveMix.mixWetSamples(buffer);
+}
+
+void JC303Line::alignLatency (juce::AudioBuffer<float>& buffer)
+{
+    // the overdrive delays the line by its own latency, which may be shorter than the reported one
+    const auto overdriveLatency = overdriveActive ? guitarML.getLatencySamples() : 0;
+    const auto delay = juce::jlimit(0, maxOverdriveLatencySamples, outputLatencySamples.load() - overdriveLatency);
+    if (delay == 0 && outputDelay.getDelay() == 0.0f)
+        return;
+
+    outputDelay.setDelay((float) delay);
+    auto* data = buffer.getWritePointer(0);
+    for (int n = 0; n < buffer.getNumSamples(); n++)
+    {
+        outputDelay.pushSample(0, data[n]);
+        data[n] = outputDelay.popSample(0);
+    }
+}
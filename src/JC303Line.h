@@ -0,0 +1,127 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Open303
+#include "dsp/open303/rosic_Open303.h"
+using namespace rosic;
+
+// GuitarML BYOD implementation
+#include "dsp/guitarml-byod/processors/drive/GuitarMLAmp.h"
+
+enum Open303Parameters
+{
+  WAVEFORM = 0,
+  TUNING,
+  CUTOFF,
+  RESONANCE,
+  ENVMOD,
+  DECAY,
+  ACCENT,
+  VOLUME,
+  // MODs
+  SWITCH_MOD,
+  NORMAL_DECAY,
+  ACCENT_DECAY,
+  FEEDBACK_HPF,
+  SOFT_ATTACK,
+  SLIDE_TIME,
+  TANH_SHAPER_DRIVE,
+  // Overdrive
+  OVERDRIVE_SWITCH,
+  OVERDRIVE_LEVEL,
+  OVERDRIVE_DRY_WET,
+  OVERDRIVE_MODEL_INDEX,
+  // Filter
+  FILTER_MODE,
+
+  OPEN303_NUM_PARAMETERS
+};
+
+// parameter ids in the order of Open303Parameters - the lines of the rack prefix them with
+// "line<n>_" from the second line on
+inline const char* const open303ParameterIDs[OPEN303_NUM_PARAMETERS] =
+{
+    "waveform", "tuning", "cutoff", "resonance", "envmod", "decay", "accent", "volume",
+    "switchModState", "normalDecay", "accentDecay", "feedbackFilter", "softAttack", "slideTime",
+    "sqrDriver",
+    "switchOverdriveState", "overdriveLevel", "overdriveDryWet", "overdriveModelIndex",
+    "filterMode"
+};
+
+//==============================================================================
+// One Open303 voice with its own parameter set and optional overdrive. The plugin plays a single
+// line, or one line per MIDI channel in rack mode.
+class JC303Line
+{
+public:
+    //==============================================================================
+    JC303Line() = default;
+
+    // the resampled overdrive models delay the wet signal by up to this many samples (the Lanczos
+    // kernels at 384 kHz against a 44.1 kHz model)
+    static constexpr int maxOverdriveLatencySamples = 128;
+
+    void prepareToPlay (double sampleRate, int samplesPerBlock);
+
+    // looks up the raw values of this line's parameters and applies them to the dsp objects
+    void attachParameters (juce::AudioProcessorValueTreeState& parameters, const juce::String& idPrefix);
+
+    // applies the values that changed since attachParameters - a line created off the audio thread
+    // doesn't get the parameter callbacks yet, so its owner calls this once the line plays
+    void applyChangedParameters();
+
+    // applies a new value of one of this line's parameters, as the parameter callback does
+    void parameterChanged (Open303Parameters index, float value);
+    void setParameter (Open303Parameters index, float value);
+    void setDevilMod (bool mode);
+
+    //==============================================================================
+    // renders the line into the first channel of the buffer (and the overdrive into all of them),
+    // playing the notes of the given MIDI channel - or of all channels when midiChannel is 0
+    void processBlock (juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int midiChannel);
+
+    // processBlock in two halves, such that the rack can run the overdrives of several lines as one
+    // batch in between: the first renders the line and keeps its dry signal when the overdrive is
+    // on, the second mixes the overdriven buffer back with that
+    void renderBlock (juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midiMessages, int midiChannel);
+    void mixOverdrive (juce::AudioBuffer<float>& buffer);
+    bool isOverdriveActive() const { return overdriveActive; }
+
+    // delays the first channel of the finished block such that the line is late by the given
+    // number of samples in total, whether the overdrive is on or not - the plugin reports a
+    // constant latency while the overdrive runs at the model rate
+    void setOutputLatency (int numSamples) { outputLatencySamples = numSamples; }
+    void alignLatency (juce::AudioBuffer<float>& buffer);
+
+    float getParameterValue (Open303Parameters index) const { return *values[(size_t) index]; }
+
+    bool isIdle() const { return open303Core.isIdle(); }
+
+    //==============================================================================
+    // embedded core dsp objects
+    // Open303
+    Open303 open303Core;
+    // GuitarML - BYOD
+    GuitarMLAmp guitarML;
+    juce::dsp::DryWetMixer<float> overdriveMix { maxOverdriveLatencySamples };
+
+private:
+    void render303 (juce::AudioBuffer<float>& buffer, int beginSample, int endSample);
+
+    std::array<std::atomic<float>*, OPEN303_NUM_PARAMETERS> values {};
+    // the values attachParameters applied
+    std::array<float, OPEN303_NUM_PARAMETERS> attachedValues {};
+
+    // the overdrive switch as read by the last renderBlock
+    bool overdriveActive = false;
+
+    std::atomic<int> outputLatencySamples { 0 };
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> outputDelay { maxOverdriveLatencySamples };
+
+    double decayMin = 200;
+    double decayMax = 2000;
+
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JC303Line)
+};
@@ -0,0 +1,89 @@
+#include "RackWorkerPool.h"
+
+//==============================================================================
+RackWorkerPool::Worker::Worker (RackWorkerPool& owner, int index)
+     : juce::Thread ("JC303 rack worker " + juce::String (index + 1)),
+       pool (owner)
+{
+}
+
+void RackWorkerPool::Worker::run()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    while (! threadShouldExit())
+    {
+        wait (-1);
+        pool.runPendingJobs();
+    }
+}
+
+//==============================================================================
+RackWorkerPool::RackWorkerPool (Client& clientToUse, int numWorkers)
+     : client (clientToUse)
+{
+    for (int i = 0; i < numWorkers; i++)
+    {
+        auto* worker = workers.add (new Worker (*this, i));
+        // fall back to a normal thread when the system refuses realtime scheduling
+        if (! worker->startRealtimeThread (juce::Thread::RealtimeOptions{}))
+            worker->startThread (juce::Thread::Priority::highest);
+    }
+}
+
+RackWorkerPool::~RackWorkerPool()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+    for (auto* worker : workers)
+        worker->notify();
+    for (auto* worker : workers)
+        worker->stopThread (1000);
+}
+
+void RackWorkerPool::run (int numJobs)
+{
+    jassert (numJobs >= 0 && numJobs < 0x10000);
+    if (numJobs <= 0)
+        return;
+
+    const auto batch = currentBatch.load (std::memory_order_relaxed) + 1;
+    currentBatch.store (batch, std::memory_order_relaxed);
+    numUnfinishedJobs.store (numJobs);
+    batchState.store ((uint32_t) numJobs << 16);
+
+    // a single job is faster done than a worker is woken up
+    const auto numHelpers = juce::jmin (numJobs - 1, workers.size());
+    for (int i = 0; i < numHelpers; i++)
+        workers.getUnchecked (i)->notify();
+
+    runPendingJobs();
+
+    // the remaining jobs are already running on the workers, so this wait is short
+    while (finishedBatch.load (std::memory_order_acquire) != batch)
+        batchFinished.wait (-1);
+}
+
+void RackWorkerPool::runPendingJobs()
+{
+    auto state = batchState.load();
+    for (;;)
+    {
+        const auto nextJob = (int) (state & 0xffff);
+        const auto numJobs = (int) (state >> 16);
+        if (nextJob >= numJobs)
+            return;
+
+        if (batchState.compare_exchange_weak (state, state + 1))
+        {
+            client.runJob (nextJob);
+            if (numUnfinishedJobs.fetch_sub (1) == 1)
+            {
+                // the caller can't start another batch before it sees this one finished
+                finishedBatch.store (currentBatch.load (std::memory_order_relaxed), std::memory_order_release);
+                batchFinished.signal();
+            }
+            state = batchState.load();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// A small pool of realtime threads that helps the audio thread through a batch of independent
+// jobs (the lines of the rack). All threads, including the caller of run(), claim jobs from one
+// shared counter until none are left, so a worker that wakes up late simply finds nothing to do
+// and the batch never waits on a sleeping thread. Once out of jobs, the caller sleeps until the
+// thread finishing the last one wakes it up.
+class RackWorkerPool
+{
+public:
+    struct Client
+    {
+        virtual ~Client() = default;
+
+        // called concurrently from the audio thread and the workers, each jobIndex exactly once
+        virtual void runJob (int jobIndex) = 0;
+    };
+
+    RackWorkerPool (Client& client, int numWorkers);
+    ~RackWorkerPool();
+
+    // runs the jobs 0...numJobs-1 and returns once all of them are finished
+    void run (int numJobs);
+
+    int getNumWorkers() const { return workers.size(); }
+
+private:
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (RackWorkerPool& owner, int index);
+        void run() override;
+
+    private:
+        RackWorkerPool& pool;
+    };
+
+    // claims and runs jobs of the current batch until there are none left
+    void runPendingJobs();
+
+    Client& client;
+    juce::OwnedArray<Worker> workers;
+
+    // the job counter and the batch size share one word, such that claiming a job can never pick
+    // up a stale batch size: the lower 16 bits hold the next job, the upper ones the number of jobs
+    std::atomic<uint32_t> batchState { 0 };
+    std::atomic<int> numUnfinishedJobs { 0 };
+    // every batch gets a new id, which the thread that finishes its last job publishes before it
+    // signals the event. A late signal of the previous batch can still hit the event after the next
+    // one has started, so the caller only returns once it sees the id of its own batch
+    std::atomic<uint32_t> currentBatch { 0 }, finishedBatch { 0 };
+    juce::WaitableEvent batchFinished;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RackWorkerPool)
+};
@@ -18,15 +18,37 @@ function(make_lib_simd_runtime name)
             message(STATUS "Compiler DOES NOT supports flags: /arch:AVX")
         endif()
     else()
-        CHECK_CXX_COMPILER_FLAG("-mavx -mfma" COMPILER_OPT_ARCH_AVX_SUPPORTED)
+        # every CPU with FMA also has the F16C half float conversions
+        CHECK_CXX_COMPILER_FLAG("-mavx -mfma -mf16c" COMPILER_OPT_ARCH_AVX_SUPPORTED)
         if(COMPILER_OPT_ARCH_AVX_SUPPORTED)
-            message(STATUS "Compiler supports flags: -mavx -mfma")
-            target_compile_options(${name}_avx PRIVATE -mavx -mfma -Wno-unused-command-line-argument)
+            message(STATUS "Compiler supports flags: -mavx -mfma -mf16c")
+            target_compile_options(${name}_avx PRIVATE -mavx -mfma -mf16c -Wno-unused-command-line-argument)
         else()
-            message(STATUS "Compiler DOES NOT supports flags: -mavx -mfma")
+            message(STATUS "Compiler DOES NOT supports flags: -mavx -mfma -mf16c")
+        endif()
+    endif()
+
+    add_library(${name}_avx512 STATIC)
+    target_sources(${name}_avx512 PRIVATE ${ARG_SOURCES})
+    target_compile_definitions(${name}_avx512 PRIVATE BYOD_COMPILING_WITH_AVX512=1)
+    if(WIN32)
+        CHECK_CXX_COMPILER_FLAG("/arch:AVX512" COMPILER_OPT_ARCH_AVX512_SUPPORTED)
+        if(COMPILER_OPT_ARCH_AVX512_SUPPORTED)
+            message(STATUS "Compiler supports flags: /arch:AVX512")
+            target_compile_options(${name}_avx512 PRIVATE /arch:AVX512)
+        else()
+            message(STATUS "Compiler DOES NOT supports flags: /arch:AVX512")
+        endif()
+    else()
+        CHECK_CXX_COMPILER_FLAG("-mavx512f -mavx512vl -mavx512bw -mavx512dq -mfma -mf16c" COMPILER_OPT_ARCH_AVX512_SUPPORTED)
+        if(COMPILER_OPT_ARCH_AVX512_SUPPORTED)
+            message(STATUS "Compiler supports flags: -mavx512f -mavx512vl -mavx512bw -mavx512dq -mfma -mf16c")
+            target_compile_options(${name}_avx512 PRIVATE -mavx512f -mavx512vl -mavx512bw -mavx512dq -mfma -mf16c -Wno-unused-command-line-argument)
+        else()
+            message(STATUS "Compiler DOES NOT supports flags: -mavx512f -mavx512vl -mavx512bw -mavx512dq -mfma -mf16c")
         endif()
     endif()
 
     add_library(${name} INTERFACE)
-    target_link_libraries(${name} INTERFACE ${name}_sse_or_arm ${name}_avx)
+    target_link_libraries(${name} INTERFACE ${name}_sse_or_arm ${name}_avx ${name}_avx512)
 endfunction()
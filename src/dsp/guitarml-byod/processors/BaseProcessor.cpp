@@ -69,6 +69,25 @@ void BaseProcessor::freeInternalMemory()
 }
 
 void BaseProcessor::processAudioBlock (AudioBuffer<float>& buffer)
+{
+    updateInputLevels (buffer);
+
+    /* if (netlistCircuitQuantities != nullptr)
+    {
+        for (auto& quantity : *netlistCircuitQuantities)
+        {
+            if (chowdsp::AtomicHelpers::compareNegate (quantity.needsUpdate))
+                quantity.setter (quantity);
+        }
+    } */
+
+    if (isBypassed())
+        processAudioBypassed (buffer);
+    else
+        processAudio (buffer);
+}
+
+void BaseProcessor::updateInputLevels (const AudioBuffer<float>& buffer)
 {
     auto updateBufferMag = [&] (const AudioBuffer<float>& inBuffer, int inputIndex)
     {
@@ -100,20 +119,6 @@ void BaseProcessor::processAudioBlock (AudioBuffer<float>& buffer)
                 updateBufferMag (getInputBuffer (i), i);
         }
     }
-
-    /* if (netlistCircuitQuantities != nullptr)
-    {
-        for (auto& quantity : *netlistCircuitQuantities)
-        {
-            if (chowdsp::AtomicHelpers::compareNegate (quantity.needsUpdate))
-                quantity.setter (quantity);
-        }
-    } */
-
-    if (isBypassed())
-        processAudioBypassed (buffer);
-    else
-        processAudio (buffer);
 }
 
 float BaseProcessor::getInputLevelDB (int portIndex) const noexcept
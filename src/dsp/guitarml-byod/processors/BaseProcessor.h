@@ -214,6 +214,9 @@ protected:
     /** All multi-input or multi-output modules should override this method! */
     virtual void processAudioBypassed (AudioBuffer<float>& /*buffer*/) { jassert (getNumInputs() <= 1 && getNumOutputs() <= 1); }
 
+    /** Tracks the port input levels, as processAudioBlock does before processing the buffer. */
+    void updateInputLevels (const AudioBuffer<float>& buffer);
+
     /**
      * If a particular parameter should be shown in the module's popup menu
      * rather than the knobs component, then call this method in the module's
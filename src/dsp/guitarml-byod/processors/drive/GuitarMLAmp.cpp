@@ -1,8 +1,64 @@
 #include "GuitarMLAmp.h"
+#include "neural_utils/CompiledModelJson.h"
 /* #include "gui/utils/ErrorMessageView.h"
 #include "gui/utils/ModulatableSlider.h" */
 #include "BinaryDataGuitarMLModels.h"
 
+namespace
+{
+// the built-in models are compiled once, and stay registered once loaded
+ModelRegistry::ModelPtr getBuiltInModel (int modelIndex)
+{
+    static CriticalSection lock;
+    static std::vector<ModelRegistry::ModelPtr> builtInModels ((size_t) RONNTags::numBuiltInModels);
+
+    const ScopedLock sl (lock);
+    auto& model = builtInModels[(size_t) modelIndex];
+    if (model == nullptr)
+    {
+        int modelDataSize = 0;
+        const auto* modelData = BinaryDataGuitarMLModels::getNamedResource (RONNTags::guitarMLModelResources[modelIndex].toRawUTF8(), modelDataSize);
+        jassert (modelData != nullptr);
+
+        const auto compiled = compiled_model::compile (chowdsp::JSONUtils::fromBinaryData (modelData, modelDataSize));
+        model = ModelRegistry::get (compiled.data(), compiled.size());
+    }
+    return model;
+}
+
+// calls back with the alternatives the variants hold, which have to be of the same type
+template <typename Variant, typename Callback>
+void visitBatch (std::span<Variant* const> variants, Callback&& callback)
+{
+    variants[0]->visit ([&] (auto& firstAlternative)
+                        {
+                            using Alternative = std::remove_reference_t<decltype (firstAlternative)>;
+                            std::array<Alternative*, (size_t) GuitarMLAmp::maxBatchSize> alternatives {};
+                            for (size_t b = 0; b < variants.size(); ++b)
+                                variants[b]->visit ([&alternatives, b] (auto& alternative)
+                                                    {
+                                                        if constexpr (std::is_same_v<std::remove_reference_t<decltype (alternative)>, Alternative>)
+                                                            alternatives[b] = &alternative;
+                                                    });
+
+                            callback (std::span<Alternative* const> { alternatives.data(), variants.size() });
+                        });
+}
+
+// all the amps run the same model, so they hold the same architecture, and the same build of it
+// as that only depends on the CPU
+template <typename ModelVariant>
+void processModelBatch (std::span<ModelVariant* const> variants, float* const* data, const float* const* conditions, size_t numSamples)
+{
+    visitBatch (variants, [&] (auto architectureVariants)
+                { visitBatch (architectureVariants, [&] (auto models)
+                              { models[0]->process_batch (models,
+                                                          { data, models.size() },
+                                                          { conditions, models.size() },
+                                                          numSamples,
+                                                          true); }); });
+}
+} // namespace
 
 GuitarMLAmp::GuitarMLAmp (UndoManager* um) : BaseProcessor ("GuitarML", createParameterLayout(), um)
 {
@@ -12,29 +68,25 @@ GuitarMLAmp::GuitarMLAmp (UndoManager* um) : BaseProcessor ("GuitarML", createPa
     loadParameterPointer (sampleRateCorrectionFilterParam, vts, RONNTags::sampleRateCorrFilterTag);
     addPopupMenuParameter (RONNTags::sampleRateCorrFilterTag);
 
+    juce::Logger::writeToLog ("Using RNN models with " + String (rnn_dispatch::getInstructionSetName (rnn_dispatch::getTarget())) + " SIMD instructions");
+    emplaceModels (modelArch);
+
     // model indexing from RONNTags::guitarMLModelResources and RONNTags::guitarMLModelNames
     //loadModel (currentModelIndex);
     loadModel (0);
+    modelLibrary->addChangeListener (this);
 
     /* uiOptions.backgroundColour = Colours::cornsilk.darker();
     uiOptions.powerColour = Colours::cyan;
     uiOptions.info.description = "An implementation of the neural LSTM guitar amp modeller used by the GuitarML project. Supports loading custom models that are compatible with the GuitarML Protues plugin";
     uiOptions.info.authors = StringArray { "Keith Bloemer", "Jatin Chowdhury" };
     uiOptions.info.infoLink = "https://guitarml.com"; */
-
-#if JUCE_INTEL
-    if (juce::SystemStats::hasAVX() && juce::SystemStats::hasFMA3())
-    {
-        juce::Logger::writeToLog ("Using RNN model with AVX SIMD instructions!");
-        lstm40CondModels[0].template emplace<rnn_avx::RNNAccelerated<2, 40, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>>();
-        lstm40CondModels[1].template emplace<rnn_avx::RNNAccelerated<2, 40, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>>();
-        lstm40NoCondModels[0].template emplace<rnn_avx::RNNAccelerated<1, 40, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>>();
-        lstm40NoCondModels[1].template emplace<rnn_avx::RNNAccelerated<1, 40, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>>();
-    }
-#endif
 }
 
-GuitarMLAmp::~GuitarMLAmp() = default;
+GuitarMLAmp::~GuitarMLAmp()
+{
+    modelLibrary->removeChangeListener (this);
+}
 
 ParamLayout GuitarMLAmp::createParameterLayout()
 {
@@ -50,74 +102,109 @@ ParamLayout GuitarMLAmp::createParameterLayout()
 
 void GuitarMLAmp::loadModelFromJson (const chowdsp::json& modelJson, const String& newModelName)
 {
-    const auto& modelDataJson = modelJson.at ("model_data");
-    const auto numInputs = modelDataJson.value ("input_size", 1);
-    const auto hiddenSize = modelDataJson.value ("hidden_size", 0);
-    const auto modelSampleRate = modelDataJson.value ("sample_rate", 44100.0);
+    const auto compiled = compiled_model::compile (modelJson);
+    loadSharedModel (ModelRegistry::get (compiled.data(), compiled.size()),
+                     newModelName.isNotEmpty() ? newModelName : String (modelJson.value (RONNTags::modelNameTag, "")));
+}
+
+void GuitarMLAmp::loadModelFromFile (const File& modelFile)
+{
+    // the library compiles each file once (caching it next to the json) for all the amps
+    loadSharedModel (modelLibrary->getModel (modelFile), modelFile.getFileNameWithoutExtension());
+}
+
+void GuitarMLAmp::loadSharedModel (ModelRegistry::ModelPtr model, const String& newModelName)
+{
+    if (model == nullptr)
+        throw std::exception();
+
+    const auto& weights = model->weights;
+    const auto newModelArch = rnn_dispatch::getArchitecture (weights);
+    if (! rnn_dispatch::isSupported (newModelArch))
+        throw std::runtime_error ("Unsupported model architecture: " + std::to_string (newModelArch.hiddenSize)
+                                  + (newModelArch.layerType == RecurrentLayerType::GRULayer ? " GRU units" : " LSTM units")
+                                  + " with " + std::to_string (newModelArch.inputSize) + " inputs");
+
+    const auto modelSampleRate = weights.sampleRate;
     const auto rnnDelaySamples = jmax (1.0, processSampleRate / modelSampleRate);
+    const auto runAtModelRate = useNativeRate && processSampleRate >= modelSampleRate * 1.1;
 
+    // the resampled models see the signal band-limited to the model rate, so they need no
+    // correction of the high end
     sampleRateCorrectionFilter.reset();
     sampleRateCorrectionFilter.calcCoefs (8100.0f,
                                           chowdsp::CoefficientCalculators::butterworthQ<float>,
-                                          (processSampleRate < modelSampleRate * 1.1) ? 1.0f : 0.25f,
+                                          (processSampleRate < modelSampleRate * 1.1 || runAtModelRate) ? 1.0f : 0.25f,
                                           (float) processSampleRate);
 
-    if (numInputs == 1 && hiddenSize == 40) // non-conditioned LSMT40
+    auto nativeRateLatency = 0;
     {
         SpinLock::ScopedLockType modelChangingLock { modelChangingMutex };
-        for (auto& modelVariant : lstm40NoCondModels)
+        if (newModelArch != modelArch)
+            emplaceModels (newModelArch);
+
+        for (auto& modelVariant : models)
         {
-            modelVariant.visit (
-                [rnnDelaySamples, &modelJson] (auto& model)
-                {
-                    model.initialise (modelJson);
-                    model.prepare ((float) rnnDelaySamples);
-                });
+            modelVariant.visit ([rnnDelaySamples, &weights] (auto& architectureVariant)
+                                { architectureVariant.visit (
+                                      [rnnDelaySamples, &weights] (auto& model)
+                                      {
+                                          model.initialise (weights);
+                                          model.prepare ((float) rnnDelaySamples);
+                                      }); });
         }
-
-        modelArch = ModelArch::LSTM40NoCond;
-    }
-    else if (numInputs == 2 && hiddenSize == 40) // conditioned LSMT40
-    {
-        SpinLock::ScopedLockType modelChangingLock { modelChangingMutex };
-        for (auto& modelVariant : lstm40CondModels)
+        if (runAtModelRate)
         {
-            modelVariant.visit (
-                [rnnDelaySamples, &modelJson] (auto& model)
-                {
-                    model.initialise (modelJson);
-                    model.prepare ((float) rnnDelaySamples);
-                });
+            for (auto& modelVariant : nativeRateModels)
+            {
+                modelVariant.visit (
+                    [this, &weights, &nativeRateLatency] (auto& model)
+                    {
+                        model.initialise (weights);
+                        model.prepare (processSampleRate, processBlockSize, true);
+                        nativeRateLatency = model.getLatencySamples();
+                    });
+            }
         }
-
-        modelArch = ModelArch::LSTM40Cond;
-        conditionParam.reset();
+        nativeRateActive = runAtModelRate;
+        silenceBypass.reset();
+
+        if (isConditioned())
+            conditionParam.reset();
+
+        // the audio thread reads the model under the lock, the old one may only go once it can't
+        // be in use by a block anymore
+        latencySamples = nativeRateLatency;
+        activeWeights = &weights;
+        currentModel = std::move (model);
+        currentModelName = newModelName;
     }
-    else
+
+    modelChangeBroadcaster();
+}
+
+void GuitarMLAmp::emplaceModels (const rnn_dispatch::Architecture& newModelArch)
+{
+    for (auto& modelVariant : models)
     {
-        // unsupported number of inputs!
-        throw std::exception();
+        rnn_dispatch::emplaceArchitecture<GuitarML_RNN> (modelVariant, newModelArch);
+        modelVariant.visit ([] (auto& architectureVariant)
+                            { rnn_dispatch::emplaceModel (architectureVariant); });
     }
+    for (auto& modelVariant : nativeRateModels)
+        rnn_dispatch::emplaceArchitecture<ResampledRNNAccelerated> (modelVariant, newModelArch);
 
-    cachedModel = modelJson;
-    if (newModelName.isNotEmpty())
-        cachedModel[RONNTags::modelNameTag] = newModelName;
-
-    modelChangeBroadcaster();
+    modelArch = newModelArch;
 }
 
 void GuitarMLAmp::loadModel (int modelIndex, Component* parentComponent)
 {
     normalizationGain = 1.0f;
+    currentModelFile = File {};
 
     if (juce::isPositiveAndBelow (modelIndex, RONNTags::numBuiltInModels))
     {
-        int modelDataSize = 0;
-        const auto* modelData = BinaryDataGuitarMLModels::getNamedResource (RONNTags::guitarMLModelResources[modelIndex].toRawUTF8(), modelDataSize);
-        jassert (modelData != nullptr);
-
-        const auto modelJson = chowdsp::JSONUtils::fromBinaryData (modelData, modelDataSize);
-        loadModelFromJson (modelJson, RONNTags::guitarMLModelNames[modelIndex]);
+        loadSharedModel (getBuiltInModel (modelIndex), RONNTags::guitarMLModelNames[modelIndex]);
 
         // The Mesa model is a bit loud, so let's normalize the level down a bit
         // Eventually it would be good to do this sort of thing programmatically.
@@ -156,8 +243,7 @@ void GuitarMLAmp::loadModel (int modelIndex, Component* parentComponent)
 
                 try
                 {
-                    const auto& modelJson = chowdsp::JSONUtils::fromFile (chosenFile);
-                    loadModelFromJson (modelJson, chosenFile.getFileNameWithoutExtension());
+                    loadModelFromFile (chosenFile);
                 }
 #endif
                                              catch (const std::exception& exc)
@@ -179,9 +265,82 @@ void GuitarMLAmp::loadModel (int modelIndex, Component* parentComponent)
     }
 }
 
+void GuitarMLAmp::setNativeRateProcessing (bool shouldRunAtModelRate)
+{
+    if (shouldRunAtModelRate == useNativeRate)
+        return;
+
+    useNativeRate = shouldRunAtModelRate;
+    if (currentModel != nullptr)
+        loadSharedModel (currentModel, currentModelName);
+}
+
+int GuitarMLAmp::getNativeRateLatencySamples (double sampleRate)
+{
+    // the built-in models run at 44.1 kHz, the ones at higher rates are resampled by less
+    constexpr auto lowestModelSampleRate = 44100.0;
+    if (sampleRate < lowestModelSampleRate * 1.1)
+        return 0;
+
+    return resampled_rnn::getLatencySamples (lowestModelSampleRate / sampleRate);
+}
+
 String GuitarMLAmp::getCurrentModelName() const
 {
-    return cachedModel.value (RONNTags::modelNameTag, "");
+    return currentModelName;
+}
+
+juce::StringArray GuitarMLAmp::getModelListNames() const
+{
+    auto names = RONNTags::guitarMLModelNames;
+    names.addArray (modelLibrary->getModelNames());
+    return names;
+}
+
+void GuitarMLAmp::loadUserModel (int modelIndex)
+{
+    pendingModelIndex = -1;
+    if (modelIndex >= getModelListSize() && ! modelLibrary->isIndexed())
+    {
+        pendingModelIndex = modelIndex;
+        return;
+    }
+
+    modelIndex = jlimit (0, getModelListSize() - 1, modelIndex);
+    // load built-in model
+    if (modelIndex < RONNTags::numBuiltInModels)
+    {
+        loadModel (modelIndex);
+        return;
+    }
+
+    // load user model
+    try
+    {
+        const auto entry = modelLibrary->getEntry (modelIndex - RONNTags::numBuiltInModels);
+        if (! entry.has_value())
+            throw std::runtime_error ("The model is not in the models folder anymore");
+
+        // the index of a model moves as files are added to the folder before it
+        if (entry->file != currentModelFile || entry->lastModified != currentModelFileTime || currentModel == nullptr)
+        {
+            loadModelFromFile (entry->file);
+            currentModelFile = entry->file;
+            currentModelFileTime = entry->lastModified;
+        }
+        currentModelIndex = modelIndex;
+    }
+    catch (const std::exception&)
+    {
+        loadModel (0);
+        //const auto errorMessage = String { "Unable to load GuitarML model from file!\n\n" } + exc.what();
+    }
+}
+
+void GuitarMLAmp::changeListenerCallback (ChangeBroadcaster*)
+{
+    if (const auto modelIndex = pendingModelIndex.exchange (-1); modelIndex >= 0)
+        loadUserModel (modelIndex);
 }
 
 void GuitarMLAmp::prepare (double sampleRate, int samplesPerBlock)
@@ -196,7 +355,9 @@ void GuitarMLAmp::prepare (double sampleRate, int samplesPerBlock)
     conditionParam.setRampLength (0.05);
 
     processSampleRate = sampleRate;
-    loadModelFromJson (cachedModel);
+    processBlockSize = samplesPerBlock;
+    if (currentModel != nullptr)
+        loadSharedModel (currentModel, currentModelName);
 
     dcBlocker.prepare (sampleRate, samplesPerBlock);
 
@@ -218,31 +379,46 @@ void GuitarMLAmp::processAudio (AudioBuffer<float>& buffer)
     const auto numChannels = 1; //buffer.getNumChannels();
     const auto numSamples = buffer.getNumSamples();
 
-    if (modelArch == ModelArch::LSTM40NoCond)
+    const auto* conditionData = processInputStage (buffer);
+    const auto condition = std::span { conditionData, conditionData != nullptr ? (size_t) numSamples : 0 };
+    for (int ch = 0; ch < numChannels; ++ch)
     {
-        inGain.setGainDecibels (gainParam->getCurrentValue() - 12.0f);
-        inGain.process (buffer);
-
-        for (int ch = 0; ch < numChannels; ++ch)
+        const auto x = std::span { buffer.getWritePointer (ch), (size_t) numSamples };
+        if (nativeRateActive)
         {
-            auto* x = buffer.getWritePointer (ch);
-            lstm40NoCondModels[ch].visit ([x, numSamples] (auto& model)
-                                          { model.process ({ x, (size_t) numSamples }, true); });
+            nativeRateModels[(size_t) ch].visit ([x, condition] (auto& model)
+                                                 { model.template process<true> (x, condition); });
+            continue;
         }
+
+        const auto inputIsSilent = SilenceBypass::isSilent (x);
+        if (silenceBypass.skipBlock (x, condition, inputIsSilent))
+            continue;
+
+        models[(size_t) ch].visit ([x, condition] (auto& architectureVariant)
+                                   { architectureVariant.visit ([x, condition] (auto& model)
+                                                                { model.process_conditioned (x, condition, true); }); });
+        silenceBypass.update (x, condition, inputIsSilent);
     }
-    else if (modelArch == ModelArch::LSTM40Cond)
-    {
-        conditionParam.process (numSamples);
-        const auto* conditionData = conditionParam.getSmoothedBuffer();
 
-        for (int ch = 0; ch < numChannels; ++ch)
-        {
-            auto* x = buffer.getWritePointer (ch);
-            lstm40CondModels[ch].visit ([x, conditionData, numSamples] (auto& model)
-                                        { model.process_conditioned ({ x, (size_t) numSamples }, { conditionData, (size_t) numSamples }, true); });
-        }
+    processOutputStage (buffer);
+}
+
+const float* GuitarMLAmp::processInputStage (AudioBuffer<float>& buffer)
+{
+    if (! isConditioned())
+    {
+        inGain.setGainDecibels (gainParam->getCurrentValue() - 12.0f);
+        inGain.process (buffer);
+        return nullptr;
     }
 
+    conditionParam.process (buffer.getNumSamples());
+    return conditionParam.getSmoothedBuffer();
+}
+
+void GuitarMLAmp::processOutputStage (AudioBuffer<float>& buffer)
+{
     if (sampleRateCorrectionFilterParam->get())
     {
         sampleRateCorrectionFilter.processBlock (buffer);
@@ -252,6 +428,88 @@ void GuitarMLAmp::processAudio (AudioBuffer<float>& buffer)
 
     dcBlocker.processAudio (buffer);
 }
+
+const void* GuitarMLAmp::getBatchKey()
+{
+    const SpinLock::ScopedTryLockType modelChangingLock { modelChangingMutex };
+    if (! modelChangingLock.isLocked() || isBypassed() || nativeRateActive)
+        return nullptr;
+
+    return activeWeights;
+}
+
+void GuitarMLAmp::processAudioBatch (std::span<GuitarMLAmp* const> amps, std::span<AudioBuffer<float>* const> buffers)
+{
+    jassert (amps.size() == buffers.size() && amps.size() <= (size_t) maxBatchSize);
+    if (amps.empty())
+        return;
+
+    // the amps still running the model of the first one hold their lock until the batch is done,
+    // any other (a model change may have come in since the batch was formed) goes on its own
+    std::array<GuitarMLAmp*, (size_t) maxBatchSize> batchAmps {};
+    std::array<AudioBuffer<float>*, (size_t) maxBatchSize> batchBuffers {};
+    std::array<float*, (size_t) maxBatchSize> batchData {};
+    std::array<const float*, (size_t) maxBatchSize> batchConditions {};
+    std::array<bool, (size_t) maxBatchSize> batchInputIsSilent {};
+    size_t batchSize = 0;
+
+    const auto* batchKey = amps[0]->getBatchKey();
+    const auto numSamples = buffers[0]->getNumSamples();
+    for (size_t i = 0; i < amps.size(); ++i)
+    {
+        auto* amp = amps[i];
+        if (batchKey == nullptr || buffers[i]->getNumSamples() != numSamples || ! amp->modelChangingMutex.tryEnter())
+        {
+            amp->processAudioBlock (*buffers[i]);
+            continue;
+        }
+
+        if (amp->isBypassed() || amp->nativeRateActive || amp->activeWeights != batchKey)
+        {
+            amp->modelChangingMutex.exit();
+            amp->processAudioBlock (*buffers[i]);
+            continue;
+        }
+
+        // the batch takes the place of processAudioBlock, so it tracks the input levels as well
+        amp->updateInputLevels (*buffers[i]);
+        const auto* conditionData = amp->processInputStage (*buffers[i]);
+        const auto x = std::span { buffers[i]->getWritePointer (0), (size_t) numSamples };
+        const auto condition = std::span { conditionData, conditionData != nullptr ? (size_t) numSamples : 0 };
+        const auto inputIsSilent = SilenceBypass::isSilent (x);
+        if (amp->silenceBypass.skipBlock (x, condition, inputIsSilent))
+        {
+            amp->processOutputStage (*buffers[i]);
+            amp->modelChangingMutex.exit();
+            continue;
+        }
+
+        batchConditions[batchSize] = conditionData;
+        batchData[batchSize] = x.data();
+        batchInputIsSilent[batchSize] = inputIsSilent;
+        batchBuffers[batchSize] = buffers[i];
+        batchAmps[batchSize++] = amp;
+    }
+
+    if (batchSize == 0)
+        return;
+
+    // the same model implies the same architecture for all of them
+    std::array<GuitarMLModel*, (size_t) maxBatchSize> models {};
+    for (size_t b = 0; b < batchSize; ++b)
+        models[b] = &batchAmps[b]->models[0];
+    processModelBatch (std::span<GuitarMLModel* const> { models.data(), batchSize }, batchData.data(), batchConditions.data(), (size_t) numSamples);
+
+    for (size_t b = 0; b < batchSize; ++b)
+    {
+        batchAmps[b]->silenceBypass.update ({ batchData[b], (size_t) numSamples },
+                                            { batchConditions[b], batchConditions[b] != nullptr ? (size_t) numSamples : 0 },
+                                            batchInputIsSilent[b]);
+        batchAmps[b]->processOutputStage (*batchBuffers[b]);
+        batchAmps[b]->modelChangingMutex.exit();
+    }
+}
+
 /* 
 std::unique_ptr<XmlElement> GuitarMLAmp::toXML()
 {
@@ -290,7 +548,7 @@ bool GuitarMLAmp::getCustomComponents (OwnedArray<Component>& customComps, chowd
     class MainParamSlider : public Slider
     {
     public:
-        MainParamSlider (const ModelArch& modelArchitecture,
+        MainParamSlider (const rnn_dispatch::Architecture& modelArchitecture,
                          AudioProcessorValueTreeState& vts,
                          ModelChangeBroadcaster& modelChangeCaster,
                          chowdsp::HostContextProvider& hcp)
@@ -328,7 +586,7 @@ bool GuitarMLAmp::getCustomComponents (OwnedArray<Component>& customComps, chowd
 
         void updateSliderVisibility()
         {
-            const auto usingConditionedModel = currentModelArch == ModelArch::LSTM40Cond;
+            const auto usingConditionedModel = currentModelArch.inputSize > 1;
 
             conditionSlider.setVisible (usingConditionedModel);
             gainSlider.setVisible (! usingConditionedModel);
@@ -356,7 +614,7 @@ bool GuitarMLAmp::getCustomComponents (OwnedArray<Component>& customComps, chowd
     private:
         using SliderAttachment = AudioProcessorValueTreeState::SliderAttachment;
 
-        const ModelArch& currentModelArch;
+        const rnn_dispatch::Architecture& currentModelArch;
         ModulatableSlider gainSlider, conditionSlider;
         SliderAttachment gainAttach, conditionAttach;
 
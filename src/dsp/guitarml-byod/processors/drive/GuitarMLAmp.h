@@ -1,6 +1,9 @@
 #pragma once
 
+#include "neural_utils/ModelLibrary.h"
+#include "neural_utils/ModelRegistry.h"
 #include "neural_utils/ResampledRNNAccelerated.h"
+#include "neural_utils/SilenceBypass.h"
 
 #include "../BaseProcessor.h"
 #include "../utility/DCBlocker.h"
@@ -99,7 +102,8 @@ constexpr std::string_view modelNameTag = "byod_guitarml_model_name";
 } // namespace RONNTags
 
 
-class GuitarMLAmp : public BaseProcessor
+class GuitarMLAmp : public BaseProcessor,
+                    private ChangeListener
 {
 public:
     explicit GuitarMLAmp (UndoManager* um = nullptr);
@@ -120,49 +124,54 @@ public:
     void loadModel (int modelIndex, Component* parentComponent = nullptr);
     String getCurrentModelName() const;
     
-    // added by midilab
-    void setModelList(juce::Array<juce::File> modelFileList, juce::StringArray modelNameList) { 
-        // modelList should contain built in models data first
-        modelListNames.addArray(RONNTags::guitarMLModelNames);
-        // add each element of modelNameList to the end of modelListNames
-        modelListNames.addArray(modelNameList);
-        // this list is only for user json files. no buil-in here
-        modelList = modelFileList;
-    }
-    juce::StringArray getModelListNames() { return modelListNames; }
-    int getModelListSize() { return RONNTags::numBuiltInModels + modelList.size(); }
+    // added by midilab: the built-in models, followed by the user models of the process-wide
+    // ModelLibrary (see JC303::overdriveModelLibrary)
+    juce::StringArray getModelListNames() const;
+    int getModelListSize() const { return RONNTags::numBuiltInModels + modelLibrary->getNumModels(); }
     int getCurrentModelIndex() { return currentModelIndex; }
-    void loadUserModel(int modelIndex) {
-        if (modelIndex >= getModelListSize())
-            modelIndex = getModelListSize() - 1;
-        if (modelIndex < 0)
-            modelIndex = 0;
-        // load built-in model
-        if (modelIndex < RONNTags::numBuiltInModels) {
-            loadModel (modelIndex);
-        // load user model
-        } else {
-            try
-            {
-                const auto modelFile = modelList[modelIndex];
-                const auto modelJson = chowdsp::JSONUtils::fromFile (modelFile);
-                loadModelFromJson (modelJson, modelFile.getFileNameWithoutExtension());
-                currentModelIndex = modelIndex;
-            } catch (const std::exception& exc) {
-                loadModel (0);
-                //const auto errorMessage = String { "Unable to load GuitarML model from file!\n\n" } + exc.what();
-            }
-        }
-    }
+    // a user model index the library hasn't indexed yet (as when a project is loaded right after
+    // startup) is loaded once it has
+    void loadUserModel (int modelIndex);
+    // added by midilab: run the model at its own sample rate when the host rate is higher, with
+    // the signal resampled around it - fewer inferences per second for some added latency
+    void setNativeRateProcessing (bool shouldRunAtModelRate);
+    bool isNativeRateProcessing() const { return useNativeRate; }
+    int getLatencySamples() const { return latencySamples.load(); }
+    // the delay of the models at the lowest model rate, the longest they can have at the model rate
+    // (user models below it delay more)
+    static int getNativeRateLatencySamples (double sampleRate);
+
+    // added by midilab: amps running the same model can process their blocks as one batch, which
+    // loads the weights of the model once per sample for the whole batch instead of once per amp.
+    // The amps of a batch must be processed by the same call: JC303 batches the lines of its rack,
+    // but not the amps of separate plugin instances, which the host calls on their own schedules
+    // (see tools/BatchBenchmark.cpp for the timings)
+    static constexpr int maxBatchSize = 4;
+    // the same for amps that can share a batch (the weights they run on), nullptr when this one
+    // can't be batched
+    const void* getBatchKey();
+    static void processAudioBatch (std::span<GuitarMLAmp* const> amps, std::span<AudioBuffer<float>* const> buffers);
+
     void setDriver (float value) {
-        if (modelArch == ModelArch::LSTM40NoCond)
-            getVTS().getParameter(RONNTags::gainTag)->setValue(value);
-        else if (modelArch == ModelArch::LSTM40Cond)
+        if (isConditioned())
             getVTS().getParameter(RONNTags::conditionTag)->setValue(value);
+        else
+            getVTS().getParameter(RONNTags::gainTag)->setValue(value);
     }
 
 private:
     void loadModelFromJson (const chowdsp::json& modelJson, const String& newModelName = {});
+    void loadModelFromFile (const File& modelFile);
+    void loadSharedModel (ModelRegistry::ModelPtr model, const String& newModelName);
+    void changeListenerCallback (ChangeBroadcaster*) override;
+    // replaces the models by ones of the architecture
+    void emplaceModels (const rnn_dispatch::Architecture& newModelArch);
+    // conditioned models take the condition as a second input instead of having a gain in front
+    bool isConditioned() const noexcept { return modelArch.inputSize > 1; }
+
+    // the parts of processAudio around the model, the input stage returns the condition signal
+    const float* processInputStage (AudioBuffer<float>& buffer);
+    void processOutputStage (AudioBuffer<float>& buffer);
     using ModelChangeBroadcaster = chowdsp::Broadcaster<void()>;
     ModelChangeBroadcaster modelChangeBroadcaster;
 
@@ -173,41 +182,49 @@ private:
 
     SpinLock modelChangingMutex;
     double processSampleRate = 96000.0;
+    int processBlockSize = 512;
     std::shared_ptr<FileChooser> customModelChooser;
 
-    template <int numIns, int hiddenSize>
-    using GuitarML_LSTM = EA::Variant<rnn_sse_arm::RNNAccelerated<numIns, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>
-#if JUCE_INTEL
-                                      ,
-                                      rnn_avx::RNNAccelerated<numIns, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNeural::SampleRateCorrectionMode::LinInterp>
-#endif
-                                      >;
-
-    using LSTM40Cond = GuitarML_LSTM<2, 40>;
-    using LSTM40NoCond = GuitarML_LSTM<1, 40>;
-
-    std::array<LSTM40Cond, 2> lstm40CondModels;
-    std::array<LSTM40NoCond, 2> lstm40NoCondModels;
+    template <int numIns, int hiddenSize, int layerType>
+    using GuitarML_RNN = rnn_dispatch::ModelVariant<numIns, hiddenSize, layerType, (int) RTNeural::SampleRateCorrectionMode::LinInterp>;
+
+    // added by midilab: the models hold the architecture of the current model (LSTM or GRU, with
+    // or without condition, of any of rnn_dispatch::SupportedHiddenSizes), as the json tells it
+    using GuitarMLModel = rnn_dispatch::ArchitectureVariant<GuitarML_RNN>;
+    std::array<GuitarMLModel, 2> models;
+
+    // the same models behind a resampler to the model rate, used instead of the ones above while
+    // native rate processing is active
+    using NativeRateModel = rnn_dispatch::ArchitectureVariant<ResampledRNNAccelerated>;
+    std::array<NativeRateModel, 2> nativeRateModels;
+    bool useNativeRate = false;
+    bool nativeRateActive = false;
+    std::atomic<int> latencySamples { 0 };
     chowdsp::HighShelfFilter<float> sampleRateCorrectionFilter;
 
-    enum class ModelArch
-    {
-        LSTM40Cond,
-        LSTM40NoCond,
-    };
+    rnn_dispatch::Architecture modelArch;
 
-    ModelArch modelArch = ModelArch::LSTM40NoCond;
+    // added by midilab: the model is skipped for silent blocks once it has settled (between the
+    // notes, most of the time at short decays), not while running at the model rate
+    SilenceBypass silenceBypass;
 
-    chowdsp::json cachedModel {};
+    // the model and the weights of it the models run on, which only change under modelChangingMutex
+    ModelRegistry::ModelPtr currentModel;
+    const compiled_model::View* activeWeights = nullptr;
+    String currentModelName;
 
     DCBlocker dcBlocker;
 
     float normalizationGain = 1.0f;
 
     // added by midilab
-    juce::Array<juce::File> modelList;    
-    juce::StringArray modelListNames;
+    SharedResourcePointer<ModelLibrary> modelLibrary;
     int currentModelIndex = 0;
+    std::atomic<int> pendingModelIndex { -1 };
+    // the user model file running (empty for the others), which keeps running when only its index
+    // changes
+    File currentModelFile;
+    Time currentModelFileTime;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GuitarMLAmp)
 };
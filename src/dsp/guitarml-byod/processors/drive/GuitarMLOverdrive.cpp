@@ -0,0 +1,317 @@
+#include "GuitarMLOverdrive.h"
+#include "neural_utils/RNNDispatch.h"
+#include "neural_utils/SilenceBypass.h"
+
+#include <RTNeural/RTNeural.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr double pi = 3.14159265358979323846;
+
+// the cutoff of the DC blocker at the default of its frequency parameter
+constexpr double dcBlockerCutoff = 27.5;
+
+// the plugin applies the drive as an input gain of -18 to +18 dB, less 12 dB, for models without
+// a condition input
+constexpr float minDriveGainDB = -18.0f - 12.0f;
+constexpr float maxDriveGainDB = 18.0f - 12.0f;
+
+/** chowdsp::SVFHighpass with a Butterworth Q, as the DCBlocker runs it */
+struct DCBlockerFilter
+{
+    void prepare (double sampleRate)
+    {
+        const auto g = std::tan (pi * dcBlockerCutoff / sampleRate);
+        k = (float) std::sqrt (2.0);
+        a1 = (float) (1.0 / (1.0 + g * (g + k)));
+        a2 = (float) g * a1;
+        a3 = (float) g * a2;
+        reset();
+    }
+
+    void reset() noexcept { ic1 = ic2 = 0.0f; }
+
+    void process (float* buffer, int numSamples) noexcept
+    {
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto v3 = buffer[n] - ic2;
+            const auto v1 = a1 * ic1 + a2 * v3;
+            const auto v2 = ic2 + a2 * ic1 + a3 * v3;
+            ic1 = 2.0f * v1 - ic1;
+            ic2 = 2.0f * v2 - ic2;
+            buffer[n] = buffer[n] - k * v1 - v2;
+        }
+    }
+
+    float k = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    float ic1 = 0.0f, ic2 = 0.0f;
+};
+
+/** A second order high shelf with a Butterworth Q, as the sample rate correction filter of GuitarMLAmp */
+struct HighShelfFilter
+{
+    void setParameters (double cutoff, double gain, double sampleRate)
+    {
+        isBypassed = gain == 1.0;
+
+        // the shelf of the audio EQ cookbook
+        const auto A = std::sqrt (gain);
+        const auto w0 = 2.0 * pi * cutoff / sampleRate;
+        const auto cosW0 = std::cos (w0);
+        const auto alpha = std::sin (w0) / (2.0 * (1.0 / std::sqrt (2.0)));
+        const auto twoSqrtAAlpha = 2.0 * std::sqrt (A) * alpha;
+
+        const auto a0 = (A + 1.0) - (A - 1.0) * cosW0 + twoSqrtAAlpha;
+        b[0] = (float) (A * ((A + 1.0) + (A - 1.0) * cosW0 + twoSqrtAAlpha) / a0);
+        b[1] = (float) (-2.0 * A * ((A - 1.0) + (A + 1.0) * cosW0) / a0);
+        b[2] = (float) (A * ((A + 1.0) + (A - 1.0) * cosW0 - twoSqrtAAlpha) / a0);
+        a[0] = (float) (2.0 * ((A - 1.0) - (A + 1.0) * cosW0) / a0);
+        a[1] = (float) (((A + 1.0) - (A - 1.0) * cosW0 - twoSqrtAAlpha) / a0);
+    }
+
+    void reset() noexcept { z1 = z2 = 0.0f; }
+
+    void process (float* buffer, int numSamples) noexcept
+    {
+        if (isBypassed)
+            return;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const auto x = buffer[n];
+            const auto y = b[0] * x + z1;
+            z1 = b[1] * x - a[0] * y + z2;
+            z2 = b[2] * x - a[1] * y;
+            buffer[n] = y;
+        }
+    }
+
+    bool isBypassed = true;
+    float b[3] {}, a[2] {};
+    float z1 = 0.0f, z2 = 0.0f;
+};
+
+/** A value ramping linearly to its target over a fixed time, as juce::SmoothedValue */
+struct LinearSmoothedValue
+{
+    void prepare (double sampleRate, double rampLengthSeconds)
+    {
+        rampLength = std::max (1, (int) std::lround (sampleRate * rampLengthSeconds));
+        setCurrentAndTarget (target);
+    }
+
+    void setCurrentAndTarget (float value) noexcept
+    {
+        current = target = value;
+        stepsToTarget = 0;
+    }
+
+    void setTarget (float value) noexcept
+    {
+        if (value == target)
+            return;
+
+        target = value;
+        stepsToTarget = rampLength;
+        step = (target - current) / (float) rampLength;
+    }
+
+    float getNext() noexcept
+    {
+        if (stepsToTarget <= 0)
+            return target;
+
+        if (--stepsToTarget == 0)
+            current = target;
+        else
+            current += step;
+        return current;
+    }
+
+    float current = 0.0f, target = 0.0f, step = 0.0f;
+    int rampLength = 1, stepsToTarget = 0;
+};
+} // namespace
+
+struct GuitarMLOverdrive::Internal
+{
+    template <int numIns, int hiddenSize, int layerType>
+    using Model = rnn_dispatch::ModelVariant<numIns, hiddenSize, layerType, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>;
+
+    rnn_dispatch::ArchitectureVariant<Model> model;
+    rnn_dispatch::Architecture modelArch;
+    std::vector<char> modelData; // the weights the model runs on
+    compiled_model::View weights;
+    bool hasModel = false;
+
+    double sampleRate = 48000.0;
+    std::vector<float> dry, condition;
+
+    float drive = 0.25f;
+    LinearSmoothedValue inputGain, conditionValue, wetGain, dryGain;
+    HighShelfFilter sampleRateCorrectionFilter;
+    DCBlockerFilter dcBlocker;
+    SilenceBypass silenceBypass;
+
+    bool isConditioned() const noexcept { return modelArch.inputSize > 1; }
+
+    void prepareModel()
+    {
+        const auto rnnDelaySamples = std::max (1.0, sampleRate / weights.sampleRate);
+        model.visit ([this, rnnDelaySamples] (auto& architectureVariant)
+                     { architectureVariant.visit ([this, rnnDelaySamples] (auto& rnn)
+                                                  {
+                                                      rnn.initialise (weights);
+                                                      rnn.prepare ((float) rnnDelaySamples);
+                                                      rnn.reset();
+                                                  }); });
+
+        sampleRateCorrectionFilter.setParameters (8100.0, sampleRate < weights.sampleRate * 1.1 ? 1.0 : 0.25, sampleRate);
+        sampleRateCorrectionFilter.reset();
+        dcBlocker.reset();
+        silenceBypass.reset();
+    }
+
+    void updateDrive() noexcept
+    {
+        if (isConditioned())
+            conditionValue.setTarget (drive);
+        else
+            inputGain.setTarget (std::pow (10.0f, (minDriveGainDB + drive * (maxDriveGainDB - minDriveGainDB)) / 20.0f));
+    }
+};
+
+GuitarMLOverdrive::GuitarMLOverdrive() : internal (std::make_unique<Internal>())
+{
+    setDryWet (1.0f);
+    setDrive (internal->drive);
+}
+
+GuitarMLOverdrive::~GuitarMLOverdrive() = default;
+
+void GuitarMLOverdrive::prepare (double sampleRate, int maxBlockSize)
+{
+    internal->sampleRate = sampleRate;
+    internal->dry.resize ((size_t) maxBlockSize);
+    internal->condition.resize ((size_t) maxBlockSize);
+
+    // the ramps of GuitarMLAmp and of the dry/wet mixer of JC303Line
+    internal->inputGain.prepare (sampleRate, 0.1);
+    internal->conditionValue.prepare (sampleRate, 0.05);
+    internal->wetGain.prepare (sampleRate, 0.05);
+    internal->dryGain.prepare (sampleRate, 0.05);
+
+    internal->dcBlocker.prepare (sampleRate);
+    if (internal->hasModel)
+        internal->prepareModel();
+}
+
+void GuitarMLOverdrive::reset()
+{
+    if (internal->hasModel)
+        internal->prepareModel();
+}
+
+bool GuitarMLOverdrive::loadModel (const void* compiledModelData, size_t compiledModelSize)
+{
+    if (compiledModelData == nullptr)
+        return false;
+
+    const auto* bytes = static_cast<const char*> (compiledModelData);
+    std::vector<char> newModelData (bytes, bytes + compiledModelSize);
+
+    compiled_model::View newWeights;
+    if (! compiled_model::getView (newModelData.data(), newModelData.size(), newWeights))
+        return false;
+
+    const auto newModelArch = rnn_dispatch::getArchitecture (newWeights);
+    if (! rnn_dispatch::emplaceArchitecture<Internal::Model> (internal->model, newModelArch))
+        return false;
+
+    internal->model.visit ([] (auto& architectureVariant)
+                           { rnn_dispatch::emplaceModel (architectureVariant); });
+    internal->modelArch = newModelArch;
+    internal->modelData = std::move (newModelData);
+    internal->weights = newWeights;
+    internal->hasModel = true;
+    internal->prepareModel();
+
+    // starts from the drive as set, without a ramp from the last model
+    internal->updateDrive();
+    internal->inputGain.setCurrentAndTarget (internal->inputGain.target);
+    internal->conditionValue.setCurrentAndTarget (internal->conditionValue.target);
+    return true;
+}
+
+bool GuitarMLOverdrive::hasModel() const noexcept
+{
+    return internal->hasModel;
+}
+
+void GuitarMLOverdrive::setDrive (float value) noexcept
+{
+    internal->drive = std::clamp (value, 0.0f, 1.0f);
+    internal->updateDrive();
+}
+
+void GuitarMLOverdrive::setDryWet (float value) noexcept
+{
+    // the sin3dB rule of juce::dsp::DryWetMixer
+    const auto wet = std::clamp (value, 0.0f, 1.0f);
+    internal->dryGain.setTarget ((float) std::sin (0.5 * pi * (1.0 - wet)));
+    internal->wetGain.setTarget ((float) std::sin (0.5 * pi * wet));
+}
+
+void GuitarMLOverdrive::process (float* buffer, int numSamples) noexcept
+{
+    auto& state = *internal;
+    if (! state.hasModel || numSamples <= 0)
+        return;
+
+    // blocks larger than prepared for are processed in parts
+    const auto maxBlockSize = (int) state.dry.size();
+    if (numSamples > maxBlockSize)
+    {
+        for (int start = 0; start < numSamples && maxBlockSize > 0; start += maxBlockSize)
+            process (buffer + start, std::min (maxBlockSize, numSamples - start));
+        return;
+    }
+
+    std::copy (buffer, buffer + numSamples, state.dry.data());
+
+    // input stage: the gain, or the condition of conditioned models
+    auto condition = std::span<const float> {};
+    if (state.isConditioned())
+    {
+        for (int n = 0; n < numSamples; ++n)
+            state.condition[(size_t) n] = state.conditionValue.getNext();
+        condition = { state.condition.data(), (size_t) numSamples };
+    }
+    else
+    {
+        for (int n = 0; n < numSamples; ++n)
+            buffer[n] *= state.inputGain.getNext();
+    }
+
+    const auto x = std::span { buffer, (size_t) numSamples };
+    const auto inputIsSilent = SilenceBypass::isSilent (x);
+    if (! state.silenceBypass.skipBlock (x, condition, inputIsSilent))
+    {
+        state.model.visit ([x, condition] (auto& architectureVariant)
+                           { architectureVariant.visit ([x, condition] (auto& rnn)
+                                                        { rnn.process_conditioned (x, condition, true); }); });
+        state.silenceBypass.update (x, condition, inputIsSilent);
+    }
+
+    // output stage
+    state.sampleRateCorrectionFilter.process (buffer, numSamples);
+    state.dcBlocker.process (buffer, numSamples);
+
+    for (int n = 0; n < numSamples; ++n)
+        buffer[n] = state.wetGain.getNext() * buffer[n] + state.dryGain.getNext() * state.dry[(size_t) n];
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+/**
+ * The GuitarML overdrive of a JC303 line without JUCE, for the WebAssembly build: the model with
+ * its input gain or condition, the sample rate correction filter and the DC blocker of
+ * GuitarMLAmp, followed by the dry/wet mix of JC303Line. The parameters map the way the plugin
+ * maps them.
+ *
+ * The models are loaded in their compiled form (see compiled_model, the .jc303model files), so
+ * this needs no JSON parsing. Everything runs on the thread calling it, there is no locking.
+ */
+class GuitarMLOverdrive
+{
+public:
+    GuitarMLOverdrive();
+    ~GuitarMLOverdrive();
+
+    GuitarMLOverdrive (const GuitarMLOverdrive&) = delete;
+    GuitarMLOverdrive& operator= (const GuitarMLOverdrive&) = delete;
+
+    void prepare (double sampleRate, int maxBlockSize);
+    void reset();
+
+    /**
+     * Loads a compiled model, copying the data. Returns false (keeping the current model) if the
+     * data holds no valid model, or one of an architecture that isn't supported.
+     */
+    bool loadModel (const void* compiledModelData, size_t compiledModelSize);
+    bool hasModel() const noexcept;
+
+    /** The drive, 0 to 1: the condition of conditioned models, the input gain of the others */
+    void setDrive (float value) noexcept;
+    /** The proportion of the overdriven signal in the output, 0 to 1 */
+    void setDryWet (float value) noexcept;
+
+    /** Overdrives a mono block in place, does nothing without a model */
+    void process (float* buffer, int numSamples) noexcept;
+
+private:
+    struct Internal;
+    std::unique_ptr<Internal> internal;
+};
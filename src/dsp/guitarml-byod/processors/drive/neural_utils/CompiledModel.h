@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * A compact binary form of the GuitarML LSTM and GRU models: a small header followed by the float
+ * weights, already transposed, with each row of gates padded to whole vectors and (for an LSTM) the
+ * two bias vectors summed. This is the layout SharedWeightsRNN runs on, so a compiled model can be
+ * used as it is - also straight from a memory-mapped file.
+ *
+ * Compiling a model from its JSON is in CompiledModelJson.h, apart from this so that the builds
+ * that only load compiled models (the WebAssembly one) don't take in the JSON parser.
+ */
+namespace compiled_model
+{
+constexpr uint32_t magicNumber = 0x4c4d3347; // "G3ML"
+constexpr uint32_t formatVersion = 2;
+constexpr const char* fileExtension = ".jc303model";
+
+/** The recurrent layer of a model, with the values of RecurrentLayerType */
+enum class LayerType : uint32_t
+{
+    lstm = 1,
+    gru = 2,
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    LayerType layerType;
+    uint32_t inputSize;
+    uint32_t hiddenSize;
+    float sampleRate;
+    uint32_t numWeights;
+};
+
+/** The weights of a compiled model, pointing into the blob */
+struct View
+{
+    LayerType layerType = LayerType::lstm;
+    int inputSize = 0;
+    int hiddenSize = 0;
+    int gatesStride = 0; // see getGatesStride
+    double sampleRate = 44100.0;
+
+    const float* kernel = nullptr; // [inputSize][gatesStride]
+    const float* recurrentKernel = nullptr; // [hiddenSize][gatesStride]
+    const float* bias = nullptr; // [gatesStride], both biases of an LSTM, the input one of a GRU
+    const float* recurrentBias = nullptr; // [gatesStride], the recurrent bias of a GRU only
+    const float* denseWeights = nullptr; // [hiddenSize]
+    const float* denseBias = nullptr; // [1]
+
+    // optional reduced precision copy of the recurrent kernel (see quantise), run instead of the
+    // float one when set: half floats, or 8 bit integers with one scale per column of gates
+    const uint16_t* recurrentKernelHalf = nullptr; // [hiddenSize][gatesStride]
+    const int8_t* recurrentKernelInt8 = nullptr; // [hiddenSize][gatesStride]
+    const float* recurrentKernelScales = nullptr; // [gatesStride]
+};
+
+/** Input, forget, cell and output gates for an LSTM, reset, update and new gates for a GRU */
+constexpr int getNumGates (LayerType layerType)
+{
+    return layerType == LayerType::gru ? 3 : 4;
+}
+
+/**
+ * The length of a row of weights for the gates of all hidden units, padded with zeros to a
+ * multiple of 16 floats: a row is a whole number of vectors for any instruction set.
+ */
+constexpr int getGatesStride (LayerType layerType, int hiddenSize)
+{
+    return (getNumGates (layerType) * hiddenSize + 15) / 16 * 16;
+}
+
+/** The precision the recurrent kernel, which holds nearly all of the weights, is stored in */
+enum class Precision
+{
+    float32,
+    float16,
+    int8,
+};
+
+/** IEEE half float, rounded to nearest even (the weights are far from the half float range) */
+inline uint16_t toHalf (float value)
+{
+    uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+    const auto sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+
+    if (bits >= 0x477fe000u) // rounds to beyond the largest half float
+        return (uint16_t) (sign | 0x7bffu);
+
+    if (bits < 0x38800000u) // a denormal half float: let the float addition do the rounding
+    {
+        float magnitude;
+        std::memcpy (&magnitude, &bits, sizeof (magnitude));
+        magnitude += 0.5f;
+        std::memcpy (&bits, &magnitude, sizeof (bits));
+        return (uint16_t) (sign | (bits - 0x3f000000u));
+    }
+
+    // rebias the exponent and round the mantissa to nearest even
+    bits += ((uint32_t) (15 - 127) << 23) + 0xfffu + ((bits >> 13) & 1u);
+    return (uint16_t) (sign | (bits >> 13));
+}
+
+inline uint32_t getNumWeights (LayerType layerType, uint32_t inputSize, uint32_t hiddenSize)
+{
+    const auto numBiases = layerType == LayerType::gru ? 2u : 1u;
+    return (inputSize + hiddenSize + numBiases) * (uint32_t) getGatesStride (layerType, (int) hiddenSize) + hiddenSize + 1;
+}
+
+/** Checks the blob and points the view at its weights, returns false for anything but a valid compiled model */
+inline bool getView (const void* data, size_t dataSize, View& view)
+{
+    if (data == nullptr || dataSize < sizeof (Header) || reinterpret_cast<uintptr_t> (data) % alignof (Header) != 0)
+        return false;
+
+    const auto& header = *static_cast<const Header*> (data);
+    if (header.magic != magicNumber || header.version != formatVersion
+        || (header.layerType != LayerType::lstm && header.layerType != LayerType::gru)
+        || header.inputSize == 0 || header.inputSize > 2 || header.hiddenSize == 0 || header.hiddenSize > 64
+        || header.numWeights != getNumWeights (header.layerType, header.inputSize, header.hiddenSize)
+        || dataSize != sizeof (Header) + header.numWeights * sizeof (float))
+        return false;
+
+    const auto gatesStride = getGatesStride (header.layerType, (int) header.hiddenSize);
+    view.layerType = header.layerType;
+    view.inputSize = (int) header.inputSize;
+    view.hiddenSize = (int) header.hiddenSize;
+    view.gatesStride = gatesStride;
+    view.sampleRate = (double) header.sampleRate;
+    view.kernel = reinterpret_cast<const float*> (static_cast<const char*> (data) + sizeof (Header));
+    view.recurrentKernel = view.kernel + view.inputSize * gatesStride;
+    view.bias = view.recurrentKernel + view.hiddenSize * gatesStride;
+    view.recurrentBias = header.layerType == LayerType::gru ? view.bias + gatesStride : nullptr;
+    view.denseWeights = view.bias + (header.layerType == LayerType::gru ? 2 : 1) * gatesStride;
+    view.denseBias = view.denseWeights + header.hiddenSize;
+    return true;
+}
+
+/**
+ * Stores the recurrent kernel in a lower precision: as half floats, or quantised to 8 bits,
+ * symmetric with one scale per column of gates (the scales come first then). The full precision
+ * needs no data of its own.
+ */
+inline std::vector<char> quantise (const View& weights, Precision precision)
+{
+    const auto gatesSize = weights.gatesStride;
+    const auto numWeights = (size_t) (weights.hiddenSize * gatesSize);
+    if (precision == Precision::float16)
+    {
+        std::vector<char> quantised (numWeights * sizeof (uint16_t));
+        auto* values = reinterpret_cast<uint16_t*> (quantised.data());
+        for (size_t i = 0; i < numWeights; ++i)
+            values[i] = toHalf (weights.recurrentKernel[i]);
+        return quantised;
+    }
+
+    if (precision == Precision::int8)
+    {
+        std::vector<float> scales ((size_t) gatesSize, 0.0f);
+        for (int j = 0; j < weights.hiddenSize; ++j)
+            for (int k = 0; k < gatesSize; ++k)
+                scales[(size_t) k] = std::max (scales[(size_t) k], std::abs (weights.recurrentKernel[j * gatesSize + k]) / 127.0f);
+
+        std::vector<char> quantised (scales.size() * sizeof (float) + numWeights);
+        std::memcpy (quantised.data(), scales.data(), scales.size() * sizeof (float));
+        auto* values = reinterpret_cast<int8_t*> (quantised.data() + scales.size() * sizeof (float));
+        for (int j = 0; j < weights.hiddenSize; ++j)
+        {
+            for (int k = 0; k < gatesSize; ++k)
+            {
+                const auto scale = scales[(size_t) k];
+                const auto value = scale > 0.0f ? std::round (weights.recurrentKernel[j * gatesSize + k] / scale) : 0.0f;
+                values[j * gatesSize + k] = (int8_t) std::clamp (value, -127.0f, 127.0f);
+            }
+        }
+        return quantised;
+    }
+
+    return {};
+}
+
+/** The weights running on the recurrent kernel from quantise() */
+inline View getQuantisedView (const View& weights, Precision precision, const std::vector<char>& quantised)
+{
+    auto view = weights;
+    if (precision == Precision::float16)
+    {
+        view.recurrentKernelHalf = reinterpret_cast<const uint16_t*> (quantised.data());
+    }
+    else if (precision == Precision::int8)
+    {
+        view.recurrentKernelScales = reinterpret_cast<const float*> (quantised.data());
+        view.recurrentKernelInt8 = reinterpret_cast<const int8_t*> (quantised.data() + (size_t) weights.gatesStride * sizeof (float));
+    }
+    return view;
+}
+} // namespace compiled_model
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CompiledModel.h"
+#include <modules/json/json.hpp>
+#include <stdexcept>
+#include <string>
+
+namespace compiled_model
+{
+/** Converts the JSON of a GuitarML LSTM or GRU model, throws for a model of any other kind */
+inline std::vector<char> compile (const nlohmann::json& modelJson)
+{
+    const auto& modelDataJson = modelJson.at ("model_data");
+    const auto& stateDict = modelJson.at ("state_dict");
+    const auto unitType = modelDataJson.value ("unit_type", std::string { "LSTM" });
+    if (unitType != "LSTM" && unitType != "GRU")
+        throw std::runtime_error ("Only LSTM and GRU models are supported");
+
+    const auto layerType = unitType == "GRU" ? LayerType::gru : LayerType::lstm;
+    const auto inputSize = modelDataJson.value ("input_size", 1u);
+    const auto hiddenSize = modelDataJson.value ("hidden_size", 0u);
+    const auto gatesSize = (uint32_t) getNumGates (layerType) * hiddenSize;
+
+    using Vec2d = std::vector<std::vector<float>>;
+    const auto kernel = stateDict.at ("rec.weight_ih_l0").get<Vec2d>();
+    const auto recurrentKernel = stateDict.at ("rec.weight_hh_l0").get<Vec2d>();
+    const auto biasIH = stateDict.at ("rec.bias_ih_l0").get<std::vector<float>>();
+    const auto biasHH = stateDict.at ("rec.bias_hh_l0").get<std::vector<float>>();
+    const auto denseWeights = stateDict.at ("lin.weight").get<Vec2d>();
+    const auto denseBias = stateDict.at ("lin.bias").get<std::vector<float>>();
+
+    auto hasShape = [] (const Vec2d& x, uint32_t rows, uint32_t columns)
+    {
+        if (x.size() != rows)
+            return false;
+        for (const auto& row : x)
+            if (row.size() != columns)
+                return false;
+        return true;
+    };
+    if (hiddenSize == 0 || ! hasShape (kernel, gatesSize, inputSize) || ! hasShape (recurrentKernel, gatesSize, hiddenSize)
+        || biasIH.size() != gatesSize || biasHH.size() != gatesSize
+        || ! hasShape (denseWeights, 1, hiddenSize) || denseBias.size() != 1)
+        throw std::runtime_error ("Unexpected model weights shape");
+
+    Header header {};
+    header.magic = magicNumber;
+    header.version = formatVersion;
+    header.layerType = layerType;
+    header.inputSize = inputSize;
+    header.hiddenSize = hiddenSize;
+    header.sampleRate = modelDataJson.value ("sample_rate", 44100.0f);
+    header.numWeights = getNumWeights (layerType, inputSize, hiddenSize);
+
+    // the rows of gates, in the order of the PyTorch layer (LSTM: input, forget, cell, output,
+    // GRU: reset, update, new), padded with zeros
+    std::vector<float> weights;
+    weights.reserve (header.numWeights);
+    const auto padding = (size_t) getGatesStride (layerType, (int) hiddenSize) - gatesSize;
+    auto addRow = [&weights, padding, gatesSize] (auto&& getValue)
+    {
+        for (uint32_t k = 0; k < gatesSize; ++k)
+            weights.push_back (getValue (k));
+        weights.insert (weights.end(), padding, 0.0f);
+    };
+    for (uint32_t i = 0; i < inputSize; ++i)
+        addRow ([&] (uint32_t k)
+                { return kernel[k][i]; });
+    for (uint32_t i = 0; i < hiddenSize; ++i)
+        addRow ([&] (uint32_t k)
+                { return recurrentKernel[k][i]; });
+    if (layerType == LayerType::gru)
+    {
+        // the recurrent bias of the new gate is scaled by the reset gate, so it can't be summed
+        addRow ([&] (uint32_t k)
+                { return biasIH[k]; });
+        addRow ([&] (uint32_t k)
+                { return biasHH[k]; });
+    }
+    else
+    {
+        addRow ([&] (uint32_t k)
+                { return biasIH[k] + biasHH[k]; });
+    }
+    weights.insert (weights.end(), denseWeights[0].begin(), denseWeights[0].end());
+    weights.push_back (denseBias[0]);
+
+    std::vector<char> blob (sizeof (Header) + weights.size() * sizeof (float));
+    std::memcpy (blob.data(), &header, sizeof (Header));
+    std::memcpy (blob.data() + sizeof (Header), weights.data(), weights.size() * sizeof (float));
+    return blob;
+}
+} // namespace compiled_model
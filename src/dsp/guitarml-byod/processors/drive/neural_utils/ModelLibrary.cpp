@@ -0,0 +1,262 @@
+#include "ModelLibrary.h"
+#include "CompiledModelJson.h"
+
+namespace
+{
+// the model_data object of a model json, from the first few kilobytes of the file: the GuitarML
+// trainer writes it first, followed by the state_dict with the weights, so those don't need to be
+// read and parsed to index the model. nullopt if the file is laid out differently.
+std::optional<nlohmann::json> readModelHeader (const File& file)
+{
+    constexpr size_t headerSize = 4096;
+    FileInputStream stream (file);
+    if (stream.failedToOpen())
+        return std::nullopt;
+
+    MemoryBlock block;
+    stream.readIntoMemoryBlock (block, (ssize_t) headerSize);
+    const std::string_view header (static_cast<const char*> (block.getData()), block.getSize());
+
+    const auto key = header.find ("\"model_data\"");
+    const auto start = key == std::string_view::npos ? key : header.find ('{', key);
+    if (start == std::string_view::npos || header.find ("\"state_dict\"") == std::string_view::npos)
+        return std::nullopt;
+
+    auto depth = 0;
+    auto inString = false;
+    for (auto i = start; i < header.size(); ++i)
+    {
+        const auto c = header[i];
+        if (inString)
+        {
+            if (c == '\\')
+                ++i;
+            else if (c == '"')
+                inString = false;
+        }
+        else if (c == '"')
+            inString = true;
+        else if (c == '{')
+            ++depth;
+        else if (c == '}' && --depth == 0)
+            return nlohmann::json::parse (header.substr (start, i + 1 - start));
+    }
+    return std::nullopt;
+}
+} // namespace
+
+ModelLibrary::ModelLibrary() : Thread ("GuitarML model index")
+{
+}
+
+ModelLibrary::~ModelLibrary()
+{
+    stopThread (2000);
+}
+
+void ModelLibrary::setFolder (const File& newFolder)
+{
+    {
+        const ScopedLock sl (lock);
+        if (newFolder == folder)
+            return;
+
+        folder = newFolder;
+        entries.clear();
+        indexed = false;
+    }
+
+    if (isThreadRunning())
+        notify();
+    else
+        startThread (Thread::Priority::background);
+}
+
+File ModelLibrary::getFolder() const
+{
+    const ScopedLock sl (lock);
+    return folder;
+}
+
+bool ModelLibrary::isIndexed() const
+{
+    const ScopedLock sl (lock);
+    return indexed;
+}
+
+std::vector<ModelLibrary::Entry> ModelLibrary::getEntries() const
+{
+    const ScopedLock sl (lock);
+    return entries;
+}
+
+int ModelLibrary::getNumModels() const
+{
+    const ScopedLock sl (lock);
+    return (int) entries.size();
+}
+
+StringArray ModelLibrary::getModelNames() const
+{
+    const ScopedLock sl (lock);
+    StringArray names;
+    for (const auto& entry : entries)
+        names.add (entry.name);
+    return names;
+}
+
+std::optional<ModelLibrary::Entry> ModelLibrary::getEntry (int index) const
+{
+    const ScopedLock sl (lock);
+    if (! isPositiveAndBelow (index, (int) entries.size()))
+        return std::nullopt;
+    return entries[(size_t) index];
+}
+
+int ModelLibrary::indexOf (const File& file) const
+{
+    const ScopedLock sl (lock);
+    const auto entry = std::find_if (entries.begin(), entries.end(), [&file] (const Entry& e)
+                                     { return e.file == file; });
+    return entry != entries.end() ? (int) std::distance (entries.begin(), entry) : -1;
+}
+
+ModelRegistry::ModelPtr ModelLibrary::getModel (const File& modelFile)
+{
+    const auto path = modelFile.getFullPathName();
+    const auto lastModified = modelFile.getLastModificationTime();
+    {
+        const ScopedLock sl (loadedModelsLock);
+        const auto loaded = loadedModels.find (path);
+        if (loaded != loadedModels.end() && loaded->second.lastModified == lastModified)
+            if (auto model = loaded->second.model.lock())
+                return model;
+    }
+
+    auto model = compileModel (modelFile);
+    if (model == nullptr)
+        throw std::runtime_error ("Not a valid model file");
+
+    const ScopedLock sl (loadedModelsLock);
+    std::erase_if (loadedModels, [] (const auto& loaded)
+                   { return loaded.second.model.expired(); });
+    loadedModels[path] = { lastModified, model };
+    return model;
+}
+
+ModelRegistry::ModelPtr ModelLibrary::compileModel (const File& modelFile)
+{
+    const auto compiledFile = modelFile.withFileExtension (compiled_model::fileExtension);
+    if (compiledFile.existsAsFile() && compiledFile.getLastModificationTime() >= modelFile.getLastModificationTime())
+    {
+        MemoryMappedFile mappedFile (compiledFile, MemoryMappedFile::readOnly);
+        if (auto model = ModelRegistry::get (mappedFile.getData(), mappedFile.getSize()))
+            return model;
+    }
+
+    const auto compiled = compiled_model::compile (nlohmann::json::parse (modelFile.loadFileAsString().toStdString()));
+    auto model = ModelRegistry::get (compiled.data(), compiled.size());
+
+    // without write access to the models folder, the json is simply parsed again next time
+    if (model != nullptr)
+        compiledFile.replaceWithData (compiled.data(), compiled.size());
+    return model;
+}
+
+void ModelLibrary::run()
+{
+    while (! threadShouldExit())
+    {
+        indexFolder();
+        wait (rescanIntervalMs);
+    }
+}
+
+void ModelLibrary::indexFolder()
+{
+    File folderToIndex;
+    std::vector<Entry> previousEntries;
+    {
+        const ScopedLock sl (lock);
+        folderToIndex = folder;
+        previousEntries = entries;
+    }
+
+    if (folderToIndex == File {})
+        return;
+    if (! folderToIndex.isDirectory())
+        folderToIndex.createDirectory();
+
+    // only the files that are new or have changed since the last walk are read again
+    std::vector<Entry> newEntries;
+    for (const auto& child : RangedDirectoryIterator (folderToIndex, true, "*.json", File::findFiles))
+    {
+        if (threadShouldExit())
+            return;
+
+        const auto& file = child.getFile();
+        const auto previous = std::find_if (previousEntries.begin(), previousEntries.end(), [&child, &file] (const Entry& entry)
+                                            { return entry.file == file && entry.lastModified == child.getModificationTime() && entry.fileSize == child.getFileSize(); });
+        newEntries.push_back (previous != previousEntries.end() ? *previous : readEntry (file, child.getModificationTime(), child.getFileSize()));
+    }
+
+    std::sort (newEntries.begin(), newEntries.end(), [] (const Entry& a, const Entry& b)
+               {
+                   const auto byName = a.name.compareNatural (b.name);
+                   return byName != 0 ? byName < 0 : a.file.getParentDirectory().getFullPathName().compareNatural (b.file.getParentDirectory().getFullPathName()) < 0;
+               });
+
+    auto isSameEntry = [] (const Entry& a, const Entry& b)
+    {
+        return a.file == b.file && a.lastModified == b.lastModified && a.fileSize == b.fileSize;
+    };
+
+    {
+        const ScopedLock sl (lock);
+        if (folder != folderToIndex)
+            return;
+
+        const auto changed = ! indexed || ! std::equal (newEntries.begin(), newEntries.end(), entries.begin(), entries.end(), isSameEntry);
+        entries = std::move (newEntries);
+        indexed = true;
+        if (! changed)
+            return;
+    }
+
+    sendChangeMessage();
+}
+
+ModelLibrary::Entry ModelLibrary::readEntry (const File& file, Time lastModified, int64 fileSize)
+{
+    Entry entry;
+    entry.file = file;
+    entry.name = file.getFileNameWithoutExtension().replace ("_", " ");
+    entry.lastModified = lastModified;
+    entry.fileSize = fileSize;
+
+    try
+    {
+        // the whole json is only parsed when the header can't be found at its start
+        auto modelDataJson = readModelHeader (file);
+        auto hasWeights = modelDataJson.has_value();
+        if (! modelDataJson.has_value())
+        {
+            const auto modelJson = nlohmann::json::parse (file.loadFileAsString().toStdString());
+            modelDataJson = modelJson.at ("model_data");
+            hasWeights = modelJson.contains ("state_dict");
+        }
+
+        entry.architecture.inputSize = modelDataJson->value ("input_size", 1);
+        entry.architecture.hiddenSize = modelDataJson->value ("hidden_size", 0);
+        const auto unitType = modelDataJson->value ("unit_type", std::string { "LSTM" });
+        entry.architecture.layerType = unitType == "GRU" ? RecurrentLayerType::GRULayer : RecurrentLayerType::LSTMLayer;
+        entry.sampleRate = modelDataJson->value ("sample_rate", 44100.0);
+        entry.isSupported = (unitType == "LSTM" || unitType == "GRU") && hasWeights
+                            && rnn_dispatch::isSupported (entry.architecture);
+    }
+    catch (const std::exception&)
+    {
+        // listed all the same: loading it reports what is wrong
+    }
+    return entry;
+}
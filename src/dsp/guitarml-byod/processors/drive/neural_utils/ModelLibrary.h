@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ModelRegistry.h"
+#include "RNNDispatch.h"
+
+/**
+ * Process-wide index of the user models: the GuitarML model jsons in a folder and its sub-folders.
+ * The folder is walked on a background thread, once when it is set and then every few seconds to
+ * pick up changes, so no plugin instance walks it itself or waits for it. Only new and changed
+ * files are read, and of those only the model_data header at the start. The names and
+ * architectures of the models are cached, and each model file is compiled once and shared by all
+ * the instances running it.
+ *
+ * The index of a model moves when files are added or removed before it, so a selection that is to
+ * be kept (as in a saved session) is best kept by file, see indexOf.
+ *
+ * Held through a SharedResourcePointer: the first instance starts the index, the last stops it.
+ */
+class ModelLibrary : public ChangeBroadcaster,
+                     private Thread
+{
+public:
+    struct Entry
+    {
+        File file;
+        String name; // the file name, with spaces for underscores
+        Time lastModified;
+        int64 fileSize = 0;
+
+        // from the model data of the json
+        bool isSupported = false;
+        rnn_dispatch::Architecture architecture;
+        double sampleRate = 0.0;
+    };
+
+    ModelLibrary();
+    ~ModelLibrary() override;
+
+    /** Indexes this folder from now on (in the background), creating it if it doesn't exist */
+    void setFolder (const File& newFolder);
+    File getFolder() const;
+
+    /** Whether the folder has been walked since it was set, before that the index is empty */
+    bool isIndexed() const;
+
+    /** The models found, sorted by file name and then by folder. Change messages tell of updates. */
+    std::vector<Entry> getEntries() const;
+    int getNumModels() const;
+    StringArray getModelNames() const;
+
+    /** The model at the index, or nullopt if there is none (anymore) */
+    std::optional<Entry> getEntry (int index) const;
+
+    /** The index of the model in the file, or -1 if it isn't in the index (yet) */
+    int indexOf (const File& file) const;
+
+    /**
+     * The shared compiled model of a json file, compiled on first use (the compiled form is cached
+     * next to the json, and read from there as long as it isn't older). Throws if the file holds
+     * no valid model.
+     */
+    ModelRegistry::ModelPtr getModel (const File& modelFile);
+
+private:
+    void run() override;
+    void indexFolder();
+    static Entry readEntry (const File& file, Time lastModified, int64 fileSize);
+    static ModelRegistry::ModelPtr compileModel (const File& modelFile);
+
+    static constexpr int rescanIntervalMs = 5000;
+
+    mutable CriticalSection lock;
+    File folder;
+    std::vector<Entry> entries;
+    bool indexed = false;
+
+    // the models compiled from files, as long as any instance runs them
+    struct LoadedModel
+    {
+        Time lastModified;
+        std::weak_ptr<const ModelRegistry::Model> model;
+    };
+    CriticalSection loadedModelsLock;
+    std::map<String, LoadedModel> loadedModels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModelLibrary)
+};
@@ -0,0 +1,71 @@
+#include "ModelRegistry.h"
+
+namespace
+{
+struct Registry
+{
+    CriticalSection lock;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const ModelRegistry::Model>> models;
+};
+
+Registry& getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+uint64_t hashModelData (const void* data, size_t numBytes)
+{
+    // FNV-1a over 64 bit words, which is plenty to tell models apart (equal hashes get compared)
+    const auto* bytes = static_cast<const char*> (data);
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + sizeof (uint64_t) <= numBytes; i += sizeof (uint64_t))
+    {
+        uint64_t word;
+        std::memcpy (&word, bytes + i, sizeof (word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < numBytes; ++i)
+        hash = (hash ^ (uint8_t) bytes[i]) * 1099511628211ULL;
+    return hash;
+}
+} // namespace
+
+ModelRegistry::ModelPtr ModelRegistry::get (const void* modelData, size_t modelDataSize)
+{
+    compiled_model::View weights;
+    if (! compiled_model::getView (modelData, modelDataSize, weights))
+        return nullptr;
+
+    const auto key = hashModelData (modelData, modelDataSize);
+    auto& registry = getRegistry();
+    const ScopedLock sl (registry.lock);
+
+    const auto [first, last] = registry.models.equal_range (key);
+    for (auto it = first; it != last; ++it)
+    {
+        auto model = it->second.lock();
+        if (model != nullptr && model->data.size() == modelDataSize && std::memcmp (model->data.data(), modelData, modelDataSize) == 0)
+            return model;
+    }
+
+    // forget the models nobody uses anymore
+    std::erase_if (registry.models, [] (const auto& entry)
+                   { return entry.second.expired(); });
+
+    auto model = std::make_shared<Model>();
+    model->data.assign (static_cast<const char*> (modelData), static_cast<const char*> (modelData) + modelDataSize);
+    compiled_model::getView (model->data.data(), model->data.size(), model->weights);
+    registry.models.emplace (key, model);
+    return model;
+}
+
+int ModelRegistry::getNumModels()
+{
+    auto& registry = getRegistry();
+    const ScopedLock sl (registry.lock);
+
+    return (int) std::count_if (registry.models.begin(), registry.models.end(), [] (const auto& entry)
+                                { return ! entry.second.expired(); });
+}
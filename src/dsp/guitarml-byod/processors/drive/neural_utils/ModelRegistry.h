@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CompiledModel.h"
+#include "../../../pch.h"
+
+/**
+ * Process-wide registry of the compiled models in use. All the instances loading the same model
+ * share one read-only copy of its weights, which lives as long as any of them holds on to it.
+ */
+class ModelRegistry
+{
+public:
+    struct Model
+    {
+        std::vector<char> data;
+        compiled_model::View weights;
+    };
+    using ModelPtr = std::shared_ptr<const Model>;
+
+    /** Returns the shared copy of a compiled model, or nullptr if the data is no valid model */
+    static ModelPtr get (const void* modelData, size_t modelDataSize);
+
+    /** The number of distinct models currently alive */
+    static int getNumModels();
+
+private:
+    ModelRegistry() = delete;
+};
@@ -12,7 +12,25 @@
 
 #include <RTNeural/RTNeural.h>
 #include <math_approx/math_approx.hpp>
+#include "SharedWeightsRNN.h"
 
+#if __clang__
+#pragma GCC diagnostic pop
+#endif
+
+#if BYOD_RNN_HAS_INTEL_TARGETS && BYOD_COMPILING_WITH_AVX512
+namespace rnn_avx512
+#elif BYOD_RNN_HAS_INTEL_TARGETS && BYOD_COMPILING_WITH_AVX
+namespace rnn_avx
+#else
+namespace rnn_sse_arm
+#endif
+{
+// the AVX builds have nothing to build off Intel
+#if BYOD_RNN_HAS_INTEL_TARGETS || ! (BYOD_COMPILING_WITH_AVX || BYOD_COMPILING_WITH_AVX512)
+
+// declared in the namespace of the instruction set, so the layers instantiated with it are too:
+// the linker would otherwise keep one build of them for all the instruction sets
 struct RNNMathsProvider
 {
     template <typename T>
@@ -28,34 +46,29 @@ struct RNNMathsProvider
     }
 };
 
-#include "model_loaders.h"
-
-#if __clang__
-#pragma GCC diagnostic pop
-#endif
-
-#if (__MMX__ || __SSE__ || __amd64__) && BYOD_COMPILING_WITH_AVX // INTEL + AVX
-namespace rnn_avx
+const char* get_instruction_set_name() noexcept
+{
+#ifdef XSIMD_NO_SUPPORTED_ARCHITECTURE
+    return "scalar";
 #else
-namespace rnn_sse_arm
+    return xsimd::default_arch::name();
 #endif
-{
-#if ! (XSIMD_WITH_NEON && BYOD_COMPILING_WITH_AVX)
+}
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 struct RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::Internal
 {
-    using RecurrentLayerTypeComplete = std::conditional_t<RecurrentLayerType == RecurrentLayerType::LSTMLayer,
-                                                          RTNEURAL_NAMESPACE::LSTMLayerT<float, inputSize, hiddenSize, (RTNEURAL_NAMESPACE::SampleRateCorrectionMode) SRCMode, RNNMathsProvider>,
-                                                          RTNEURAL_NAMESPACE::GRULayerT<float, inputSize, hiddenSize, (RTNEURAL_NAMESPACE::SampleRateCorrectionMode) SRCMode, RNNMathsProvider>>;
-    using DenseLayerType = RTNEURAL_NAMESPACE::DenseT<float, hiddenSize, 1>;
-    RTNEURAL_NAMESPACE::ModelT<float, inputSize, 1, RecurrentLayerTypeComplete, DenseLayerType> model;
+    static_assert (RecurrentLayerType == RecurrentLayerType::LSTMLayer || RecurrentLayerType == RecurrentLayerType::GRULayer);
+    static constexpr auto layerType = (compiled_model::LayerType) RecurrentLayerType;
+
+    // the weights belong to a shared compiled model
+    SharedWeightsRNN<inputSize, hiddenSize, layerType, RNNMathsProvider> model;
 };
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::RNNAccelerated()
 {
-    static_assert (sizeof (Internal) <= max_model_size);
+    static_assert (sizeof (Internal) <= max_model_size && alignof (Internal) <= alignment);
     internal = new (internal_data) Internal();
 }
 
@@ -66,30 +79,26 @@ RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::~RNNAccelera
 }
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
-void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::initialise (const nlohmann::json& weights_json)
+void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::initialise (const compiled_model::View& weights)
 {
-    // @TODO: handle GRU models if needed...
-    model_loaders::loadLSTMModel (internal->model, weights_json);
+    if (weights.layerType != Internal::layerType || weights.inputSize != inputSize || weights.hiddenSize != hiddenSize)
+        return;
+
+    internal->model.setWeights (weights);
 }
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::prepare ([[maybe_unused]] int rnnDelaySamples)
 {
     if constexpr (SRCMode == (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp)
-    {
-        internal->model.template get<0>().prepare (rnnDelaySamples);
-        internal->model.reset();
-    }
+        internal->model.setDelay ((float) rnnDelaySamples);
 }
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::prepare ([[maybe_unused]] float rnnDelaySamples)
 {
     if constexpr (SRCMode == (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp)
-    {
-        internal->model.template get<0>().prepare (rnnDelaySamples);
-        internal->model.reset();
-    }
+        internal->model.setDelay (rnnDelaySamples);
 }
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
@@ -101,22 +110,35 @@ void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::reset()
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::process (std::span<float> buffer, bool useResiduals) noexcept
 {
+    float input_vec[inputSize] {};
     if (useResiduals)
     {
         for (auto& x : buffer)
-            x += internal->model.forward (&x);
+        {
+            input_vec[0] = x;
+            x += internal->model.forward (input_vec);
+        }
     }
     else
     {
         for (auto& x : buffer)
-            x = internal->model.forward (&x);
+        {
+            input_vec[0] = x;
+            x = internal->model.forward (input_vec);
+        }
     }
 }
 
 template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
 void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::process_conditioned (std::span<float> buffer, std::span<const float> condition, bool useResiduals) noexcept
 {
-    alignas (alignment) float input_vec[xsimd::batch<float>::size] {};
+    if constexpr (inputSize < 2)
+    {
+        process (buffer, useResiduals);
+        return;
+    }
+
+    float input_vec[inputSize] {};
     if (useResiduals)
     {
         for (size_t n = 0; n < buffer.size(); ++n)
@@ -137,9 +159,91 @@ void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::process
     }
 }
 
-template class RNNAccelerated<1, 28, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>; // MetalFace
-template class RNNAccelerated<2, 24, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>; // BassFace
-template class RNNAccelerated<1, 40, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>; // GuitarML (no-cond)
-template class RNNAccelerated<2, 40, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>; // GuitarML (cond)
-#endif // NEON + AVX
+template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
+void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::process_batch (std::span<RNNAccelerated* const> models,
+                                                                                        std::span<float* const> buffers,
+                                                                                        std::span<const float* const> conditions,
+                                                                                        size_t numSamples,
+                                                                                        bool useResiduals) noexcept
+{
+    // models on different weights can't share a batch, so they fall back to one at a time
+    const auto hasSameWeights = std::all_of (models.begin(), models.end(), [&models] (const RNNAccelerated* model)
+                                             { return model->internal->model.hasSameWeights (models[0]->internal->model); });
+
+    for (size_t first = 0; first < models.size();)
+    {
+        const auto batchSize = hasSameWeights ? std::min (max_batch_size, models.size() - first) : (size_t) 1;
+        const auto* const* batchConditions = inputSize > 1 ? conditions.data() + first : nullptr;
+        switch (batchSize)
+        {
+            case 4:
+                process_batch_of<4> (models.data() + first, buffers.data() + first, batchConditions, numSamples, useResiduals);
+                break;
+            case 3:
+                process_batch_of<3> (models.data() + first, buffers.data() + first, batchConditions, numSamples, useResiduals);
+                break;
+            case 2:
+                process_batch_of<2> (models.data() + first, buffers.data() + first, batchConditions, numSamples, useResiduals);
+                break;
+            default:
+                process_batch_of<1> (models.data() + first, buffers.data() + first, batchConditions, numSamples, useResiduals);
+                break;
+        }
+        first += batchSize;
+    }
+}
+
+template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
+template <int batchSize>
+void RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>::process_batch_of (RNNAccelerated* const* models,
+                                                                                           float* const* buffers,
+                                                                                           const float* const* conditions,
+                                                                                           size_t numSamples,
+                                                                                           bool useResiduals) noexcept
+{
+    using Layer = decltype (Internal::model);
+    Layer* layers[batchSize];
+    for (int b = 0; b < batchSize; ++b)
+        layers[b] = &models[b]->internal->model;
+
+    static_assert (batchSize <= (int) max_batch_size);
+
+    float inputs[batchSize][inputSize] {};
+    float outputs[batchSize];
+    for (size_t n = 0; n < numSamples; ++n)
+    {
+        for (int b = 0; b < batchSize; ++b)
+        {
+            inputs[b][0] = buffers[b][n];
+            if constexpr (inputSize > 1)
+                inputs[b][1] = conditions[b][n];
+        }
+
+        Layer::template forwardBatch<batchSize> (layers, inputs, outputs);
+
+        for (int b = 0; b < batchSize; ++b)
+            buffers[b][n] = useResiduals ? buffers[b][n] + outputs[b] : outputs[b];
+    }
+}
+
+// GuitarML: without and with condition, LSTM and GRU, for each of rnn_dispatch::SupportedHiddenSizes
+// (the native rate models run without interpolation)
+#define BYOD_INSTANTIATE_GUITARML_RNN(hiddenSize)                                                                                               \
+    template class RNNAccelerated<1, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>; \
+    template class RNNAccelerated<2, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>; \
+    template class RNNAccelerated<1, hiddenSize, RecurrentLayerType::GRULayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>;  \
+    template class RNNAccelerated<2, hiddenSize, RecurrentLayerType::GRULayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::LinInterp>;  \
+    template class RNNAccelerated<1, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>;  \
+    template class RNNAccelerated<2, hiddenSize, RecurrentLayerType::LSTMLayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>;  \
+    template class RNNAccelerated<1, hiddenSize, RecurrentLayerType::GRULayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>;   \
+    template class RNNAccelerated<2, hiddenSize, RecurrentLayerType::GRULayer, (int) RTNEURAL_NAMESPACE::SampleRateCorrectionMode::NoInterp>;
+
+BYOD_INSTANTIATE_GUITARML_RNN (8)
+BYOD_INSTANTIATE_GUITARML_RNN (12)
+BYOD_INSTANTIATE_GUITARML_RNN (16)
+BYOD_INSTANTIATE_GUITARML_RNN (20)
+BYOD_INSTANTIATE_GUITARML_RNN (32)
+BYOD_INSTANTIATE_GUITARML_RNN (40)
+#undef BYOD_INSTANTIATE_GUITARML_RNN
+#endif // INTEL || baseline
 }
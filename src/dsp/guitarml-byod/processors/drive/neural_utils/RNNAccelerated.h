@@ -1,6 +1,6 @@
 #pragma once
 
-#include <modules/json/json.hpp>
+#include "CompiledModel.h"
 #include <span>
 
 namespace RecurrentLayerType
@@ -8,71 +8,32 @@ namespace RecurrentLayerType
 constexpr int LSTMLayer = 1;
 constexpr int GRULayer = 2;
 } // namespace RecurrentLayerType
+static_assert (RecurrentLayerType::LSTMLayer == (int) compiled_model::LayerType::lstm
+               && RecurrentLayerType::GRULayer == (int) compiled_model::LayerType::gru);
+
+// RNNAccelerated.cpp is built once per instruction set, each build in its own namespace: the
+// baseline one (SSE2, NEON or WASM SIMD, whatever the target has) and, on Intel, AVX and AVX-512
+// ones. RNNDispatch picks the one to run on at startup.
+#if __MMX__ || __SSE__ || __amd64__ || _M_X64 || _M_IX86 // INTEL
+#define BYOD_RNN_HAS_INTEL_TARGETS 1
+#endif
 
 namespace rnn_sse_arm
 {
-template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
-class RNNAccelerated
-{
-public:
-    RNNAccelerated();
-    ~RNNAccelerated();
-
-    RNNAccelerated (const RNNAccelerated&) = delete;
-    RNNAccelerated& operator= (const RNNAccelerated&) = delete;
-    RNNAccelerated (RNNAccelerated&&) noexcept = delete;
-    RNNAccelerated& operator= (RNNAccelerated&&) noexcept = delete;
-
-    void initialise (const nlohmann::json& weights_json);
-
-    void prepare (int rnnDelaySamples);
-    void prepare (float rnnDelaySamples);
-    void reset();
-
-    void process (std::span<float> buffer, bool useResiduals = false) noexcept;
-    void process_conditioned (std::span<float> buffer, std::span<const float> condition, bool useResiduals = false) noexcept;
-
-private:
-    struct Internal;
-    Internal* internal = nullptr;
-
-    static constexpr size_t max_model_size = 30000;
-    static constexpr size_t alignment = 16;
-    alignas (alignment) char internal_data[max_model_size] {};
-};
+constexpr size_t simd_alignment = 16;
+#include "RNNAcceleratedClass.h"
 } // namespace rnn_sse_arm
 
-#if __MMX__ || __SSE__ || __amd64__ // INTEL
+#if BYOD_RNN_HAS_INTEL_TARGETS
 namespace rnn_avx
 {
-template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
-class RNNAccelerated
-{
-public:
-    RNNAccelerated();
-    ~RNNAccelerated();
-
-    RNNAccelerated (const RNNAccelerated&) = delete;
-    RNNAccelerated& operator= (const RNNAccelerated&) = delete;
-    RNNAccelerated (RNNAccelerated&&) noexcept = delete;
-    RNNAccelerated& operator= (RNNAccelerated&&) noexcept = delete;
-
-    void initialise (const nlohmann::json& weights_json);
-
-    void prepare (int rnnDelaySamples);
-    void prepare (float rnnDelaySamples);
-    void reset();
-
-    void process (std::span<float> buffer, bool useResiduals = false) noexcept;
-    void process_conditioned (std::span<float> buffer, std::span<const float> condition, bool useResiduals = false) noexcept;
-
-private:
-    struct Internal;
-    Internal* internal = nullptr;
-
-    static constexpr size_t max_model_size = 40000;
-    static constexpr size_t alignment = 32;
-    alignas (alignment) char internal_data[max_model_size] {};
-};
+constexpr size_t simd_alignment = 32;
+#include "RNNAcceleratedClass.h"
 } // namespace rnn_avx
+
+namespace rnn_avx512
+{
+constexpr size_t simd_alignment = 64;
+#include "RNNAcceleratedClass.h"
+} // namespace rnn_avx512
 #endif
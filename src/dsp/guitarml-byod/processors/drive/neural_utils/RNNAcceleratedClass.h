@@ -0,0 +1,51 @@
+// The declaration of RNNAccelerated, included once into the namespace of each instruction set it
+// is built for (see RNNAccelerated.h) - with simd_alignment declared there.
+
+template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
+class RNNAccelerated
+{
+public:
+    RNNAccelerated();
+    ~RNNAccelerated();
+
+    RNNAccelerated (const RNNAccelerated&) = delete;
+    RNNAccelerated& operator= (const RNNAccelerated&) = delete;
+    RNNAccelerated (RNNAccelerated&&) noexcept = delete;
+    RNNAccelerated& operator= (RNNAccelerated&&) noexcept = delete;
+
+    void initialise (const compiled_model::View& weights);
+
+    void prepare (int rnnDelaySamples);
+    void prepare (float rnnDelaySamples);
+    void reset();
+
+    void process (std::span<float> buffer, bool useResiduals = false) noexcept;
+    void process_conditioned (std::span<float> buffer, std::span<const float> condition, bool useResiduals = false) noexcept;
+
+    /**
+     * Processes one block for each of several models initialised with the same weights, stepping
+     * all of them together such that the weights are loaded once per sample for up to
+     * max_batch_size models. The conditions are only read by models with two inputs.
+     */
+    static void process_batch (std::span<RNNAccelerated* const> models,
+                               std::span<float* const> buffers,
+                               std::span<const float* const> conditions,
+                               size_t numSamples,
+                               bool useResiduals = false) noexcept;
+
+    static constexpr size_t max_batch_size = 4;
+
+private:
+    template <int batchSize>
+    static void process_batch_of (RNNAccelerated* const* models, float* const* buffers, const float* const* conditions, size_t numSamples, bool useResiduals) noexcept;
+
+    struct Internal;
+    Internal* internal = nullptr;
+
+    static constexpr size_t max_model_size = 8192;
+    static constexpr size_t alignment = simd_alignment;
+    alignas (alignment) char internal_data[max_model_size] {};
+};
+
+/** The instruction set this build of RNNAccelerated.cpp runs on, as xsimd names it */
+const char* get_instruction_set_name() noexcept;
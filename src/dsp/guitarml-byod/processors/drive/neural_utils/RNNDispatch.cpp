@@ -0,0 +1,112 @@
+#include "RNNDispatch.h"
+
+#if BYOD_RNN_HAS_INTEL_TARGETS
+#if defined(_MSC_VER) && ! defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace rnn_dispatch
+{
+namespace
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+struct CPUIDRegisters
+{
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+};
+
+CPUIDRegisters cpuid (uint32_t leaf, uint32_t subleaf = 0)
+{
+    CPUIDRegisters registers;
+#if defined(_MSC_VER) && ! defined(__clang__)
+    int values[4] {};
+    __cpuidex (values, (int) leaf, (int) subleaf);
+    registers = { (uint32_t) values[0], (uint32_t) values[1], (uint32_t) values[2], (uint32_t) values[3] };
+#else
+    __cpuid_count (leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+    return registers;
+}
+
+// the register state the OS saves on context switches
+uint64_t getEnabledRegisterState()
+{
+#if defined(_MSC_VER) && ! defined(__clang__)
+    return _xgetbv (0);
+#else
+    uint32_t low = 0, high = 0;
+    __asm__ volatile ("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((uint64_t) high << 32) | low;
+#endif
+}
+
+bool hasBit (uint32_t value, int bit)
+{
+    return (value >> bit) & 1u;
+}
+
+bool detectSupport (Target target)
+{
+    if (target == Target::baseline)
+        return true;
+
+    // AVX, FMA and F16C, with the OS saving the YMM registers
+    const auto leaf1 = cpuid (1);
+    if (! hasBit (leaf1.ecx, 27) || ! hasBit (leaf1.ecx, 28) || ! hasBit (leaf1.ecx, 12) || ! hasBit (leaf1.ecx, 29))
+        return false;
+
+    const auto registerState = getEnabledRegisterState();
+    if ((registerState & 0x6) != 0x6)
+        return false;
+
+    if (target == Target::avx)
+        return true;
+
+    // AVX-512 F, DQ, BW and VL, with the OS saving the opmask and ZMM registers as well
+    if (cpuid (0).eax < 7 || (registerState & 0xe6) != 0xe6)
+        return false;
+
+    const auto leaf7 = cpuid (7);
+    return hasBit (leaf7.ebx, 16) && hasBit (leaf7.ebx, 17) && hasBit (leaf7.ebx, 30) && hasBit (leaf7.ebx, 31);
+}
+#else
+bool detectSupport (Target target)
+{
+    return target == Target::baseline;
+}
+#endif
+} // namespace
+
+bool isSupported (Target target) noexcept
+{
+    static const bool supported[] = { detectSupport (Target::baseline), detectSupport (Target::avx), detectSupport (Target::avx512) };
+    return supported[(size_t) target];
+}
+
+Target getTarget() noexcept
+{
+    static const auto target = []
+    {
+        for (auto candidate : { Target::avx512, Target::avx })
+            if (isSupported (candidate))
+                return candidate;
+        return Target::baseline;
+    }();
+    return target;
+}
+
+const char* getInstructionSetName (Target target) noexcept
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+    if (target == Target::avx512)
+        return rnn_avx512::get_instruction_set_name();
+    if (target == Target::avx)
+        return rnn_avx::get_instruction_set_name();
+#endif
+    (void) target;
+    return rnn_sse_arm::get_instruction_set_name();
+}
+} // namespace rnn_dispatch
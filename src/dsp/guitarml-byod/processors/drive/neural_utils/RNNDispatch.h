@@ -0,0 +1,133 @@
+#pragma once
+
+#include "RNNAccelerated.h"
+#include <ea_variant/ea_variant.h>
+#include <utility>
+
+/**
+ * Runtime selection of the RNNAccelerated build for the CPU we are running on. The best target
+ * the CPU supports is detected once, and every model variant is created for that target, so all
+ * the models of a process run on the same instruction set.
+ *
+ * The architecture of a model (inputs, hidden size and layer type) is only known once its json is
+ * read, so the models it may have are held in a variant of all the supported architectures too.
+ */
+namespace rnn_dispatch
+{
+enum class Target
+{
+    baseline, // SSE2, NEON or WASM SIMD, whatever the build targets
+    avx, // AVX with FMA and F16C
+    avx512, // AVX-512 F, VL, BW and DQ
+};
+
+/** Whether this CPU (and OS) can run the given target */
+bool isSupported (Target target) noexcept;
+
+/** The best target this CPU supports, detected on the first call */
+Target getTarget() noexcept;
+
+/** The instruction set the build for the target runs on, as xsimd names it */
+const char* getInstructionSetName (Target target) noexcept;
+
+template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
+using ModelVariant = EA::Variant<rnn_sse_arm::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>
+#if BYOD_RNN_HAS_INTEL_TARGETS
+                                 ,
+                                 rnn_avx::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>,
+                                 rnn_avx512::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>
+#endif
+                                 >;
+
+/** Replaces the model in the variant by a new one built for the target */
+template <int inputSize, int hiddenSize, int RecurrentLayerType, int SRCMode>
+void emplaceModel (ModelVariant<inputSize, hiddenSize, RecurrentLayerType, SRCMode>& variant, Target target = getTarget())
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+    if (target == Target::avx512)
+    {
+        variant.template emplace<rnn_avx512::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>>();
+        return;
+    }
+
+    if (target == Target::avx)
+    {
+        variant.template emplace<rnn_avx::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>>();
+        return;
+    }
+#endif
+    (void) target;
+    variant.template emplace<rnn_sse_arm::RNNAccelerated<inputSize, hiddenSize, RecurrentLayerType, SRCMode>>();
+}
+
+/** The shape of a model, which selects the RNNAccelerated instantiation it runs on */
+struct Architecture
+{
+    int inputSize = 1;
+    int hiddenSize = 40;
+    int layerType = RecurrentLayerType::LSTMLayer;
+
+    bool operator== (const Architecture&) const = default;
+};
+
+inline Architecture getArchitecture (const compiled_model::View& weights)
+{
+    return { weights.inputSize, weights.hiddenSize, (int) weights.layerType };
+}
+
+/** The hidden sizes RNNAccelerated is built for, with one or two inputs and LSTM or GRU layers each */
+using SupportedHiddenSizes = std::integer_sequence<int, 8, 12, 16, 20, 32, 40>;
+
+/**
+ * Calls callback.template operator()<inputSize, hiddenSize, layerType>() with the architecture as
+ * template arguments, returns false without calling it for an architecture that isn't supported.
+ */
+template <typename Callback>
+bool visitArchitecture (const Architecture& architecture, Callback&& callback)
+{
+    return [&architecture, &callback]<int... hiddenSizes> (std::integer_sequence<int, hiddenSizes...>)
+    {
+        auto visitHiddenSize = [&architecture, &callback]<int inputSize, int layerType>()
+        {
+            return ((architecture.hiddenSize == hiddenSizes && (callback.template operator()<inputSize, hiddenSizes, layerType>(), true)) || ...);
+        };
+
+        if (architecture.layerType == RecurrentLayerType::LSTMLayer)
+            return architecture.inputSize == 1   ? visitHiddenSize.template operator()<1, RecurrentLayerType::LSTMLayer>()
+                   : architecture.inputSize == 2 ? visitHiddenSize.template operator()<2, RecurrentLayerType::LSTMLayer>()
+                                                 : false;
+        if (architecture.layerType == RecurrentLayerType::GRULayer)
+            return architecture.inputSize == 1   ? visitHiddenSize.template operator()<1, RecurrentLayerType::GRULayer>()
+                   : architecture.inputSize == 2 ? visitHiddenSize.template operator()<2, RecurrentLayerType::GRULayer>()
+                                                 : false;
+        return false;
+    }(SupportedHiddenSizes {});
+}
+
+inline bool isSupported (const Architecture& architecture)
+{
+    return visitArchitecture (architecture, []<int, int, int>() {});
+}
+
+namespace detail
+{
+    template <template <int, int, int> class Model, int... hiddenSizes>
+    EA::Variant<Model<1, hiddenSizes, RecurrentLayerType::LSTMLayer>...,
+                Model<2, hiddenSizes, RecurrentLayerType::LSTMLayer>...,
+                Model<1, hiddenSizes, RecurrentLayerType::GRULayer>...,
+                Model<2, hiddenSizes, RecurrentLayerType::GRULayer>...>
+        makeArchitectureVariant (std::integer_sequence<int, hiddenSizes...>);
+} // namespace detail
+
+/** A variant of Model<inputSize, hiddenSize, layerType> for every supported architecture */
+template <template <int, int, int> class Model>
+using ArchitectureVariant = decltype (detail::makeArchitectureVariant<Model> (SupportedHiddenSizes {}));
+
+/** Replaces the model in the variant by one of the architecture, returns false if that isn't supported */
+template <template <int, int, int> class Model>
+bool emplaceArchitecture (ArchitectureVariant<Model>& variant, const Architecture& architecture)
+{
+    return visitArchitecture (architecture, [&variant]<int inputSize, int hiddenSize, int layerType>()
+                              { variant.template emplace<Model<inputSize, hiddenSize, layerType>>(); });
+}
+} // namespace rnn_dispatch
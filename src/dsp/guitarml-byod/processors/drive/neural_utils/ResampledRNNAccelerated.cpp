@@ -3,38 +3,31 @@
 template <int numIns, int hiddenSize, int RecurrentLayerType>
 ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::ResampledRNNAccelerated()
 {
-#if JUCE_INTEL
-    if (juce::SystemStats::hasAVX() && juce::SystemStats::hasFMA3())
-    {
-        juce::Logger::writeToLog ("Using RNN model with AVX SIMD instructions!");
-        model_variant.template emplace<rnn_avx::RNNAccelerated<numIns, hiddenSize, RecurrentLayerType, (int) RTNeural::SampleRateCorrectionMode::NoInterp>>();
-    }
-#endif
-    juce::ignoreUnused (this);
+    rnn_dispatch::emplaceModel (model_variant);
 }
 
 template <int numIns, int hiddenSize, int RecurrentLayerType>
-void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::initialise (const void* modelData, int modelDataSize, double modelSampleRate)
+void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::initialise (const compiled_model::View& weights)
 {
-    targetSampleRate = modelSampleRate;
-
-    MemoryInputStream jsonInputStream (modelData, (size_t) modelDataSize, false);
-    auto weightsJson = nlohmann::json::parse (jsonInputStream.readEntireStreamAsString().toStdString());
+    targetSampleRate = weights.sampleRate;
 
-    model_variant.visit ([&weightsJson] (auto& model)
-                         { model.initialise (weightsJson); });
+    model_variant.visit ([&weights] (auto& model)
+                         { model.initialise (weights); });
 }
 
 template <int numIns, int hiddenSize, int RecurrentLayerType>
-void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::prepare (double sampleRate, int samplesPerBlock)
+void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::prepare (double sampleRate, int samplesPerBlock, bool runAtModelRate)
 {
-    const auto [resampleRatio, rnnDelaySamples] = [] (auto curFs, auto targetFs)
+    const auto [resampleRatio, rnnDelaySamples] = [runAtModelRate] (auto curFs, auto targetFs)
     {
         if (curFs == targetFs)
             return std::make_pair (1.0, 1);
 
         if (curFs > targetFs)
         {
+            if (runAtModelRate)
+                return std::make_pair (targetFs / curFs, 1);
+
             const auto delaySamples = std::ceil (curFs / targetFs);
             return std::make_pair (delaySamples * targetFs / curFs, (int) delaySamples);
         }
@@ -45,6 +38,9 @@ void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::prepare (d
 
     needsResampling = resampleRatio != 1.0;
     resampler.prepareWithTargetSampleRate ({ sampleRate, (uint32) samplesPerBlock, 1 }, sampleRate * resampleRatio);
+    conditionAtSampleRate.resize ((size_t) std::ceil (samplesPerBlock * resampleRatio) + 2 * resamplerKernelSize, 0.0f);
+
+    latencySamples = resampled_rnn::getLatencySamples (resampleRatio);
 
     model_variant.visit ([delaySamples = rnnDelaySamples] (auto& model)
                          { model.prepare (delaySamples); });
@@ -59,5 +55,17 @@ void ResampledRNNAccelerated<numIns, hiddenSize, RecurrentLayerType>::reset()
 }
 
 //=======================================================
-template class ResampledRNNAccelerated<1, 28>; // MetalFace
-template class ResampledRNNAccelerated<2, 24>; // BassFace
+// GuitarML: without and with condition, LSTM and GRU, for each of rnn_dispatch::SupportedHiddenSizes
+#define BYOD_INSTANTIATE_GUITARML_RNN(hiddenSize)                                         \
+    template class ResampledRNNAccelerated<1, hiddenSize, RecurrentLayerType::LSTMLayer>; \
+    template class ResampledRNNAccelerated<2, hiddenSize, RecurrentLayerType::LSTMLayer>; \
+    template class ResampledRNNAccelerated<1, hiddenSize, RecurrentLayerType::GRULayer>;  \
+    template class ResampledRNNAccelerated<2, hiddenSize, RecurrentLayerType::GRULayer>;
+
+BYOD_INSTANTIATE_GUITARML_RNN (8)
+BYOD_INSTANTIATE_GUITARML_RNN (12)
+BYOD_INSTANTIATE_GUITARML_RNN (16)
+BYOD_INSTANTIATE_GUITARML_RNN (20)
+BYOD_INSTANTIATE_GUITARML_RNN (32)
+BYOD_INSTANTIATE_GUITARML_RNN (40)
+#undef BYOD_INSTANTIATE_GUITARML_RNN
@@ -1,9 +1,22 @@
 #pragma once
 
-#include "RNNAccelerated.h"
+#include "RNNDispatch.h"
 //#include <pch.h>
 #include "../../../pch.h"
 
+namespace resampled_rnn
+{
+// the size of the Lanczos kernels of the resamplers around the model
+constexpr int kernelSize = 8;
+
+// the delay of the two resampling stages in samples at the host rate, for the ratio of the rate
+// the model runs at to the host rate: each stage looks ahead by its kernel size at its input rate
+inline int getLatencySamples (double resampleRatio)
+{
+    return resampleRatio == 1.0 ? 0 : (int) std::ceil (kernelSize * (1.0 + 1.0 / resampleRatio));
+}
+} // namespace resampled_rnn
+
 template <int numIns, int hiddenSize, int RecurrentLayerType = RecurrentLayerType::LSTMLayer>
 class ResampledRNNAccelerated
 {
@@ -12,42 +25,49 @@ public:
     ResampledRNNAccelerated (ResampledRNNAccelerated&&) noexcept = default;
     ResampledRNNAccelerated& operator= (ResampledRNNAccelerated&&) noexcept = default;
 
-    void initialise (const void* modelData, int modelDataSize, double modelSampleRate);
+    void initialise (const compiled_model::View& weights);
 
-    void prepare (double sampleRate, int samplesPerBlock);
+    // With runAtModelRate, a host rate above the model rate is resampled down to exactly the model
+    // rate, so the model runs one inference per model sample instead of one per host sample.
+    // Otherwise the model runs at an integer multiple of its rate with a matching delay.
+    void prepare (double sampleRate, int samplesPerBlock, bool runAtModelRate = false);
     void reset();
 
+    // the delay of the two resampling stages in samples at the host rate (0 without resampling)
+    int getLatencySamples() const noexcept { return latencySamples; }
+
     template <bool useResiduals = false>
     void process (std::span<float> block, std::span<const float> condition_data = {}) noexcept
     {
-        auto processNNInternal = [this, &condition_data] (std::span<float> data)
+        auto processNNInternal = [this] (std::span<float> data, std::span<const float> conditionData)
         {
             model_variant.visit (
-                [&data, &condition_data] (auto& model)
+                [&data, &conditionData] (auto& model)
                 {
                     if constexpr (numIns == 1)
                     {
-                        jassert (condition_data.empty());
-                        juce::ignoreUnused (condition_data);
+                        jassert (conditionData.empty());
+                        juce::ignoreUnused (conditionData);
                         model.process (data, useResiduals);
                     }
                     else
                     {
-                        jassert (condition_data.size() == data.size());
-                        model.process_conditioned (data, condition_data, useResiduals);
+                        jassert (conditionData.size() == data.size());
+                        model.process_conditioned (data, conditionData, useResiduals);
                     }
                 });
         };
 
         if (! needsResampling)
         {
-            processNNInternal (block);
+            processNNInternal (block, condition_data);
         }
         else
         {
             auto bufferView = chowdsp::BufferView<float> { block.data(), (int) block.size() };
             auto blockAtSampleRate = resampler.processIn (bufferView);
-            processNNInternal (blockAtSampleRate.getWriteSpan (0));
+            const auto dataAtSampleRate = blockAtSampleRate.getWriteSpan (0);
+            processNNInternal (dataAtSampleRate, resampleCondition (condition_data, dataAtSampleRate.size()));
             resampler.processOut (blockAtSampleRate, bufferView);
         }
     }
@@ -61,18 +81,28 @@ public:
     }
 
 private:
-    EA::Variant<rnn_sse_arm::RNNAccelerated<numIns, hiddenSize, RecurrentLayerType, (int) RTNeural::SampleRateCorrectionMode::NoInterp>
-#if JUCE_INTEL
-                ,
-                rnn_avx::RNNAccelerated<numIns, hiddenSize, RecurrentLayerType, (int) RTNeural::SampleRateCorrectionMode::NoInterp>
-#endif
-                >
-        model_variant;
+    // the condition is a smoothed parameter, so picking the nearest value is accurate enough
+    std::span<const float> resampleCondition (std::span<const float> condition_data, size_t numSamples) noexcept
+    {
+        if (condition_data.empty())
+            return condition_data;
+
+        numSamples = std::min (numSamples, conditionAtSampleRate.size());
+        const auto step = (double) condition_data.size() / (double) numSamples;
+        for (size_t n = 0; n < numSamples; ++n)
+            conditionAtSampleRate[n] = condition_data[std::min ((size_t) ((double) n * step), condition_data.size() - 1)];
+        return { conditionAtSampleRate.data(), numSamples };
+    }
+
+    rnn_dispatch::ModelVariant<numIns, hiddenSize, RecurrentLayerType, (int) RTNeural::SampleRateCorrectionMode::NoInterp> model_variant;
 
-    using ResamplerType = chowdsp::ResamplingTypes::LanczosResampler<8192, 8>;
+    static constexpr int resamplerKernelSize = resampled_rnn::kernelSize;
+    using ResamplerType = chowdsp::ResamplingTypes::LanczosResampler<8192, resamplerKernelSize>;
     chowdsp::ResampledProcess<ResamplerType> resampler;
     bool needsResampling = true;
     double targetSampleRate = 48000.0;
+    int latencySamples = 0;
+    std::vector<float> conditionAtSampleRate;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ResampledRNNAccelerated)
 };
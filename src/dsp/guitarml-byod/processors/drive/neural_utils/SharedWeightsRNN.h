@@ -0,0 +1,328 @@
+#pragma once
+
+#include "CompiledModel.h"
+#include <algorithm>
+#include <bit>
+#include <xsimd/xsimd.hpp>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+/**
+ * An LSTM or GRU layer followed by a dense output layer, running on the weights of a compiled model
+ * that may be shared with any number of other instances: the layer only owns its recurrent state.
+ *
+ * For sample rate correction, the recurrent state is taken from delaySamples ago instead of from
+ * the last sample, with a fractional delay interpolated linearly between the two nearest states.
+ *
+ * Builds for several instruction sets need a MathsProvider of their own each, such that they
+ * don't share the (inline) instantiations of the layer.
+ */
+template <int inputSize, int hiddenSize, compiled_model::LayerType layerType, typename MathsProvider>
+class SharedWeightsRNN
+{
+public:
+    static constexpr bool isLSTM = layerType == compiled_model::LayerType::lstm;
+    static constexpr int gatesStride = compiled_model::getGatesStride (layerType, hiddenSize);
+    static constexpr int maxDelaySamples = 14;
+
+    /** The weights need to stay alive (and unchanged) while the layer is running on them */
+    void setWeights (const compiled_model::View& newWeights) noexcept
+    {
+        weights = newWeights;
+    }
+
+    void setDelay (float delaySamples) noexcept
+    {
+        delaySamples = std::clamp (delaySamples, 1.0f, (float) maxDelaySamples);
+        delayInt = (int) delaySamples;
+        delayFrac = delaySamples - (float) delayInt;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill (&hidden[0][0], &hidden[0][0] + numSlots * hiddenSize, 0.0f);
+        if constexpr (isLSTM)
+            std::fill (&cell[0][0], &cell[0][0] + numSlots * hiddenSize, 0.0f);
+        writeSlot = 0;
+    }
+
+    float forward (const float (&input)[inputSize]) noexcept
+    {
+        auto* layer = this;
+        auto output = 0.0f;
+        forwardBatch<1> (&layer, &input, &output);
+        return output;
+    }
+
+    /**
+     * Runs one step of several layers on the same weights at once, as one matrix-matrix product
+     * instead of one matrix-vector product per layer: each weight is loaded once for the whole batch.
+     */
+    template <int batchSize>
+    static void forwardBatch (SharedWeightsRNN* const* layers, const float (*inputs)[inputSize], float* outputs) noexcept
+    {
+        const auto& weights = layers[0]->weights;
+        if (weights.kernel == nullptr)
+        {
+            std::fill (outputs, outputs + batchSize, 0.0f);
+            return;
+        }
+
+        const float* hPrev[batchSize];
+        const float* cPrev[batchSize];
+        alignas (16) float hCopy[batchSize][hiddenSize];
+        alignas (16) float cCopy[batchSize][hiddenSize];
+        for (int b = 0; b < batchSize; ++b)
+            layers[b]->getPreviousState (hPrev[b], cPrev[b], hCopy[b], cCopy[b]);
+
+        // the recurrent product of the gates, which for an LSTM takes in the input (and bias) too
+        alignas (16) float gates[batchSize][gatesStride];
+        if (weights.recurrentKernelHalf != nullptr || weights.recurrentKernelInt8 != nullptr)
+        {
+            for (int b = 0; b < batchSize; ++b)
+                layers[b]->computeGatesQuantised (inputs[b], hPrev[b], gates[b]);
+        }
+        else
+        {
+#ifdef XSIMD_NO_SUPPORTED_ARCHITECTURE
+            for (int b = 0; b < batchSize; ++b)
+                layers[b]->computeGates (inputs[b], hPrev[b], gates[b]);
+#else
+            using Batch = xsimd::batch<float>;
+            constexpr auto numVectors = getNumVectorsPerPass (batchSize);
+            constexpr auto passSize = numVectors * (int) Batch::size;
+            const auto* recurrentBias = isLSTM ? weights.bias : weights.recurrentBias;
+            for (int k0 = 0; k0 < gatesStride; k0 += passSize)
+            {
+                Batch acc[batchSize][numVectors];
+                for (int b = 0; b < batchSize; ++b)
+                {
+                    for (int v = 0; v < numVectors; ++v)
+                        acc[b][v] = Batch::load_unaligned (recurrentBias + k0 + v * (int) Batch::size);
+                    if constexpr (isLSTM)
+                        for (int i = 0; i < inputSize; ++i)
+                            for (int v = 0; v < numVectors; ++v)
+                                acc[b][v] = xsimd::fma (Batch::load_unaligned (weights.kernel + i * gatesStride + k0 + v * (int) Batch::size), Batch (inputs[b][i]), acc[b][v]);
+                }
+
+                for (int j = 0; j < hiddenSize; ++j)
+                {
+                    Batch u[numVectors];
+                    for (int v = 0; v < numVectors; ++v)
+                        u[v] = Batch::load_unaligned (weights.recurrentKernel + j * gatesStride + k0 + v * (int) Batch::size);
+                    for (int b = 0; b < batchSize; ++b)
+                    {
+                        const Batch h (hPrev[b][j]);
+                        for (int v = 0; v < numVectors; ++v)
+                            acc[b][v] = xsimd::fma (u[v], h, acc[b][v]);
+                    }
+                }
+
+                for (int b = 0; b < batchSize; ++b)
+                    for (int v = 0; v < numVectors; ++v)
+                        acc[b][v].store_unaligned (gates[b] + k0 + v * (int) Batch::size);
+            }
+#endif
+        }
+
+        for (int b = 0; b < batchSize; ++b)
+            outputs[b] = layers[b]->finishStep (gates[b], inputs[b], hPrev[b], cPrev[b]);
+    }
+
+    bool hasSameWeights (const SharedWeightsRNN& other) const noexcept
+    {
+        return weights.kernel == other.weights.kernel
+               && weights.recurrentKernelHalf == other.weights.recurrentKernelHalf
+               && weights.recurrentKernelInt8 == other.weights.recurrentKernelInt8;
+    }
+
+private:
+    // the state from delayInt samples ago (the newest one is in writeSlot), or one interpolated
+    // between that and the one before - copied in any case, as reading the state straight after
+    // finishStep has written it stalls on the store forwarding
+    void getPreviousState (const float*& hPrev, const float*& cPrev, float* hCopy, float* cCopy) const noexcept
+    {
+        interpolateState (hidden, hCopy);
+        hPrev = hCopy;
+        cPrev = nullptr;
+        if constexpr (isLSTM)
+        {
+            interpolateState (cell, cCopy);
+            cPrev = cCopy;
+        }
+    }
+
+    void interpolateState (const float (*slots)[hiddenSize], float* state) const noexcept
+    {
+        const auto* last = slots[(writeSlot - delayInt + 1) & slotMask];
+        if (delayFrac > 0.0f)
+        {
+            const auto* before = slots[(writeSlot - delayInt) & slotMask];
+            for (int j = 0; j < hiddenSize; ++j)
+                state[j] = last[j] + delayFrac * (before[j] - last[j]);
+        }
+        else
+        {
+            std::copy (last, last + hiddenSize, state);
+        }
+    }
+
+    // the bias the recurrent product starts from, and the input product for an LSTM
+    void initialiseGates (const float* input, float* gates) const noexcept
+    {
+        if constexpr (isLSTM)
+        {
+            std::copy (weights.bias, weights.bias + gatesStride, gates);
+            for (int i = 0; i < inputSize; ++i)
+            {
+                const auto* __restrict w = weights.kernel + i * gatesStride;
+                for (int k = 0; k < gatesStride; ++k)
+                    gates[k] += w[k] * input[i];
+            }
+        }
+        else
+        {
+            std::copy (weights.recurrentBias, weights.recurrentBias + gatesStride, gates);
+        }
+    }
+
+    void computeGates (const float* input, const float* hPrev, float* gates) const noexcept
+    {
+        initialiseGates (input, gates);
+        for (int j = 0; j < hiddenSize; ++j)
+        {
+            const auto* __restrict u = weights.recurrentKernel + j * gatesStride;
+            const auto h = hPrev[j];
+            for (int k = 0; k < gatesStride; ++k)
+                gates[k] += u[k] * h;
+        }
+    }
+
+    // the same from a reduced precision recurrent kernel, converted to float on the fly - the 8 bit
+    // products are summed up before they are scaled
+    void computeGatesQuantised (const float* input, const float* hPrev, float* gates) const noexcept
+    {
+        alignas (16) float sums[gatesStride] {};
+        if (weights.recurrentKernelHalf != nullptr)
+        {
+            alignas (16) float row[gatesStride];
+            for (int j = 0; j < hiddenSize; ++j)
+            {
+                convertHalfFloats (weights.recurrentKernelHalf + j * gatesStride, row);
+                const auto h = hPrev[j];
+                for (int k = 0; k < gatesStride; ++k)
+                    sums[k] += row[k] * h;
+            }
+        }
+        else
+        {
+            for (int j = 0; j < hiddenSize; ++j)
+            {
+                const auto* __restrict q = weights.recurrentKernelInt8 + j * gatesStride;
+                const auto h = hPrev[j];
+                for (int k = 0; k < gatesStride; ++k)
+                    sums[k] += (float) q[k] * h;
+            }
+            const auto* __restrict scales = weights.recurrentKernelScales;
+            for (int k = 0; k < gatesStride; ++k)
+                sums[k] *= scales[k];
+        }
+
+        initialiseGates (input, gates);
+        for (int k = 0; k < gatesStride; ++k)
+            gates[k] += sums[k];
+    }
+
+    // a row of half floats, with the conversion instructions where the build has them and in a
+    // loop that vectorises otherwise
+    static void convertHalfFloats (const uint16_t* __restrict values, float* __restrict floats) noexcept
+    {
+        auto k = 0;
+#if defined(__F16C__)
+        for (; k + 8 <= gatesStride; k += 8)
+            _mm256_storeu_ps (floats + k, _mm256_cvtph_ps (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (values + k))));
+#endif
+        for (; k < gatesStride; ++k)
+        {
+            const auto magnitude = std::bit_cast<float> ((uint32_t) (values[k] & 0x7fffu) << 13) * 0x1.0p112f;
+            floats[k] = std::bit_cast<float> (std::bit_cast<uint32_t> (magnitude) | ((uint32_t) (values[k] & 0x8000u) << 16));
+        }
+    }
+
+    // applies the gates to the state and returns the output of the dense layer
+    float finishStep (const float* gates, const float* input, const float* hPrev, const float* cPrev) noexcept
+    {
+        const auto newSlot = (writeSlot + 1) & slotMask;
+        auto* __restrict hOut = hidden[newSlot];
+        if constexpr (isLSTM)
+        {
+            // input, forget, cell and output gates
+            auto* __restrict cOut = cell[newSlot];
+            for (int j = 0; j < hiddenSize; ++j)
+            {
+                const auto inputGate = MathsProvider::sigmoid (gates[j]);
+                const auto forgetGate = MathsProvider::sigmoid (gates[hiddenSize + j]);
+                const auto cellGate = MathsProvider::tanh (gates[2 * hiddenSize + j]);
+                const auto outputGate = MathsProvider::sigmoid (gates[3 * hiddenSize + j]);
+                cOut[j] = forgetGate * cPrev[j] + inputGate * cellGate;
+                hOut[j] = outputGate * MathsProvider::tanh (cOut[j]);
+            }
+        }
+        else
+        {
+            // reset, update and new gates, with the input product added here as the reset gate
+            // only scales the recurrent part of the new gate
+            alignas (16) float inputGates[3 * hiddenSize];
+            std::copy (weights.bias, weights.bias + 3 * hiddenSize, inputGates);
+            for (int i = 0; i < inputSize; ++i)
+                for (int k = 0; k < 3 * hiddenSize; ++k)
+                    inputGates[k] += weights.kernel[i * gatesStride + k] * input[i];
+
+            for (int j = 0; j < hiddenSize; ++j)
+            {
+                const auto resetGate = MathsProvider::sigmoid (inputGates[j] + gates[j]);
+                const auto updateGate = MathsProvider::sigmoid (inputGates[hiddenSize + j] + gates[hiddenSize + j]);
+                const auto newGate = MathsProvider::tanh (inputGates[2 * hiddenSize + j] + resetGate * gates[2 * hiddenSize + j]);
+                hOut[j] = newGate + updateGate * (hPrev[j] - newGate);
+            }
+        }
+        writeSlot = newSlot;
+
+        auto y = weights.denseBias[0];
+        for (int j = 0; j < hiddenSize; ++j)
+            y += weights.denseWeights[j] * hOut[j];
+        return y;
+    }
+
+    // a power of two above the longest delay, so the slot written never is one still read
+    static constexpr int numSlots = 16;
+    static constexpr int slotMask = numSlots - 1;
+    static_assert (maxDelaySamples + 1 < numSlots);
+
+#ifndef XSIMD_NO_SUPPORTED_ARCHITECTURE
+    // the number of vectors of gates a batch accumulates per layer at a time: enough independent
+    // sums to hide the latency of the multiply-adds, few enough to stay in registers
+    static constexpr int getNumVectorsPerPass (int batchSize)
+    {
+        constexpr auto numVectorsOfGates = gatesStride / (int) xsimd::batch<float>::size;
+        static_assert (numVectorsOfGates * (int) xsimd::batch<float>::size == gatesStride);
+
+        auto numVectors = std::max (1, 8 / batchSize);
+        while (numVectorsOfGates % numVectors != 0)
+            --numVectors;
+        return numVectors;
+    }
+#endif
+
+    compiled_model::View weights;
+    int delayInt = 1;
+    float delayFrac = 0.0f;
+    int writeSlot = 0;
+
+    alignas (16) float hidden[numSlots][hiddenSize] {};
+    // the cell state of an LSTM, a GRU has none
+    alignas (16) float cell[isLSTM ? numSlots : 1][hiddenSize] {};
+};
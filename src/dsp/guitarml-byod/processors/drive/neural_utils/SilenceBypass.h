@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+/**
+ * Skips the model while its input is silent, as it is between the notes of a sequence.
+ *
+ * Under zero input (and a constant condition) the recurrent state of a model runs into a fixed
+ * point, and the model outputs a constant from then on. Once a silent block shows it has settled
+ * there, the following silent blocks get that constant without running the model. Its state is
+ * left at the fixed point, which is where running it would have kept it, so it carries on from
+ * the right state when the signal returns and needs no pre-roll.
+ *
+ * The output stages after the model (DC blocker etc.) still run on the constant, so the output
+ * is the same as with the model running, up to the tolerances below.
+ */
+class SilenceBypass
+{
+public:
+    // below -120 dBFS the input counts as silent
+    static constexpr float silenceThreshold = 1.0e-6f;
+    // the model has settled when its output moves by less than this over a whole silent block
+    static constexpr float settledTolerance = 1.0e-6f;
+
+    static bool isSilent (std::span<const float> input) noexcept
+    {
+        return std::all_of (input.begin(), input.end(), [] (float x)
+                            { return std::abs (x) < silenceThreshold; });
+    }
+
+    /**
+     * For a block of silent input: if the model has settled (on the same condition), fills the
+     * block with its output and returns true, the model can skip the block then.
+     */
+    bool skipBlock (std::span<float> block, std::span<const float> condition, bool inputIsSilent) const noexcept
+    {
+        if (! (inputIsSilent && isSettled && isConstant (condition, settledCondition, 0.0f)))
+            return false;
+
+        std::fill (block.begin(), block.end(), settledOutput);
+        return true;
+    }
+
+    /** After the model has processed a block, with its output in the block */
+    void update (std::span<const float> block, std::span<const float> condition, bool inputWasSilent) noexcept
+    {
+        isSettled = inputWasSilent && ! block.empty() && isConstant (block, block.back(), settledTolerance)
+                    && (condition.empty() || isConstant (condition, condition.back(), 0.0f));
+        if (! isSettled)
+            return;
+
+        settledOutput = block.back();
+        settledCondition = condition.empty() ? 0.0f : condition.back();
+    }
+
+    /** For a model change or reset, which moves the fixed point */
+    void reset() noexcept { isSettled = false; }
+
+private:
+    static bool isConstant (std::span<const float> values, float value, float tolerance) noexcept
+    {
+        return std::all_of (values.begin(), values.end(), [value, tolerance] (float x)
+                            { return std::abs (x - value) <= tolerance; });
+    }
+
+    bool isSettled = false;
+    float settledOutput = 0.0f;
+    float settledCondition = 0.0f;
+};
@@ -0,0 +1,205 @@
+/**
+ * Times the batched inference of the rack lines on every model json in a folder (by default the
+ * built-in models), with the RNNAccelerated build selected at runtime for this CPU.
+ *
+ * Each line processes a few seconds of a saw line at 48 kHz in blocks of 512 samples. The first
+ * column runs the lines one after the other, as separate plugin instances would; the others step
+ * batches of 1 to 8 lines sharing the weights of the model through process_batch, which splits
+ * them into batches of up to RNNAccelerated::max_batch_size. The table shows the time per sample
+ * and line in nanoseconds.
+ *
+ * usage: guitarml_batch_benchmark [models folder]
+ */
+
+#include "../processors/drive/neural_utils/CompiledModelJson.h"
+#include "../processors/drive/neural_utils/RNNDispatch.h"
+#include <RTNeural/RTNeural.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if BYOD_RNN_HAS_INTEL_TARGETS
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+constexpr size_t blockSize = 512;
+constexpr size_t numBlocks = 250;
+constexpr size_t maxLines = 8;
+
+constexpr size_t batchSizes[] = { 1, 2, 3, 4, 8 };
+constexpr int numColumns = 1 + (int) std::size (batchSizes);
+
+// a saw line of sixteenth notes at 130 bpm, slightly detuned for each line of a batch
+std::vector<float> makeTestSignal (size_t line)
+{
+    constexpr double notes[] = { 36, 48, 39, 43, 36, 46, 51, 34 };
+    const auto samplesPerNote = (size_t) (sampleRate * 60.0 / 130.0 / 4.0);
+
+    std::vector<float> signal (blockSize * numBlocks);
+    auto phase = 0.0;
+    for (size_t n = 0; n < signal.size(); ++n)
+    {
+        const auto note = notes[(n / samplesPerNote) % std::size (notes)] + 0.1 * (double) line;
+        phase += 440.0 * std::pow (2.0, (note - 69.0) / 12.0) / sampleRate;
+        phase -= std::floor (phase);
+        const auto envelope = std::exp (-(double) (n % samplesPerNote) / (0.12 * sampleRate));
+        signal[n] = (float) ((2.0 * phase - 1.0) * envelope * 0.5);
+    }
+    return signal;
+}
+
+using Timings = std::array<double, numColumns>;
+
+template <int inputSize, int hiddenSize, int layerType>
+Timings runModel (const compiled_model::View& weights, rnn_dispatch::Target target)
+{
+    using Clock = std::chrono::steady_clock;
+    using ModelVariant = rnn_dispatch::ModelVariant<inputSize, hiddenSize, layerType, (int) RTNeural::SampleRateCorrectionMode::LinInterp>;
+
+    std::array<std::unique_ptr<ModelVariant>, maxLines> variants;
+    std::array<std::vector<float>, maxLines> signals;
+    const std::vector<float> condition (blockSize, 0.5f);
+    for (size_t line = 0; line < maxLines; ++line)
+    {
+        variants[line] = std::make_unique<ModelVariant>();
+        rnn_dispatch::emplaceModel (*variants[line], target);
+        variants[line]->visit ([&weights] (auto& model)
+                               {
+                                   model.initialise (weights);
+                                   model.prepare ((float) (sampleRate / weights.sampleRate));
+                               });
+        signals[line] = makeTestSignal (line);
+    }
+
+    Timings timings {};
+    variants[0]->visit ([&] (auto& firstModel)
+                        {
+                            using Model = std::remove_reference_t<decltype (firstModel)>;
+                            std::array<Model*, maxLines> models {};
+                            for (size_t line = 0; line < maxLines; ++line)
+                                variants[line]->visit ([&models, line] (auto& model)
+                                                       {
+                                                           if constexpr (std::is_same_v<std::remove_reference_t<decltype (model)>, Model>)
+                                                               models[line] = &model;
+                                                       });
+
+                            const auto numSamples = (double) (blockSize * numBlocks);
+
+                            auto buffers = signals;
+                            for (auto* model : models)
+                                model->reset();
+                            const auto separateStart = Clock::now();
+                            for (size_t block = 0; block < numBlocks; ++block)
+                                for (size_t line = 0; line < maxLines; ++line)
+                                    models[line]->process_conditioned ({ buffers[line].data() + block * blockSize, blockSize }, condition, true);
+                            timings[0] = std::chrono::duration<double, std::nano> (Clock::now() - separateStart).count() / (maxLines * numSamples);
+
+                            std::array<float*, maxLines> data {};
+                            std::array<const float*, maxLines> conditions {};
+                            for (int column = 1; column < numColumns; ++column)
+                            {
+                                const auto batchSize = batchSizes[column - 1];
+                                buffers = signals;
+                                for (auto* model : models)
+                                    model->reset();
+                                const auto batchStart = Clock::now();
+                                for (size_t block = 0; block < numBlocks; ++block)
+                                {
+                                    for (size_t line = 0; line < batchSize; ++line)
+                                    {
+                                        data[line] = buffers[line].data() + block * blockSize;
+                                        conditions[line] = condition.data();
+                                    }
+                                    Model::process_batch ({ models.data(), batchSize }, { data.data(), batchSize }, { conditions.data(), batchSize }, blockSize, true);
+                                }
+                                timings[(size_t) column] = std::chrono::duration<double, std::nano> (Clock::now() - batchStart).count() / ((double) batchSize * numSamples);
+                            }
+                        });
+    return timings;
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+    // the plugin runs with denormals flushed to zero as well
+    _mm_setcsr (_mm_getcsr() | 0x8040);
+#endif
+
+    const std::filesystem::path modelsFolder = argc > 1 ? argv[1] : BYOD_BUILT_IN_MODELS_FOLDER;
+
+    std::vector<std::filesystem::path> modelFiles;
+    for (const auto& entry : std::filesystem::directory_iterator (modelsFolder))
+        if (entry.path().extension() == ".json")
+            modelFiles.push_back (entry.path());
+    std::sort (modelFiles.begin(), modelFiles.end());
+
+    if (modelFiles.empty())
+    {
+        std::fprintf (stderr, "No model json files in %s\n", modelsFolder.string().c_str());
+        return 1;
+    }
+
+    const auto target = rnn_dispatch::getTarget();
+    std::printf ("%s, ns per sample and line\n%-40s %8s", rnn_dispatch::getInstructionSetName (target), "model", "separate");
+    for (const auto batchSize : batchSizes)
+        std::printf ("  batch %zu", batchSize);
+    std::printf ("\n");
+
+    Timings total {};
+    auto numModels = 0;
+    for (const auto& modelFile : modelFiles)
+    {
+        std::vector<char> compiled;
+        try
+        {
+            std::ifstream stream (modelFile);
+            compiled = compiled_model::compile (nlohmann::json::parse (stream));
+        }
+        catch (const std::exception& exc)
+        {
+            std::printf ("%-40s skipped: %s\n", modelFile.stem().string().c_str(), exc.what());
+            continue;
+        }
+
+        compiled_model::View weights;
+        if (! compiled_model::getView (compiled.data(), compiled.size(), weights) || ! rnn_dispatch::isSupported (rnn_dispatch::getArchitecture (weights)))
+        {
+            std::printf ("%-40s skipped: unsupported architecture\n", modelFile.stem().string().c_str());
+            continue;
+        }
+
+        Timings timings {};
+        rnn_dispatch::visitArchitecture (rnn_dispatch::getArchitecture (weights), [&]<int inputSize, int hiddenSize, int layerType>()
+                                         { timings = runModel<inputSize, hiddenSize, layerType> (weights, target); });
+
+        std::printf ("%-40s", (modelFile.stem().string().substr (0, 30) + (weights.layerType == compiled_model::LayerType::gru ? " GRU-" : " LSTM-") + std::to_string (weights.hiddenSize)).c_str());
+        for (int column = 0; column < numColumns; ++column)
+        {
+            total[(size_t) column] += timings[(size_t) column];
+            std::printf (" %8.0f", timings[(size_t) column]);
+        }
+        std::printf ("\n");
+        ++numModels;
+    }
+
+    if (numModels == 0)
+        return 1;
+
+    std::printf ("%-40s", "mean");
+    for (const auto time : total)
+        std::printf (" %8.0f", time / numModels);
+    std::printf ("\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ * Times the RNNAccelerated builds for each instruction set this CPU supports, on every model json
+ * in a folder (by default the built-in models), of any supported architecture.
+ *
+ * Each model processes a few seconds of a saw line at 48 kHz in blocks of 512 samples, once as a
+ * single line and once as a batch of four lines sharing its weights, as the rack runs them. The
+ * table shows the time per sample and line in nanoseconds.
+ *
+ * usage: guitarml_kernel_benchmark [models folder]
+ */
+
+#include "../processors/drive/neural_utils/CompiledModelJson.h"
+#include "../processors/drive/neural_utils/RNNDispatch.h"
+#include <RTNeural/RTNeural.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if BYOD_RNN_HAS_INTEL_TARGETS
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+constexpr size_t blockSize = 512;
+constexpr size_t numBlocks = 250;
+constexpr size_t batchSize = 4;
+
+constexpr rnn_dispatch::Target targets[] = { rnn_dispatch::Target::baseline, rnn_dispatch::Target::avx, rnn_dispatch::Target::avx512 };
+constexpr int numTargets = (int) std::size (targets);
+
+// a saw line of sixteenth notes at 130 bpm, slightly detuned for each line of a batch
+std::vector<float> makeTestSignal (size_t line)
+{
+    constexpr double notes[] = { 36, 48, 39, 43, 36, 46, 51, 34 };
+    const auto samplesPerNote = (size_t) (sampleRate * 60.0 / 130.0 / 4.0);
+
+    std::vector<float> signal (blockSize * numBlocks);
+    auto phase = 0.0;
+    for (size_t n = 0; n < signal.size(); ++n)
+    {
+        const auto note = notes[(n / samplesPerNote) % std::size (notes)] + 0.1 * (double) line;
+        phase += 440.0 * std::pow (2.0, (note - 69.0) / 12.0) / sampleRate;
+        phase -= std::floor (phase);
+        const auto envelope = std::exp (-(double) (n % samplesPerNote) / (0.12 * sampleRate));
+        signal[n] = (float) ((2.0 * phase - 1.0) * envelope * 0.5);
+    }
+    return signal;
+}
+
+struct Timing
+{
+    double single = 0.0;
+    double batched = 0.0;
+};
+
+template <int inputSize, int hiddenSize, int layerType>
+Timing runModel (const compiled_model::View& weights, rnn_dispatch::Target target)
+{
+    using Clock = std::chrono::steady_clock;
+    using ModelVariant = rnn_dispatch::ModelVariant<inputSize, hiddenSize, layerType, (int) RTNeural::SampleRateCorrectionMode::LinInterp>;
+
+    std::array<std::unique_ptr<ModelVariant>, batchSize> variants;
+    std::array<std::vector<float>, batchSize> signals;
+    const std::vector<float> condition (blockSize, 0.5f);
+    for (size_t b = 0; b < batchSize; ++b)
+    {
+        variants[b] = std::make_unique<ModelVariant>();
+        rnn_dispatch::emplaceModel (*variants[b], target);
+        variants[b]->visit ([&weights] (auto& model)
+                            {
+                                model.initialise (weights);
+                                model.prepare ((float) (sampleRate / weights.sampleRate));
+                            });
+        signals[b] = makeTestSignal (b);
+    }
+
+    Timing timing;
+    variants[0]->visit ([&] (auto& firstModel)
+                        {
+                            using Model = std::remove_reference_t<decltype (firstModel)>;
+                            std::array<Model*, batchSize> models {};
+                            for (size_t b = 0; b < batchSize; ++b)
+                                variants[b]->visit ([&models, b] (auto& model)
+                                                    {
+                                                        if constexpr (std::is_same_v<std::remove_reference_t<decltype (model)>, Model>)
+                                                            models[b] = &model;
+                                                    });
+
+                            auto buffer = signals[0];
+                            firstModel.reset();
+                            const auto singleStart = Clock::now();
+                            for (size_t block = 0; block < numBlocks; ++block)
+                                firstModel.process_conditioned ({ buffer.data() + block * blockSize, blockSize }, condition, true);
+                            timing.single = std::chrono::duration<double, std::nano> (Clock::now() - singleStart).count() / (double) buffer.size();
+
+                            auto buffers = signals;
+                            std::array<float*, batchSize> data {};
+                            std::array<const float*, batchSize> conditions {};
+                            for (auto* model : models)
+                                model->reset();
+                            const auto batchStart = Clock::now();
+                            for (size_t block = 0; block < numBlocks; ++block)
+                            {
+                                for (size_t b = 0; b < batchSize; ++b)
+                                {
+                                    data[b] = buffers[b].data() + block * blockSize;
+                                    conditions[b] = condition.data();
+                                }
+                                Model::process_batch (models, data, conditions, blockSize, true);
+                            }
+                            timing.batched = std::chrono::duration<double, std::nano> (Clock::now() - batchStart).count() / (double) (batchSize * buffer.size());
+                        });
+    return timing;
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+    // the plugin runs with denormals flushed to zero as well
+    _mm_setcsr (_mm_getcsr() | 0x8040);
+#endif
+
+    const std::filesystem::path modelsFolder = argc > 1 ? argv[1] : BYOD_BUILT_IN_MODELS_FOLDER;
+
+    std::vector<std::filesystem::path> modelFiles;
+    for (const auto& entry : std::filesystem::directory_iterator (modelsFolder))
+        if (entry.path().extension() == ".json")
+            modelFiles.push_back (entry.path());
+    std::sort (modelFiles.begin(), modelFiles.end());
+
+    if (modelFiles.empty())
+    {
+        std::fprintf (stderr, "No model json files in %s\n", modelsFolder.string().c_str());
+        return 1;
+    }
+
+    std::printf ("%-40s", "");
+    for (const auto target : targets)
+        if (rnn_dispatch::isSupported (target))
+            std::printf (" %17s", rnn_dispatch::getInstructionSetName (target));
+    std::printf ("\n%-40s", "model (ns per sample and line)");
+    for (const auto target : targets)
+        if (rnn_dispatch::isSupported (target))
+            std::printf (" %8s %8s", "single", "batch 4");
+    std::printf ("\n");
+
+    Timing total[numTargets];
+    auto numModels = 0;
+    for (const auto& modelFile : modelFiles)
+    {
+        std::vector<char> compiled;
+        try
+        {
+            std::ifstream stream (modelFile);
+            compiled = compiled_model::compile (nlohmann::json::parse (stream));
+        }
+        catch (const std::exception& exc)
+        {
+            std::printf ("%-40s skipped: %s\n", modelFile.stem().string().c_str(), exc.what());
+            continue;
+        }
+
+        compiled_model::View weights;
+        if (! compiled_model::getView (compiled.data(), compiled.size(), weights) || ! rnn_dispatch::isSupported (rnn_dispatch::getArchitecture (weights)))
+        {
+            std::printf ("%-40s skipped: unsupported architecture\n", modelFile.stem().string().c_str());
+            continue;
+        }
+
+        std::printf ("%-40s", (modelFile.stem().string().substr (0, 30) + (weights.layerType == compiled_model::LayerType::gru ? " GRU-" : " LSTM-") + std::to_string (weights.hiddenSize)).c_str());
+        for (int t = 0; t < numTargets; ++t)
+        {
+            if (! rnn_dispatch::isSupported (targets[t]))
+                continue;
+
+            Timing timing;
+            rnn_dispatch::visitArchitecture (rnn_dispatch::getArchitecture (weights), [&]<int inputSize, int hiddenSize, int layerType>()
+                                             { timing = runModel<inputSize, hiddenSize, layerType> (weights, targets[t]); });
+            total[t].single += timing.single;
+            total[t].batched += timing.batched;
+            std::printf (" %8.0f %8.0f", timing.single, timing.batched);
+        }
+        std::printf ("\n");
+        ++numModels;
+    }
+
+    if (numModels == 0)
+        return 1;
+
+    std::printf ("%-40s", "mean");
+    for (int t = 0; t < numTargets; ++t)
+        if (rnn_dispatch::isSupported (targets[t]))
+            std::printf (" %8.0f %8.0f", total[t].single / numModels, total[t].batched / numModels);
+    std::printf ("\n\nselected at runtime: %s\n", rnn_dispatch::getInstructionSetName (rnn_dispatch::getTarget()));
+    return 0;
+}
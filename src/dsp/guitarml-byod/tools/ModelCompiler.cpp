@@ -0,0 +1,113 @@
+/**
+ * Compiles the GuitarML model jsons of a folder (by default the built-in models) to .jc303model
+ * files, for the WebAssembly build, which loads the models in their compiled form only. Next to
+ * them an index.json lists the models the page can offer: their names, files and architectures.
+ *
+ * Models of an architecture the accelerated kernels don't run are left out, with a note.
+ *
+ * usage: guitarml_model_compiler <output folder> [models folder]
+ */
+
+#include "../processors/drive/neural_utils/CompiledModelJson.h"
+#include "../processors/drive/neural_utils/RNNDispatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct CompiledEntry
+{
+    std::string name;
+    std::string file;
+    rnn_dispatch::Architecture architecture;
+    double sampleRate = 0.0;
+};
+
+std::string getModelName (const std::filesystem::path& file)
+{
+    auto name = file.stem().string();
+    std::replace (name.begin(), name.end(), '_', ' ');
+    return name;
+}
+} // namespace
+
+int main (int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf (stderr, "usage: %s <output folder> [models folder]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path outputFolder = argv[1];
+#ifdef BYOD_BUILT_IN_MODELS_FOLDER
+    const std::filesystem::path modelsFolder = argc > 2 ? argv[2] : BYOD_BUILT_IN_MODELS_FOLDER;
+#else
+    if (argc < 3)
+    {
+        std::fprintf (stderr, "usage: %s <output folder> <models folder>\n", argv[0]);
+        return 1;
+    }
+    const std::filesystem::path modelsFolder = argv[2];
+#endif
+
+    std::vector<std::filesystem::path> modelFiles;
+    for (const auto& entry : std::filesystem::directory_iterator (modelsFolder))
+        if (entry.is_regular_file() && entry.path().extension() == ".json")
+            modelFiles.push_back (entry.path());
+    std::sort (modelFiles.begin(), modelFiles.end());
+
+    std::filesystem::create_directories (outputFolder);
+
+    std::vector<CompiledEntry> entries;
+    size_t totalSize = 0;
+    for (const auto& modelFile : modelFiles)
+    {
+        std::vector<char> compiled;
+        try
+        {
+            std::ifstream stream (modelFile);
+            compiled = compiled_model::compile (nlohmann::json::parse (stream));
+        }
+        catch (const std::exception& e)
+        {
+            std::printf ("skipped %s: %s\n", modelFile.filename().string().c_str(), e.what());
+            continue;
+        }
+
+        compiled_model::View weights;
+        if (! compiled_model::getView (compiled.data(), compiled.size(), weights)
+            || ! rnn_dispatch::isSupported (rnn_dispatch::getArchitecture (weights)))
+        {
+            std::printf ("skipped %s: architecture not supported\n", modelFile.filename().string().c_str());
+            continue;
+        }
+
+        const auto outputFile = modelFile.stem().string() + compiled_model::fileExtension;
+        std::ofstream (outputFolder / outputFile, std::ios::binary).write (compiled.data(), (std::streamsize) compiled.size());
+        totalSize += compiled.size();
+        entries.push_back ({ getModelName (modelFile), outputFile, rnn_dispatch::getArchitecture (weights), weights.sampleRate });
+    }
+
+    auto index = nlohmann::json::array();
+    for (const auto& entry : entries)
+    {
+        index.push_back ({
+            { "name", entry.name },
+            { "file", entry.file },
+            { "unit_type", entry.architecture.layerType == RecurrentLayerType::GRULayer ? "GRU" : "LSTM" },
+            { "input_size", entry.architecture.inputSize },
+            { "hidden_size", entry.architecture.hiddenSize },
+            { "sample_rate", entry.sampleRate },
+        });
+    }
+    std::ofstream (outputFolder / "index.json") << index.dump (2) << '\n';
+
+    std::printf ("compiled %zu of %zu models, %.1f kB\n", entries.size(), modelFiles.size(), (double) totalSize / 1024.0);
+    return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * Measures how far the GuitarML models drift when they run on half float or 8 bit recurrent
+ * weights instead of the float ones, for every model json in a folder (by default the built-in
+ * models).
+ *
+ * Each model plays a few bars of a 303 style saw line at several input levels (and conditions, for
+ * conditioned models) through the full and the reduced precision weights, and the difference of
+ * the outputs is reported as a signal to error ratio and as its peak, next to the time per sample.
+ *
+ * The plugin runs the float weights only: on the CPUs measured so far both reduced precisions are
+ * slower (the float kernel of the largest models fits in the L2 cache), the 8 bit weights are far
+ * off on the high gain models, and the memory they would save is 13 to 20 kB per model.
+ *
+ * usage: guitarml_quantisation_calibration [models folder]
+ */
+
+#include "../processors/drive/neural_utils/CompiledModelJson.h"
+#include "../processors/drive/neural_utils/RNNDispatch.h"
+#include "../processors/drive/neural_utils/SharedWeightsRNN.h"
+#include <math_approx/math_approx.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace
+{
+// the activations RNNAccelerated runs with
+struct RNNMathsProvider
+{
+    template <typename T>
+    static T tanh (T x)
+    {
+        return math_approx::tanh<7> (x);
+    }
+
+    template <typename T>
+    static T sigmoid (T x)
+    {
+        return math_approx::sigmoid_exp<5, true> (x);
+    }
+};
+
+constexpr double sampleRate = 44100.0;
+
+// a saw line of sixteenth notes at 130 bpm, each note decaying like a 303 with the filter open
+std::vector<float> makeTestSignal (float level)
+{
+    constexpr double notes[] = { 36, 36, 48, 36, 39, 36, 43, 41, 36, 48, 46, 36, 39, 51, 36, 34 };
+    constexpr int numBars = 4;
+    const auto samplesPerNote = (int) (sampleRate * 60.0 / 130.0 / 4.0);
+
+    std::vector<float> signal;
+    signal.reserve ((size_t) (numBars * 16 * samplesPerNote));
+    auto phase = 0.0;
+    for (int note = 0; note < numBars * 16; ++note)
+    {
+        const auto frequency = 440.0 * std::pow (2.0, (notes[note % 16] - 69.0) / 12.0);
+        for (int n = 0; n < samplesPerNote; ++n)
+        {
+            phase += frequency / sampleRate;
+            phase -= std::floor (phase);
+            const auto envelope = std::exp (-(double) n / (0.12 * sampleRate));
+            signal.push_back ((float) ((2.0 * phase - 1.0) * envelope * level));
+        }
+    }
+    return signal;
+}
+
+constexpr compiled_model::Precision reducedPrecisions[] = { compiled_model::Precision::float16, compiled_model::Precision::int8 };
+constexpr int numReducedPrecisions = (int) std::size (reducedPrecisions);
+
+struct Result
+{
+    double signalEnergy = 0.0;
+    double floatSeconds = 0.0;
+    double peakError[numReducedPrecisions] {};
+    double errorEnergy[numReducedPrecisions] {};
+    double seconds[numReducedPrecisions] {};
+    size_t numSamples = 0;
+
+    double getRatio (int p) const
+    {
+        return 10.0 * std::log10 (signalEnergy / std::max (errorEnergy[p], 1.0e-30));
+    }
+};
+
+// the amp adds the model output to its input
+template <int inputSize, int hiddenSize, int layerType>
+void runModel (const compiled_model::View& weights, const compiled_model::View (&reducedWeights)[numReducedPrecisions], Result& result)
+{
+    using RNN = SharedWeightsRNN<inputSize, hiddenSize, (compiled_model::LayerType) layerType, RNNMathsProvider>;
+    auto fullModel = std::make_unique<RNN>();
+    auto reducedModel = std::make_unique<RNN>();
+    fullModel->setWeights (weights);
+
+    const std::vector<float> conditions = inputSize > 1 ? std::vector<float> { 0.0f, 0.5f, 1.0f } : std::vector<float> { 0.0f };
+    for (const auto level : { 0.125f, 0.5f, 1.0f })
+    {
+        const auto signal = makeTestSignal (level);
+        std::vector<float> fullOutput (signal.size());
+        std::vector<float> reducedOutput (signal.size());
+
+        for (const auto condition : conditions)
+        {
+            auto process = [&signal, condition] (RNN& model, std::vector<float>& output)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                float input[inputSize] {};
+                for (size_t n = 0; n < signal.size(); ++n)
+                {
+                    input[0] = signal[n];
+                    if constexpr (inputSize > 1)
+                        input[1] = condition;
+                    output[n] = signal[n] + model.forward (input);
+                }
+                return std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+            };
+            fullModel->reset();
+            result.floatSeconds += process (*fullModel, fullOutput);
+            for (size_t n = 0; n < signal.size(); ++n)
+                result.signalEnergy += (double) fullOutput[n] * (double) fullOutput[n];
+            result.numSamples += signal.size();
+
+            for (int p = 0; p < numReducedPrecisions; ++p)
+            {
+                reducedModel->setWeights (reducedWeights[p]);
+                reducedModel->reset();
+                result.seconds[p] += process (*reducedModel, reducedOutput);
+
+                for (size_t n = 0; n < signal.size(); ++n)
+                {
+                    const auto error = (double) reducedOutput[n] - (double) fullOutput[n];
+                    result.peakError[p] = std::max (result.peakError[p], std::abs (error));
+                    result.errorEnergy[p] += error * error;
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    const std::filesystem::path modelsFolder = argc > 1 ? argv[1] : BYOD_BUILT_IN_MODELS_FOLDER;
+
+    std::vector<std::filesystem::path> modelFiles;
+    for (const auto& entry : std::filesystem::directory_iterator (modelsFolder))
+        if (entry.path().extension() == ".json")
+            modelFiles.push_back (entry.path());
+    std::sort (modelFiles.begin(), modelFiles.end());
+
+    if (modelFiles.empty())
+    {
+        std::fprintf (stderr, "No model json files in %s\n", modelsFolder.string().c_str());
+        return 1;
+    }
+
+    std::printf ("%-40s %10s %24s %24s\n", "", "float", "16 bit float", "8 bit integer");
+    std::printf ("%-40s %10s %8s %8s %6s %8s %8s %6s\n", "model", "ns", "SER (dB)", "peak", "ns", "SER (dB)", "peak", "ns");
+    double worstRatio[numReducedPrecisions];
+    std::fill (std::begin (worstRatio), std::end (worstRatio), 1.0e9);
+    for (const auto& modelFile : modelFiles)
+    {
+        std::vector<char> compiled;
+        try
+        {
+            std::ifstream stream (modelFile);
+            compiled = compiled_model::compile (nlohmann::json::parse (stream));
+        }
+        catch (const std::exception& exc)
+        {
+            std::printf ("%-40s skipped: %s\n", modelFile.stem().string().c_str(), exc.what());
+            continue;
+        }
+
+        compiled_model::View weights;
+        if (! compiled_model::getView (compiled.data(), compiled.size(), weights) || ! rnn_dispatch::isSupported (rnn_dispatch::getArchitecture (weights)))
+        {
+            std::printf ("%-40s skipped: unsupported architecture\n", modelFile.stem().string().c_str());
+            continue;
+        }
+
+        std::vector<char> reducedData[numReducedPrecisions];
+        compiled_model::View reducedWeights[numReducedPrecisions];
+        for (int p = 0; p < numReducedPrecisions; ++p)
+        {
+            reducedData[p] = compiled_model::quantise (weights, reducedPrecisions[p]);
+            reducedWeights[p] = compiled_model::getQuantisedView (weights, reducedPrecisions[p], reducedData[p]);
+        }
+
+        Result result;
+        rnn_dispatch::visitArchitecture (rnn_dispatch::getArchitecture (weights), [&]<int inputSize, int hiddenSize, int layerType>()
+                                         { runModel<inputSize, hiddenSize, layerType> (weights, reducedWeights, result); });
+
+        const auto toNanoseconds = [&result] (double seconds) { return 1.0e9 * seconds / (double) result.numSamples; };
+        std::printf ("%-40s %10.0f", modelFile.stem().string().c_str(), toNanoseconds (result.floatSeconds));
+        for (int p = 0; p < numReducedPrecisions; ++p)
+        {
+            worstRatio[p] = std::min (worstRatio[p], result.getRatio (p));
+            std::printf (" %8.1f %8.1e %6.0f", result.getRatio (p), result.peakError[p], toNanoseconds (result.seconds[p]));
+        }
+        std::printf ("\n");
+    }
+
+    std::printf ("\nworst signal to error ratio: %.1f dB at 16 bit float, %.1f dB at 8 bit integer\n", worstRatio[0], worstRatio[1]);
+    return 0;
+}
@@ -0,0 +1,212 @@
+/**
+ * Times the model of every json in a folder (by default the built-in models) on a sparse
+ * sequenced line, once running it on every block and once skipping the silent blocks it has
+ * settled on (see SilenceBypass), as GuitarMLAmp does. The RNNAccelerated build is selected at
+ * runtime for this CPU.
+ *
+ * The line is a 303-like saw at 48 kHz: sixteenth notes at 130 bpm on 6 of 16 steps, each with a
+ * 30 ms decay and a gate closing after 100 ms, so most of the time the input is silent. It is
+ * processed in blocks of 512 samples. The table shows the model time of both (the best of three
+ * runs each), the share of blocks that were skipped and the peak deviation of the output with the
+ * bypass from the output of the model running throughout.
+ *
+ * usage: guitarml_silence_benchmark [models folder]
+ */
+
+#include "../processors/drive/neural_utils/CompiledModelJson.h"
+#include "../processors/drive/neural_utils/RNNDispatch.h"
+#include "../processors/drive/neural_utils/SilenceBypass.h"
+#include <RTNeural/RTNeural.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <vector>
+
+#if BYOD_RNN_HAS_INTEL_TARGETS
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+constexpr size_t blockSize = 512;
+constexpr size_t numBlocks = 940;
+constexpr int numRuns = 3;
+
+// a saw line on the steps of a pattern that has notes, with the gate closing after 100 ms
+std::vector<float> makeTestSignal()
+{
+    constexpr bool steps[] = { 1, 0, 0, 1, 0, 0, 1, 0, 0, 0, 1, 0, 1, 0, 0, 1 };
+    constexpr double notes[] = { 36, 48, 39, 43, 36, 46, 51, 34 };
+    const auto samplesPerStep = (size_t) (sampleRate * 60.0 / 130.0 / 4.0);
+    const auto gateSamples = (size_t) (0.1 * sampleRate);
+
+    std::vector<float> signal (blockSize * numBlocks);
+    auto phase = 0.0;
+    for (size_t n = 0; n < signal.size(); ++n)
+    {
+        const auto step = n / samplesPerStep;
+        const auto position = n % samplesPerStep;
+        if (! steps[step % std::size (steps)] || position >= gateSamples)
+            continue;
+
+        const auto note = notes[step % std::size (notes)];
+        phase += 440.0 * std::pow (2.0, (note - 69.0) / 12.0) / sampleRate;
+        phase -= std::floor (phase);
+        const auto envelope = std::exp (-(double) position / (0.03 * sampleRate));
+        signal[n] = (float) ((2.0 * phase - 1.0) * envelope * 0.5);
+    }
+    return signal;
+}
+
+struct Result
+{
+    double fullSeconds = 0.0, bypassSeconds = 0.0;
+    size_t numSkipped = 0;
+    float peakDeviation = 0.0f;
+};
+
+template <int inputSize, int hiddenSize, int layerType>
+Result runModel (const compiled_model::View& weights, rnn_dispatch::Target target, const std::vector<float>& signal)
+{
+    using Clock = std::chrono::steady_clock;
+    using ModelVariant = rnn_dispatch::ModelVariant<inputSize, hiddenSize, layerType, (int) RTNeural::SampleRateCorrectionMode::LinInterp>;
+
+    // the amp only hands a condition to the conditioned models
+    const std::vector<float> conditionBuffer (inputSize > 1 ? blockSize : 0, 0.5f);
+    const auto condition = std::span<const float> { conditionBuffer };
+
+    Result result;
+    std::vector<float> full, bypassed;
+    for (const auto useBypass : { false, true })
+    {
+        ModelVariant variant;
+        rnn_dispatch::emplaceModel (variant, target);
+        variant.visit ([&] (auto& model)
+                       {
+                           model.initialise (weights);
+                           model.prepare ((float) (sampleRate / weights.sampleRate));
+
+                           auto& output = useBypass ? bypassed : full;
+                           auto& seconds = useBypass ? result.bypassSeconds : result.fullSeconds;
+                           for (int run = 0; run < numRuns; ++run)
+                           {
+                               model.reset();
+                               output = signal;
+                               result.numSkipped = 0;
+
+                               SilenceBypass silenceBypass;
+                               const auto start = Clock::now();
+                               for (size_t block = 0; block < numBlocks; ++block)
+                               {
+                                   const auto x = std::span<float> { output.data() + block * blockSize, blockSize };
+                                   if (! useBypass)
+                                   {
+                                       model.process_conditioned (x, condition, true);
+                                       continue;
+                                   }
+
+                                   const auto inputIsSilent = SilenceBypass::isSilent (x);
+                                   if (silenceBypass.skipBlock (x, condition, inputIsSilent))
+                                   {
+                                       ++result.numSkipped;
+                                       continue;
+                                   }
+                                   model.process_conditioned (x, condition, true);
+                                   silenceBypass.update (x, condition, inputIsSilent);
+                               }
+                               const auto runSeconds = std::chrono::duration<double> (Clock::now() - start).count();
+                               seconds = run == 0 ? runSeconds : std::min (seconds, runSeconds);
+                           }
+                       });
+    }
+
+    for (size_t n = 0; n < signal.size(); ++n)
+        result.peakDeviation = std::max (result.peakDeviation, std::abs (bypassed[n] - full[n]));
+    return result;
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+#if BYOD_RNN_HAS_INTEL_TARGETS
+    // the plugin runs with denormals flushed to zero as well
+    _mm_setcsr (_mm_getcsr() | 0x8040);
+#endif
+
+    const std::filesystem::path modelsFolder = argc > 1 ? argv[1] : BYOD_BUILT_IN_MODELS_FOLDER;
+
+    std::vector<std::filesystem::path> modelFiles;
+    for (const auto& entry : std::filesystem::directory_iterator (modelsFolder))
+        if (entry.path().extension() == ".json")
+            modelFiles.push_back (entry.path());
+    std::sort (modelFiles.begin(), modelFiles.end());
+
+    if (modelFiles.empty())
+    {
+        std::fprintf (stderr, "No model json files in %s\n", modelsFolder.string().c_str());
+        return 1;
+    }
+
+    const auto signal = makeTestSignal();
+    const auto target = rnn_dispatch::getTarget();
+    std::printf ("%s, %.1f s in blocks of %zu samples\n%-40s %10s %10s %8s %8s %10s\n",
+                 rnn_dispatch::getInstructionSetName (target),
+                 (double) signal.size() / sampleRate,
+                 blockSize,
+                 "model",
+                 "full ms",
+                 "bypass ms",
+                 "speed-up",
+                 "skipped",
+                 "peak dev");
+
+    auto totalFull = 0.0, totalBypass = 0.0;
+    for (const auto& modelFile : modelFiles)
+    {
+        std::vector<char> compiled;
+        try
+        {
+            std::ifstream stream (modelFile);
+            compiled = compiled_model::compile (nlohmann::json::parse (stream));
+        }
+        catch (const std::exception& exc)
+        {
+            std::printf ("%-40s skipped: %s\n", modelFile.stem().string().c_str(), exc.what());
+            continue;
+        }
+
+        compiled_model::View weights;
+        if (! compiled_model::getView (compiled.data(), compiled.size(), weights) || ! rnn_dispatch::isSupported (rnn_dispatch::getArchitecture (weights)))
+        {
+            std::printf ("%-40s skipped: unsupported architecture\n", modelFile.stem().string().c_str());
+            continue;
+        }
+
+        Result result;
+        rnn_dispatch::visitArchitecture (rnn_dispatch::getArchitecture (weights), [&]<int inputSize, int hiddenSize, int layerType>()
+                                         { result = runModel<inputSize, hiddenSize, layerType> (weights, target, signal); });
+
+        std::printf ("%-40s %10.1f %10.1f %7.2fx %7.0f%% %7.1f dB\n",
+                     (modelFile.stem().string().substr (0, 30) + (weights.layerType == compiled_model::LayerType::gru ? " GRU-" : " LSTM-") + std::to_string (weights.hiddenSize)).c_str(),
+                     result.fullSeconds * 1.0e3,
+                     result.bypassSeconds * 1.0e3,
+                     result.fullSeconds / result.bypassSeconds,
+                     100.0 * (double) result.numSkipped / (double) numBlocks,
+                     result.peakDeviation > 0.0f ? 20.0 * std::log10 ((double) result.peakDeviation) : -INFINITY);
+        totalFull += result.fullSeconds;
+        totalBypass += result.bypassSeconds;
+    }
+
+    if (totalFull == 0.0)
+        return 1;
+
+    std::printf ("%-40s %10.1f %10.1f %7.2fx\n", "total", totalFull * 1.0e3, totalBypass * 1.0e3, totalFull / totalBypass);
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef rosic_AcidSequencer_h
 #define rosic_AcidSequencer_h
 
+#include <climits>
+
 // rosic-indcludes:
 #include "rosic_AcidPattern.h"
 
@@ -105,9 +107,32 @@ namespace rosic
     int getStepLengthInSamples() const 
     { return roundToInt(sampleRate*getStepLength()*beatsToSeconds(0.25, bpm)); }
 
+    /** Returns the tempo in BPM. */
+    double getTempo() const { return bpm; }
+
+    /** Returns the index of the pattern that is played. */
+    int getActivePatternIndex() const { return activePattern; }
+
+    /** Returns the index of the step that was started by the most recent call to getNote() that 
+    returned a note. */
+    int getPlayingStep() const 
+    { 
+      int numSteps = patterns[activePattern].getNumSteps();
+      return (step + numSteps - 1) % numSteps; 
+    }
+
     /** Returns the selected sequencer mode @see sequencerModes. */
     int getSequencerMode() const { return sequencerMode; }
 
+    /** Returns the number of subsequent calls to getNote() that will return NULL because no step 
+    is due (INT_MAX when the sequencer is not running). */
+    int getSamplesToNextStep() const 
+    { 
+      if( !running )
+        return INT_MAX;
+      return countDown > 0 ? countDown : 0;
+    }
+
     /** Returns, if the given key is among the permissible ones. */
     bool isKeyPermissible(int key);
 
@@ -117,6 +142,15 @@ namespace rosic
     /** Returns a pointer to the note that occurs at this sample if any, NULL otherwise. */
     INLINE AcidNote* getNote();
 
+    /** Advances the sequencer by the given number of samples - this is equivalent to the same 
+    number of calls to getNote() and may only be used when all these calls would return NULL, i.e.
+    numSamples must not exceed getSamplesToNextStep(). */
+    void skipSamples(int numSamples) 
+    { 
+      if( running )
+        countDown -= numSamples;
+    }
+
     /** Returns the next note that will be scheduled - after getNote() has returned a non-NULL 
     pointer, this will be the next non-NULL note that will be returned. So, if an event has 
     occurred at some time instant, you may investigate the next upcoming event beforehand by 
@@ -35,11 +35,6 @@ AnalogEnvelope::AnalogEnvelope()
   setRelease(releaseTime);
 }
 
-AnalogEnvelope::~AnalogEnvelope()
-{
-
-}
-
 //-------------------------------------------------------------------------------------------------
 // parameter settings:
 
@@ -63,7 +58,7 @@ void AnalogEnvelope::setAttack(double newAttackTime)
   {
     attackTime  = newAttackTime;
     double tau  = (sampleRate*0.001*attackTime) * tauScale/timeScale;
-    attackCoeff = 1.0 - exp( -1.0 / tau );
+    attackCoeff = 1.0 - fastExp<FAST_MATH_HIGH>( -1.0 / tau );
   }
   else // newAttackTime <= 0
   {
@@ -86,7 +81,7 @@ void AnalogEnvelope::setDecay(double newDecayTime)
   {
     decayTime  = newDecayTime;
     double tau = (sampleRate*0.001*decayTime) * tauScale/timeScale;
-    decayCoeff = 1.0 - exp( -1.0 / tau  );
+    decayCoeff = 1.0 - fastExp<FAST_MATH_HIGH>( -1.0 / tau  );
   }
   else // newDecayTime <= 0
   {
@@ -102,7 +97,7 @@ void AnalogEnvelope::setRelease(double newReleaseTime)
   {
     releaseTime  = newReleaseTime;
     double tau   = (sampleRate*0.001*releaseTime) * tauScale/timeScale;
-    releaseCoeff = 1.0 - exp( -1.0 / tau  );
+    releaseCoeff = 1.0 - fastExp<FAST_MATH_HIGH>( -1.0 / tau  );
   }
   else // newReleaseTime <= 0
   {
@@ -141,6 +136,59 @@ void AnalogEnvelope::setPeakScale(double newPeakScale)
     peakScale = newPeakScale;
 }
 
+//-------------------------------------------------------------------------------------------------
+// audio processing:
+
+void AnalogEnvelope::processBlock(double *out, int numSamples)
+{
+  int n = 0;
+  while( n < numSamples )
+  {
+    double target, coeff;
+    double end      = -1.0;   // time at which the current phase ends (if it ends)
+    bool   timeRuns = true;   // time is not incremented in sustain
+    if( time <= attPlusHld )
+    {
+      target = peakScale*peakLevel;
+      coeff  = attackCoeff;
+      end    = attPlusHld;
+    }
+    else if( time <= attPlusHldPlusDec )
+    {
+      target = sustainLevel;
+      coeff  = decayCoeff;
+      end    = attPlusHldPlusDec;
+    }
+    else if( noteIsOn )
+    {
+      target   = sustainLevel;
+      coeff    = decayCoeff;
+      timeRuns = false;
+    }
+    else
+    {
+      target = endLevel;
+      coeff  = releaseCoeff;
+    }
+
+    // number of samples until the end of the phase or the block (computed in double precision to 
+    // avoid integer overflow for long phases):
+    int pieceLength = numSamples - n;
+    if( end >= 0.0 )
+    {
+      double samplesToEnd = floor((end-time)/increment) + 1.0;
+      if( samplesToEnd < pieceLength )
+        pieceLength = (int) samplesToEnd;
+    }
+
+    exponentialApproach(&out[n], pieceLength, previousOutput, target, 1.0-coeff);
+    previousOutput = out[n+pieceLength-1];
+    if( timeRuns )
+      time += pieceLength*increment;
+    n += pieceLength;
+  }
+}
+
 //-------------------------------------------------------------------------------------------------
 // others:
 
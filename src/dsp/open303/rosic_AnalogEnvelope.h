@@ -32,9 +32,6 @@ namespace rosic
     /** Constructor. */
     AnalogEnvelope();  
 
-    /** Destructor. */
-    ~AnalogEnvelope(); 
-
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
@@ -146,6 +143,15 @@ namespace rosic
     /** Calculates one output sample at a time. */
     INLINE double getSample();    
 
+    /** Calculates a block of output samples. The block is split at the boundaries between the 
+    attack/hold, decay and sustain/release phases and each of the pieces is generated in closed 
+    form (@see exponentialApproach), so apart from rounding errors the output is the same as from 
+    numSamples calls to getSample(). Because the time variable is advanced by a multiple of the 
+    increment per piece instead of sample by sample, a phase boundary may be detected one sample 
+    later or earlier than in getSample() when the accumulated time lands within rounding distance 
+    of it. */
+    void processBlock(double *out, int numSamples);
+
     //---------------------------------------------------------------------------------------------
     // others:
 
@@ -160,6 +166,10 @@ namespace rosic
     /** Resets the time variable. */
     void reset();   
 
+    /** Snaps the state of the RC-filter to zero when it is close enough to zero - this is 
+    relevant in the release phase where the envelope approaches zero asymptotically. */
+    void flushDenormals() { previousOutput = flushToZero(previousOutput); }
+
   protected:
 
     /** Calculates our members that represent accumulated time values from attack, hold, etc. */
@@ -75,6 +75,11 @@ namespace rosic
     /** Returns the bandwidth in octaves. */
     double getBandwidth() const { return bandwidth; }
 
+    /** Writes the current filter coefficients into the passed variables. */
+    void getCoefficients(double *b0Out, double *b1Out, double *b2Out, double *a1Out,
+      double *a2Out) const
+    { *b0Out = b0; *b1Out = b1; *b2Out = b2; *a1Out = a1; *a2Out = a2; }
+
     //---------------------------------------------------------------------------------------------
     // audio processing:
 
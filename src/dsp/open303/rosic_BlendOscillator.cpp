@@ -12,9 +12,35 @@ BlendOscillator::BlendOscillator()
   freq                 = 440.0;
   increment            = (tableLengthDbl*freq)/sampleRate;
   phaseIndex           = 0.0;
+  phase                = 0;
+  phaseIncrement       = 0;
+  tableNumber          = 0;
+  fixedPointPhase      = false;
   startIndex           = 0.0;
+  blend.store(0.0);
   waveTable1           = NULL;
   waveTable2           = NULL;
+  readTable1           = NULL;
+  readTable2           = NULL;
+  readGain1            = 1.0;
+  readGain2            = 0.0;
+  selectedTableNumber  = -1;
+  selectedPublished    = -1;
+  selectedBlend        = -1.0;
+  selectedVersion1     = 0;
+  selectedVersion2     = 0;
+  preBlendedSelected   = -1;
+  preBlendedRequested  = -1.0;
+  preBlendedPublished.store(-1);
+  preBlendedInUse.store(-1);
+  for(int i=0; i<2; i++)
+  {
+    // allocated (and touched) here, such that the updates don't allocate on the audio thread:
+    preBlendedTables[i]   = new double[MipMappedWaveTable::numTables*paddedTableLength]();
+    preBlendedFactor[i]   = -1.0;
+    preBlendedVersion1[i] = 0;
+    preBlendedVersion2[i] = 0;
+  }
 
   // somewhat redundant:
   setSampleRate(44100.0);          // sampleRate = 44100 Hz by default
@@ -29,7 +55,8 @@ BlendOscillator::BlendOscillator()
 
 BlendOscillator::~BlendOscillator()
 {
-
+  delete[] preBlendedTables[0];
+  delete[] preBlendedTables[1];
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -40,7 +67,7 @@ void BlendOscillator::setSampleRate(double newSampleRate)
   if( newSampleRate > 0.0 )
     sampleRate = newSampleRate;
   sampleRateRec = 1.0 / sampleRate;
-  increment = tableLengthDbl*freq*sampleRateRec;
+  setIncrement(tableLengthDbl*freq*sampleRateRec);
 }
 
 void BlendOscillator::setWaveForm1(int newWaveForm1)
@@ -58,11 +85,68 @@ void BlendOscillator::setWaveForm2(int newWaveForm2)
 void BlendOscillator::setWaveTable1(MipMappedWaveTable* newWaveTable1)
 {
   waveTable1 = newWaveTable1;
+  selectTables();
 }
 
 void BlendOscillator::setWaveTable2(MipMappedWaveTable* newWaveTable2)
 {
   waveTable2 = newWaveTable2;
+  selectTables();
+}
+
+bool BlendOscillator::updatePreBlendedTable()
+{
+  if( !preBlendedTableNeedsUpdate() )
+    return true;
+
+  // wait until the blend factor stays where it is:
+  double b = blend.load(std::memory_order_relaxed);  // may be changed concurrently
+  if( b != preBlendedRequested )
+  {
+    preBlendedRequested = b;
+    return false;
+  }
+
+  // render into the buffer that is not published - unless the audio thread didn't notice yet 
+  // that it has been replaced by the published one:
+  int target = preBlendedPublished.load() == 0 ? 1 : 0;
+  if( preBlendedInUse.load() == target )
+    return false;
+
+  // the versions are taken before the tables are read, such that a change of the content in the
+  // meantime shows up as a mismatch:
+  unsigned int version1 = waveTable1->getContentVersion();
+  unsigned int version2 = waveTable2->getContentVersion();
+
+  double g1 = 1.0-b;
+  double g2 = 0.5*b;     // see getSample for the factor 0.5
+  for(int t=0; t<MipMappedWaveTable::numTables; t++)
+  {
+    double *src1 = waveTable1->tableSet[t];
+    double *src2 = waveTable2->tableSet[t];
+    double *dst  = preBlendedTables[target] + t*paddedTableLength;
+    for(int i=0; i<paddedTableLength; i++)
+      dst[i] = g1*src1[i] + g2*src2[i];
+  }
+  if( waveTable1->getContentVersion() != version1 || waveTable2->getContentVersion() != version2 )
+    return false;  // torn by a change of the content, try again with the new one
+  preBlendedFactor[target]   = b;
+  preBlendedVersion1[target] = version1;
+  preBlendedVersion2[target] = version2;
+
+  preBlendedPublished.store(target);
+  return true;
+}
+
+void BlendOscillator::setUseFixedPointPhase(bool shouldUseFixedPoint)
+{
+  // carry the current phase over into the other format:
+  if( shouldUseFixedPoint && !fixedPointPhase )
+    phase = phaseIndexToFixedPoint(phaseIndex);
+  else if( !shouldUseFixedPoint && fixedPointPhase )
+    phaseIndex = tableLengthDbl * (double) (phase >> fixedPointIndexBits) 
+                 / (double) (1ULL << fixedPointFracBits);
+  fixedPointPhase = shouldUseFixedPoint;
 }
 
 void BlendOscillator::setStartPhase(double StartPhase)
@@ -71,15 +155,68 @@ void BlendOscillator::setStartPhase(double StartPhase)
     startIndex = (StartPhase/360.0)*tableLengthDbl;
 }
 
+//-------------------------------------------------------------------------------------------------
+// inquiry:
+
+bool BlendOscillator::preBlendedTableNeedsUpdate() const
+{
+  double b = blend.load(std::memory_order_relaxed);
+  if( waveTable1 == NULL || waveTable2 == NULL || b == 0.0 || b == 1.0 )
+    return false;
+  int published = preBlendedPublished.load();
+  return published < 0 || !preBlendedTableMatches(published, b);
+}
+
 //-------------------------------------------------------------------------------------------------
 // event processing:
 
 void BlendOscillator::resetPhase()
 {
   phaseIndex = startIndex;
+  phase      = phaseIndexToFixedPoint(phaseIndex);
 }
 
 void BlendOscillator::setPhase(double PhaseIndex)
 {
   phaseIndex = startIndex+PhaseIndex;
+  phase      = phaseIndexToFixedPoint(phaseIndex);
+}
+
+void BlendOscillator::getState(State *state) const
+{
+  state->phaseIndex      = phaseIndex;
+  state->freq            = freq;
+  state->increment       = increment;
+  state->blend           = blend.load(std::memory_order_relaxed);
+  state->startIndex      = startIndex;
+  state->sampleRate      = sampleRate;
+  state->phase           = phase;
+  state->fixedPointPhase = fixedPointPhase;
+}
+
+void BlendOscillator::setState(const State *state)
+{
+  phaseIndex      = state->phaseIndex;
+  freq            = state->freq;
+  blend.store(state->blend, std::memory_order_relaxed);
+  preBlendedRequested = state->blend;  // settled, the next update renders the table right away
+  startIndex      = state->startIndex;
+  sampleRate      = state->sampleRate;
+  sampleRateRec   = 1.0 / sampleRate;
+  phase           = state->phase;
+  fixedPointPhase = state->fixedPointPhase;
+  setIncrement(state->increment);  // updates the fixed point increment and the table selection
+}
+
+//-------------------------------------------------------------------------------------------------
+// internal functions:
+
+UINT64 BlendOscillator::phaseIndexToFixedPoint(double index)
+{
+  // map into 0...1 (a full cycle) and scale to 2^53 (such that the conversion is exact and can't 
+  // overflow), then shift the remaining bits in:
+  double normalized = index/tableLengthDbl;
+  normalized -= floor(normalized);
+  UINT64 fixed = (UINT64) (INT64) (normalized * (double) (1ULL << fixedPointFracBits));
+  return fixed << fixedPointIndexBits;
 }
@@ -1,6 +1,8 @@
 #ifndef rosic_BlendOscillator_h
 #define rosic_BlendOscillator_h
 
+#include <atomic>
+
 // rosic-indcludes:
 #include "rosic_MipMappedWaveTable.h"
 
@@ -13,6 +15,21 @@ namespace rosic
   than using two separate oscillators because the phase-accumulator has to be calculated only once
   for both waveforms.
 
+  The phase can optionally be accumulated in 64 bit fixed point format where one cycle corresponds 
+  to 2^64 (@see setUseFixedPointPhase). The wraparound then happens implicitly on integer overflow, 
+  the table index is given by the topmost bits and the fractional part by the bits below - so 
+  there are no branches and no float-to-int conversions in the per-sample phase computations and 
+  the phase evolves deterministically over arbitrarily long time spans. The mip-map level is 
+  resolved whenever the increment changes, in either mode.
+
+  When the blend factor is exactly 0 or 1, only one of the tables is read. For factors in between,
+  updatePreBlendedTable() can be called between two blocks to render a mip-map that contains the 
+  mix of both waveforms, which is then read instead of the two separate tables as long as the 
+  blend factor stays where it is. While the blend factor is moving (i.e. the pre-blended table 
+  doesn't match it), the oscillator falls back to reading both tables. Which tables are read is 
+  decided in setIncrement() (or calculateIncrement()), so a new blend factor takes effect with the 
+  next call to one of these. The blend factor may be set from any thread.
+
   */
 
   class BlendOscillator
@@ -56,7 +73,22 @@ namespace rosic
     /** Sets the blend/mix factor between the two waveforms. The value is expected between 0...1
     where 0 means waveform1 only, 1 means waveform2 only - in between there will be a linear blend
     between the two waveforms. */
-    void setBlendFactor(double newBlendFactor) { blend = newBlendFactor; }
+    void setBlendFactor(double newBlendFactor) 
+    { blend.store(newBlendFactor, std::memory_order_relaxed); }
+
+    /** Renders the mix of both wavetables for the current blend factor into a pre-blended mip-map
+    if the one that is currently in use doesn't match the blend factor or the content of the 
+    wavetables anymore (otherwise, this does nothing). It doesn't allocate memory (both buffers 
+    are allocated in the constructor). It may be called concurrently to getSample() and to the
+    setters of the wavetables' content, so a rebuild can be left to a thread other than the one 
+    that renders the oscillator (a timer, for instance): the table is rendered into a second 
+    buffer that is swapped in atomically when it's ready, and it is dropped when the content of 
+    the wavetables changed while it was rendered. It must not be called concurrently to itself or
+    to setWaveTable1/2. The table is rendered only when the blend factor is the same as on the 
+    previous call, such that a moving knob doesn't cause a rebuild on each call. It returns false
+    when the update could not be done for one of these reasons or because the audio thread still
+    holds on to the second buffer from the previous update - call it again later in this case. */
+    bool updatePreBlendedTable();
 
     /** Sets the frequency of the oscillator. */
     INLINE void setFrequency(double newFrequency);
@@ -65,7 +97,11 @@ namespace rosic
     INLINE void setPulseWidth(double newPulseWidth);
 
     /** Sets the phase increment from outside. */
-    INLINE void setIncrement(double newIncrement) { increment = newIncrement; }
+    INLINE void setIncrement(double newIncrement);
+
+    /** Switches between accumulating the phase as 64 bit fixed point number and as double 
+    precision floating point number (the default). */
+    void setUseFixedPointPhase(bool shouldUseFixedPoint);
 
     //---------------------------------------------------------------------------------------------
     // inquiry:
@@ -73,7 +109,7 @@ namespace rosic
     /** Returns the blend/mix factor between the two waveforms as a value between 0...1 where 0 
     means waveform1 only, 1 means waveform2 only - in between there will be a linear blend between 
     the two waveforms. */
-    double getBlendFactor() const { return blend; }
+    double getBlendFactor() const { return blend.load(std::memory_order_relaxed); }
 
     /** Returns the phase increment. */
     INLINE double getIncrement() const { return increment; }
@@ -91,27 +127,90 @@ namespace rosic
     pulseWidth. */
     INLINE void calculateIncrement();
 
+    /** Returns true when a pre-blended mip-map is needed for the current blend factor but doesn't
+    exist or doesn't match it or the wavetables anymore. */
+    bool preBlendedTableNeedsUpdate() const;
+
     /** Resets the phaseIndex to startIndex. */
     void resetPhase();
 
     /** Reset the phaseIndex to startIndex+PhaseIndex. */
     void setPhase(double PhaseIndex);
 
+    /** The settings and the running phase of the oscillator - everything except the wavetables 
+    and the tables that are derived from them. */
+    struct State
+    {
+      double phaseIndex, freq, increment, blend, startIndex, sampleRate;
+      UINT64 phase;
+      bool   fixedPointPhase;
+    };
+
+    /** Writes the settings and the phase into the passed State. */
+    void getState(State *state) const;
+
+    /** Restores settings and phase from a State that was written by getState() (of this or 
+    another oscillator). The wavetables remain those that were assigned to this oscillator. The 
+    restored blend factor counts as settled, so the next call to updatePreBlendedTable() renders 
+    the pre-blended mip-map for it. */
+    void setState(const State *state);
+
     //=============================================================================================
 
   protected:
 
+    /** Decides which table(s) getSample() reads for the current tableNumber and blend factor. */
+    INLINE void selectTables();
+
+    /** Returns true when the pre-blended buffer with given index matches the given blend factor
+    and the current wavetables. */
+    INLINE bool preBlendedTableMatches(int index, double blendFactor) const;
+
+    /** Converts a phase index between 0 and tableLength into fixed point format. */
+    UINT64 phaseIndexToFixedPoint(double index);
+
+    // the length of one table in the mip-map including the additional samples for interpolation:
+    static const int paddedTableLength = MipMappedWaveTable::tableLength+4;
+
+    // the table index occupies the topmost bits of the fixed point phase - this must be consistent
+    // with MipMappedWaveTable::tableLength = 2^11:
+    static const int fixedPointIndexBits = 11;
+    static const int fixedPointFracBits  = 64-fixedPointIndexBits;
+
     double tableLengthDbl;    // tableLength as double variable
     double phaseIndex;        // current phase index
+    UINT64 phase;             // current phase in fixed point format
+    UINT64 phaseIncrement;    // phase increment per sample in fixed point format
+    int    tableNumber;       // index of the mip-map level to be used for the current increment
+    bool   fixedPointPhase;   // indicates that the phase is accumulated in fixed point format
     double freq;              // frequency of the oscillator
     double increment;         // phase increment per sample
-    double blend;             // the blend factor between the two waveforms
+    std::atomic<double> blend; // the blend factor between the two waveforms
     double startIndex;        // start-phase-index of the osc (range: 0 - tableLength)
     double sampleRate;        // the samplerate
     double sampleRateRec;     // 1/sampleRate
 
     MipMappedWaveTable *waveTable1, *waveTable2; // the 2 wavetables between which we blend
 
+    // the tables that getSample() reads - readTable2 is NULL when only one table is read:
+    double *readTable1, *readTable2;
+    double readGain1,   readGain2;
+
+    // the values of tableNumber, blend, etc. for which the tables were selected:
+    int          selectedTableNumber, selectedPublished;
+    double       selectedBlend;
+    unsigned int selectedVersion1, selectedVersion2;
+
+    // double-buffered pre-blended mip-maps, the blend factor and the content versions of the 
+    // wavetables they were rendered from, and the blend factor at the previous update request:
+    double       *preBlendedTables[2];
+    double       preBlendedFactor[2];
+    unsigned int preBlendedVersion1[2], preBlendedVersion2[2];
+    std::atomic<int> preBlendedPublished; // buffer that may be read (-1 if none)
+    std::atomic<int> preBlendedInUse;     // buffer that is read by the audio thread (-1 if none)
+    int              preBlendedSelected;  // audio thread's copy of preBlendedInUse
+    double           preBlendedRequested;
+
   };
 
   //-----------------------------------------------------------------------------------------------
@@ -129,39 +228,149 @@ namespace rosic
     waveTable2->setSymmetry(0.01*newPulseWidth);
   }
 
+  INLINE void BlendOscillator::setIncrement(double newIncrement)
+  {
+    increment = newIncrement;
+
+    // from this increment, decide which table is to be used:
+    tableNumber  = ((int)EXPOFDBL(increment));
+    //tableNumber += 1;           // generate frequencies up to nyquist/2 on the highest note
+    tableNumber += 2;             // generate frequencies up to nyquist/4 on the highest note
+                                  // \todo: make this number adjustable from outside
+    tableNumber  = clip(tableNumber, 0, MipMappedWaveTable::numTables-1);
+
+    // the increment is below tableLength/2 for all frequencies below the Nyquist frequency - we 
+    // clip it to that range such that it can be converted via a signed integer (which is a 
+    // single instruction on all platforms):
+    double fixedIncrement = clip(increment, 0.0, 0.5*tableLengthDbl);
+    phaseIncrement = (UINT64) (INT64) (fixedIncrement * (double) (1ULL << fixedPointFracBits));
+
+    // the table selection needs to be redone only when one of its inputs has changed:
+    if( waveTable1 == NULL || waveTable2 == NULL )
+      return;
+    if(    tableNumber != selectedTableNumber 
+        || blend.load(std::memory_order_relaxed) != selectedBlend 
+        || preBlendedPublished.load(std::memory_order_acquire) != selectedPublished
+        || waveTable1->getContentVersion() != selectedVersion1
+        || waveTable2->getContentVersion() != selectedVersion2 )
+    {
+      selectTables();
+    }
+  }
+
+  INLINE bool BlendOscillator::preBlendedTableMatches(int index, double blendFactor) const
+  {
+    return preBlendedFactor[index]   == blendFactor 
+        && preBlendedVersion1[index] == waveTable1->getContentVersion()
+        && preBlendedVersion2[index] == waveTable2->getContentVersion();
+  }
+
+  INLINE void BlendOscillator::selectTables()
+  {
+    if( waveTable1 == NULL || waveTable2 == NULL )
+      return;
+
+    double b = blend.load(std::memory_order_relaxed);  // may be changed concurrently
+
+    selectedTableNumber = tableNumber;
+    selectedBlend       = b;
+    selectedPublished   = preBlendedPublished.load();
+    selectedVersion1    = waveTable1->getContentVersion();
+    selectedVersion2    = waveTable2->getContentVersion();
+
+    double *table1 = waveTable1->tableSet[tableNumber];
+    double *table2 = waveTable2->tableSet[tableNumber];
+    int    use     = -1;
+    if( b == 0.0 )
+    {
+      readTable1 = table1; readGain1 = 1.0;
+      readTable2 = NULL;   readGain2 = 0.0;
+    }
+    else if( b == 1.0 )
+    {
+      readTable1 = table2; readGain1 = 0.5; // see getSample for the factor 0.5
+      readTable2 = NULL;   readGain2 = 0.0;
+    }
+    else
+    {
+      use = preBlendedPublished.load();
+      if( use >= 0 && preBlendedTableMatches(use, b) )
+      {
+        // announce that we are going to read this buffer and make sure that it has not been 
+        // replaced in the meantime (such that updatePreBlendedTable won't overwrite it):
+        if( use != preBlendedSelected )
+        {
+          preBlendedInUse.store(use);
+          preBlendedSelected = use;
+          if( preBlendedPublished.load() != use )
+            use = -1;
+        }
+      }
+      else
+        use = -1;
+
+      if( use >= 0 )
+      {
+        readTable1 = preBlendedTables[use] + tableNumber*paddedTableLength;
+        readGain1  = 1.0;
+        readTable2 = NULL;
+        readGain2  = 0.0;
+      }
+      else
+      {
+        readTable1 = table1; readGain1 = 1.0-b;
+        readTable2 = table2; readGain2 = 0.5*b;
+      }
+    }
+
+    if( use < 0 && preBlendedSelected >= 0 )
+    {
+      preBlendedInUse.store(-1);
+      preBlendedSelected = -1;
+    }
+  }
+
   INLINE void BlendOscillator::calculateIncrement()
   {
-    increment = tableLengthDbl*freq*sampleRateRec;
+    setIncrement(tableLengthDbl*freq*sampleRateRec);
   }
 
   INLINE double BlendOscillator::getSample()
   {
     double out1, out2;
-    int    tableNumber;
 
     if( waveTable1 == NULL || waveTable2 == NULL )
       return 0.0;
 
-    // from this increment, decide which table is to be used:
-    tableNumber  = ((int)EXPOFDBL(increment));
-    //tableNumber += 1;           // generate frequencies up to nyquist/2 on the highest note
-    tableNumber += 2;             // generate frequencies up to nyquist/4 on the highest note
-                                  // \todo: make this number adjustable from outside
-
-    // wraparound if necessary:
-    while( phaseIndex>=tableLengthDbl )
-      phaseIndex -= tableLengthDbl;
-
-    int    intIndex = floorInt(phaseIndex);
-    double frac     = phaseIndex  - (double) intIndex;
-    out1 = (1.0-blend) * waveTable1->getValueLinear(intIndex, frac, tableNumber);
-    out2 =      blend  * waveTable2->getValueLinear(intIndex, frac, tableNumber);
-    
-    out2 *= 0.5; // \todo: this is preliminary to scale the square in AciDevil we need to
-                 // implement something more general here (like a kind of crest-compensation in 
-                 // the wavetable-class)
-
-    phaseIndex += increment;
+    int    intIndex;
+    double frac;
+    if( fixedPointPhase )
+    {
+      // the topmost bits are the integer part, the 52 bits below are used as mantissa of a double
+      // in the range 1...2 which gives us the fractional part without any conversion:
+      intIndex = (int) (phase >> fixedPointFracBits);
+      frac     = bitsToDouble(0x3FF0000000000000ULL 
+                              | ((phase >> (fixedPointFracBits-52)) & 0x000FFFFFFFFFFFFFULL)) - 1.0;
+      phase   += phaseIncrement;  // wraps around on overflow
+    }
+    else
+    {
+      // wraparound if necessary:
+      while( phaseIndex>=tableLengthDbl )
+        phaseIndex -= tableLengthDbl;
+
+      intIndex    = floorInt(phaseIndex);
+      frac        = phaseIndex  - (double) intIndex;
+      phaseIndex += increment;
+    }
+
+    // the tables were selected in setIncrement - the 2nd waveform is scaled by 0.5 there:
+    // \todo: this is preliminary to scale the square in AciDevil we need to implement something 
+    // more general here (like a kind of crest-compensation in the wavetable-class)
+    out1 = readGain1 * ((1.0-frac)*readTable1[intIndex] + frac*readTable1[intIndex+1]);
+    if( readTable2 == NULL )
+      return out1;
+    out2 = readGain2 * ((1.0-frac)*readTable2[intIndex] + frac*readTable2[intIndex+1]);
     return out1 + out2;
   }
 
@@ -15,11 +15,6 @@ DecayEnvelope::DecayEnvelope()
   calculateCoefficient();
 }
 
-DecayEnvelope::~DecayEnvelope()
-{
-
-}
-
 //-------------------------------------------------------------------------------------------------
 // parameter settings:
 
@@ -47,6 +42,17 @@ void DecayEnvelope::setNormalizeSum(bool shouldNormalizeSum)
   calculateCoefficient();
 }
 
+//-------------------------------------------------------------------------------------------------
+// audio processing:
+
+void DecayEnvelope::processBlock(double *out, int numSamples)
+{
+  if( numSamples <= 0 )
+    return;
+  exponentialApproach(out, numSamples, y, 0.0, c);
+  y = out[numSamples-1];
+}
+
 //-------------------------------------------------------------------------------------------------
 // others:
 
@@ -68,7 +74,7 @@ bool DecayEnvelope::endIsReached(double threshold)
 
 void DecayEnvelope::calculateCoefficient()
 {
-  c     = exp( -1.0 / (0.001*tau*fs) );
+  c     = fastExp<FAST_MATH_HIGH>( -1.0 / (0.001*tau*fs) );
   if( normalizeSum == true )
     yInit = (1.0-c)/c;
   else  
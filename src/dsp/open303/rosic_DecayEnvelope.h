@@ -25,9 +25,6 @@ namespace rosic
     /** Constructor. */
     DecayEnvelope();  
 
-    /** Destructor. */
-    ~DecayEnvelope(); 
-
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
@@ -58,12 +55,20 @@ namespace rosic
     /** Calculates one output sample at a time. */
     INLINE double getSample();    
 
+    /** Calculates a block of output samples - equivalent to numSamples calls to getSample() up to
+    rounding errors (@see exponentialApproach). */
+    void processBlock(double *out, int numSamples);
+
     //---------------------------------------------------------------------------------------------
     // others:
 
     /** Triggers the envelope - the next sample retrieved via getSample() will be 1. */
     void trigger();
 
+    /** Sets the output to zero once it has decayed below the denormal-safety threshold (the
+    multiplicative accumulation would otherwise crawl through the denormal range). */
+    void flushDenormals() { y = flushToZero(y); }
+
   protected:
 
     /** Calculates the coefficient for multiplicative accumulation. */
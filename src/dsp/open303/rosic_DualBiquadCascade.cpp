@@ -0,0 +1,115 @@
+#include "rosic_DualBiquadCascade.h"
+using namespace rosic;
+
+//-------------------------------------------------------------------------------------------------
+// construction/destruction:
+
+DualBiquadCascade::DualBiquadCascade()
+{
+  for(int s=0; s<numSections; s++)
+  {
+    for(int l=0; l<numLanes; l++)
+      setToIdentity(s, l);
+  }
+  reset();
+}
+
+//-------------------------------------------------------------------------------------------------
+// parameter settings:
+
+void DualBiquadCascade::setCoefficients(int section, int lane, double newB0, double newB1,
+                                        double newB2, double newA1, double newA2)
+{
+  if( section < 0 || section >= numSections || lane < 0 || lane >= numLanes )
+    return;
+  b0[section][lane] = newB0;
+  b1[section][lane] = newB1;
+  b2[section][lane] = newB2;
+  a1[section][lane] = newA1;
+  a2[section][lane] = newA2;
+}
+
+void DualBiquadCascade::setCoefficientsFromOnePoles(int section, int lane, double b0a, double b1a,
+                                                    double a1a, double b0b, double b1b, double a1b)
+{
+  // multiply out (b0a + b1a/z) * (b0b + b1b/z) / ( (1 - a1a/z) * (1 - a1b/z) ):
+  setCoefficients(section, lane, b0a*b0b, b0a*b1b + b1a*b0b, b1a*b1b, a1a + a1b, -a1a*a1b);
+}
+
+//-------------------------------------------------------------------------------------------------
+// audio processing:
+
+void DualBiquadCascade::processBlock(double *buffer0, double *buffer1, int numSamples)
+{
+  // work on local copies such that the compiler can keep everything in registers (the buffers
+  // might alias our members as far as it knows):
+  double cb0[numSections][numLanes], cb1[numSections][numLanes], cb2[numSections][numLanes];
+  double ca1[numSections][numLanes], ca2[numSections][numLanes];
+  double z1[numSections][numLanes], z2[numSections][numLanes];
+  int s, l;
+  for(s=0; s<numSections; s++)
+  {
+    for(l=0; l<numLanes; l++)
+    {
+      cb0[s][l] = b0[s][l]; cb1[s][l] = b1[s][l]; cb2[s][l] = b2[s][l];
+      ca1[s][l] = a1[s][l]; ca2[s][l] = a2[s][l];
+      z1[s][l]  = s1[s][l]; z2[s][l]  = s2[s][l];
+    }
+  }
+
+  double x[numLanes], y[numLanes];
+  for(int n=0; n<numSamples; n++)
+  {
+    x[0] = buffer0[n];
+    x[1] = buffer1[n];
+    for(s=0; s<numSections; s++)
+    {
+      for(l=0; l<numLanes; l++)
+      {
+        y[l]     = cb0[s][l]*x[l] + z1[s][l];
+        z1[s][l] = cb1[s][l]*x[l] + ca1[s][l]*y[l] + z2[s][l];
+        z2[s][l] = cb2[s][l]*x[l] + ca2[s][l]*y[l];
+      }
+      for(l=0; l<numLanes; l++)
+        x[l] = y[l];
+    }
+    buffer0[n] = x[0];
+    buffer1[n] = x[1];
+  }
+
+  for(s=0; s<numSections; s++)
+  {
+    for(l=0; l<numLanes; l++)
+    {
+      s1[s][l] = z1[s][l];
+      s2[s][l] = z2[s][l];
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// others:
+
+void DualBiquadCascade::reset()
+{
+  for(int s=0; s<numSections; s++)
+  {
+    for(int l=0; l<numLanes; l++)
+    {
+      s1[s][l] = 0.0;
+      s2[s][l] = 0.0;
+    }
+  }
+}
+
+void DualBiquadCascade::flushDenormals()
+{
+  for(int s=0; s<numSections; s++)
+  {
+    for(int l=0; l<numLanes; l++)
+    {
+      s1[s][l] = flushToZero(s1[s][l]);
+      s2[s][l] = flushToZero(s2[s][l]);
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef rosic_DualBiquadCascade_h
+#define rosic_DualBiquadCascade_h
+
+// rosic-indcludes:
+#include "rosic_RealFunctions.h"
+
+namespace rosic
+{
+
+  /**
+
+  This is a bank of biquad sections in transposed direct form II that filters two independent
+  signals ("lanes") through a series connection of two sections each. The coefficients and states
+  are stored interleaved by lane, so each section updates both lanes with the same sequence of
+  operations which the compiler turns into 2-wide vector instructions (SSE2, NEON or WASM simd128).
+  The coefficients have to be supplied from outside (for example by designing them with
+  OnePoleFilter or BiquadFilter objects and reading them back from there) and follow the same sign
+  convention as the other filters in this library:
+
+  y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2]
+
+  */
+
+  class DualBiquadCascade
+  {
+
+  public:
+
+    /** The number of independent signals that run through the bank. */
+    static const int numLanes = 2;
+
+    /** The number of biquad sections per lane. */
+    static const int numSections = 2;
+
+    //---------------------------------------------------------------------------------------------
+    // construction/destruction:
+
+    /** Constructor. Initializes all sections to pass their input through unchanged. */
+    DualBiquadCascade();
+
+    //---------------------------------------------------------------------------------------------
+    // parameter settings:
+
+    /** Sets the coefficients of one section in one of the lanes. */
+    void setCoefficients(int section, int lane, double b0, double b1, double b2, double a1,
+      double a2);
+
+    /** Sets the coefficients of a section to the product of two first order filters with
+    coefficients b0, b1, a1 each (as used by OnePoleFilter). */
+    void setCoefficientsFromOnePoles(int section, int lane, double b0a, double b1a, double a1a,
+      double b0b, double b1b, double a1b);
+
+    /** Lets a section pass its input through unchanged. */
+    void setToIdentity(int section, int lane) { setCoefficients(section, lane, 1.0, 0.0, 0.0, 0.0,
+      0.0); }
+
+    //---------------------------------------------------------------------------------------------
+    // audio processing:
+
+    /** Filters one sample in each of the lanes (in place). */
+    INLINE void getSamplePair(double *inOut0, double *inOut1);
+
+    /** Filters a block of samples in each of the lanes (in place). */
+    void processBlock(double *buffer0, double *buffer1, int numSamples);
+
+    //---------------------------------------------------------------------------------------------
+    // others:
+
+    /** Resets the states of all sections to zero. */
+    void reset();
+
+    /** Zeroes those states that have decayed to almost zero. */
+    void flushDenormals();
+
+    //=============================================================================================
+
+  protected:
+
+    // coefficients and states, indexed by [section][lane]:
+    double b0[numSections][numLanes], b1[numSections][numLanes], b2[numSections][numLanes];
+    double a1[numSections][numLanes], a2[numSections][numLanes];
+    double s1[numSections][numLanes], s2[numSections][numLanes];
+
+  };
+
+  //-----------------------------------------------------------------------------------------------
+  // inlined functions:
+
+  INLINE void DualBiquadCascade::getSamplePair(double *inOut0, double *inOut1)
+  {
+    double x[numLanes] = { *inOut0, *inOut1 };
+    double y[numLanes];
+    for(int s=0; s<numSections; s++)
+    {
+      for(int l=0; l<numLanes; l++)
+      {
+        y[l]     = b0[s][l]*x[l] + s1[s][l];
+        s1[s][l] = b1[s][l]*x[l] + a1[s][l]*y[l] + s2[s][l];
+        s2[s][l] = b2[s][l]*x[l] + a2[s][l]*y[l];
+      }
+      for(int l=0; l<numLanes; l++)
+        x[l] = y[l];
+    }
+    *inOut0 = x[0];
+    *inOut1 = x[1];
+  }
+
+} // end namespace rosic
+
+#endif // rosic_DualBiquadCascade_h
@@ -0,0 +1,44 @@
+#include "rosic_FastMath.h"
+using namespace rosic;
+
+template<int precision>
+void rosic::fastExp2(const double *x, double *y, int N)
+{
+  for(int n=0; n<N; n++)
+    y[n] = fastExp2<precision>(x[n]);
+}
+
+template<int precision>
+void rosic::fastLog2(const double *x, double *y, int N)
+{
+  for(int n=0; n<N; n++)
+    y[n] = fastLog2<precision>(x[n]);
+}
+
+template<int precision>
+void rosic::fastTanh(const double *x, double *y, int N)
+{
+  for(int n=0; n<N; n++)
+    y[n] = fastTanh<precision>(x[n]);
+}
+
+template<int precision>
+void rosic::fastSin(const double *x, double *y, int N)
+{
+  for(int n=0; n<N; n++)
+    y[n] = fastSin<precision>(x[n]);
+}
+
+// explicit instantiations for all precision tiers:
+template void rosic::fastExp2<FAST_MATH_LOW>(   const double *x, double *y, int N);
+template void rosic::fastExp2<FAST_MATH_MEDIUM>(const double *x, double *y, int N);
+template void rosic::fastExp2<FAST_MATH_HIGH>(  const double *x, double *y, int N);
+template void rosic::fastLog2<FAST_MATH_LOW>(   const double *x, double *y, int N);
+template void rosic::fastLog2<FAST_MATH_MEDIUM>(const double *x, double *y, int N);
+template void rosic::fastLog2<FAST_MATH_HIGH>(  const double *x, double *y, int N);
+template void rosic::fastTanh<FAST_MATH_LOW>(   const double *x, double *y, int N);
+template void rosic::fastTanh<FAST_MATH_MEDIUM>(const double *x, double *y, int N);
+template void rosic::fastTanh<FAST_MATH_HIGH>(  const double *x, double *y, int N);
+template void rosic::fastSin<FAST_MATH_LOW>(    const double *x, double *y, int N);
+template void rosic::fastSin<FAST_MATH_MEDIUM>( const double *x, double *y, int N);
+template void rosic::fastSin<FAST_MATH_HIGH>(   const double *x, double *y, int N);
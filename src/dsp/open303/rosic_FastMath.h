@@ -0,0 +1,299 @@
+#ifndef rosic_FastMath_h
+#define rosic_FastMath_h
+
+// standard library includes:
+#include <math.h>
+#include <string.h>
+
+// rosic includes:
+#include "GlobalDefinitions.h"
+
+namespace rosic
+{
+
+  /**
+
+  This file contains fast approximations of exp2, log2, pow, tanh and sin for double precision
+  arguments. Each function comes in three precision tiers which are selected via the template
+  parameter (@see fastMathPrecisions). The kernels are branch-free: range reduction is done by
+  manipulating the IEEE 754 exponent bits directly and the remaining interval is covered by a
+  near-minimax (Chebyshev-economized) polynomial. This makes the buffer versions (declared at the
+  bottom and instantiated in rosic_FastMath.cpp) auto-vectorizable with SSE2/AVX on x86, NEON on
+  ARM and simd128 on WebAssembly, so we don't need to maintain separate intrinsics versions for
+  each instruction set.
+
+  Measured maximum errors against libm (10^7 random arguments per function, "ulp" refers to the
+  double precision unit in the last place of the libm result, see tools/FastMathAccuracy.cpp):
+
+  function  range            LOW                 MEDIUM              HIGH
+  fastExp2  [-1022, 1023]    3.5e-6 rel          9.2e-8 rel          1 ulp
+  fastLog2  (0, DBL_MAX]     1.1e-5 abs          6.0e-8 abs          3 ulp
+  fastTanh  all reals        1.7e-6 abs          4.6e-8 abs          3.3e-16 abs
+            1e-6 <= |x| <= 1 3.8e-5 rel          7.5e-7 rel          5.5e-11 rel (**)
+  fastSin   [-10, 10]        1.2e-6 abs          6.7e-9 abs          3.3e-16 abs (*)
+
+  (*) the HIGH tier of fastSin uses a two-part (Cody-Waite) representation of pi for the range
+  reduction, so its absolute error grows only slowly with |x| - for |x| up to 1e5 it is still
+  below 1e-11. The lower tiers have the same error over that range.
+
+  (**) the polynomials for 2^f of all tiers are exactly 1 at f = 0, so fastTanh(0) is 0 and the
+  relative error around it is that of the polynomial's slope. Towards zero, e^(2x)-1 cancels, so
+  the relative error of all tiers grows by roughly 5e-17/|x| on top of that.
+
+  LOW is meant for control signals and modulation paths (3.5e-6 relative error in exp2
+  corresponds to 0.006 cents), MEDIUM roughly matches single precision and HIGH is as good as
+  libm for all practical purposes while still being branch-free. fastPow inherits the errors of
+  fastExp2 and fastLog2 with the log2-error scaled by the exponent.
+
+  */
+
+  /** The available precision tiers for the fast math functions. */
+  enum fastMathPrecisions
+  {
+    FAST_MATH_LOW = 0,
+    FAST_MATH_MEDIUM,
+    FAST_MATH_HIGH
+  };
+
+  /** Computes 2^x. Arguments are clipped into the range -1022...1023 such that the result is
+  always a normal number. */
+  template<int precision>
+  INLINE double fastExp2(double x);
+
+  /** Computes e^x by means of fastExp2. */
+  template<int precision>
+  INLINE double fastExp(double x);
+
+  /** Computes the base 2 logarithm of x. The argument must be a positive, normal number - zero,
+  denormals, negative numbers, infinities and NaNs produce garbage. */
+  template<int precision>
+  INLINE double fastLog2(double x);
+
+  /** Computes base^exponent as 2^(exponent*log2(base)). The same restrictions as for fastLog2 apply
+  to the base. */
+  template<int precision>
+  INLINE double fastPow(double base, double exponent);
+
+  /** Computes the hyperbolic tangent of x. */
+  template<int precision>
+  INLINE double fastTanh(double x);
+
+  /** Computes the sine of x. */
+  template<int precision>
+  INLINE double fastSin(double x);
+
+  /** Computes the cosine of x as sin(x+pi/2). */
+  template<int precision>
+  INLINE double fastCos(double x);
+
+  /** Buffer versions of the functions above, y[n] = f(x[n]) for n = 0,...,N-1. In-place operation
+  (x == y) is allowed. These are not inlined but instantiated for all precision tiers in
+  rosic_FastMath.cpp such that the loops are compiled (and vectorized) once. */
+  template<int precision>
+  void fastExp2(const double *x, double *y, int N);
+  template<int precision>
+  void fastLog2(const double *x, double *y, int N);
+  template<int precision>
+  void fastTanh(const double *x, double *y, int N);
+  template<int precision>
+  void fastSin(const double *x, double *y, int N);
+
+  //===============================================================================================
+  // implementation:
+
+  /** Reinterprets the bits of a double as unsigned 64 bit integer and vice versa. We use memcpy
+  for this which is optimized away and (unlike a pointer cast) doesn't violate strict aliasing. */
+  INLINE UINT64 doubleToBits(double x)
+  {
+    UINT64 bits;
+    memcpy(&bits, &x, sizeof(double));
+    return bits;
+  }
+
+  INLINE double bitsToDouble(UINT64 bits)
+  {
+    double x;
+    memcpy(&x, &bits, sizeof(double));
+    return x;
+  }
+
+  // adding this constant (1.5*2^52) to a double with magnitude < 2^51 pushes all fractional bits
+  // out of the mantissa, so the low bits of the sum contain the argument rounded to the nearest
+  // integer - this requires the FPU to be in round-to-nearest mode (which is the default) and must
+  // not be reassociated away by the compiler (so don't compile this with -ffast-math):
+  #define FAST_MATH_ROUNDING_CONSTANT 6755399441055744.0
+
+  template<int precision>
+  INLINE double fastExp2(double x)
+  {
+    x = x < -1022.0 ? -1022.0 : x;
+    x = x >  1023.0 ?  1023.0 : x;
+
+    // split x into integer part n and fractional part f in [-0.5, 0.5]:
+    double t = x + FAST_MATH_ROUNDING_CONSTANT;
+    double n = t - FAST_MATH_ROUNDING_CONSTANT;
+    double f = x - n;
+    UINT64 i = doubleToBits(t) - doubleToBits(FAST_MATH_ROUNDING_CONSTANT); // n, two's complement
+
+    // approximate 2^f:
+    double p;
+    if( precision == FAST_MATH_LOW )
+    {
+      p =              0.0096663685153854483;
+      p = p*f +        0.055921975842255849;
+      p = p*f +        0.24022349038020361;
+      p = p*f +        0.6931210452034271;
+      p = p*f +        1.0;
+    }
+    else if( precision == FAST_MATH_MEDIUM )
+    {
+      p =              0.001326472721773109;
+      p = p*f +        0.009671512639579197;
+      p = p*f +        0.05550733743189216;
+      p = p*f +        0.24022242085377907;
+      p = p*f +        0.6931469775991951;
+      p = p*f +        1.0;
+    }
+    else
+    {
+      p =              4.4558179083360645e-10;
+      p = p*f +        7.074194297288521e-9;
+      p = p*f +        1.0178057087733941e-7;
+      p = p*f +        1.3215432535912376e-6;
+      p = p*f +        1.5252733841556773e-5;
+      p = p*f +        0.00015403530463724354;
+      p = p*f +        0.0013333558146406471;
+      p = p*f +        0.0096181291075872567;
+      p = p*f +        0.055504108664821627;
+      p = p*f +        0.2402265069591016;
+      p = p*f +        0.69314718055994531;
+      p = p*f +        1.0;
+    }
+
+    // multiply by 2^n by adding n to the exponent field:
+    return bitsToDouble(doubleToBits(p) + (i << 52));
+  }
+
+  template<int precision>
+  INLINE double fastExp(double x)
+  {
+    return fastExp2<precision>(ONE_OVER_LN2*x);
+  }
+
+  template<int precision>
+  INLINE double fastLog2(double x)
+  {
+    // split x into 2^k * m with m in [sqrt(0.5), sqrt(2)) - offsetting the bit-pattern by the
+    // difference between 1.0 and sqrt(0.5) before extracting the exponent shifts the split point
+    // from 1 to sqrt(0.5). We stay with unsigned integers and convert the biased exponent via the
+    // rounding constant because 64 bit arithmetic shifts and int64-to-double conversions have no
+    // SIMD instructions before AVX-512:
+    UINT64 bits = doubleToBits(x);
+    UINT64 kb   = (bits + (0x3FF0000000000000ULL - 0x3FE6A09E667F3BCDULL)) >> 52; // k + 1023
+    double m    = bitsToDouble(bits - (kb << 52) + (1023ULL << 52));
+    double k    = bitsToDouble(kb + doubleToBits(FAST_MATH_ROUNDING_CONSTANT))
+                  - (FAST_MATH_ROUNDING_CONSTANT + 1023.0);
+
+    // log2(m) = t * q(t^2) with t = (m-1)/(m+1) in [-0.1716, 0.1716]:
+    double t = (m-1.0) / (m+1.0);
+    double s = t*t;
+    double q;
+    if( precision == FAST_MATH_LOW )
+    {
+      q =              0.97910308965120126;
+      q = q*s +        2.8853262320521357;
+    }
+    else if( precision == FAST_MATH_MEDIUM )
+    {
+      q =              0.59575960690037194;
+      q = q*s +        0.96158894669407809;
+      q = q*s +        2.8853904219618327;
+    }
+    else
+    {
+      q =              0.21365895694319269;
+      q = q*s +        0.2209130842311768;
+      q = q*s +        0.26233435250418302;
+      q = q*s +        0.32059853491395986;
+      q = q*s +        0.41219858584090053;
+      q = q*s +        0.57707801634552023;
+      q = q*s +        0.96179669392598973;
+      q = q*s +        2.8853900817779268;
+    }
+
+    return k + t*q;
+  }
+
+  template<int precision>
+  INLINE double fastPow(double base, double exponent)
+  {
+    return fastExp2<precision>(exponent * fastLog2<precision>(base));
+  }
+
+  template<int precision>
+  INLINE double fastTanh(double x)
+  {
+    // tanh(x) = (e^(2x)-1) / (e^(2x)+1) - beyond |x| = 19.1, tanh(x) rounds to +-1 anyway, so we
+    // clip there to avoid overflow in the exponential:
+    x = x < -19.1 ? -19.1 : x;
+    x = x >  19.1 ?  19.1 : x;
+    double e = fastExp2<precision>(2.0*ONE_OVER_LN2*x);
+    return (e-1.0) / (e+1.0);
+  }
+
+  template<int precision>
+  INLINE double fastSin(double x)
+  {
+    // reduce the argument to r = x - k*pi in [-pi/2, pi/2] such that sin(x) = (-1)^k * sin(r):
+    double t = x * (1.0/PI) + FAST_MATH_ROUNDING_CONSTANT;
+    double k = t - FAST_MATH_ROUNDING_CONSTANT;
+    double r;
+    if( precision == FAST_MATH_HIGH )
+      r = (x - k*3.141592653589793116) - k*1.2246467991473532e-16;
+    else
+      r = x - k*PI;
+    UINT64 signFlip = doubleToBits(t) << 63;  // the lowest bit of k becomes the sign bit
+
+    // sin(r) = r * q(r^2):
+    double s = r*r;
+    double q;
+    if( precision == FAST_MATH_LOW )
+    {
+      q =              -0.00018522539324609908;
+      q = q*s +         0.0083131914143764377;
+      q = q*s +        -0.16665676500413847;
+      q = q*s +         0.99999923706153127;
+    }
+    else if( precision == FAST_MATH_MEDIUM )
+    {
+      q =               2.6051076353347881e-6;
+      q = q*s +        -0.00019809017408678004;
+      q = q*s +         0.0083330501706717732;
+      q = q*s +        -0.16666657947846011;
+      q = q*s +         0.99999999569880902;
+    }
+    else
+    {
+      q =               2.7215749422983443e-15;
+      q = q*s +        -7.6430265579716327e-13;
+      q = q*s +         1.605894087848656e-10;
+      q = q*s +        -2.505210689056952e-8;
+      q = q*s +         2.7557319211229607e-6;
+      q = q*s +        -0.00019841269841208675;
+      q = q*s +         0.0083333333333331864;
+      q = q*s +        -0.16666666666666665;
+      q = q*s +         1.0;
+    }
+
+    return bitsToDouble(doubleToBits(r*q) ^ signFlip);
+  }
+
+  template<int precision>
+  INLINE double fastCos(double x)
+  {
+    return fastSin<precision>(x + 0.5*PI);
+  }
+
+} // end namespace rosic
+
+#endif // rosic_FastMath_h
@@ -1,7 +1,14 @@
+#include <mutex>
 #include "rosic_FourierTransformerRadix2.h"
 #include "fft4g.c"
 using namespace rosic;
 
+// the number of entries in the cos/sin part and in the cos-only part of Ooura's tables for a given
+// block size - the cos/sin part covers complex transforms of length blockSize (which Ooura counts 
+// as 2*blockSize doubles) and the cos-only part covers real transforms of length blockSize:
+static int getNumTwiddlesCosSin(int blockSize) { return blockSize >= 4 ? blockSize/2 : 2; }
+static int getNumTwiddlesCos(int blockSize)    { return blockSize >= 8 ? blockSize/4 : 2; }
+
 //-------------------------------------------------------------------------------------------------
 // construction/destruction:
 
@@ -13,17 +20,17 @@ FourierTransformerRadix2::FourierTransformerRadix2()
   normalizationMode   = NORMALIZE_ON_INVERSE_TRAFO;
   normalizationFactor = 1.0;
   w                   = NULL;
+  tableSize           = 0;
   ip                  = NULL;
   tmpBuffer           = NULL;
+  bufferSize          = 0;
 
   setBlockSize(256);
 }
 
 FourierTransformerRadix2::~FourierTransformerRadix2()
 {
-  // free dynamically allocated memory:
-  if( w != NULL )
-    delete[] w;
+  // free dynamically allocated memory (the twiddle-factors are shared and not ours to delete):
   if( ip != NULL )
     delete[] ip;
   if( tmpBuffer != NULL )
@@ -46,18 +53,30 @@ void FourierTransformerRadix2::setBlockSize(int newBlockSize)
       logN = (int) floor( log2((double) N + 0.5 ) );
       updateNormalizationFactor();
 
-      if( w != NULL )
-        delete[] w;
-      w    = new double[2*N];
-
-      if( ip != NULL )
-        delete[] ip;
-      ip    = new int[(int) ceil(4.0+sqrt((double)N))];
-      ip[0] = 0; // indicate that re-initialization is necesarry
-
-      if( tmpBuffer != NULL )
-        delete[] tmpBuffer;
-      tmpBuffer = new Complex[N];
+      // the work areas only ever grow:
+      if( N > bufferSize )
+      {
+        if( ip != NULL )
+          delete[] ip;
+        ip = new int[(int) ceil(4.0+sqrt((double)N))];
+
+        if( tmpBuffer != NULL )
+          delete[] tmpBuffer;
+        tmpBuffer  = new Complex[N];
+        bufferSize = N;
+      }
+
+      // a shared table for a larger size serves smaller sizes as well:
+      if( N > tableSize )
+      {
+        w         = getSharedTwiddleFactors(N);
+        tableSize = N;
+      }
+
+      // tell Ooura's routines that the table is already initialized (they would otherwise write
+      // into the shared table):
+      ip[0] = getNumTwiddlesCosSin(tableSize);
+      ip[1] = getNumTwiddlesCos(tableSize);
     }
   }
   else if( !isPowerOfTwo(newBlockSize) || newBlockSize <= 1 )
@@ -94,7 +113,7 @@ void FourierTransformerRadix2::setNormalizationMode(int newNormalizationMode)
 
 void FourierTransformerRadix2::setRealSignalMode(bool willBeUsedForRealSignals)
 {
-  ip[0] = 0; // retriggers twiddle-factor computation
+  // nothing to do - the shared tables are valid for both modes
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -292,6 +311,32 @@ void FourierTransformerRadix2::getRealSignalFromMagnitudesAndPhases(double *magn
 //-------------------------------------------------------------------------------------------------
 // pre-calculations:
 
+double* FourierTransformerRadix2::getSharedTwiddleFactors(int blockSize)
+{
+  // one table per power of two, created on demand and never freed (the tables are small and 
+  // instances may hold on to them until the very end):
+  static double*    tables[32] = { NULL };
+  static std::mutex mutex;
+
+  int k = 0;
+  while( (1 << k) < blockSize )
+    k++;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if( tables[k] == NULL )
+  {
+    int nw = getNumTwiddlesCosSin(blockSize);
+    int nc = getNumTwiddlesCos(blockSize);
+    int *tmpIp = new int[(int) ceil(4.0+sqrt((double)blockSize))];
+    double *table = new double[nw+nc];
+    makewt(nw, tmpIp, table);
+    makect(nc, tmpIp, table+nw);
+    delete[] tmpIp;
+    tables[k] = table;
+  }
+  return tables[k];
+}
+
 void FourierTransformerRadix2::updateNormalizationFactor()
 {
   if( (normalizationMode == NORMALIZE_ON_FORWARD_TRAFO && direction == FORWARD) ||
@@ -22,6 +22,12 @@ namespace rosic
   class FourierTransfromerRadix2Clean which goes without such nasty hacks but is vastly inferior 
   efficiency-wise.
 
+  The tables of twiddle factors are computed only once per process and block size and are then
+  shared (read-only) by all instances. Ooura's tables for a given size also serve all smaller sizes,
+  so an instance can switch to a smaller block size without any allocation or re-computation -
+  only growing beyond the largest size used so far fetches a new table (and possibly grows the
+  work areas).
+
   */
 
   class FourierTransformerRadix2  
@@ -56,7 +62,8 @@ namespace rosic
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
-    /** FFT-size, has to be a power of 2 and >= 2. */
+    /** FFT-size, has to be a power of 2 and >= 2. Switching to a block size that is not larger than
+    any size used before with this object is cheap (no allocations, no trigonometric functions). */
     void setBlockSize(int newBlockSize);     
 
     /** Sets the direction of the transform (@see: directions). This will affect the sign of the 
@@ -64,9 +71,9 @@ namespace rosic
     constant. */
     void setDirection(int newDirection);
 
-    /** When you switch bewteen usage of this object for real or complex signals, you will need to 
-    call this switch-function in between which just triggers a re-computation of the twiddle 
-    factors (which must be different for the two cases). */
+    /** Formerly triggered a re-computation of the twiddle factors when switching between real and
+    complex signals. The shared tables now contain the factors for both cases, so this does nothing
+    anymore and is kept only for compatibility. */
     void setRealSignalMode(bool willBeUsedForRealSignals);
 
     /** Sets the mode for normalization of the output (@see: normalizationModes). */
@@ -142,6 +149,11 @@ namespace rosic
     normalizationMode. */
     void updateNormalizationFactor();
 
+    /** Returns the shared table of twiddle factors for transforms of real signals of length
+    blockSize and complex signals of length blockSize (and all smaller lengths). The table is
+    computed on the first request for the given size and lives until the end of the program. */
+    static double* getSharedTwiddleFactors(int blockSize);
+
     int    N;                    /**< the blocksize of the FFT. */
     int    logN;                 /**< Base 2 logarithm of the blocksize. */
     int    direction;            /**< The direction of the transform (@see: directions). */
@@ -149,11 +161,13 @@ namespace rosic
     double normalizationFactor;  /**< The normalization factor (can be 1, 1/N or 1/sqrt(N)). */
 
     // work-area stuff for Ooura's fft-routines:
-    double *w;                   /**< Table of the twiddle-factors. */
+    double *w;                   /**< Table of the twiddle-factors (shared, not owned). */
+    int    tableSize;            /**< The largest block size that w is valid for. */
     int    *ip;                  /**< Work area for bit-reversal (index pointer?). */
 
     // our own temporary storage area:
     Complex* tmpBuffer;
+    int      bufferSize;         /**< The largest block size that ip and tmpBuffer can hold. */
 
   };
 
@@ -13,11 +13,6 @@ LeakyIntegrator::LeakyIntegrator()
   calculateCoefficient();
 }
 
-LeakyIntegrator::~LeakyIntegrator()
-{
-
-}
-
 //-------------------------------------------------------------------------------------------------
 // parameter settings:
 
@@ -91,6 +86,39 @@ double LeakyIntegrator::getNormalizer(double tau1, double tau2, double fs)
   return 1.0/xp;
 }
 
+//-------------------------------------------------------------------------------------------------
+// audio processing:
+
+void LeakyIntegrator::processBlock(const double *in, double *out, int numSamples)
+{
+  // with a = coeff and b = 1-coeff, the recursion y[n] = b*x[n] + a*y[n-1] unrolled over 4 
+  // samples reads y[n] = a^4*y[n-4] + b*(x[n] + a*x[n-1] + a^2*x[n-2] + a^3*x[n-3]) - neither 
+  // the FIR part nor the recursion over every 4th sample has dependencies between neighbouring 
+  // samples, so both loops vectorize. The FIR part runs backwards to allow in-place operation:
+  double a  = coeff;
+  double b  = 1.0-coeff;
+  double a2 = a*a;
+  double a3 = a2*a;
+  double a4 = a2*a2;
+  int    n;
+  for(n=numSamples-1; n>=4; n--)
+    out[n] = b * (in[n] + a*in[n-1] + a2*in[n-2] + a3*in[n-3]);
+  for(n=0; n<4 && n<numSamples; n++)
+    out[n] = y1 = in[n] + coeff*(y1-in[n]);
+  for(n=4; n<numSamples; n++)
+    out[n] += a4*out[n-4];
+  if( numSamples > 0 )
+    y1 = out[numSamples-1];
+}
+
+void LeakyIntegrator::processBlock(double in, double *out, int numSamples)
+{
+  if( numSamples <= 0 )
+    return;
+  exponentialApproach(out, numSamples, y1, in, coeff);
+  y1 = out[numSamples-1];
+}
+
 //-------------------------------------------------------------------------------------------------
 // others:
 
@@ -102,7 +130,7 @@ void LeakyIntegrator::reset()
 void LeakyIntegrator::calculateCoefficient()
 {
   if( tau > 0.0 )
-    coeff = exp( -1.0 / (sampleRate*0.001*tau)  );
+    coeff = fastExp<FAST_MATH_HIGH>( -1.0 / (sampleRate*0.001*tau)  );
   else
     coeff = 0.0;
 }
@@ -25,9 +25,6 @@ namespace rosic
     /** Constructor. */
     LeakyIntegrator();  
 
-    /** Destructor. */
-    ~LeakyIntegrator();  
-
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
@@ -57,12 +54,24 @@ namespace rosic
     /** Calculates one sample at a time. */
     INLINE double getSample(double in);
 
+    /** Filters a block of samples - equivalent to numSamples calls to getSample(). In-place 
+    operation (in == out) is allowed. */
+    void processBlock(const double *in, double *out, int numSamples);
+
+    /** Calculates the response to a constant input signal for a block of samples in closed form - 
+    equivalent to numSamples calls to getSample(in) up to rounding errors 
+    (@see exponentialApproach). */
+    void processBlock(double in, double *out, int numSamples);
+
     //---------------------------------------------------------------------------------------------
     // others:
 
     /** Resets the internal state of the filter. */
     void reset();
 
+    /** Sets the internal state to zero, if it has decayed to almost zero. */
+    void flushDenormals() { y1 = flushToZero(y1); }
+
     //=============================================================================================
 
   protected:
@@ -0,0 +1,232 @@
+#include "rosic_LoopRenderCache.h"
+using namespace rosic;
+
+//-------------------------------------------------------------------------------------------------
+// construction/destruction:
+
+LoopRenderCache::LoopRenderCache()
+{
+  buffer          = NULL;
+  stepStarts      = NULL;
+  maxLoopLength   = 0;
+  maxNumSteps     = 0;
+  crossfadeLength = 1;
+  parameterHash   = 0;
+  reset();
+}
+
+LoopRenderCache::~LoopRenderCache()
+{
+  delete[] buffer;
+  delete[] stepStarts;
+}
+
+//-------------------------------------------------------------------------------------------------
+// parameter settings:
+
+void LoopRenderCache::setCapacity(int newMaxLoopLength, int newMaxNumSteps,
+                                  int newCrossfadeLength)
+{
+  delete[] buffer;
+  delete[] stepStarts;
+  maxLoopLength   = newMaxLoopLength   > 0 ? newMaxLoopLength   : 0;
+  maxNumSteps     = newMaxNumSteps     > 0 ? newMaxNumSteps     : 0;
+  crossfadeLength = newCrossfadeLength > 1 ? newCrossfadeLength : 1;
+  buffer          = new float[maxLoopLength+crossfadeLength];
+  stepStarts      = new int[maxNumSteps];
+  reset();
+}
+
+void LoopRenderCache::setParameterHash(UINT64 newHash)
+{
+  if( newHash != parameterHash )
+  {
+    parameterHash = newHash;
+    discardLoop();
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// inquiry:
+
+UINT64 LoopRenderCache::hash(const void *data, int numBytes, UINT64 previousHash)
+{
+  const unsigned char *bytes = (const unsigned char*) data;
+  UINT64 h = previousHash;
+  for(int i=0; i<numBytes; i++)
+  {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+//-------------------------------------------------------------------------------------------------
+// audio processing:
+
+void LoopRenderCache::startStep(int step)
+{
+  if( step < 0 || step >= maxNumSteps )
+  {
+    discardLoop();
+    return;
+  }
+
+  switch( state )
+  {
+  case WAITING:
+  {
+    if( step == 0 )
+    {
+      numSteadyCycles++;
+      if( numSteadyCycles >= 2 )  // one full cycle has passed without changes
+      {
+        state         = RECORDING;
+        writePosition = 0;
+        stepStarts[0] = 0;
+      }
+    }
+  } break;
+  case RECORDING:
+  {
+    if( step == 0 )
+    {
+      loopLength   = writePosition;
+      numLoopSteps = lastStep+1;
+      state        = RECORDING_TAIL;
+      if( loopLength < 2*crossfadeLength )
+      {
+        state           = WAITING;  // too short, tried again after another steady cycle
+        numSteadyCycles = 0;
+      }
+    }
+    else if( step == lastStep+1 )
+      stepStarts[step] = writePosition;
+    else
+      state = WAITING;  // the sequencer has jumped
+  } break;
+  case RECORDING_TAIL:
+    break;          // the tail is shorter than a step unless the tempo is extreme, in which case
+                    // the loop is played back with the step positions from the recording
+  default:
+  {
+    // resynchronize the playback position with the sequencer:
+    if( step < numLoopSteps )
+      readPosition = stepStarts[step];
+    else
+      discardLoop();
+  }
+  }
+
+  lastStep = step;
+}
+
+void LoopRenderCache::playBlock(double *signal, int numSamples)
+{
+  for(int n=0; n<numSamples; n++)
+  {
+    signal[n] = buffer[readPosition];
+    if( ++readPosition >= loopLength )
+      readPosition = 0;
+  }
+}
+
+void LoopRenderCache::processLiveBlock(double *signal, int numSamples)
+{
+  if( state == WAITING )
+    return;
+
+  double fadeScaler = 1.0 / (crossfadeLength+1);
+  for(int n=0; n<numSamples; n++)
+  {
+    switch( state )
+    {
+    case RECORDING:
+    {
+      if( writePosition < maxLoopLength )
+        buffer[writePosition++] = (float) signal[n];
+      else
+      {
+        state           = WAITING;  // too long, tried again after another steady cycle
+        numSteadyCycles = 0;
+      }
+    } break;
+    case RECORDING_TAIL:
+    {
+      buffer[writePosition++] = (float) signal[n];
+      if( writePosition == loopLength+crossfadeLength )
+      {
+        crossfadeSeam();
+        state        = FADING_IN;
+        readPosition = crossfadeLength;  // that's where the live signal is now within the cycle
+        fadePosition = 0;
+      }
+    } break;
+    case FADING_IN:
+    {
+      double w   = fadeScaler * ++fadePosition;
+      signal[n] += w * (buffer[readPosition] - signal[n]);
+      if( ++readPosition >= loopLength )
+        readPosition = 0;
+      if( fadePosition == crossfadeLength )
+        state = PLAYING;
+    } break;
+    case PLAYING:
+    {
+      signal[n] = buffer[readPosition];  // the rest of a block in which the fade-in has ended
+      if( ++readPosition >= loopLength )
+        readPosition = 0;
+    } break;
+    case FADING_OUT:
+    {
+      double w   = fadeScaler * ++fadePosition;
+      signal[n]  = buffer[readPosition] + w * (signal[n] - buffer[readPosition]);
+      if( ++readPosition >= loopLength )
+        readPosition = 0;
+      if( fadePosition == crossfadeLength )
+        state = WAITING;
+    } break;
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+// others:
+
+void LoopRenderCache::reset()
+{
+  state           = WAITING;
+  numSteadyCycles = 0;
+  loopLength      = 0;
+  numLoopSteps    = 0;
+  lastStep        = -1;
+  writePosition   = 0;
+  readPosition    = 0;
+  fadePosition    = 0;
+}
+
+void LoopRenderCache::discardLoop()
+{
+  numSteadyCycles = 0;
+  if( state == PLAYING || state == FADING_IN )
+  {
+    // the loop still matches the live signal closely enough for a crossfade:
+    state        = FADING_OUT;
+    fadePosition = 0;
+  }
+  else if( state != FADING_OUT )
+    state = WAITING;
+}
+
+void LoopRenderCache::crossfadeSeam()
+{
+  // the tail continues where the loop ends, so letting the head start with the tail and fade over
+  // to the recorded head makes the wrap-around continuous:
+  float *tail       = &buffer[loopLength];
+  double fadeScaler = 1.0 / (crossfadeLength+1);
+  for(int i=0; i<crossfadeLength; i++)
+  {
+    double w  = fadeScaler * (i+1);
+    buffer[i] = (float) (tail[i] + w * (buffer[i] - tail[i]));
+  }
+}
@@ -0,0 +1,133 @@
+#ifndef rosic_LoopRenderCache_h
+#define rosic_LoopRenderCache_h
+
+// rosic-indcludes:
+#include "GlobalFunctions.h"
+
+namespace rosic
+{
+
+  /**
+
+  This class records one cycle of a signal that is driven by a looping step sequencer and plays it
+  back on the subsequent cycles for as long as nothing that shapes the signal changes. The owner
+  reports the start of each sequencer step via startStep(), passes a hash of all relevant
+  parameters to setParameterHash() before each block and either feeds its live signal through
+  processLiveBlock() or - when isPlaying() returns true - skips rendering and fetches the signal
+  from playBlock().
+
+  A recording starts at the first step of the pattern after one full cycle with an unchanged hash
+  (such that slides and envelopes that reach across the loop boundary have settled) and ends at the
+  next first step. During playback, the read position is set to the recorded start of each step as
+  that step starts, so the small differences between step lengths that are due to the sequencer's
+  rounding to whole samples don't accumulate.
+
+  Consecutive cycles are not exactly identical because the oscillator of a synth usually runs
+  freely across the notes. Therefore, the seam of the loop is crossfaded with the live signal that
+  followed the recorded cycle, and the transitions from the live signal to the loop and back are
+  crossfaded, too.
+
+  */
+
+  class LoopRenderCache
+  {
+
+  public:
+
+    //---------------------------------------------------------------------------------------------
+    // construction/destruction:
+
+    /** Constructor. */
+    LoopRenderCache();
+
+    /** Destructor. */
+    ~LoopRenderCache();
+
+    //---------------------------------------------------------------------------------------------
+    // parameter settings:
+
+    /** Allocates the memory for loops of up to maxLoopLength samples and up to maxNumSteps
+    sequencer steps and sets the length of the crossfades (in samples). This discards a recorded
+    loop and is not realtime-safe. */
+    void setCapacity(int maxLoopLength, int maxNumSteps, int newCrossfadeLength);
+
+    /** Discards a recorded loop (with a crossfade to the live signal when it is currently played),
+    when the passed hash differs from the one that was passed before. */
+    void setParameterHash(UINT64 newHash);
+
+    //---------------------------------------------------------------------------------------------
+    // inquiry:
+
+    /** Returns true, when the next samples can be taken from playBlock() instead of being rendered
+    - this is the case while a recorded loop is played back and no crossfade is in progress. */
+    bool isPlaying() const { return state == PLAYING; }
+
+    /** Returns a 64 bit FNV-1a hash of a memory block, continuing from a previous hash value (pass
+    hashSeed for the first block). */
+    static UINT64 hash(const void *data, int numBytes, UINT64 previousHash = hashSeed);
+
+    static const UINT64 hashSeed = 14695981039346656037ULL;
+
+    //---------------------------------------------------------------------------------------------
+    // audio processing:
+
+    /** Must be called at the start of each step of the sequencer, before the signal for that step
+    is passed to processLiveBlock or fetched via playBlock. */
+    void startStep(int step);
+
+    /** Writes the next numSamples samples of the recorded loop into the buffer. Must only be called
+    when isPlaying() returns true. */
+    void playBlock(double *signal, int numSamples);
+
+    /** Takes the next numSamples samples of the live signal, records them if a recording is in
+    progress and crossfades them with the loop (in place) when we switch between live signal and
+    loop. */
+    void processLiveBlock(double *signal, int numSamples);
+
+    //---------------------------------------------------------------------------------------------
+    // others:
+
+    /** Discards a recorded loop without crossfade and waits for a new steady cycle. */
+    void reset();
+
+    //=============================================================================================
+
+  protected:
+
+    /** Starts to wait for a new steady cycle - a loop that is currently played is faded out. */
+    void discardLoop();
+
+    /** Blends the head of the recorded loop with the tail that was recorded after the loop end,
+    such that the loop seamlessly wraps around. */
+    void crossfadeSeam();
+
+    enum states
+    {
+      WAITING = 0,     // waiting for a steady cycle to record
+      RECORDING,       // recording a cycle
+      RECORDING_TAIL,  // recording the continuation after the cycle for the seam crossfade
+      FADING_IN,       // crossfading from the live signal to the loop
+      PLAYING,         // playing back the loop
+      FADING_OUT       // crossfading from the loop to the live signal
+    };
+
+    float  *buffer;          // the loop, followed by the tail
+    int    *stepStarts;      // start positions of the steps in the loop
+    int    maxLoopLength;    // capacity of the buffer (without the tail)
+    int    maxNumSteps;      // capacity of the stepStarts array
+    int    crossfadeLength;  // length of the crossfades (and the tail)
+    int    loopLength;       // length of the recorded loop
+    int    numLoopSteps;     // number of steps in the recorded loop
+    int    lastStep;         // the step that was started most recently
+    int    writePosition;    // recording position in the buffer
+    int    readPosition;     // playback position in the loop
+    int    fadePosition;     // position within a crossfade
+    int    numSteadyCycles;  // number of started cycles since the hash has last changed
+    int    state;            // one of the states above
+    UINT64 parameterHash;    // the most recently passed hash
+
+  };
+
+} // end namespace rosic
+
+#endif // rosic_LoopRenderCache_h
@@ -32,11 +32,6 @@ MidiNoteEvent::MidiNoteEvent(int initKey, int initVel, int initDetune, int initP
   detune = initDetune;
 }
 
-MidiNoteEvent::~MidiNoteEvent()
-{
-
-}
-
 //-------------------------------------------------------------------------------------------------
 // parameter settings:
 
@@ -24,9 +24,6 @@ namespace rosic
     /** Constructor with initializations. */
     MidiNoteEvent(int initKey, int initVel, int initDetune = 0, int initPriority = 0 );
 
-    /** Destructor. */
-    ~MidiNoteEvent();
-
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
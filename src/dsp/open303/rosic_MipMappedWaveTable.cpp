@@ -12,6 +12,7 @@ MipMappedWaveTable::MipMappedWaveTable()
   tanhShaperFactor = dB2amp(36.9);
   tanhShaperOffset = 4.37;
   squarePhaseShift = 180.0;
+  contentVersion   = 0;
 
   // set up the fourier-transformer:
   fourierTransformer.setBlockSize(tableLength);
@@ -57,8 +58,13 @@ void MipMappedWaveTable::setWaveform(int newWaveform)
 
 void MipMappedWaveTable::setSymmetry(double newSymmetry)
 {
+  // only the square and saw waveforms depend on the symmetry, so we don't need to re-render
+  // anything for the others (setWaveform will pick up the new value when switching to them):
+  if( newSymmetry == symmetry )
+    return;
   symmetry = newSymmetry;
-  renderWaveform();
+  if( waveform == SQUARE || waveform == SAW )
+    renderWaveform();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -66,7 +72,7 @@ void MipMappedWaveTable::setSymmetry(double newSymmetry)
 
 void MipMappedWaveTable::initPrototypeTable()
 {
-  for(int i=0; i<(tableLength+4); i++)
+  for(int i=0; i<tableLength; i++)
     prototypeTable[i] = 0.0;
 }
 
@@ -137,6 +143,7 @@ void MipMappedWaveTable::renderWaveform()
 void MipMappedWaveTable::generateMipMap()
 {
   double spectrum[tableLength];
+  double subSignals[tableLength];
   int t, i; // indices for the table and position
 
   //position = 0;             // begin of the 1st table (index 0)
@@ -156,28 +163,60 @@ void MipMappedWaveTable::generateMipMap()
   tableSet[t][tableLength+3] = tableSet[t][3];
 
   // get the spectrum from the prototype-table:
+  fourierTransformer.setBlockSize(tableLength);
   fourierTransformer.transformRealSignal(prototypeTable, spectrum);
 
   // ensure that DC and Nyquist are zero:
   spectrum[0] = 0.0;
   spectrum[1] = 0.0;
 
-  // now, render the bandlimited versions by successively shrinking the
-  // spectrum by one octave and iFFT'ing this spectrum:
-  int lowBin, highBin;
+  // now, render the bandlimited versions by successively shrinking the spectrum by one octave. 
+  // Table t contains only the bins below numBins = (tableLength/2)/2^t, so instead of transforming
+  // the (mostly zero) full length spectrum, we split the table into D interleaved subsignals 
+  // x_r[q] = x[q*D+r] of length M = tableLength/D >= 2*numBins each. The spectrum of x_r is the 
+  // truncated spectrum rotated by e^(i*2*pi*k*r/tableLength), so all D subsignals together cost 
+  // about log2(M)/log2(tableLength) of a full length transform:
+  const double *rotations = getRotationFactors();
+  int numBins, M, D, k, q, r;
   for(t=1; t<numTables; t++)
   {
-    lowBin  = (int) (tableLength / pow(2.0, t));   // the cutoff-bin
-    highBin = (int) (tableLength / pow(2.0, t-1)); // the bin up to which the
-    // spectrum is currently still nonzero
-
-    // zero out the bins above the cutoff-bin:
-    for(i=lowBin; i<highBin; i++)
-      spectrum[i] = 0.0;
-
-    // transform the truncated spectrum back to the time-domain and store it in
-    // the tableSet
-    fourierTransformer.transformSymmetricSpectrum(spectrum, tableSet[t]);
+    numBins = (tableLength/2) >> t;
+    if( numBins <= 1 )
+    {
+      // nothing left but DC which is zero:
+      for(i=0; i<tableLength+4; i++)
+        tableSet[t][i] = 0.0;
+      continue;
+    }
+    M       = rmin(rmax(2*numBins, (int) minTransformSize), (int) tableLength);
+    D       = tableLength / M;
+    fourierTransformer.setBlockSize(M);
+
+    // set up the rotated spectra (with the normalization by the full tableLength instead of M):
+    double scale = 1.0 / D;
+    for(r=0; r<D; r++)
+    {
+      double *subSpectrum = &subSignals[r*M];
+      for(k=0; k<numBins; k++)
+      {
+        double re = spectrum[2*k], im = spectrum[2*k+1];
+        double c  = scale*rotations[2*k*r], s = scale*rotations[2*k*r+1];
+        subSpectrum[2*k]   = re*c - im*s;
+        subSpectrum[2*k+1] = re*s + im*c;
+      }
+      for(k=2*numBins; k<M; k++)
+        subSpectrum[k] = 0.0;
+
+      // transform back to the time domain (in place):
+      fourierTransformer.transformSymmetricSpectrum(subSpectrum, subSpectrum);
+    }
+
+    // interleave the subsignals into the table:
+    for(r=0; r<D; r++)
+    {
+      for(q=0; q<M; q++)
+        tableSet[t][q*D+r] = subSignals[r*M+q];
+    }
 
     // additional sample(s) for the interpolator:
     tableSet[t][tableLength]   = tableSet[t][0];
@@ -185,6 +224,27 @@ void MipMappedWaveTable::generateMipMap()
     tableSet[t][tableLength+2] = tableSet[t][2];
     tableSet[t][tableLength+3] = tableSet[t][3];
   }
+
+  // the versions are unique over all tables, such that an object which switches to another table 
+  // can't take its content for the one it derived its data from:
+  static std::atomic<unsigned int> lastContentVersion(0);
+  contentVersion.store(++lastContentVersion, std::memory_order_release);
+}
+
+const double* MipMappedWaveTable::getRotationFactors()
+{
+  // the initialization of function-local statics is thread-safe:
+  struct RotationFactors
+  {
+    RotationFactors()
+    {
+      for(int m=0; m<tableLength/2; m++)
+        sinCos(2.0*PI*m/tableLength, &values[2*m+1], &values[2*m]);
+    }
+    double values[tableLength];
+  };
+  static const RotationFactors rotationFactors;
+  return rotationFactors.values;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -1,6 +1,8 @@
 #ifndef rosic_MipMappedWaveTable_h
 #define rosic_MipMappedWaveTable_h
 
+#include <atomic>
+
 // rosic-indcludes:
 #include "rosic_FunctionTemplates.h"
 #include "rosic_FourierTransformerRadix2.h"
@@ -100,6 +102,15 @@ namespace rosic
     - this is important when the two are mixed. */
     double get303SquarePhaseShift() const { return squarePhaseShift; }
 
+    /** Returns a number that changes whenever the content of the tables changes - objects that 
+    derive data from the tables (like the pre-blended tables in BlendOscillator) can use this to 
+    find out when they need to update. No two tables ever share a version, so this also tells 
+    when such an object has been switched over to another table. The version is renewed after 
+    the tables have been written, so an object that reads it before and after it copied the 
+    tables on another thread finds out whether they were changed in the meantime. */
+    unsigned int getContentVersion() const 
+    { return contentVersion.load(std::memory_order_acquire); }
+
     //---------------------------------------------------------------------------------------------
     // audio processing:
 
@@ -149,6 +160,11 @@ namespace rosic
       // generates a multisample from the prototype table, where each of the
       // successive tables contains one half of the spectrum of the previous one
 
+    static const double* getRotationFactors();
+      // returns the complex exponentials e^(i*2*pi*m/tableLength), m = 0,...,tableLength/2-1 as 
+      // interleaved real and imaginary parts - the table is computed once and shared by all 
+      // instances
+
     static const int tableLength = 2048;
       // Length of the lookup-table. The actual length of the allocated memory is 4 samples longer, 
       // to store additional samples for the interpolator (which are the same values as at the 
@@ -163,6 +179,10 @@ namespace rosic
       // fundamental frequency (the frequency where the increment is 1) of 11025 which is good for 
       // the highest frequency. 
 
+    static const int minTransformSize = 64;
+      // The bandlimited tables are computed by inverse FFTs that are as short as the bandwidth 
+      // allows but not shorter than this (many very short transforms are dominated by overhead).
+
     int    waveform;   // index of the currently chosen native waveform
     double sampleRate; // the sampleRate
 
@@ -186,6 +206,8 @@ namespace rosic
     // internal parameters:
     double tanhShaperFactor, tanhShaperOffset, squarePhaseShift;
 
+    std::atomic<unsigned int> contentVersion; // renewed each time the mip-map is regenerated
+
   };
 
   //-----------------------------------------------------------------------------------------------
@@ -196,8 +218,8 @@ namespace rosic
     // ensure, that the table index is in the valid range:
     if( tableIndex<=0 )
       tableIndex = 0;
-    else if ( tableIndex>numTables )
-      tableIndex = 11;
+    else if ( tableIndex>=numTables )
+      tableIndex = numTables-1;
 
     return   (1.0-fractionalPart) * tableSet[tableIndex][integerPart] 
            +      fractionalPart  * tableSet[tableIndex][integerPart+1];
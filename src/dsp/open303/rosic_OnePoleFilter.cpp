@@ -82,7 +82,7 @@ void OnePoleFilter::calcCoeffs()
   case LOWPASS: 
     {
       // formula from dspguide:
-      double x = exp( -2.0 * PI * cutoff * sampleRateRec); 
+      double x = fastExp<FAST_MATH_HIGH>( -2.0 * PI * cutoff * sampleRateRec); 
       b0 = 1-x;
       b1 = 0.0;
       a1 = x;
@@ -91,7 +91,7 @@ void OnePoleFilter::calcCoeffs()
   case HIGHPASS:  
     {
       // formula from dspguide:
-      double x = exp( -2.0 * PI * cutoff * sampleRateRec);
+      double x = fastExp<FAST_MATH_HIGH>( -2.0 * PI * cutoff * sampleRateRec);
       b0 =  0.5*(1+x);
       b1 = -0.5*(1+x);
       a1 = x;
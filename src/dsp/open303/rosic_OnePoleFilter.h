@@ -72,6 +72,10 @@ namespace rosic
     /** Returns the cutoff-frequency. */
     double getCutoff() const { return cutoff; }
 
+    /** Writes the current filter coefficients into the passed variables. */
+    void getCoefficients(double *b0Out, double *b1Out, double *a1Out) const
+    { *b0Out = b0; *b1Out = b1; *a1Out = a1; }
+
     //---------------------------------------------------------------------------------------------
     // audio processing:
 
@@ -84,6 +88,9 @@ namespace rosic
     /** Resets the internal buffers (for the \f$ x[n-1], y[n-1] \f$-samples) to zero. */
     void reset();
 
+    /** Zeroes those internal buffers that are about to become denormal. */
+    void flushDenormals() { x1 = flushToZero(x1); y1 = flushToZero(y1); }
+
     //=============================================================================================
 
   protected:
@@ -1,4 +1,6 @@
 #include "rosic_Open303.h"
+#include <string.h>
+#include <type_traits>
 using namespace rosic;
 
 //-------------------------------------------------------------------------------------------------
@@ -27,15 +29,27 @@ Open303::Open303()
   currentNote      =    -1;
   currentVel       =     0;
   noteOffCountDown =     0;
+  flushCountDown   = denormalFlushInterval;
   slideToNextNote  = false;
   idle             = true;
+  postFiltersResetPending = false;
 
   setEnvMod(25.0);
-
-  oscillator.setWaveTable1(&waveTable1);
+  activeFilterMode = -1;
+  setFilterMode(TeeBeeFilter::TB_303);
+  switchFilterMode(TeeBeeFilter::TB_303);
+
+  waveTable1 = new MipMappedWaveTable;
+  waveTable2 = new MipMappedWaveTable;
+  loopCache  = NULL;
+  loopCacheActive = false;
+  loopCacheEnabled.store(false, std::memory_order_relaxed);
+  ownsWaveTables = true;
+  oscillator.setWaveTable1(waveTable1);
   oscillator.setWaveForm1(MipMappedWaveTable::SAW303);
-  oscillator.setWaveTable2(&waveTable2);
+  oscillator.setWaveTable2(waveTable2);
   oscillator.setWaveForm2(MipMappedWaveTable::SQUARE303);
+  oscillator.setUseFixedPointPhase(true);
 
   //mainEnv.setNormalizeSum(true);
   mainEnv.setNormalizeSum(false);
@@ -71,11 +85,17 @@ Open303::Open303()
   notch.setBandwidth(4.7);
 
   filter.setFeedbackHighpassCutoff(150.0);
+  updatePostFilters();
 }
 
 Open303::~Open303()
 {
-
+  if( ownsWaveTables )
+  {
+    delete waveTable1;
+    delete waveTable2;
+  }
+  delete loopCache;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -83,6 +103,8 @@ Open303::~Open303()
 
 void Open303::setSampleRate(double newSampleRate)
 {
+  sampleRate = newSampleRate;
+
   mainEnv.setSampleRate         (       newSampleRate);
   ampEnv.setSampleRate          (       newSampleRate);
   pitchSlewLimiter.setSampleRate((float)newSampleRate);
@@ -99,6 +121,9 @@ void Open303::setSampleRate(double newSampleRate)
 
   oscillator.setSampleRate    (  oversampling*newSampleRate);
   filter.setSampleRate        (  oversampling*newSampleRate);
+
+  updatePostFilters();
+  updateLoopCacheCapacity();
 }
 
 void Open303::setCutoff(double newCutoff)
@@ -107,6 +132,88 @@ void Open303::setCutoff(double newCutoff)
   calculateEnvModScalerAndOffset();
 }
 
+void Open303::setFilterMode(int newMode)
+{
+  if( newMode >= 0 && newMode < TeeBeeFilter::NUM_MODES )
+    filterMode.store(newMode, std::memory_order_relaxed);
+}
+
+void Open303::switchFilterMode(int newMode)
+{
+  // one specialisation of the oversampled voice loop per filter mode, in the order of the enum:
+  typedef TeeBeeFilter F;
+  static const VoiceKernel kernels[F::NUM_MODES] =
+  {
+    &Open303::getOscillatorAndFilterBlock<F::FLAT>,
+    &Open303::getOscillatorAndFilterBlock<F::LP_6>,
+    &Open303::getOscillatorAndFilterBlock<F::LP_12>,
+    &Open303::getOscillatorAndFilterBlock<F::LP_18>,
+    &Open303::getOscillatorAndFilterBlock<F::LP_24>,
+    &Open303::getOscillatorAndFilterBlock<F::HP_6>,
+    &Open303::getOscillatorAndFilterBlock<F::HP_12>,
+    &Open303::getOscillatorAndFilterBlock<F::HP_18>,
+    &Open303::getOscillatorAndFilterBlock<F::HP_24>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_12_12>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_6_18>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_18_6>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_6_12>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_12_6>,
+    &Open303::getOscillatorAndFilterBlock<F::BP_6_6>,
+    &Open303::getOscillatorAndFilterBlock<F::TB_303>
+  };
+
+  filter.setMode(newMode);
+  voiceKernel      = kernels[newMode];
+  activeFilterMode = newMode;
+}
+
+void Open303::setLoopCacheEnabled(bool shouldBeEnabled)
+{
+  // the rendering thread doesn't touch the cache before it sees the switch on, so it can be
+  // allocated here - and as it may still use it after the switch is off, it is kept:
+  if( shouldBeEnabled && loopCache == NULL )
+  {
+    loopCache = new LoopRenderCache;
+    updateLoopCacheCapacity();
+  }
+  loopCacheEnabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+void Open303::setSharedWaveTables(MipMappedWaveTable* sawTable, MipMappedWaveTable* squareTable)
+{
+  MipMappedWaveTable *oldTable1 = waveTable1, *oldTable2 = waveTable2;
+  bool ownedOldTables = ownsWaveTables;
+
+  if( sawTable != NULL && squareTable != NULL )
+  {
+    waveTable1     = sawTable;
+    waveTable2     = squareTable;
+    ownsWaveTables = false;
+  }
+  else if( !ownsWaveTables )
+  {
+    waveTable1 = new MipMappedWaveTable;
+    waveTable1->setWaveform(MipMappedWaveTable::SAW303);
+    waveTable2 = new MipMappedWaveTable;
+    waveTable2->setWaveform(MipMappedWaveTable::SQUARE303);
+    waveTable2->setTanhShaperDriveFor303Square(oldTable2->getTanhShaperDriveFor303Square());
+    waveTable2->setTanhShaperOffsetFor303Square(oldTable2->getTanhShaperOffsetFor303Square());
+    waveTable2->set303SquarePhaseShift(oldTable2->get303SquarePhaseShift());
+    ownsWaveTables = true;
+  }
+  else
+    return;
+
+  // the oscillator must not be left pointing to a freed table:
+  oscillator.setWaveTable1(waveTable1);
+  oscillator.setWaveTable2(waveTable2);
+  if( ownedOldTables )
+  {
+    delete oldTable1;
+    delete oldTable2;
+  }
+}
+
 void Open303::setEnvMod(double newEnvMod)
 {
   envMod = newEnvMod;
@@ -138,6 +245,118 @@ void Open303::setPitchBend(double newPitchBend)
   pitchWheelFactor = pitchOffsetToFreqFactor(newPitchBend);
 }
 
+//-------------------------------------------------------------------------------------------------
+// state snapshots:
+
+namespace
+{
+  // copies the members of the state one after another into or out of a blob - or only adds up 
+  // their sizes when there is no blob:
+  class StateTransfer
+  {
+  public:
+    StateTransfer(char *blobToUse, bool shouldSave) : blob(blobToUse), save(shouldSave), size(0) {}
+
+    template<class T>
+    void operator()(T &member)
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "state must be copyable via memcpy");
+      if( blob != NULL )
+      {
+        if( save )
+          memcpy(blob+size, &member, sizeof(T));
+        else
+          memcpy(&member, blob+size, sizeof(T));
+      }
+      size += (int) sizeof(T);
+    }
+
+    bool isLoading() const { return blob != NULL && !save; }
+
+    char *blob;
+    bool save;
+    int  size;
+  };
+}
+
+template<class Transfer>
+void Open303::transferState(Transfer &t)
+{
+  int version = stateVersion;
+  int size    = 0;
+  t(version); t(size);  // the header - checked in loadState before anything else is read
+
+  BlendOscillator::State oscillatorState;
+  oscillator.getState(&oscillatorState);
+  t(oscillatorState);
+  if( t.isLoading() )
+    oscillator.setState(&oscillatorState);
+
+  t(highpass1); t(filter); t(antiAliasFilter); t(postFilters); t(pitchSlewLimiter); t(mainEnv);
+  t(rc1); t(rc2); t(ampEnv); t(ampDeClicker); t(highpass2); t(allpass); t(notch); t(sequencer);
+
+  t(oscFreq); t(pitchWheelFactor); t(cutoff); t(envOffset); t(envScaler); t(accentGain); t(n1); 
+  t(n2); t(ampScaler); t(noteOffCountDown); t(flushCountDown); t(idle);
+  t(postFiltersResetPending);
+
+  t(tuning); t(sampleRate); t(level); t(levelByVel); t(accent); t(slideTime); t(envMod); 
+  t(envUpFraction); t(normalAttack); t(accentAttack); t(normalDecay); t(accentDecay); 
+  t(normalAmpRelease); t(accentAmpRelease); t(currentNote); t(currentVel); t(slideToNextNote);
+
+  // the note list goes into a fixed size array (with the most recent notes first):
+  MidiNoteEvent notes[maxNumStateNotes];
+  int numNotes = 0;
+  for(list<MidiNoteEvent>::iterator it = noteList.begin(); 
+      it != noteList.end() && numNotes < maxNumStateNotes; ++it)
+    notes[numNotes++] = *it;
+  t(numNotes); t(notes);
+  if( t.isLoading() )
+  {
+    noteList.clear();
+    for(int i=0; i<numNotes; i++)
+      noteList.push_back(notes[i]);
+  }
+}
+
+int Open303::getStateSize()
+{
+  StateTransfer counter(NULL, true);
+  transferState(counter);
+  return counter.size;
+}
+
+void Open303::saveState(void *destination)
+{
+  StateTransfer writer((char*) destination, true);
+  transferState(writer);
+  int size = writer.size;
+  memcpy((char*) destination + sizeof(int), &size, sizeof(int));
+}
+
+bool Open303::loadState(const void *source)
+{
+  int header[2];
+  memcpy(header, source, sizeof(header));
+  if( header[0] != stateVersion || header[1] != getStateSize() )
+    return false;
+
+  double oldSampleRate = sampleRate;
+  StateTransfer reader((char*) source, false);
+  transferState(reader);
+
+  // what is not part of the state but derived from it:
+  setFilterMode(filter.getMode());
+  switchFilterMode(filter.getMode());
+  if( loopCache != NULL )
+  {
+    if( sampleRate != oldSampleRate )
+      updateLoopCacheCapacity();
+    else
+      loopCache->reset();
+  }
+  return true;
+}
+
 //------------------------------------------------------------------------------------------------------------
 // others:
 
@@ -210,6 +429,156 @@ void Open303::allNotesOff()
   currentVel  = 0;
 }
 
+void Open303::flushDenormals()
+{
+  // the elliptic filter adds TINY internally, so we only need to care about the remaining
+  // recursive states:
+  ampEnv.flushDenormals();
+  mainEnv.flushDenormals();
+  rc1.flushDenormals();
+  rc2.flushDenormals();
+  filter.flushDenormals();
+  highpass1.flushDenormals();
+  postFilters.flushDenormals();
+  flushCountDown = denormalFlushInterval;
+}
+
+void Open303::processBlock(double *out, int numSamples)
+{
+  processBlockInternal(out, numSamples);
+}
+
+void Open303::processBlock(float *out, int numSamples)
+{
+  processBlockInternal(out, numSamples);
+}
+
+template<class T>
+void Open303::processBlockInternal(T *out, int numSamples)
+{
+  if( idle )
+  {
+    for(int n=0; n<numSamples; n++)
+      out[n] = 0;
+    return;
+  }
+
+  applyFilterMode();
+  applyLoopCacheSwitch();
+
+  double signal[maxChunkSize], amplitude[maxChunkSize];
+  bool   sequencerOn = sequencer.getSequencerMode() != AcidSequencer::OFF;
+  int    start       = 0;
+
+  // parameters can only change between calls, so checking them once per call is enough:
+  if( loopCacheActive )
+    loopCache->setParameterHash(getLoopCacheHash());
+
+  while( start < numSamples )
+  {
+    int chunkSize = numSamples - start;
+    if( chunkSize > maxChunkSize )
+      chunkSize = maxChunkSize;
+
+    // the chunks are not longer than denormalFlushInterval, so flushing once per chunk is enough:
+    flushDenormals();
+
+    // render the chunk in pieces between note events - without the sequencer, events can only 
+    // occur between calls to processBlock. A note that resets the postFilters ends their chunk, 
+    // so the samples before it are filtered with the state they had:
+    int n = 0, filtered = 0;
+    while( n < chunkSize )
+    {
+      int pieceLength = chunkSize - n;
+      if( sequencerOn )
+      {
+        if( pollSequencer() && loopCacheActive )
+          loopCache->startStep(sequencer.getPlayingStep());
+        pieceLength = 1 + skipQuietSequencerSamples(pieceLength-1);
+      }
+      if( postFiltersResetPending )
+      {
+        postFilters.processBlock(&signal[filtered], &amplitude[filtered], n-filtered);
+        postFilters.reset();
+        postFiltersResetPending = false;
+        filtered = n;
+      }
+      getVoiceBlock(&signal[n], &amplitude[n], pieceLength);
+      n += pieceLength;
+    }
+
+    postFilters.processBlock(&signal[filtered], &amplitude[filtered], chunkSize-filtered);
+    for(int n=0; n<chunkSize; n++)
+      out[start+n] = (T) (signal[n] * amplitude[n] * ampScaler);
+
+    start += chunkSize;
+  }
+  idle = false;
+}
+
+void Open303::getVoiceBlock(double *signal, double *amplitude, int numSamples)
+{
+  double instFreq[maxChunkSize], mainEnvOut[maxChunkSize], tmp1[maxChunkSize];
+  double tmp2[maxChunkSize];
+  int    n;
+
+  // instantaneous oscillator frequencies:
+  pitchSlewLimiter.processBlock(oscFreq, instFreq, numSamples);
+
+  // instantaneous cutoff frequencies (as factors for the nominal cutoff):
+  mainEnv.processBlock(mainEnvOut, numSamples);
+  rc1.processBlock(mainEnvOut, tmp1, numSamples);
+  if( accentGain > 0.0 )
+    rc2.processBlock(mainEnvOut, tmp2, numSamples);
+  else
+    rc2.processBlock(0.0, tmp2, numSamples);
+  for(n=0; n<numSamples; n++)
+    tmp1[n] = envScaler * ( n1*tmp1[n] - envOffset ) + accentGain * ( n2*tmp2[n] );
+  fastExp2<FAST_MATH_LOW>(tmp1, tmp1, numSamples);
+
+  // amplitude envelope:
+  ampEnv.processBlock(amplitude, numSamples);
+  if( ampEnv.isNoteOn() )
+  {
+    for(n=0; n<numSamples; n++)
+      amplitude[n] += 0.45*mainEnvOut[n] + accentGain*4.0*mainEnvOut[n]; 
+  }
+
+  // oscillator and filters - unless the loop cache can provide their output:
+  if( loopCacheActive && loopCache->isPlaying() )
+  {
+    loopCache->playBlock(signal, numSamples);
+    return;
+  }
+  for(n=0; n<numSamples; n++)
+    tmp1[n] *= cutoff;
+  (this->*voiceKernel)(signal, instFreq, tmp1, numSamples);
+  if( loopCacheActive )
+    loopCache->processLiveBlock(signal, numSamples);
+}
+
+template<int filterMode>
+void Open303::getOscillatorAndFilterBlock(double *signal, const double *instFreq, 
+                                          const double *cutoffs, int numSamples)
+{
+  for(int n=0; n<numSamples; n++)
+  {
+    oscillator.setFrequency(instFreq[n]*pitchWheelFactor);
+    oscillator.calculateIncrement();
+    filter.setCutoff<filterMode>(cutoffs[n]);
+
+    double tmp;
+    for(int i=1; i<=oversampling; i++)
+    {
+      tmp  = -oscillator.getSample();                // the raw oscillator signal 
+      tmp  = highpass1.getSample(tmp);               // pre-filter highpass
+      tmp  = filter.getSample<filterMode>(tmp);      // now it's filtered
+      tmp  = antiAliasFilter.getSample(tmp);         // anti-aliasing filtered
+    }
+    signal[n] = tmp;
+  }
+}
+
 void Open303::triggerNote(int noteNumber, bool hasAccent)
 {
   // retrigger osc and reset filter buffers only if amplitude is near zero (to avoid clicks):
@@ -218,11 +587,8 @@ void Open303::triggerNote(int noteNumber, bool hasAccent)
     oscillator.resetPhase();
     filter.reset();
     highpass1.reset();
-    highpass2.reset();
-    allpass.reset();
-    notch.reset();
     antiAliasFilter.reset();
-    ampDeClicker.reset();
+    postFiltersResetPending = true;  // done before the first sample of the note is filtered
   }
 
   if( hasAccent )
@@ -238,7 +604,7 @@ void Open303::triggerNote(int noteNumber, bool hasAccent)
     ampEnv.setRelease(normalAmpRelease);
   }
 
-  oscFreq = pitchToFreq(noteNumber, tuning);
+  oscFreq = tuning * fastExp2<FAST_MATH_HIGH>((noteNumber-69.0)/12.0);
   pitchSlewLimiter.setState(oscFreq);
   mainEnv.trigger();
   ampEnv.noteOn(true, noteNumber, 64);
@@ -247,7 +613,7 @@ void Open303::triggerNote(int noteNumber, bool hasAccent)
 
 void Open303::slideToNote(int noteNumber, bool hasAccent)
 {
-  oscFreq = pitchToFreq(noteNumber, tuning);
+  oscFreq = tuning * fastExp2<FAST_MATH_HIGH>((noteNumber-69.0)/12.0);
 
   if( hasAccent )
   {
@@ -281,6 +647,23 @@ void Open303::releaseNote(int noteNumber)
   }
 }
 
+void Open303::updatePostFilters()
+{
+  double b0a, b1a, a1a, b0h, b1h, a1h, b0, b1, b2, a1, a2;
+
+  // audio lane:
+  allpass.getCoefficients(&b0a, &b1a, &a1a);
+  highpass2.getCoefficients(&b0h, &b1h, &a1h);
+  postFilters.setCoefficientsFromOnePoles(0, 0, b0a, b1a, a1a, b0h, b1h, a1h);
+  notch.getCoefficients(&b0, &b1, &b2, &a1, &a2);
+  postFilters.setCoefficients(1, 0, b0, b1, b2, a1, a2);
+
+  // envelope lane:
+  ampDeClicker.getCoefficients(&b0, &b1, &b2, &a1, &a2);
+  postFilters.setCoefficients(0, 1, b0, b1, b2, a1, a2);
+  postFilters.setToIdentity(1, 1);
+}
+
 void Open303::setMainEnvDecay(double newDecay)
 {
   mainEnv.setDecayTimeConstant(newDecay);
@@ -323,6 +706,45 @@ void Open303::calculateEnvModScalerAndOffset()
   }
 }
 
+void Open303::updateLoopCacheCapacity()
+{
+  if( loopCache != NULL )
+  {
+    loopCache->setCapacity(roundToInt(maxLoopCacheSeconds*sampleRate), 
+                           AcidPattern::getMaxNumSteps(), roundToInt(0.005*sampleRate));
+  }
+}
+
+UINT64 Open303::getLoopCacheHash()
+{
+  // the amplitude envelope, the post-filters and the volume are applied live to the signal from
+  // the cache, so they don't need to be included here:
+  double values[] =
+  {
+    sampleRate, tuning, cutoff, envMod, envUpFraction, normalAttack, accentAttack, normalDecay, 
+    accentDecay, accent, slideTime, pitchWheelFactor, getWaveform(), getResonance(), 
+    getFeedbackHighpass(), getPreFilterHighpass(), getTanhShaperDrive(), getTanhShaperOffset(), 
+    getSquarePhaseShift(), sequencer.getTempo(), sequencer.getStepLength(), 
+    (double) getFilterMode(), (double) sequencer.getSequencerMode(), 
+    (double) sequencer.isRunning(), (double) currentNote
+  };
+  UINT64 h = LoopRenderCache::hash(values, sizeof(values));
+
+  AcidPattern *pattern = sequencer.getPattern(sequencer.getActivePatternIndex());
+  for(int i=0; i<pattern->getNumSteps(); i++)
+  {
+    int note[5] = { pattern->getKey(i), pattern->getOctave(i), pattern->getAccent(i), 
+                    pattern->getSlide(i), pattern->getGate(i) };
+    h = LoopRenderCache::hash(note, sizeof(note), h);
+  }
+  for(int k=0; k<=12; k++)
+  {
+    bool permissible = sequencer.isKeyPermissible(k);
+    h = LoopRenderCache::hash(&permissible, sizeof(permissible), h);
+  }
+  return h;
+}
+
 void Open303::updateNormalizer1()
 {
   n1 = LeakyIntegrator::getNormalizer(mainEnv.getDecayTimeConstant(), rc1.getTimeConstant(),
@@ -1,6 +1,7 @@
 #ifndef rosic_Open303_h
 #define rosic_Open303_h
 
+#include <atomic>
 #include <climits>
 #include "rosic_MidiNoteEvent.h"
 #include "rosic_BlendOscillator.h"
@@ -10,7 +11,9 @@
 #include "rosic_DecayEnvelope.h"
 #include "rosic_LeakyIntegrator.h"
 #include "rosic_EllipticQuarterBandFilter.h"
+#include "rosic_DualBiquadCascade.h"
 #include "rosic_AcidSequencer.h"
+#include "rosic_LoopRenderCache.h"
 
 #include <list>
 using namespace std; // for the noteList
@@ -23,6 +26,13 @@ namespace rosic
   This is a monophonic bass-synth that aims to emulate the sound of the famous Roland TB 303 and
   goes a bit beyond.
 
+  The data members are ordered by how often they are accessed: the embedded objects and the 
+  variables that are used for each sample come first, starting at a cache line boundary, followed by
+  the objects and parameters that are only touched on events or parameter changes. The two 
+  wavetables are allocated separately, such that the object itself is only a few kilobytes and the 
+  per-sample state of many interleaved instances doesn't compete for the same cache sets (which it
+  does when each instance spans hundreds of page-aligned kilobytes).
+
   */
 
   class Open303
@@ -39,6 +49,10 @@ namespace rosic
     /** Destructor. */
     ~Open303();
 
+    /** Not copyable: it owns its wavetables (unless shared) and the loop render cache. */
+    Open303(const Open303&) = delete;
+    Open303& operator=(const Open303&) = delete;
+
     //-----------------------------------------------------------------------------------------------
     // parameter settings:
 
@@ -49,6 +63,14 @@ namespace rosic
     0...1 where 0 means pure saw and 1 means pure square. */
     void setWaveform(double newWaveform) { oscillator.setBlendFactor(newWaveform); }
 
+    /** Renders a pre-blended wavetable for the current waveform setting, such that the oscillator
+    needs to read only one table per sample (for the pure saw and square it does that anyway). 
+    This should be called regularly, at the start of each block or from another thread (but not 
+    concurrently to setSharedWaveTables) - it doesn't allocate and does nothing when the 
+    pre-blended table is up to date. Until it has rendered the table for a new waveform setting, 
+    the oscillator reads both tables. @see BlendOscillator::updatePreBlendedTable */
+    bool updatePreBlendedWaveform() { return oscillator.updatePreBlendedTable(); }
+
     /** Sets the master tuning frequency for note A4 (usually 440 Hz). */
     void setTuning(double newTuning) { tuning = newTuning; }
 
@@ -58,6 +80,22 @@ namespace rosic
     /** Sets the resonance amount for the filter. */
     void setResonance(double newResonance) { filter.setResonance(newResonance); }
 
+    /** Sets the mode of the filter (@see TeeBeeFilter::modes) - the default is TB_303. The mode
+    takes effect with the next call to processBlock or getSample, so it may be set from another 
+    thread than the one rendering. */
+    void setFilterMode(int newMode);
+
+    /** Switches the loop render cache on or off (it's off by default). When it is on and the
+    sequencer loops a pattern with unchanged parameters, the oscillator and filter signal of one 
+    cycle is recorded and then played back from memory, which saves most of the CPU load. Any 
+    change of a parameter that affects this signal switches back to live rendering at the next 
+    block (with a short crossfade). The envelopes, the post-filters and the volume keep running
+    live. The cache works only in processBlock. The switch takes effect with the next call to 
+    processBlock, so it may be flipped from another thread than the one rendering. Switching it 
+    on for the first time allocates a few megabytes, so that call is not realtime-safe - the 
+    memory is kept when it is switched off again. @see LoopRenderCache */
+    void setLoopCacheEnabled(bool shouldBeEnabled);
+
     /** Sets the modulation depth of the filter's cutoff frequency by the filter-envelope generator 
     (in percent). */
     void setEnvMod(double newEnvMod);
@@ -83,12 +121,20 @@ namespace rosic
     /** Sets the drive (in dB) for the tanh-shaper for 303-square waveform - internal parameter, to 
     be scrapped eventually. */
     void setTanhShaperDrive(double newDrive) 
-    { waveTable2.setTanhShaperDriveFor303Square(newDrive); }
+    { waveTable2->setTanhShaperDriveFor303Square(newDrive); }
 
     /** Sets the offset (as raw value for the tanh-shaper for 303-square waveform - internal 
     parameter, to be scrapped eventually. */
     void setTanhShaperOffset(double newOffset) 
-    { waveTable2.setTanhShaperOffsetFor303Square(newOffset); }
+    { waveTable2->setTanhShaperOffsetFor303Square(newOffset); }
+
+    /** Lets the oscillator read from wavetables owned by someone else instead of its own, which 
+    are freed - such that any number of instances can share one pair of tables. The saw table is 
+    expected to hold MipMappedWaveTable::SAW303, the square table MipMappedWaveTable::SQUARE303, 
+    and both have to outlive the sharing. The square shaper settings (setTanhShaperDrive, etc.) 
+    then change the shared table, for all instances using it. Passing NULL for both goes back to 
+    tables of its own, with the square shaper settings of the shared one. */
+    void setSharedWaveTables(MipMappedWaveTable* sawTable, MipMappedWaveTable* squareTable);
 
     /** Sets the cutoff frequency for the highpass before the main filter. */
     void setPreFilterHighpass(double newCutoff) { highpass1.setCutoff(newCutoff); }
@@ -97,11 +143,15 @@ namespace rosic
     void setFeedbackHighpass(double newCutoff) { filter.setFeedbackHighpassCutoff(newCutoff); }
 
     /** Sets the cutoff frequency for the highpass after the main filter. */
-    void setPostFilterHighpass(double newCutoff) { highpass2.setCutoff(newCutoff); }
+    void setPostFilterHighpass(double newCutoff) 
+    { 
+      highpass2.setCutoff(newCutoff); 
+      updatePostFilters();
+    }
 
     /** Sets the phase shift of tanh-shaped square wave with respect to the saw-wave (in degrees)
     - this is important when the two are mixed. */
-    void setSquarePhaseShift(double newShift) { waveTable2.set303SquarePhaseShift(newShift); }
+    void setSquarePhaseShift(double newShift) { waveTable2->set303SquarePhaseShift(newShift); }
 
     /** Sets the slide-time (in ms). The TB-303 had a slide time of 60 ms. */
     void setSlideTime(double newSlideTime);
@@ -156,6 +206,20 @@ namespace rosic
     /** Returns the filter's resonance amount (in percent) */
     double getResonance() const { return filter.getResonance(); }
 
+    /** Returns the mode of the filter (@see TeeBeeFilter::modes). */
+    int getFilterMode() const { return filterMode.load(std::memory_order_relaxed); }
+
+    /** Returns true when the loop render cache is switched on. */
+    bool isLoopCacheEnabled() const { return loopCacheEnabled.load(std::memory_order_relaxed); }
+
+    /** Returns true when the oscillator and filter signal currently comes from the loop render 
+    cache. */
+    bool isPlayingFromLoopCache() const { return loopCacheActive && loopCache->isPlaying(); }
+
+    /** Returns true, as long as no note has been played since construction - until then, the 
+    output is all zeros. */
+    bool isIdle() const { return idle; }
+
     /** Returns the modulation depth of the filter's cutoff frequency by the filter-envelope 
     generator (in percent). */
     double getEnvMod() const { return envMod; }
@@ -177,12 +241,12 @@ namespace rosic
     /** Returns the drive (in dB) for the tanh-shaper for 303-square waveform - internal parameter, 
     to be scrapped eventually. */
     double getTanhShaperDrive() const 
-    { return waveTable2.getTanhShaperDriveFor303Square(); }
+    { return waveTable2->getTanhShaperDriveFor303Square(); }
 
     /** Returns the offset (as raw value for the tanh-shaper for 303-square waveform - internal 
     parameter, to be scrapped eventually. */   
     double getTanhShaperOffset() const 
-    { return waveTable2.getTanhShaperOffsetFor303Square(); }
+    { return waveTable2->getTanhShaperOffsetFor303Square(); }
 
     /** Returns the cutoff frequency for the highpass before the main filter. */
     double getPreFilterHighpass() const { return highpass1.getCutoff(); }
@@ -196,7 +260,7 @@ namespace rosic
 
     /** Returns the phase shift of tanh-shaped square wave with respect to the saw-wave (in degrees)
     - this is important when the two are mixed. */
-    double getSquarePhaseShift() const { return waveTable2.get303SquarePhaseShift(); }
+    double getSquarePhaseShift() const { return waveTable2->get303SquarePhaseShift(); }
 
     /** Returns the slide-time (in ms). */
     double getSlideTime() const { return slideTime; }
@@ -222,6 +286,39 @@ namespace rosic
     /** Calculates onse output sample at a time. */
     INLINE double getSample(); 
 
+    /** Calculates a block of output samples. This is equivalent to calling getSample() 
+    numSamples times (up to rounding errors) but computes the envelopes, the cutoff modulation, 
+    the post-filters and the de-clicker for whole runs of samples between note events at once. */
+    void processBlock(double *out, int numSamples);
+
+    /** Calculates a block of output samples in single precision. */
+    void processBlock(float *out, int numSamples);
+
+    /** Sets all recursive states that have decayed to almost zero to exactly zero. This is called
+    from getSample() every denormalFlushInterval samples, so client code doesn't need to call it
+    to avoid denormals. */
+    void flushDenormals();
+
+    //-----------------------------------------------------------------------------------------------
+    // state snapshots:
+
+    /** Returns the size (in bytes) of the blob that saveState() writes. */
+    int getStateSize();
+
+    /** Writes the complete state of the synth into a blob of getStateSize() bytes that can be 
+    copied around with memcpy: all parameters, the oscillator phase, the filter and envelope 
+    states, the sequencer with its patterns and position and the held notes. The wavetables (and 
+    thereby the pulse width, the square phase shift and the tanh shaper settings) and the loop 
+    cache are not part of it. The blob starts with a version number and is only valid for the
+    same build of the synth. */
+    void saveState(void *destination);
+
+    /** Restores a state that was written by saveState() of this or another instance. Returns false
+    and leaves the synth unchanged when the blob has a different version or size. With a waveform 
+    between saw and square, the output continues exactly like that of the original when 
+    updatePreBlendedWaveform() is called before the first block. */
+    bool loadState(const void *source);
+
     //-----------------------------------------------------------------------------------------------
     // event handling:
 
@@ -237,20 +334,57 @@ namespace rosic
     //-----------------------------------------------------------------------------------------------
     // embedded objects: 
 
-    MipMappedWaveTable        waveTable1, waveTable2;
+    // the objects that are used for each sample (in the order of the signal flow):
+    alignas(64)               // start on a fresh cache line
     BlendOscillator           oscillator;
+    OnePoleFilter             highpass1;
     TeeBeeFilter              filter;
-    AnalogEnvelope            ampEnv; 
-    DecayEnvelope             mainEnv;
+    EllipticQuarterBandFilter antiAliasFilter;
+    DualBiquadCascade         postFilters;    // runs allpass, highpass2, notch and ampDeClicker
     LeakyIntegrator           pitchSlewLimiter;
-    //LeakyIntegrator           ampDeClicker;
-    BiquadFilter              ampDeClicker;
+    DecayEnvelope             mainEnv;
     LeakyIntegrator           rc1, rc2;
-    OnePoleFilter             highpass1, highpass2, allpass; 
+    AnalogEnvelope            ampEnv; 
+
+  protected:
+
+    typedef void (Open303::*VoiceKernel)(double*, const double*, const double*, int);
+
+    // the variables that are used for each sample (the other ones are further below):
+    double oscFreq;          // frequecy of the oscillator (without pitchbend)
+    double pitchWheelFactor; // scale factor for oscillator frequency from pitch-wheel
+    double cutoff;           // nominal cutoff frequency of the filter
+    double envOffset;        // offset for the normalized envelope ('bipolarity' parameter)
+    double envScaler;        // scale-factor for the normalized envelope (derived from envMod)
+    double accentGain;       // between 0.0...1.0 - to scale the 3rd amp-envelope on accents
+    double n1, n2;           // normalizers for the RCs that are driven by the MEG
+    double ampScaler;        // final volume as raw factor
+    int    noteOffCountDown; // a countdown variable till next note-off in sequencer mode
+    int    flushCountDown;   // a countdown variable till the next call to flushDenormals
+    VoiceKernel voiceKernel; // getOscillatorAndFilterBlock for the filter mode in use
+    int    activeFilterMode; // the filter mode in use (-1 before the first block)
+    std::atomic<int> filterMode; // the selected filter mode, applied by applyFilterMode()
+    bool   loopCacheActive;  // the loop cache is in use (false before the first block)
+    std::atomic<bool> loopCacheEnabled; // the loop cache switch, applied by applyLoopCacheSwitch()
+    bool   idle;             // flag to indicate that we have currently nothing to do in getSample
+    bool   postFiltersResetPending; // triggerNote asks for a reset of the postFilters
+    bool   ownsWaveTables;   // false when the wavetables are shared (see setSharedWaveTables)
+
+  public:
+
+    // the objects that are used only on events or parameter changes:
+    //LeakyIntegrator           ampDeClicker;
+    BiquadFilter              ampDeClicker;   // these four only design the coefficients for
+    OnePoleFilter             highpass2;      // the postFilters
+    OnePoleFilter             allpass; 
     BiquadFilter              notch;
-    EllipticQuarterBandFilter antiAliasFilter;
     AcidSequencer             sequencer;
 
+    // the wavetables (allocated in the constructor, unless shared) and the loop cache (allocated 
+    // when it is first switched on, only used by the rendering thread while loopCacheActive):
+    MipMappedWaveTable        *waveTable1, *waveTable2;
+    LoopRenderCache           *loopCache;
+
   protected:
 
     /** Triggers a note (called either directly in noteOn or in getSample when the sequencer is 
@@ -265,6 +399,55 @@ namespace rosic
     used). */
     void releaseNote(int noteNumber);
 
+    /** Copies the coefficients of allpass, highpass2, notch and ampDeClicker into the postFilters 
+    cascade. These four objects are only used to design the coefficients - the actual filtering is
+    done in postFilters, where the audio signal runs through lane 0 (allpass and highpass2 merged 
+    into the first section, notch in the second) and the amplitude envelope through lane 1 
+    (ampDeClicker in the first section, the second one is an identity). */
+    void updatePostFilters();
+
+    /** Polls the sequencer and triggers, slides or releases notes accordingly. Returns true when
+    a new step has started. */
+    INLINE bool pollSequencer();
+
+    /** Computes one sample of the decimated filter output and the amplitude envelope, both
+    before they go through the postFilters cascade. */
+    INLINE void getVoiceSample(double *signal, double *amplitude);
+
+    /** Switches the filter and the voice kernel to the selected filter mode, if it has changed 
+    since the last call (called from the rendering thread only). */
+    INLINE void applyFilterMode();
+
+    /** Starts or stops using the loop cache, if it has been switched since the last call (called
+    from the rendering thread only). */
+    INLINE void applyLoopCacheSwitch();
+
+    /** Switches the filter and the voice kernel to a filter mode. */
+    void switchFilterMode(int newMode);
+
+    /** Computes a block of (at most maxChunkSize) samples of what getVoiceSample() computes, 
+    assuming that no note events occur within the block. The envelopes, the pitch slew limiter and 
+    the cutoff modulation are computed for the whole block at once via the processBlock functions 
+    of the respective objects - only the oscillator and the filters run sample by sample. */
+    void getVoiceBlock(double *signal, double *amplitude, int numSamples);
+
+    /** The part of getVoiceBlock that runs at the oversampled rate (oscillator and filters), with
+    the main filter specialised for one of its modes. The cutoffs are the instantaneous cutoff 
+    frequencies of the main filter per (non-oversampled) sample. */
+    template<int filterMode>
+    void getOscillatorAndFilterBlock(double *signal, const double *instFreq, 
+      const double *cutoffs, int numSamples);
+
+    /** Returns how many of the next (at most maxSamples) calls to pollSequencer() would neither 
+    trigger, slide nor release a note and advances the sequencer and our note-off countdown over 
+    these samples. When the sequencer is stopped, pollSequencer() releases the note on each call, 
+    which has no further effect after the first call, so these samples count as quiet, too. */
+    INLINE int skipQuietSequencerSamples(int maxSamples);
+
+    /** Implementation of the processBlock functions for either sample type. */
+    template<class T>
+    void processBlockInternal(T *out, int numSamples);
+
     /** Sets the decay-time of the main envelope and updates the normalizers n1, n2 accordingly. */
     void setMainEnvDecay(double newDecay);
 
@@ -278,35 +461,51 @@ namespace rosic
     main envelope generator. */
     void updateNormalizer2();
 
+    /** Sets the size of the loop cache according to the sample rate. */
+    void updateLoopCacheCapacity();
+
+    /** Returns a hash of everything that shapes the signal that is recorded in the loop cache. */
+    UINT64 getLoopCacheHash();
+
+    /** Passes all members that make up the state (as saved by saveState()) one after another to 
+    the transfer object, which copies them into or out of the blob. */
+    template<class Transfer>
+    void transferState(Transfer &transfer);
+
     static const int oversampling = 4;
 
+    // processBlock works through its buffer in chunks of at most this number of samples:
+    static const int maxChunkSize = 64;
+
+    // denormal-prone states decay by at most a few orders of magnitude within this number of
+    // samples, so flushing them below 1.e-20 at this rate keeps them out of the denormal range:
+    static const int denormalFlushInterval = 64;
+
+    // the loop cache holds patterns of up to this length (4 beats at 30 BPM):
+    static const int maxLoopCacheSeconds = 8;
+
+    // the state blob holds up to this number of held notes and starts with this version number, 
+    // which must be incremented whenever the members or their layout change:
+    static const int maxNumStateNotes = 128;
+    static const int stateVersion     = 2;
+
     double tuning;           // master tunung for A4 in Hz
-    double ampScaler;        // final volume as raw factor
-    double oscFreq;          // frequecy of the oscillator (without pitchbend)
     double sampleRate;       // the (non-oversampled) sample rate
     double level;            // master volume level (in dB)
     double levelByVel;       // velocity dependence of the level (in dB)
     double accent;           // scales all "byVel" parameters
     double slideTime;        // the time to slide from one note to another (in ms)
-    double cutoff;           // nominal cutoff frequency of the filter
     double envMod;           // strength of the envelope modulation in percent
     double envUpFraction;    // fraction of the envelope that goes upward
-    double envOffset;        // offset for the normalized envelope ('bipolarity' parameter)
-    double envScaler;        // scale-factor for the normalized envelope (derived from envMod)
     double normalAttack;     // attack time for the filter envelope on non-accented notes
     double accentAttack;     // attack time for the filter envelope on accented notes
     double normalDecay;      // decay time for the filter envelope on non-accented notes
     double accentDecay;      // decay time for the filter envelope on accented notes
     double normalAmpRelease; // amp-env release time for non-accented notes
     double accentAmpRelease; // amp-env release time for accented notes
-    double accentGain;       // between 0.0...1.0 - to scale the 3rd amp-envelope on accents
-    double pitchWheelFactor; // scale factor for oscillator frequency from pitch-wheel
-    double n1, n2;           // normalizers for the RCs that are driven by the MEG
     int    currentNote;      // note which is currently played (-1 if none)
     int    currentVel;       // velocity of currently played note
-    int    noteOffCountDown; // a countdown variable till next note-off in sequencer mode
     bool   slideToNextNote;  // indicate that we need to slide to the next note in sequencer mode
-    bool   idle;             // flag to indicate that we have currently nothing to do in getSample
 
     list<MidiNoteEvent> noteList;
 
@@ -315,48 +514,79 @@ namespace rosic
   //-------------------------------------------------------------------------------------------------
   // inlined functions:
 
-  INLINE double Open303::getSample()
+  INLINE bool Open303::pollSequencer()
   {
-    //if( sequencer.getSequencerMode() == AcidSequencer::OFF && ampEnv.endIsReached() )
-    //  return 0.0;
-    if( idle )
-      return 0.0;
+    noteOffCountDown--;
+    if( noteOffCountDown == 0 || sequencer.isRunning() == false )
+      releaseNote(currentNote);
 
-    // check the sequencer if we have some note to trigger:
-    if( sequencer.getSequencerMode() != AcidSequencer::OFF )
+    AcidNote *note = sequencer.getNote();
+    if( note != NULL )
     {
-      noteOffCountDown--;
-      if( noteOffCountDown == 0 || sequencer.isRunning() == false )
-        releaseNote(currentNote);
-
-      AcidNote *note = sequencer.getNote();
-      if( note != NULL )
+      if( note->gate == true && currentNote != -1)
       {
-        if( note->gate == true && currentNote != -1)
+        int key = note->key + 12*note->octave + currentNote;
+        key = clip(key, 0, 127);
+
+        if( !slideToNextNote )
+          triggerNote(key, note->accent);
+        else
+          slideToNote(key, note->accent);
+
+        AcidNote* nextNote = sequencer.getNextScheduledNote();
+        if( note->slide && nextNote->gate == true )
+        {
+          noteOffCountDown = INT_MAX;
+          slideToNextNote  = true;
+        }
+        else
         {
-          int key = note->key + 12*note->octave + currentNote;
-          key = clip(key, 0, 127);
-
-          if( !slideToNextNote )
-            triggerNote(key, note->accent);
-          else
-            slideToNote(key, note->accent);
-
-          AcidNote* nextNote = sequencer.getNextScheduledNote();
-          if( note->slide && nextNote->gate == true )
-          {
-            noteOffCountDown = INT_MAX;
-            slideToNextNote  = true;
-          }
-          else
-          {
-            noteOffCountDown = sequencer.getStepLengthInSamples();
-            slideToNextNote  = false;
-          }
+          noteOffCountDown = sequencer.getStepLengthInSamples();
+          slideToNextNote  = false;
         }
       }
+      return true;
     }
+    return false;
+  }
+
+  INLINE int Open303::skipQuietSequencerSamples(int maxSamples)
+  {
+    int numQuiet = maxSamples;
+    if( sequencer.isRunning() )
+    {
+      if( sequencer.getSamplesToNextStep() < numQuiet )
+        numQuiet = sequencer.getSamplesToNextStep();
+      if( noteOffCountDown > 0 && noteOffCountDown-1 < numQuiet )
+        numQuiet = noteOffCountDown-1;
+    }
+    noteOffCountDown -= numQuiet;
+    sequencer.skipSamples(numQuiet);
+    return numQuiet;
+  }
 
+  INLINE void Open303::applyFilterMode()
+  {
+    int newMode = filterMode.load(std::memory_order_relaxed);
+    if( newMode != activeFilterMode )
+      switchFilterMode(newMode);
+  }
+
+  INLINE void Open303::applyLoopCacheSwitch()
+  {
+    // acquire pairs with the release in setLoopCacheEnabled, such that the cache it allocated is
+    // complete before we use it:
+    bool enabled = loopCacheEnabled.load(std::memory_order_acquire);
+    if( enabled != loopCacheActive )
+    {
+      loopCacheActive = enabled;
+      if( enabled )
+        loopCache->reset();  // a loop recorded before it was switched off may be outdated
+    }
+  }
+
+  INLINE void Open303::getVoiceSample(double *signal, double *amplitude)
+  {
     // calculate instantaneous oscillator frequency and set up the oscillator:
     double instFreq = pitchSlewLimiter.getSample(oscFreq);
     oscillator.setFrequency(instFreq*pitchWheelFactor);
@@ -372,14 +602,14 @@ namespace rosic
     tmp2 = n2 * rc2.getSample(tmp2);  
     tmp1 = envScaler * ( tmp1 - envOffset );  // seems not to work yet
     tmp2 = accentGain*tmp2;
-    double instCutoff = cutoff * pow(2.0, tmp1+tmp2);
+    double instCutoff = cutoff * fastExp2<FAST_MATH_LOW>(tmp1+tmp2);
     filter.setCutoff(instCutoff);
 
     double ampEnvOut = ampEnv.getSample();
     //ampEnvOut += 0.45*filterEnvOut + accentGain*6.8*filterEnvOut; 
     if( ampEnv.isNoteOn() )
       ampEnvOut += 0.45*mainEnvOut + accentGain*4.0*mainEnvOut; 
-    ampEnvOut = ampDeClicker.getSample(ampEnvOut);
+    *amplitude = ampEnvOut;
 
     // oversampled calculations:
     double tmp;
@@ -391,12 +621,40 @@ namespace rosic
       tmp  = antiAliasFilter.getSample(tmp);  // anti-aliasing filtered
 
     }
+    *signal = tmp;
+  }
+
+  INLINE double Open303::getSample()
+  {
+    //if( sequencer.getSequencerMode() == AcidSequencer::OFF && ampEnv.endIsReached() )
+    //  return 0.0;
+    if( idle )
+      return 0.0;
+
+    applyFilterMode();
+
+    if( loopCacheActive )
+      loopCache->reset();  // the cache follows processBlock only
+
+    if( --flushCountDown <= 0 )
+      flushDenormals();
 
-    // these filters may actually operate without oversampling (but only if we reset them in
-    // triggerNote - avoid clicks)
-    tmp  = allpass.getSample(tmp);
-    tmp  = highpass2.getSample(tmp);        
-    tmp  = notch.getSample(tmp);
+    // check the sequencer if we have some note to trigger:
+    if( sequencer.getSequencerMode() != AcidSequencer::OFF )
+      pollSequencer();
+
+    double tmp, ampEnvOut;
+    getVoiceSample(&tmp, &ampEnvOut);
+
+    // the post-filters (allpass, highpass2, notch) on the signal and the de-clicker on the
+    // envelope - these may actually operate without oversampling (but only if we reset them in
+    // triggerNote - avoid clicks):
+    if( postFiltersResetPending )
+    {
+      postFilters.reset();
+      postFiltersResetPending = false;
+    }
+    postFilters.getSamplePair(&tmp, &ampEnvOut);
     tmp *= ampEnvOut;                       // amplified
     tmp *= ampScaler;
 
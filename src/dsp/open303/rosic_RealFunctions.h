@@ -8,6 +8,7 @@
 // rosic includes:
 #include "GlobalFunctions.h"
 #include "rosic_NumberManipulations.h"
+#include "rosic_FastMath.h"
 
 namespace rosic
 {
@@ -25,6 +26,20 @@ namespace rosic
   /** Evaluates the quartic polynomial y = a4*x^4 + a3*x^3 + a2*x^2 + a1*x + a0 at x. */
   INLINE double evaluateQuartic(double x, double a0, double a1, double a2, double a3, double a4);
 
+  /** Fills y with the output of the recursion y[n] = target + r * (y[n-1] - target) for
+  n = 0,...,N-1 with y[-1] = start, i.e. with the exponential approach of an RC-type envelope
+  segment towards its target value. The samples are computed as 4 interleaved geometric sequences
+  with ratio r^4 which have no dependency between neighbouring samples and can therefore be
+  vectorized. The result deviates from the serial recursion by rounding errors only - these grow
+  by roughly one ulp of max(|start|, |target|) every 4 samples. */
+  INLINE void exponentialApproach(double *y, int N, double start, double target, double r);
+
+  /** Returns zero when the absolute value of x is below 1.e-20 and x itself otherwise. Recursive
+  states that decay towards zero can be passed through this function every now and then to keep
+  them from ever reaching the (slow) denormal range on platforms where we can't rely on a
+  flush-to-zero mode of the FPU (for example WebAssembly). */
+  INLINE double flushToZero(double x);
+
   /** foldover at the specified value */
   INLINE double foldOver(double x, double min, double max);
 
@@ -87,6 +102,32 @@ namespace rosic
     return x*(a3*x2+a1) + x2*(a4*x2+a2) + a0;
   }
 
+  INLINE void exponentialApproach(double *y, int N, double start, double target, double r)
+  {
+    double d  = start - target;
+    double rn = r;
+    int    n;
+    for(n=0; n<4 && n<N; n++)
+    {
+      y[n] = target + d * rn;
+      rn  *= r;
+    }
+
+    // y[n] - target = r^4 * (y[n-4] - target):
+    double r4 = r*r*r*r;
+    double c  = target - r4*target;
+    for(n=4; n<N; n++)
+      y[n] = r4*y[n-4] + c;
+  }
+
+  INLINE double flushToZero(double x)
+  {
+    if( fabs(x) < 1.e-20 )
+      return 0.0;
+    else
+      return x;
+  }
+
   INLINE double foldOver(double x, double min, double max)
   {
     if( x > max )
@@ -24,11 +24,6 @@ TeeBeeFilter::TeeBeeFilter()
   reset();
 }
 
-TeeBeeFilter::~TeeBeeFilter()
-{
-
-}
-
 //-------------------------------------------------------------------------------------------------
 // parameter settings:
 
@@ -52,25 +47,11 @@ void TeeBeeFilter::setMode(int newMode)
   if( newMode >= 0 && newMode < NUM_MODES )
   {
     mode = newMode;
-    switch(mode)
-    {
-    case FLAT:      c0 =  1.0; c1 =  0.0; c2 =  0.0; c3 =  0.0; c4 =  0.0;  break;
-    case LP_6:      c0 =  0.0; c1 =  1.0; c2 =  0.0; c3 =  0.0; c4 =  0.0;  break;
-    case LP_12:     c0 =  0.0; c1 =  0.0; c2 =  1.0; c3 =  0.0; c4 =  0.0;  break;
-    case LP_18:     c0 =  0.0; c1 =  0.0; c2 =  0.0; c3 =  1.0; c4 =  0.0;  break;
-    case LP_24:     c0 =  0.0; c1 =  0.0; c2 =  0.0; c3 =  0.0; c4 =  1.0;  break;
-    case HP_6:      c0 =  1.0; c1 = -1.0; c2 =  0.0; c3 =  0.0; c4 =  0.0;  break;
-    case HP_12:     c0 =  1.0; c1 = -2.0; c2 =  1.0; c3 =  0.0; c4 =  0.0;  break;
-    case HP_18:     c0 =  1.0; c1 = -3.0; c2 =  3.0; c3 = -1.0; c4 =  0.0;  break;
-    case HP_24:     c0 =  1.0; c1 = -4.0; c2 =  6.0; c3 = -4.0; c4 =  1.0;  break;
-    case BP_12_12:  c0 =  0.0; c1 =  0.0; c2 =  1.0; c3 = -2.0; c4 =  1.0;  break;
-    case BP_6_18:   c0 =  0.0; c1 =  0.0; c2 =  0.0; c3 =  1.0; c4 = -1.0;  break;
-    case BP_18_6:   c0 =  0.0; c1 =  1.0; c2 = -3.0; c3 =  3.0; c4 = -1.0;  break;
-    case BP_6_12:   c0 =  0.0; c1 =  0.0; c2 =  1.0; c3 = -1.0; c4 =  0.0;  break;
-    case BP_12_6:   c0 =  0.0; c1 =  1.0; c2 = -2.0; c3 =  1.0; c4 =  0.0;  break;
-    case BP_6_6:    c0 =  0.0; c1 =  1.0; c2 = -1.0; c3 =  0.0; c4 =  0.0;  break;
-    default:        c0 =  1.0; c1 =  0.0; c2 =  0.0; c3 =  0.0; c4 =  0.0;  // flat
-    }
+    c0   = mixCoefficients[mode][0];
+    c1   = mixCoefficients[mode][1];
+    c2   = mixCoefficients[mode][2];
+    c3   = mixCoefficients[mode][3];
+    c4   = mixCoefficients[mode][4];
   }
   calculateCoefficientsApprox4();
 }
@@ -86,3 +67,12 @@ void TeeBeeFilter::reset()
   y3 = 0.0;
   y4 = 0.0;
 }
+
+void TeeBeeFilter::flushDenormals()
+{
+  feedbackHighpass.flushDenormals();
+  y1 = flushToZero(y1);
+  y2 = flushToZero(y2);
+  y3 = flushToZero(y3);
+  y4 = flushToZero(y4);
+}
@@ -20,6 +20,12 @@ namespace rosic
 
   ...18 vs. 24 dB? blah?
 
+  The per-sample functions setCutoff, getSample and calculateCoefficientsApprox4 exist in two
+  flavours: the plain ones check the mode at runtime whereas the templated ones take the mode as
+  template parameter, so all mode dependent branches and the zero terms of the output mix disappear
+  at compile time. Client code that runs the filter in a loop can instantiate that loop for each
+  mode and pick the instantiation for the selected mode from a table (as Open303 does).
+
   */
 
   class TeeBeeFilter
@@ -56,9 +62,6 @@ namespace rosic
     /** Constructor. */
     TeeBeeFilter();
 
-    /** Destructor. */
-    ~TeeBeeFilter();
-
     //---------------------------------------------------------------------------------------------
     // parameter settings:
 
@@ -70,6 +73,11 @@ namespace rosic
     manually later by calling calculateCoefficients. */
     INLINE void setCutoff(double newCutoff, bool updateCoefficients = true);
 
+    /** Sets the cutoff frequency and updates the coefficients for the given mode (which must be
+    the selected one). */
+    template<int filterMode>
+    INLINE void setCutoff(double newCutoff);
+
     /** Sets the resonance in percent where 100% is self oscillation. */
     INLINE void setResonance(double newResonance, bool updateCoefficients = true);
 
@@ -106,6 +114,11 @@ namespace rosic
     /** Calculates one output sample at a time. */
     INLINE double getSample(double in);
 
+    /** Calculates one output sample at a time for the given mode (which must be the selected
+    one). */
+    template<int filterMode>
+    INLINE double getSample(double in);
+
     //---------------------------------------------------------------------------------------------
     // others:
 
@@ -116,16 +129,48 @@ namespace rosic
     for normalized radian cutoff frequencies up to pi/4. */
     INLINE void calculateCoefficientsApprox4();
 
+    /** Same as calculateCoefficientsApprox4() for the given mode (which must be the selected 
+    one). The TB_303 mode does not need the a1-coefficient and uses its own feedback factor, so
+    it skips the polynomials for these. */
+    template<int filterMode>
+    INLINE void calculateCoefficientsApprox4();
+
     /** Implements the waveshaping nonlinearity between the stages. */
     INLINE double shape(double x);
 
     /** Resets the internal state variables. */
     void reset();
 
+    /** Zeroes the states of the ladder stages (and of the feedback highpass) when they have 
+    almost died out, such that they never go denormal when the input is silent. */
+    void flushDenormals();
+
     //=============================================================================================
 
   protected:
 
+    /** The weights for the outputs of the input and the 4 stages for the different modes (the 
+    TB_303 mode doesn't use them). */
+    static constexpr double mixCoefficients[NUM_MODES][5] =
+    {
+      {  1.0,  0.0,  0.0,  0.0,  0.0 },  // FLAT
+      {  0.0,  1.0,  0.0,  0.0,  0.0 },  // LP_6
+      {  0.0,  0.0,  1.0,  0.0,  0.0 },  // LP_12
+      {  0.0,  0.0,  0.0,  1.0,  0.0 },  // LP_18
+      {  0.0,  0.0,  0.0,  0.0,  1.0 },  // LP_24
+      {  1.0, -1.0,  0.0,  0.0,  0.0 },  // HP_6
+      {  1.0, -2.0,  1.0,  0.0,  0.0 },  // HP_12
+      {  1.0, -3.0,  3.0, -1.0,  0.0 },  // HP_18
+      {  1.0, -4.0,  6.0, -4.0,  1.0 },  // HP_24
+      {  0.0,  0.0,  1.0, -2.0,  1.0 },  // BP_12_12
+      {  0.0,  0.0,  0.0,  1.0, -1.0 },  // BP_6_18
+      {  0.0,  1.0, -3.0,  3.0, -1.0 },  // BP_18_6
+      {  0.0,  0.0,  1.0, -1.0,  0.0 },  // BP_6_12
+      {  0.0,  1.0, -2.0,  1.0,  0.0 },  // BP_12_6
+      {  0.0,  1.0, -1.0,  0.0,  0.0 },  // BP_6_6
+      {  1.0,  0.0,  0.0,  0.0,  0.0 }   // TB_303
+    };
+
     double b0, a1;              // coefficients for the first order sections
     double y1, y2, y3, y4;      // output signals of the 4 filter stages 
     double c0, c1, c2, c3, c4;  // coefficients for combining various ouput stages
@@ -163,6 +208,21 @@ namespace rosic
     }
   }
 
+  template<int filterMode>
+  INLINE void TeeBeeFilter::setCutoff(double newCutoff)
+  {
+    if( newCutoff != cutoff )
+    {
+      if( newCutoff < 200.0 )
+        cutoff = 200.0;  
+      else if( newCutoff > 20000.0 )
+        cutoff = 20000.0;
+      else
+        cutoff = newCutoff;
+      calculateCoefficientsApprox4<filterMode>();
+    }
+  }
+
   INLINE void TeeBeeFilter::setResonance(double newResonance, bool updateCoefficients)
   {
     resonanceRaw    = 0.01 * newResonance;
@@ -203,6 +263,15 @@ namespace rosic
       k *= (17.0/4.0);
   }
 
+  INLINE void TeeBeeFilter::calculateCoefficientsApprox4()
+  {
+    if( mode == TB_303 )
+      calculateCoefficientsApprox4<TB_303>();
+    else
+      calculateCoefficientsApprox4<FLAT>();  // all other modes share the coefficients
+  }
+
+  template<int filterMode>
   INLINE void TeeBeeFilter::calculateCoefficientsApprox4()
   {
     // calculate intermediate variables:
@@ -211,6 +280,18 @@ namespace rosic
     double r   = resonanceSkewed;
     double tmp;
 
+    if( filterMode == TB_303 )
+    {
+      double fx = wc * ONE_OVER_SQRT2/(2*PI); 
+      b0 = (0.00045522346 + 6.1922189 * fx) / (1.0 + 12.358354 * fx + 4.4156345 * (fx * fx)); 
+      k  = fx*(fx*(fx*(fx*(fx*(fx+7198.6997)-5837.7917)-476.47308)+614.95611)+213.87126)+16.998792; 
+      g  = k * 0.058823529411764705882352941176471; // 17 reciprocal 
+      g  = (g - 1.0) * r + 1.0;                     // r is 0 to 1.0
+      g  = (g * (1.0 + r)); 
+      k  = k * r;                                   // k is ready now 
+      return;
+    }
+
     // compute the filter coefficient via a 12th order polynomial approximation (polynomial 
     // evaluation is done with a Horner-rule alike scheme with nested quadratic factors in the hope
     // for potentially better parallelization compared to Horner's rule as is):
@@ -252,17 +333,6 @@ namespace rosic
     tmp  = wc2*tmp + pr1*wc + pr0; // this is now the scale factor
     k    = r * tmp;
     g    = 1.0;
-
-    if( mode == TB_303 )
-    {
-      double fx = wc * ONE_OVER_SQRT2/(2*PI); 
-      b0 = (0.00045522346 + 6.1922189 * fx) / (1.0 + 12.358354 * fx + 4.4156345 * (fx * fx)); 
-      k  = fx*(fx*(fx*(fx*(fx*(fx+7198.6997)-5837.7917)-476.47308)+614.95611)+213.87126)+16.998792; 
-      g  = k * 0.058823529411764705882352941176471; // 17 reciprocal 
-      g  = (g - 1.0) * r + 1.0;                     // r is 0 to 1.0
-      g  = (g * (1.0 + r)); 
-      k  = k * r;                                   // k is ready now 
-    }
   }
 
   INLINE double TeeBeeFilter::shape(double x)
@@ -282,18 +352,7 @@ namespace rosic
     double y0;
 
     if( mode == TB_303 )
-    {
-      //y0  = in - feedbackHighpass.getSample(k * shape(y4));  
-      y0 = in - feedbackHighpass.getSample(k*y4);  
-      //y0  = in - k*shape(y4);  
-      //y0  = in-k*y4;  
-      y1 += 2*b0*(y0-y1+y2);
-      y2 +=   b0*(y1-2*y2+y3);
-      y3 +=   b0*(y2-2*y3+y4);
-      y4 +=   b0*(y3-2*y4);
-      return 2*g*y4;
-      //return 3*y4;
-    }
+      return getSample<TB_303>(in);
 
     // apply drive and feedback to obtain the filter's input signal:
     //double y0 = inputFilter.getSample(0.125*driveFactor*in) - feedbackHighpass.getSample(k*y4);
@@ -323,6 +382,43 @@ namespace rosic
     return 8.0 * (c0*y0 + c1*y1 + c2*y2 + c3*y3 + c4*y4);;
   }
 
+  template<int filterMode>
+  INLINE double TeeBeeFilter::getSample(double in)
+  {
+    double y0;
+
+    if( filterMode == TB_303 )
+    {
+      //y0  = in - feedbackHighpass.getSample(k * shape(y4));  
+      y0 = in - feedbackHighpass.getSample(k*y4);  
+      //y0  = in - k*shape(y4);  
+      //y0  = in-k*y4;  
+      y1 += 2*b0*(y0-y1+y2);
+      y2 +=   b0*(y1-2*y2+y3);
+      y3 +=   b0*(y2-2*y3+y4);
+      y4 +=   b0*(y3-2*y4);
+      return 2*g*y4;
+      //return 3*y4;
+    }
+
+    y0 = 0.125*driveFactor*in - feedbackHighpass.getSample(k*y4);  
+    y1 = y0 + a1*(y0-y1);
+    y2 = y1 + a1*(y1-y2);
+    y3 = y2 + a1*(y2-y3);
+    y4 = y3 + a1*(y3-y4);
+
+    // mix the stage outputs, leaving out the terms with zero weight (the weights are compile-time
+    // constants, so the conditions as well as multiplications by one are optimized away):
+    const double *c = mixCoefficients[filterMode];
+    double out = 0.0;
+    if( c[0] != 0.0 ) out += c[0]*y0;
+    if( c[1] != 0.0 ) out += c[1]*y1;
+    if( c[2] != 0.0 ) out += c[2]*y2;
+    if( c[3] != 0.0 ) out += c[3]*y3;
+    if( c[4] != 0.0 ) out += c[4]*y4;
+    return 8.0 * out;
+  }
+
 }
 
 #endif // rosic_TeeBeeFilter_h
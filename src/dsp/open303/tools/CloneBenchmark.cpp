@@ -0,0 +1,138 @@
+/**
+ * Compares cloning a warmed-up Open303 through its state snapshot (see Open303::saveState and
+ * Open303::loadState) against constructing a fresh one, with and without setting it up and
+ * playing it until it is in the same state.
+ *
+ * The template synth is set up and plays a line of sixteenth notes for a while. Each case runs a
+ * number of times, the best and the mean time are printed in microseconds. New synths are kept
+ * until the end of each case, so each one gets memory it has to touch for the first time, as in a
+ * project that creates them. At the end a clone and the template render a few more seconds of the
+ * line, which have to be the same to the bit.
+ *
+ * usage: open303_clone_benchmark [repetitions (100)] [warm-up seconds (1.5)]
+ */
+
+#include "../rosic_Open303.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr double sampleRate = 44100.0;
+constexpr int blockSize = 64;
+constexpr double checkSeconds = 5.0;
+
+void setUp (rosic::Open303& synth)
+{
+    synth.setSampleRate (sampleRate);
+    synth.setWaveform (0.3);
+    synth.setCutoff (700.0);
+    synth.setResonance (80.0);
+    synth.setEnvMod (60.0);
+    synth.setDecay (400.0);
+    synth.setAccent (70.0);
+}
+
+// plays the line from a sample position on, note changes are on block boundaries
+void play (rosic::Open303& synth, long position, long numSamples, std::vector<double>& output)
+{
+    constexpr int notes[] = { 36, 48, 39, 43, 36, 46, 51, 34 };
+    const auto samplesPerNote = (long) (sampleRate * 60.0 / 130.0 / 4.0);
+
+    output.resize ((size_t) numSamples);
+    for (long done = 0; done < numSamples; done += blockSize, position += blockSize)
+    {
+        const auto step = position / samplesPerNote;
+        const auto note = notes[step % (long) std::size (notes)];
+        if (position % samplesPerNote < blockSize)
+            synth.noteOn (note, step % 4 == 0 ? 127 : 80, 0.0);
+        else if ((position + samplesPerNote / 2) % samplesPerNote < blockSize)
+            synth.noteOn (note, 0, 0.0);
+
+        synth.updatePreBlendedWaveform();
+        synth.processBlock (output.data() + done, (int) std::min<long> (blockSize, numSamples - done));
+    }
+}
+
+void measure (const char* name, int repetitions, const std::function<void()>& action)
+{
+    auto best = (double) INFINITY, total = 0.0;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        const auto start = Clock::now();
+        action();
+        const auto microseconds = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+        best = std::min (best, microseconds);
+        total += microseconds;
+    }
+    std::printf ("%-40s %10.2f %10.2f\n", name, best, total / repetitions);
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    const auto repetitions = argc > 1 ? std::max (1, std::atoi (argv[1])) : 100;
+    const auto warmUpSamples = (long) ((argc > 2 ? std::max (0.0, std::atof (argv[2])) : 1.5) * sampleRate);
+
+    std::vector<double> output;
+    rosic::Open303 original;
+    setUp (original);
+    play (original, 0, warmUpSamples, output);
+
+    std::vector<char> state ((size_t) original.getStateSize());
+    std::printf ("state of %zu bytes after %.2f s, %d repetitions, microseconds\n%-40s %10s %10s\n",
+                 state.size(),
+                 (double) warmUpSamples / sampleRate,
+                 repetitions,
+                 "",
+                 "best",
+                 "mean");
+
+    rosic::Open303 existing;
+    measure ("saveState", repetitions, [&] { original.saveState (state.data()); });
+    measure ("loadState (existing synth)", repetitions, [&] { existing.loadState (state.data()); });
+
+    std::vector<std::unique_ptr<rosic::Open303>> synths;
+    synths.reserve ((size_t) repetitions);
+    measure ("new Open303", repetitions, [&] { synths.push_back (std::make_unique<rosic::Open303>()); });
+    synths.clear();
+    measure ("new Open303 + loadState", repetitions, [&]
+             {
+                 synths.push_back (std::make_unique<rosic::Open303>());
+                 synths.back()->loadState (state.data());
+             });
+    synths.clear();
+    measure ("new Open303 + set up + warm-up", repetitions, [&]
+             {
+                 synths.push_back (std::make_unique<rosic::Open303>());
+                 setUp (*synths.back());
+                 play (*synths.back(), 0, warmUpSamples, output);
+             });
+    synths.clear();
+
+    // the clone has to go on exactly like the original
+    rosic::Open303 clone;
+    if (! clone.loadState (state.data()))
+    {
+        std::fprintf (stderr, "loadState rejected the state\n");
+        return 1;
+    }
+    std::vector<double> originalOutput, cloneOutput;
+    const auto checkSamples = (long) (checkSeconds * sampleRate);
+    play (original, warmUpSamples, checkSamples, originalOutput);
+    play (clone, warmUpSamples, checkSamples, cloneOutput);
+
+    const auto identical = originalOutput == cloneOutput;
+    std::printf ("clone %s the original for %.0f s\n", identical ? "is identical to" : "differs from", checkSeconds);
+    return identical ? 0 : 1;
+}
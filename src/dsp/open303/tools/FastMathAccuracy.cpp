@@ -0,0 +1,180 @@
+/**
+ * Measures the errors of the fast math functions (see rosic_FastMath.h) against libm, for each
+ * precision tier and for both the inlined scalar and the buffer (vectorized) versions. Each
+ * function is evaluated at uniformly distributed random arguments over the range given in the
+ * table of rosic_FastMath.h (log2 at random exponents and mantissas over all normal numbers).
+ *
+ * Printed are the maximum distance in units in the last place of the libm result, the maximum
+ * absolute and the maximum relative error. The ulp and relative errors of tanh, sin and log2 are
+ * dominated by the arguments where the result gets close to zero, which is why the table quotes
+ * absolute errors for those. Every other argument of tanh and sin is drawn with a uniformly
+ * distributed exponent down to 1e-6 instead, so their relative error around zero is measured too
+ * (the uniform arguments hardly ever get there).
+ *
+ * usage: open303_fast_math_accuracy [arguments per function (10000000)] [seed (1)]
+ */
+
+#include "../rosic_FastMath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr int bufferSize = 4096;
+
+struct Errors
+{
+    double ulps = 0.0, absolute = 0.0, relative = 0.0;
+
+    void add (double approximation, double reference)
+    {
+        ulps = std::max (ulps, ulpDistance (approximation, reference));
+        const auto error = std::abs (approximation - reference);
+        absolute = std::max (absolute, error);
+        if (reference != 0.0)
+            relative = std::max (relative, error / std::abs (reference));
+    }
+
+    // maps the bits of a double onto integers which are ordered like the doubles, so their
+    // difference counts the representable numbers in between
+    static int64_t orderedBits (double x)
+    {
+        int64_t bits;
+        std::memcpy (&bits, &x, sizeof (double));
+        return bits < 0 ? INT64_MIN - bits : bits;
+    }
+
+    static double ulpDistance (double a, double b)
+    {
+        if (std::isnan (a) != std::isnan (b))
+            return INFINITY;
+        const auto x = orderedBits (a), y = orderedBits (b);
+        return (double) (x > y ? (uint64_t) x - (uint64_t) y : (uint64_t) y - (uint64_t) x);
+    }
+};
+
+enum Functions
+{
+    EXP2 = 0,
+    LOG2,
+    TANH,
+    SIN,
+    numFunctions
+};
+
+const char* functionNames[numFunctions] = { "fastExp2", "fastLog2", "fastTanh", "fastSin" };
+const char* precisionNames[] = { "LOW", "MEDIUM", "HIGH" };
+
+double randomArgument (int function, std::mt19937_64& generator, bool nearZero)
+{
+    if (nearZero && (function == TANH || function == SIN))
+    {
+        const auto magnitude = std::pow (10.0, std::uniform_real_distribution<double> (-6.0, 0.0) (generator));
+        return std::bernoulli_distribution() (generator) ? magnitude : -magnitude;
+    }
+
+    switch (function)
+    {
+        case EXP2:
+            return std::uniform_real_distribution<double> (-1022.0, 1023.0) (generator);
+        case LOG2:
+            return std::ldexp (std::uniform_real_distribution<double> (1.0, 2.0) (generator),
+                               std::uniform_int_distribution<int> (DBL_MIN_EXP - 1, DBL_MAX_EXP - 1) (generator));
+        case TANH:
+            return std::uniform_real_distribution<double> (-20.0, 20.0) (generator);
+        default:
+            return std::uniform_real_distribution<double> (-10.0, 10.0) (generator);
+    }
+}
+
+double reference (int function, double x)
+{
+    switch (function)
+    {
+        case EXP2: return std::exp2 (x);
+        case LOG2: return std::log2 (x);
+        case TANH: return std::tanh (x);
+        default: return std::sin (x);
+    }
+}
+
+template <int precision>
+double scalar (int function, double x)
+{
+    switch (function)
+    {
+        case EXP2: return rosic::fastExp2<precision> (x);
+        case LOG2: return rosic::fastLog2<precision> (x);
+        case TANH: return rosic::fastTanh<precision> (x);
+        default: return rosic::fastSin<precision> (x);
+    }
+}
+
+template <int precision>
+void buffer (int function, const double* x, double* y, int N)
+{
+    switch (function)
+    {
+        case EXP2: rosic::fastExp2<precision> (x, y, N); break;
+        case LOG2: rosic::fastLog2<precision> (x, y, N); break;
+        case TANH: rosic::fastTanh<precision> (x, y, N); break;
+        default: rosic::fastSin<precision> (x, y, N); break;
+    }
+}
+
+template <int precision>
+void measure (int function, long numArguments, unsigned long seed)
+{
+    std::mt19937_64 generator (seed);
+    std::vector<double> x (bufferSize), y (bufferSize);
+    Errors scalarErrors, bufferErrors;
+
+    for (long done = 0; done < numArguments; done += bufferSize)
+    {
+        const auto N = (int) std::min<long> (bufferSize, numArguments - done);
+        for (int n = 0; n < N; ++n)
+            x[(size_t) n] = randomArgument (function, generator, n % 2 == 1);
+
+        buffer<precision> (function, x.data(), y.data(), N);
+        for (int n = 0; n < N; ++n)
+        {
+            const auto exact = reference (function, x[(size_t) n]);
+            scalarErrors.add (scalar<precision> (function, x[(size_t) n]), exact);
+            bufferErrors.add (y[(size_t) n], exact);
+        }
+    }
+
+    for (const auto* errors : { &scalarErrors, &bufferErrors })
+        std::printf ("%-9s %-7s %-7s %12.4g %12.3g %12.3g\n",
+                     functionNames[function],
+                     precisionNames[precision],
+                     errors == &scalarErrors ? "scalar" : "buffer",
+                     errors->ulps,
+                     errors->absolute,
+                     errors->relative);
+}
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    const auto numArguments = argc > 1 ? std::max (1L, std::atol (argv[1])) : 10000000L;
+    const auto seed = argc > 2 ? std::strtoul (argv[2], nullptr, 10) : 1UL;
+
+    std::printf ("%ld arguments per function\n%-9s %-7s %-7s %12s %12s %12s\n",
+                 numArguments, "function", "tier", "version", "max ulp", "max abs", "max rel");
+    for (int function = 0; function < numFunctions; ++function)
+    {
+        measure<rosic::FAST_MATH_LOW> (function, numArguments, seed);
+        measure<rosic::FAST_MATH_MEDIUM> (function, numArguments, seed);
+        measure<rosic::FAST_MATH_HIGH> (function, numArguments, seed);
+    }
+    return 0;
+}
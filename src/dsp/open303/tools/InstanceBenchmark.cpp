@@ -0,0 +1,110 @@
+/**
+ * Renders many Open303 instances interleaved, as the rack and the ensemble of the WebAssembly build
+ * do: each instance renders a short block in turn, so its per-sample state has to come back into
+ * the cache every time. The time per sample and instance is printed at the end. Run it under perf
+ * stat to see where the time goes, e.g.
+ *
+ *   perf stat -e cycles,L1-dcache-loads,L1-dcache-load-misses open303_instance_benchmark 1024 4
+ *
+ * Each instance plays its own line of sixteenth notes at 130 bpm for a few seconds, with its own
+ * cutoff. With "shared" all instances read from one pair of wavetables (see
+ * Open303::setSharedWaveTables), which leaves the state of the instances as the only memory they
+ * don't share; otherwise each one has its own tables, some 430 kB.
+ *
+ * usage: open303_instance_benchmark [instances (256)] [block size (4)] [shared]
+ */
+
+#include "../rosic_Open303.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+constexpr double sampleRate = 44100.0;
+constexpr double numSeconds = 4.0;
+} // namespace
+
+int main (int argc, char* argv[])
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    // the plugin runs with denormals flushed to zero as well
+    _mm_setcsr (_mm_getcsr() | 0x8040);
+#endif
+
+    const auto numInstances = argc > 1 ? std::max (1, std::atoi (argv[1])) : 256;
+    const auto blockSize = argc > 2 ? std::max (1, std::atoi (argv[2])) : 4;
+    const auto shareWaveTables = argc > 3 && std::strcmp (argv[3], "shared") == 0;
+
+    rosic::MipMappedWaveTable sawTable, squareTable;
+    if (shareWaveTables)
+    {
+        sawTable.setWaveform (rosic::MipMappedWaveTable::SAW303);
+        squareTable.setWaveform (rosic::MipMappedWaveTable::SQUARE303);
+    }
+
+    std::vector<std::unique_ptr<rosic::Open303>> instances;
+    for (int i = 0; i < numInstances; ++i)
+    {
+        auto& synth = *instances.emplace_back (std::make_unique<rosic::Open303>());
+        if (shareWaveTables)
+            synth.setSharedWaveTables (&sawTable, &squareTable);
+        synth.setSampleRate (sampleRate);
+        synth.setWaveform (i % 2 == 0 ? 0.0 : 1.0);
+        synth.setCutoff (400.0 + 1600.0 * (double) (i % 17) / 16.0);
+        synth.setResonance (70.0);
+        synth.setEnvMod (60.0);
+        synth.setDecay (400.0);
+    }
+
+    constexpr int notes[] = { 36, 48, 39, 43, 36, 46, 51, 34 };
+    const auto samplesPerNote = (long) (sampleRate * 60.0 / 130.0 / 4.0);
+    const auto numBlocks = (long) (numSeconds * sampleRate) / blockSize;
+
+    std::vector<float> buffer ((size_t) blockSize);
+    auto checksum = 0.0;
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    for (long block = 0; block < numBlocks; ++block)
+    {
+        const auto position = block * blockSize;
+        const auto step = position / samplesPerNote;
+        const auto noteStarts = position % samplesPerNote < blockSize;
+        const auto noteEnds = (position + samplesPerNote / 2) % samplesPerNote < blockSize;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            auto& synth = *instances[(size_t) i];
+            const auto note = notes[(step + i) % (long) std::size (notes)] + i % 12;
+            if (noteStarts)
+                synth.noteOn (note, (step + i) % 4 == 0 ? 127 : 80, 0.0);
+            else if (noteEnds)
+                synth.noteOn (note, 0, 0.0);
+
+            synth.updatePreBlendedWaveform();
+            synth.processBlock (buffer.data(), blockSize);
+            checksum += (double) buffer[0];
+        }
+    }
+    const auto seconds = std::chrono::duration<double> (Clock::now() - start).count();
+
+    const auto numSamples = (double) numBlocks * blockSize * numInstances;
+    std::printf ("%d instances (%s wavetables), blocks of %d samples: %.1f ns per sample and instance (checksum %g)\n",
+                 numInstances,
+                 shareWaveTables ? "shared" : "own",
+                 blockSize,
+                 seconds * 1.0e9 / numSamples,
+                 checksum);
+    return 0;
+}
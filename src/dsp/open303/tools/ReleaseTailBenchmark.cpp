@@ -0,0 +1,117 @@
+/**
+ * Times Open303 through a long release tail: four accented notes with a high resonance, then
+ * minutes of silence in which the envelopes, filters and the ladder decay towards zero. Without
+ * the flushing of the recursive states (see Open303::flushDenormals) they would run into
+ * subnormal numbers after a while, which are many times slower to compute with on most CPUs,
+ * unless the FPU flushes them to zero. WebAssembly has no such mode, so the tail has to cost the
+ * same as the notes in the WASM build.
+ *
+ * The synth renders blocks of 128 samples at 48 kHz. For each span of 10 seconds, the time per
+ * sample and the peak level of the output are printed, so the time should stay flat down the
+ * table. The native build runs without flush-to-zero unless "ftz" is given, like the WASM build;
+ * to run that, configure wasm/ with -DJC303_WASM_RELEASE_TAIL_BENCHMARK=ON and run
+ *
+ *   node jc303_release_tail_benchmark.js
+ *
+ * usage: open303_release_tail_benchmark [tail seconds (300)] [ftz]
+ */
+
+#include "../rosic_Open303.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize = 128;
+constexpr double secondsPerSpan = 10.0;
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    const auto tailSeconds = argc > 1 ? std::max (secondsPerSpan, std::atof (argv[1])) : 300.0;
+    const auto flushToZero = argc > 2 && std::strcmp (argv[2], "ftz") == 0;
+
+#if defined(__x86_64__) || defined(_M_X64)
+    if (flushToZero)
+        _mm_setcsr (_mm_getcsr() | 0x8040);
+#endif
+
+    rosic::Open303 synth;
+    synth.setSampleRate (sampleRate);
+    synth.setCutoff (500.0);
+    synth.setResonance (95.0);
+    synth.setEnvMod (80.0);
+    synth.setDecay (2000.0);
+    synth.setAccent (100.0);
+
+    // the notes: one step each at 130 bpm, the last one released at the start of the tail
+    constexpr int notes[] = { 36, 48, 39, 43 };
+    const auto samplesPerNote = (long) (sampleRate * 60.0 / 130.0 / 4.0);
+    const auto samplesPerSpan = (long) (secondsPerSpan * sampleRate);
+    const auto numSpans = (long) std::ceil (((double) std::size (notes) * samplesPerNote + tailSeconds * sampleRate) / samplesPerSpan);
+    const auto numSamples = numSpans * samplesPerSpan;
+
+    std::printf ("%s, blocks of %d samples at %g Hz\n%10s %16s %12s\n",
+                 flushToZero ? "flush-to-zero" : "no flush-to-zero",
+                 blockSize,
+                 sampleRate,
+                 "seconds",
+                 "ns per sample",
+                 "peak dB");
+
+    using Clock = std::chrono::steady_clock;
+    // rendered in double precision, so the peak level follows the tail below the range of floats
+    std::vector<double> buffer ((size_t) blockSize);
+    auto spanTime = Clock::duration::zero();
+    auto spanPeak = 0.0;
+    auto firstSpan = 0.0, lastSpan = 0.0;
+    for (long position = 0; position < numSamples; position += blockSize)
+    {
+        // note changes on block boundaries are close enough here
+        const auto step = position / samplesPerNote;
+        if (step < (long) std::size (notes) && position % samplesPerNote < blockSize)
+        {
+            if (step > 0)
+                synth.noteOn (notes[step - 1], 0, 0.0);
+            synth.noteOn (notes[step], 127, 0.0);
+        }
+        else if (step == (long) std::size (notes) && position % samplesPerNote < blockSize)
+            synth.noteOn (notes[step - 1], 0, 0.0);
+
+        const auto start = Clock::now();
+        synth.processBlock (buffer.data(), blockSize);
+        spanTime += Clock::now() - start;
+
+        for (const auto sample : buffer)
+            spanPeak = std::max (spanPeak, std::abs (sample));
+
+        const auto end = position + blockSize;
+        if (end % samplesPerSpan < blockSize)
+        {
+            const auto nsPerSample = std::chrono::duration<double, std::nano> (spanTime).count() / (double) samplesPerSpan;
+            std::printf ("%10.0f %16.2f %12.1f\n",
+                         (double) end / sampleRate,
+                         nsPerSample,
+                         spanPeak > 0.0 ? 20.0 * std::log10 (spanPeak) : -INFINITY);
+            if (firstSpan == 0.0)
+                firstSpan = nsPerSample;
+            lastSpan = nsPerSample;
+            spanTime = Clock::duration::zero();
+            spanPeak = 0.0;
+        }
+    }
+
+    std::printf ("last span against the first: %.2fx\n", lastSpan / firstSpan);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * Times the construction of the mip-mapped wavetables, which makes up most of the time it takes to
+ * create an Open303: each one renders its own saw and square table, with one forward and the
+ * pruned inverse transforms of MipMappedWaveTable::generateMipMap for each.
+ *
+ * Each case runs a number of times, the best and the mean time are printed in microseconds. The
+ * cases on a warm table re-render an existing one, so they show the time of the transforms; the
+ * others create a new object each time and include the first touch of its memory (some 200 kB per
+ * table), as creating a synth in a large project does.
+ *
+ * usage: open303_wavetable_benchmark [repetitions (200)]
+ */
+
+#include "../rosic_Open303.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// times an action, setup and teardown are run before and after each repetition without being timed
+void measure (const char* name, int repetitions, const std::function<void()>& setup, const std::function<void()>& action, const std::function<void()>& teardown)
+{
+    auto best = (double) INFINITY, total = 0.0;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        setup();
+        const auto start = Clock::now();
+        action();
+        const auto microseconds = std::chrono::duration<double, std::micro> (Clock::now() - start).count();
+        teardown();
+
+        best = std::min (best, microseconds);
+        total += microseconds;
+    }
+    std::printf ("%-44s %10.1f %10.1f\n", name, best, total / repetitions);
+}
+
+const std::function<void()> nothing = [] {};
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    const auto repetitions = argc > 1 ? std::max (1, std::atoi (argv[1])) : 200;
+
+    std::printf ("%d repetitions, microseconds\n%-44s %10s %10s\n", repetitions, "", "best", "mean");
+
+    // a band-limited saw as user prototype, copied into the table before its mip-map is generated
+    std::vector<double> prototype (2048);
+    for (size_t n = 0; n < prototype.size(); ++n)
+        prototype[n] = 1.0 - 2.0 * (double) n / (double) prototype.size();
+
+    rosic::MipMappedWaveTable warmTable;
+    warmTable.setWaveform (rosic::MipMappedWaveTable::SAW303);
+    measure ("generateMipMap (user waveform, warm table)", repetitions, nothing, [&] { warmTable.setWaveform (prototype.data(), (int) prototype.size()); }, nothing);
+
+    // switching the waveform re-renders the table, so we go back and forth between the two
+    measure ("SAW303 (warm table)", repetitions, [&] { warmTable.setWaveform (rosic::MipMappedWaveTable::SQUARE303); }, [&] { warmTable.setWaveform (rosic::MipMappedWaveTable::SAW303); }, nothing);
+    measure ("SQUARE303 (warm table)", repetitions, [&] { warmTable.setWaveform (rosic::MipMappedWaveTable::SAW303); }, [&] { warmTable.setWaveform (rosic::MipMappedWaveTable::SQUARE303); }, nothing);
+
+    // the new objects are kept until the end of each case, so the allocator can't hand out the
+    // memory of the previous one again
+    std::vector<std::unique_ptr<rosic::MipMappedWaveTable>> tables;
+    tables.reserve ((size_t) repetitions);
+    measure ("new MipMappedWaveTable", repetitions, nothing, [&] { tables.push_back (std::make_unique<rosic::MipMappedWaveTable>()); }, nothing);
+    tables.clear();
+    measure ("new MipMappedWaveTable + SAW303", repetitions, nothing, [&]
+             {
+                 tables.push_back (std::make_unique<rosic::MipMappedWaveTable>());
+                 tables.back()->setWaveform (rosic::MipMappedWaveTable::SAW303);
+             },
+             nothing);
+    tables.clear();
+
+    std::vector<std::unique_ptr<rosic::Open303>> synths;
+    synths.reserve ((size_t) repetitions);
+    measure ("new Open303", repetitions, nothing, [&] { synths.push_back (std::make_unique<rosic::Open303>()); }, nothing);
+    return 0;
+}
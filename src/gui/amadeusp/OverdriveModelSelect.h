@@ -1,11 +1,12 @@
 #include "Gui.h"
 
 class OverdriveModelSelect : public juce::Component,
-                             public juce::AudioProcessorValueTreeState::Listener
+                             public juce::AudioProcessorValueTreeState::Listener,
+                             private juce::ChangeListener
 {
 public:
-    OverdriveModelSelect(juce::AudioProcessorValueTreeState& vts, juce::StringArray modelNamesList)
-        : valueTreeState(vts), modelNameList(modelNamesList)
+    OverdriveModelSelect(juce::AudioProcessorValueTreeState& vts, JC303& processor)
+        : valueTreeState(vts), processorRef(processor), modelNameList(processor.getModelListNames())
     {
         // 
         customFont = juce::Font(juce::Typeface::createSystemTypefaceFor(BinaryData::ErbosDraco1StOpenNbpRegularl5wX_ttf, BinaryData::ErbosDraco1StOpenNbpRegularl5wX_ttfSize));
@@ -44,6 +45,8 @@ public:
 
         // Attach the listener
         valueTreeState.addParameterListener("overdriveModelIndex", this);
+        // the user models are indexed in the background, and change with the models folder
+        processorRef.getOverdriveModelLibrary().addChangeListener(this);
 
         setSize(127, 100);
     }
@@ -52,6 +55,7 @@ public:
     {
         // Remove the listener
         valueTreeState.removeParameterListener("overdriveModelIndex", this);
+        processorRef.getOverdriveModelLibrary().removeChangeListener(this);
     }
 
     void changeModelIndex(int delta)
@@ -60,7 +64,8 @@ public:
         if (param != nullptr)
         {
             int currentValue = param->get();
-            int newValue = juce::jlimit(param->getRange().getStart(), param->getRange().getEnd(), currentValue + delta);
+            // the parameter range leaves room for more user models than there are
+            int newValue = juce::jlimit(0, juce::jmin(param->getRange().getEnd(), modelNameList.size() - 1), currentValue + delta);
             param->beginChangeGesture();
             *param = newValue;
             param->endChangeGesture();
@@ -128,6 +133,13 @@ public:
 
 private:
 
+    void changeListenerCallback(juce::ChangeBroadcaster*) override
+    {
+        modelNameList = processorRef.getModelListNames();
+        if (auto* param = dynamic_cast<juce::AudioParameterInt*>(valueTreeState.getParameter("overdriveModelIndex")))
+            setModelName(modelNameList[param->get()]);
+    }
+
     // Helper function to paint the image buttons with hover effects
     void paintImageButton(juce::Graphics& g, juce::ImageButton& button, const juce::Image& image, bool isHovered)
     {
@@ -141,6 +153,7 @@ private:
     }
 
     juce::AudioProcessorValueTreeState& valueTreeState;
+    JC303& processorRef;
     juce::ImageButton prevButton;
     juce::ImageButton nextButton;
     juce::Label modelName;
@@ -77,9 +77,23 @@ cp -f jc303.js "${DIST_DIR}/" 2>/dev/null || true
 cp -f jc303.wasm "${DIST_DIR}/" 2>/dev/null || true
 cp -f jc303_worklet.js "${DIST_DIR}/" 2>/dev/null || true
 
+# Compile the overdrive models for the page to fetch (with the host compiler, the model compiler
+# runs at build time only)
+if [ -d "_deps/rtneural-src" ]; then
+    echo -e "${YELLOW}Compiling overdrive models...${NC}"
+    GUITARML_DIR="${SCRIPT_DIR}/../src/dsp/guitarml-byod"
+    EA_VARIANT_INCLUDE="$(dirname "$(dirname "$(find _deps/ea_variant-src -name ea_variant.h | head -n1)")")"
+    ${CXX_HOST:-c++} -std=c++20 -O2 \
+        -I"_deps/rtneural-src" -I"${EA_VARIANT_INCLUDE}" \
+        "${GUITARML_DIR}/tools/ModelCompiler.cpp" -o guitarml_model_compiler
+    ./guitarml_model_compiler "${DIST_DIR}/models" "${GUITARML_DIR}/models/JC303"
+fi
+
 # Copy web files
 cp -f "${SCRIPT_DIR}/jc303-web.js" "${DIST_DIR}/"
 cp -f "${SCRIPT_DIR}/jc303-worklet-processor.js" "${DIST_DIR}/"
+cp -f "${SCRIPT_DIR}/jc303-event-ring.js" "${DIST_DIR}/"
+cp -f "${SCRIPT_DIR}/jc303-ensemble.js" "${DIST_DIR}/"
 cp -f "${SCRIPT_DIR}/index.html" "${DIST_DIR}/"
 
 echo -e "${GREEN}========================================${NC}"
@@ -87,6 +101,11 @@ echo -e "${GREEN} Build Complete!${NC}"
 echo -e "${GREEN}========================================${NC}"
 echo ""
 echo "Output files in: ${DIST_DIR}/"
+for file in jc303.wasm jc303.js jc303_worklet.js; do
+    if [ -f "${DIST_DIR}/${file}" ]; then
+        echo "  ${file}: $(wc -c < "${DIST_DIR}/${file}") bytes"
+    fi
+done
 echo ""
 echo "To test locally, run a web server in the dist directory:"
 echo "  cd ${DIST_DIR}"
@@ -0,0 +1,216 @@
+/**
+ * JC-303 Ensemble
+ *
+ * Several synths in one WASM module, rendered together with a single call per block: each synth
+ * gets a channel of the output, and all of them are summed into a stereo mix bus with their own
+ * gain and pan. Notes and parameter changes are written into the event queue of each synth (see
+ * jc303_events.h) and applied by that call at their sample, so a block costs one crossing into
+ * WASM however many synths play. The synths share their wavetables, each one after the first
+ * takes some 30 kB of memory.
+ *
+ * Works wherever the module is loaded: on the main thread, or inside an AudioWorkletProcessor.
+ * Load jc303-event-ring.js before this file.
+ *
+ * Usage:
+ *   const ensemble = new JC303Ensemble(await JC303Module(), sampleRate);
+ *   const bass = ensemble.createSynth();
+ *   bass.setParameter('cutoff', 0.4);
+ *   bass.setMix(0.8, -0.5);
+ *   bass.noteOn(36, 100, 64);          // at frame 64 of the next block
+ *   const mix = ensemble.render(128, JC303Ensemble.MIX);
+ *   left.set(mix.subarray(0, 128)); right.set(mix.subarray(128));
+ *
+ * Licensed under GPL-3.0
+ */
+
+const EnsembleEventRing = typeof JC303EventRing !== 'undefined'
+    ? JC303EventRing
+    : require('./jc303-event-ring.js').JC303EventRing;
+
+class JC303EnsembleSynth {
+    constructor(ensemble, handle) {
+        this.ensemble = ensemble;
+        this.handle = handle;
+        this.queueAddress = ensemble.wasmModule.synthGetEventQueue(handle);
+
+        // Events that found the queue full, as [type, data, value, frameOffset], queued at the
+        // start of the next render in order (and a block late)
+        this.pending = [];
+    }
+
+    /**
+     * Trigger a note at a frame of the next block (velocity 0 = note off)
+     */
+    noteOn(note, velocity = 100, frameOffset = 0) {
+        this.queue(EnsembleEventRing.NOTE_ON, note, velocity, frameOffset);
+    }
+
+    noteOff(note, frameOffset = 0) {
+        this.queue(EnsembleEventRing.NOTE_OFF, note, 0, frameOffset);
+    }
+
+    allNotesOff(frameOffset = 0) {
+        this.queue(EnsembleEventRing.ALL_NOTES_OFF, 0, 0, frameOffset);
+    }
+
+    /**
+     * Set a parameter by the name the worklet's setParameter message takes (e.g. 'cutoff'), with
+     * the value the matching JC303 setter takes
+     */
+    setParameter(param, value, frameOffset = 0) {
+        const id = EnsembleEventRing.parameterId(param);
+        if (id < 0) return;
+
+        const number = typeof value === 'boolean' ? (value ? 1 : 0) : value;
+        this.queue(EnsembleEventRing.PARAMETER, id, number, frameOffset);
+    }
+
+    /**
+     * Switch the loop render cache of the synth on or off: while its sequencer loops a pattern
+     * with unchanged parameters, one cycle is played back from memory (allocates a few MB when
+     * switched on)
+     */
+    setLoopCacheEnabled(enabled) {
+        this.ensemble.wasmModule.synthSetLoopCacheEnabled(this.handle, enabled ? 1 : 0);
+    }
+
+    /**
+     * Set how much of the synth goes into the mix bus
+     * @param {number} gain - Linear gain, 0 leaves the synth out of the mix
+     * @param {number} pan - -1 (left) to 1 (right), -3 dB on both sides at 0
+     */
+    setMix(gain, pan = 0) {
+        this.ensemble.wasmModule.setSynthMix(this.handle, gain, pan);
+    }
+
+    /**
+     * Hand a compiled overdrive model (the contents of a .jc303model file) to the synth, which
+     * keeps a copy of it
+     * @returns {boolean} - False if it holds no model the module can run
+     */
+    loadOverdriveModel(model) {
+        const module = this.ensemble.wasmModule;
+        if (typeof module.synthLoadOverdriveModel !== 'function') return false;
+
+        const size = model.byteLength;
+        const ptr = module._malloc(size);
+        if (!ptr) return false;
+
+        module.HEAPU8.set(new Uint8Array(model), ptr);
+        const success = module.synthLoadOverdriveModel(this.handle, ptr, size);
+        module._free(ptr);
+        return success === 1;
+    }
+
+    /**
+     * The channel of the synth in a block rendered with the PLANAR layout
+     */
+    channel(block, numSamples) {
+        return block.subarray((this.handle - 1) * numSamples, this.handle * numSamples);
+    }
+
+    destroy() {
+        this.ensemble.destroySynth(this);
+    }
+
+    queue(type, data, value, frameOffset) {
+        // nothing overtakes the events already waiting
+        if (this.pending.length === 0 && this.queueEvent(type, data, value, frameOffset)) return;
+        this.pending.push([type, data, value, frameOffset]);
+    }
+
+    /**
+     * Move the waiting events into the event queue in order, as far as it has room
+     */
+    flushPending() {
+        let count = 0;
+        while (count < this.pending.length && this.queueEvent(...this.pending[count])) {
+            count++;
+        }
+        if (count > 0) {
+            this.pending.splice(0, count);
+        }
+    }
+
+    queueEvent(type, data, value, frameOffset) {
+        const module = this.ensemble.wasmModule;
+        return EnsembleEventRing.queueEvent(module.HEAP32, module.HEAPF32, this.queueAddress, type, data, value, frameOffset);
+    }
+}
+
+class JC303Ensemble {
+    /**
+     * @param {Object} wasmModule - A loaded JC303Module
+     * @param {number} sampleRate - The sample rate of the synths
+     * @param {number} blockSize - The block size render is called with most
+     */
+    constructor(wasmModule, sampleRate, blockSize = 128) {
+        this.wasmModule = wasmModule;
+        this.sampleRate = sampleRate;
+        this.blockSize = blockSize;
+        this.synths = new Set();
+    }
+
+    /**
+     * Create a synth with the default parameters
+     */
+    createSynth() {
+        const synth = new JC303EnsembleSynth(this, this.wasmModule.createSynth(this.sampleRate, this.blockSize));
+        this.synths.add(synth);
+        return synth;
+    }
+
+    /**
+     * Destroy a synth, its channel turns silent and may be taken by the next synth created
+     */
+    destroySynth(synth) {
+        if (!this.synths.delete(synth)) return;
+        this.wasmModule.destroySynth(synth.handle);
+        synth.handle = 0;
+        synth.pending = [];
+    }
+
+    /**
+     * The number of channels render returns in a layout: one per synth (up to the highest handle)
+     * and the left and right of the mix bus last, or only those two for MIX
+     */
+    numChannels(layout = JC303Ensemble.PLANAR) {
+        return this.wasmModule.getNumChannels(layout);
+    }
+
+    /**
+     * Render a block of all synths, applying the events queued for them
+     * @returns {Float32Array} - numChannels(layout) * numSamples samples, a view of WASM memory
+     *                           that is only valid until the next call
+     */
+    render(numSamples, layout = JC303Ensemble.PLANAR) {
+        for (const synth of this.synths) {
+            if (synth.pending.length > 0) synth.flushPending();
+        }
+
+        const ptr = this.wasmModule.renderAll(numSamples, layout);
+        return new Float32Array(this.wasmModule.HEAPF32.buffer, ptr, this.numChannels(layout) * numSamples);
+    }
+
+    /**
+     * Destroy all synths
+     */
+    destroy() {
+        for (const synth of [...this.synths]) {
+            this.destroySynth(synth);
+        }
+    }
+}
+
+// The layouts of render, as enum RenderLayout in jc303_wasm.cpp
+JC303Ensemble.PLANAR = 0;
+JC303Ensemble.INTERLEAVED = 1;
+JC303Ensemble.MIX = 2;
+
+// Export for different module systems
+if (typeof module !== 'undefined' && module.exports) {
+    module.exports = { JC303Ensemble, JC303EnsembleSynth };
+} else if (typeof globalThis !== 'undefined') {
+    globalThis.JC303Ensemble = JC303Ensemble;
+    globalThis.JC303EnsembleSynth = JC303EnsembleSynth;
+}
@@ -0,0 +1,289 @@
+/**
+ * JC-303 Event Ring
+ *
+ * Carries notes and parameter changes from the main thread to the AudioWorklet without
+ * postMessage: a single producer, single consumer ring of fixed size binary events in a
+ * SharedArrayBuffer. The main thread writes events and publishes them with Atomics, the worklet
+ * copies them into the event queue of the WASM module once per render quantum (see
+ * jc303_events.h), and the C++ render call applies them. No message is cloned, nothing is
+ * allocated per event and no Embind call is made per event.
+ *
+ * SharedArrayBuffer needs a cross-origin isolated page (COOP/COEP headers). Without it,
+ * JC303EventSender posts the messages jc303-worklet-processor.js also accepts instead - for all of
+ * its events, as the worklet applies the two in separate orders. While the ring is full, the sender
+ * holds the events back itself and hands them on in order as the worklet makes room.
+ *
+ * Events can be scheduled at an AudioContext time, and then apply at that very sample (or as soon
+ * as possible if they arrive late). Scheduled events must be sent in time order: the worklet stops
+ * at the first one that isn't due yet, holding back the events behind it.
+ *
+ * Usage (main thread):
+ *   const events = new JC303EventSender(workletNode);
+ *   events.noteOn(36, 100);
+ *   events.noteOn(36, 100, context.currentTime + 0.1);
+ *   events.setParameter('cutoff', 0.5);
+ *
+ * Licensed under GPL-3.0
+ */
+
+// Header: the write index, the read index and the capacity, as 32 bit words, padded to 16 bytes.
+// The indices run freely and wrap at 2^32, the capacity is a power of two.
+const RING_WRITE_INDEX = 0;
+const RING_READ_INDEX = 1;
+const RING_CAPACITY = 2;
+const RING_HEADER_BYTES = 16;
+
+// Each event is four 32 bit words: type, data, value (float) and frame offset. Must match struct
+// Event in jc303_events.h. In the ring, an event with the AT_FRAME bit in its type holds the
+// AudioContext frame it is scheduled for instead (modulo 2^32), which the worklet turns into the
+// offset in its block.
+const EVENT_WORDS = 4;
+const AT_FRAME = 0x100;
+
+// The event queue in WASM memory (struct EventQueue): numEvents, capacity, then the events
+const QUEUE_NUM_EVENTS = 0;
+const QUEUE_CAPACITY = 1;
+const QUEUE_HEADER_WORDS = 2;
+
+class JC303EventRing {
+    /**
+     * Wrap a ring buffer created by JC303EventRing.create (on the other thread)
+     */
+    constructor(buffer) {
+        this.buffer = buffer;
+        this.header = new Int32Array(buffer, 0, RING_HEADER_BYTES / 4);
+        this.words = new Int32Array(buffer, RING_HEADER_BYTES);
+        this.values = new Float32Array(buffer, RING_HEADER_BYTES);
+        this.capacity = this.header[RING_CAPACITY];
+    }
+
+    /**
+     * Whether the page can share memory with the worklet
+     */
+    static isSupported() {
+        return typeof SharedArrayBuffer !== 'undefined'
+            && (typeof crossOriginIsolated === 'undefined' || crossOriginIsolated);
+    }
+
+    /**
+     * Create a ring for up to capacity pending events (rounded up to a power of two)
+     */
+    static create(capacity = 1024) {
+        let size = 1;
+        while (size < capacity) size *= 2;
+
+        const buffer = new SharedArrayBuffer(RING_HEADER_BYTES + size * EVENT_WORDS * 4);
+        new Int32Array(buffer, 0, RING_HEADER_BYTES / 4)[RING_CAPACITY] = size;
+        return new JC303EventRing(buffer);
+    }
+
+    // ==================== Producer (main thread) ====================
+
+    /**
+     * Append an event, returns false if the ring is full
+     * @param {number} frame - The AudioContext frame to apply it at, or -1 for the next block
+     */
+    push(type, data = 0, value = 0, frame = -1) {
+        const write = this.header[RING_WRITE_INDEX];
+        const read = Atomics.load(this.header, RING_READ_INDEX);
+        if (((write - read) >>> 0) >= this.capacity) return false;
+
+        const slot = (write & (this.capacity - 1)) * EVENT_WORDS;
+        this.words[slot] = frame >= 0 ? type | AT_FRAME : type;
+        this.words[slot + 1] = data;
+        this.values[slot + 2] = value;
+        this.words[slot + 3] = frame >= 0 ? frame | 0 : 0;
+
+        // publishes the event: the worklet reads the index before the event
+        Atomics.store(this.header, RING_WRITE_INDEX, (write + 1) | 0);
+        return true;
+    }
+
+    // ==================== Consumer (audio thread) ====================
+
+    /**
+     * Move the events due in the coming block into the event queue of the WASM module, as many as
+     * it has room for
+     * @param {Int32Array} heap - HEAP32 of the module
+     * @param {number} queueAddress - the address jc303_getEventQueue returned
+     * @param {number} blockFrame - The AudioContext frame the block starts at (currentFrame)
+     * @param {number} blockLength - The number of frames in the block
+     * @returns {number} - The number of events moved
+     */
+    drainInto(heap, queueAddress, blockFrame, blockLength) {
+        const read = this.header[RING_READ_INDEX];
+        const write = Atomics.load(this.header, RING_WRITE_INDEX);
+        const pending = (write - read) >>> 0;
+        if (pending === 0) return 0;
+
+        const queue = queueAddress >> 2;
+        const queued = heap[queue + QUEUE_NUM_EVENTS];
+        const room = Math.min(pending, heap[queue + QUEUE_CAPACITY] - queued);
+
+        // the events are copied as raw words, the float values keep their bits
+        let count = 0;
+        let destination = queue + QUEUE_HEADER_WORDS + queued * EVENT_WORDS;
+        for (; count < room; count++) {
+            const slot = ((read + count) & (this.capacity - 1)) * EVENT_WORDS;
+            const type = this.words[slot];
+
+            // late events apply at the start of the block, later ones wait for theirs
+            let frameOffset = 0;
+            if (type & AT_FRAME) {
+                frameOffset = (this.words[slot + 3] - blockFrame) | 0;
+                if (frameOffset >= blockLength) break;
+                frameOffset = Math.max(0, frameOffset);
+            }
+
+            heap[destination++] = type & ~AT_FRAME;
+            heap[destination++] = this.words[slot + 1];
+            heap[destination++] = this.words[slot + 2];
+            heap[destination++] = frameOffset;
+        }
+        heap[queue + QUEUE_NUM_EVENTS] = queued + count;
+
+        // hands the slots back to the main thread
+        Atomics.store(this.header, RING_READ_INDEX, (read + count) | 0);
+        return count;
+    }
+
+    /**
+     * Append one event to the event queue of the WASM module, returns false if it is full
+     * @param {Int32Array} heap - HEAP32 of the module
+     * @param {Float32Array} heapFloat - HEAPF32 of the module
+     */
+    static queueEvent(heap, heapFloat, queueAddress, type, data = 0, value = 0, frameOffset = 0) {
+        const queue = queueAddress >> 2;
+        const queued = heap[queue + QUEUE_NUM_EVENTS];
+        if (queued >= heap[queue + QUEUE_CAPACITY]) return false;
+
+        const destination = queue + QUEUE_HEADER_WORDS + queued * EVENT_WORDS;
+        heap[destination] = type;
+        heap[destination + 1] = data;
+        heapFloat[destination + 2] = value;
+        heap[destination + 3] = frameOffset;
+        heap[queue + QUEUE_NUM_EVENTS] = queued + 1;
+        return true;
+    }
+
+    /**
+     * The ParameterId (see jc303_events.h) of a parameter name, or -1
+     */
+    static parameterId(name) {
+        return JC303EventRing.PARAMETERS.indexOf(name);
+    }
+}
+
+// Event types, as enum EventType in jc303_events.h
+JC303EventRing.NOTE_ON = 1;
+JC303EventRing.NOTE_OFF = 2;
+JC303EventRing.ALL_NOTES_OFF = 3;
+JC303EventRing.PARAMETER = 4;
+
+// Parameter names (as the worklet's setParameter message takes them) in the order of ParameterId
+JC303EventRing.PARAMETERS = [
+    'waveform', 'tuning', 'cutoff', 'resonance', 'envmod', 'decay', 'accent', 'volume',
+    'modEnabled', 'normalDecay', 'accentDecay', 'feedbackFilter', 'softAttack', 'slideTime',
+    'squareDriver', 'filterMode', 'pitchBend',
+    'overdriveEnabled', 'overdriveLevel', 'overdriveDryWet'
+];
+
+/**
+ * Sends the events of the main thread to a jc303-processor worklet node: through an event ring
+ * when the page is cross-origin isolated, as messages otherwise. The optional time of each event
+ * is an AudioContext time (e.g. context.currentTime + 0.1), without it the event applies at the
+ * start of the next block.
+ */
+class JC303EventSender {
+    constructor(node, capacity = 1024) {
+        this.port = node.port;
+        this.sampleRate = node.context.sampleRate;
+        this.ring = null;
+
+        // Events waiting for room in the ring, as [type, data, value, frame], and the timer that
+        // retries them about once per render quantum
+        this.overflow = [];
+        this.overflowTimer = null;
+
+        if (JC303EventRing.isSupported()) {
+            this.ring = JC303EventRing.create(capacity);
+            this.port.postMessage({ type: 'setEventRing', buffer: this.ring.buffer });
+        }
+    }
+
+    noteOn(note, velocity, time) {
+        if (this.ring) {
+            this.push(JC303EventRing.NOTE_ON, note, velocity, time);
+        } else {
+            this.port.postMessage({ type: 'noteOn', note, velocity, time });
+        }
+    }
+
+    noteOff(note, time) {
+        if (this.ring) {
+            this.push(JC303EventRing.NOTE_OFF, note, 0, time);
+        } else {
+            this.port.postMessage({ type: 'noteOff', note, time });
+        }
+    }
+
+    allNotesOff(time) {
+        if (this.ring) {
+            this.push(JC303EventRing.ALL_NOTES_OFF, 0, 0, time);
+        } else {
+            this.port.postMessage({ type: 'allNotesOff', time });
+        }
+    }
+
+    /**
+     * Parameters the ring has no id for are ignored, as the worklet does with them
+     */
+    setParameter(param, value, time) {
+        if (this.ring) {
+            const id = JC303EventRing.parameterId(param);
+            if (id < 0) return;
+            this.push(JC303EventRing.PARAMETER, id, typeof value === 'boolean' ? (value ? 1 : 0) : value, time);
+        } else {
+            this.port.postMessage({ type: 'setParameter', param, value, time });
+        }
+    }
+
+    push(type, data, value, time) {
+        const frame = time === undefined ? -1 : Math.round(time * this.sampleRate);
+
+        // nothing overtakes the events already waiting
+        if (this.overflow.length === 0 && this.ring.push(type, data, value, frame)) return;
+
+        this.overflow.push([type, data, value, frame]);
+        this.flushOverflow();
+    }
+
+    /**
+     * Move the waiting events into the ring in order, as far as it has room
+     */
+    flushOverflow() {
+        let count = 0;
+        while (count < this.overflow.length && this.ring.push(...this.overflow[count])) {
+            count++;
+        }
+        if (count > 0) {
+            this.overflow.splice(0, count);
+        }
+
+        if (this.overflow.length > 0 && this.overflowTimer === null) {
+            const quantumMs = Math.max(1, Math.ceil(128 * 1000 / this.sampleRate));
+            this.overflowTimer = setTimeout(() => {
+                this.overflowTimer = null;
+                this.flushOverflow();
+            }, quantumMs);
+        }
+    }
+}
+
+// Export for different module systems (the worklet imports this file for its side effect)
+if (typeof module !== 'undefined' && module.exports) {
+    module.exports = { JC303EventRing, JC303EventSender };
+} else if (typeof globalThis !== 'undefined') {
+    globalThis.JC303EventRing = JC303EventRing;
+    globalThis.JC303EventSender = JC303EventSender;
+}
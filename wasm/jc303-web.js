@@ -9,6 +9,7 @@
  * 2. Create instance: const synth = new JC303();
  * 3. Initialize: await synth.init();
  * 4. Play notes: synth.noteOn(60, 100);
+ *    or schedule them sample accurately: synth.noteOn(60, 100, synth.audioContext.currentTime + 0.5);
  * 
  * Licensed under GPL-3.0
  */
@@ -38,11 +39,24 @@ class JC303 {
             feedbackFilter: 0.63,
             softAttack: 0.26,
             slideTime: 0.33,
-            squareDriver: 0.25
+            squareDriver: 0.25,
+            filterMode: 15,     // TB-303, see JC303.FILTER_MODES
+            overdriveEnabled: false,
+            overdriveLevel: 0.25,
+            overdriveDryWet: 0.25,
+            loopCache: false
         };
         
+        // The compiled overdrive model loaded last (a .jc303model file), loaded again on init
+        this.overdriveModel = null;
+        
         // Active notes for tracking
         this.activeNotes = new Set();
+        
+        // Notes scheduled at an AudioContext time, sorted by frame, and the WASM memory they are
+        // handed to processWithEvents in
+        this.scheduledEvents = [];
+        this.eventBufferPtr = 0;
     }
     
     /**
@@ -74,6 +88,7 @@ class JC303 {
             if (!success) {
                 throw new Error('Failed to initialize WASM synthesizer');
             }
+            this.eventBufferPtr = this.wasmModule._malloc(JC303.MAX_BLOCK_EVENTS * JC303.EVENT_BYTES);
             
             // Apply cached parameters
             this.applyAllParameters();
@@ -121,8 +136,9 @@ class JC303 {
             const outputBuffer = event.outputBuffer;
             const numSamples = outputBuffer.length;
             
-            // Generate samples using WASM
-            const bufferPtr = this.wasmModule.process(numSamples);
+            // Generate samples using WASM, starting the notes due in this buffer at their sample
+            const numEvents = this.writeDueEvents(event.playbackTime, numSamples);
+            const bufferPtr = this.wasmModule.processWithEvents(this.eventBufferPtr, numEvents, numSamples);
             
             if (bufferPtr) {
                 // Get the WASM memory view
@@ -141,6 +157,47 @@ class JC303 {
         };
     }
     
+    /**
+     * Write the scheduled events due in the buffer starting at playbackTime into the event buffer,
+     * with their frame offsets (late ones at the start of the buffer)
+     * @returns {number} - The number of events written
+     */
+    writeDueEvents(playbackTime, numSamples) {
+        if (this.scheduledEvents.length === 0) return 0;
+        
+        const sampleRate = this.audioContext.sampleRate;
+        const blockFrame = Math.round((playbackTime !== undefined ? playbackTime : this.audioContext.currentTime) * sampleRate);
+        const heap = this.wasmModule.HEAP32;
+        const heapFloat = this.wasmModule.HEAPF32;
+        
+        // Event layout as struct Event in jc303_events.h: type, data, value, frame offset
+        let count = 0;
+        while (count < this.scheduledEvents.length && count < JC303.MAX_BLOCK_EVENTS) {
+            const scheduled = this.scheduledEvents[count];
+            const frameOffset = scheduled.frame - blockFrame;
+            if (frameOffset >= numSamples) break;
+            
+            const word = (this.eventBufferPtr >> 2) + count * 4;
+            heap[word] = scheduled.type;
+            heap[word + 1] = scheduled.data;
+            heapFloat[word + 2] = scheduled.value;
+            heap[word + 3] = Math.max(0, frameOffset);
+            count++;
+        }
+        this.scheduledEvents.splice(0, count);
+        return count;
+    }
+    
+    /**
+     * Schedule an event at an AudioContext time, after the ones scheduled for the same frame
+     */
+    scheduleEvent(type, data, value, time) {
+        const frame = Math.round(time * this.audioContext.sampleRate);
+        let index = this.scheduledEvents.length;
+        while (index > 0 && this.scheduledEvents[index - 1].frame > frame) index--;
+        this.scheduledEvents.splice(index, 0, { frame, type, data, value });
+    }
+    
     /**
      * Resume audio context (required after user gesture)
      */
@@ -164,7 +221,9 @@ class JC303 {
         this.wasmModule.setDecay(this.parameters.decay);
         this.wasmModule.setAccent(this.parameters.accent);
         this.wasmModule.setVolume(this.parameters.volume);
+        this.wasmModule.setFilterMode(this.parameters.filterMode);
         this.wasmModule.setModEnabled(this.parameters.modEnabled ? 1 : 0);
+        this.wasmModule.setLoopCacheEnabled(this.parameters.loopCache ? 1 : 0);
         
         if (this.parameters.modEnabled) {
             this.wasmModule.setNormalDecay(this.parameters.normalDecay);
@@ -174,6 +233,13 @@ class JC303 {
             this.wasmModule.setSlideTime(this.parameters.slideTime);
             this.wasmModule.setSquareDriver(this.parameters.squareDriver);
         }
+        
+        if (this.hasOverdrive()) {
+            if (this.overdriveModel) this.copyOverdriveModel(this.overdriveModel);
+            this.wasmModule.setOverdriveLevel(this.parameters.overdriveLevel);
+            this.wasmModule.setOverdriveDryWet(this.parameters.overdriveDryWet);
+            this.wasmModule.setOverdriveEnabled(this.parameters.overdriveEnabled ? 1 : 0);
+        }
     }
     
     // ==================== MIDI Control ====================
@@ -182,33 +248,51 @@ class JC303 {
      * Trigger a note on
      * @param {number} note - MIDI note number (0-127)
      * @param {number} velocity - MIDI velocity (1-127, or 100+ for accent)
+     * @param {number} time - Optional AudioContext time to start the note at, to the sample;
+     *                        without it the note starts with the next buffer
      */
-    noteOn(note, velocity = 100) {
+    noteOn(note, velocity = 100, time = undefined) {
         if (!this.isReady) return;
         
         this.resume();
-        this.wasmModule.noteOn(note, velocity);
+        if (time === undefined) {
+            this.wasmModule.noteOn(note, velocity);
+        } else {
+            this.scheduleEvent(JC303.EVENTS.NOTE_ON, note, velocity, time);
+        }
         this.activeNotes.add(note);
     }
     
     /**
      * Trigger a note off
      * @param {number} note - MIDI note number (0-127)
+     * @param {number} time - Optional AudioContext time to end the note at
      */
-    noteOff(note) {
+    noteOff(note, time = undefined) {
         if (!this.isReady) return;
         
-        this.wasmModule.noteOff(note);
+        if (time === undefined) {
+            this.wasmModule.noteOff(note);
+        } else {
+            this.scheduleEvent(JC303.EVENTS.NOTE_OFF, note, 0, time);
+        }
         this.activeNotes.delete(note);
     }
     
     /**
      * Turn off all notes
+     * @param {number} time - Optional AudioContext time to do so at. Without it the notes
+     *                        scheduled and not yet started are dropped too.
      */
-    allNotesOff() {
+    allNotesOff(time = undefined) {
         if (!this.isReady) return;
         
-        this.wasmModule.allNotesOff();
+        if (time === undefined) {
+            this.scheduledEvents.length = 0;
+            this.wasmModule.allNotesOff();
+        } else {
+            this.scheduleEvent(JC303.EVENTS.ALL_NOTES_OFF, 0, 0, time);
+        }
         this.activeNotes.clear();
     }
     
@@ -278,6 +362,14 @@ class JC303 {
         if (this.wasmModule) this.wasmModule.setVolume(this.parameters.volume);
     }
     
+    /**
+     * Set filter mode (index into JC303.FILTER_MODES)
+     */
+    setFilterMode(mode) {
+        this.parameters.filterMode = Math.max(0, Math.min(JC303.FILTER_MODES.length - 1, mode | 0));
+        if (this.wasmModule) this.wasmModule.setFilterMode(this.parameters.filterMode);
+    }
+    
     /**
      * Enable/disable mod mode (extended Devil Fish-style parameters)
      */
@@ -348,6 +440,88 @@ class JC303 {
         if (this.wasmModule) this.wasmModule.setPitchBend(semitones);
     }
     
+    /**
+     * Switch the loop render cache on or off: while the sequencer loops a pattern with unchanged
+     * parameters, one cycle is played back from memory (allocates a few MB when switched on)
+     */
+    setLoopCacheEnabled(enabled) {
+        this.parameters.loopCache = !!enabled;
+        if (this.wasmModule) this.wasmModule.setLoopCacheEnabled(enabled ? 1 : 0);
+    }
+    
+    // ==================== Overdrive ====================
+    
+    /**
+     * Whether the module was built with the GuitarML overdrive (JC303_WASM_OVERDRIVE)
+     */
+    hasOverdrive() {
+        return !!this.wasmModule && typeof this.wasmModule.loadOverdriveModel === 'function';
+    }
+    
+    /**
+     * List the overdrive models built into dist/models by build.sh
+     * @returns {Promise<Array<{name: string, file: string}>>}
+     */
+    async listOverdriveModels(modelsPath = this.getWasmPath() + 'models/') {
+        const response = await fetch(modelsPath + 'index.json');
+        if (!response.ok) throw new Error(`Could not fetch the overdrive models index (${response.status})`);
+        const models = await response.json();
+        return models.map((model) => ({ name: model.name, file: modelsPath + model.file }));
+    }
+    
+    /**
+     * Fetch a compiled overdrive model (.jc303model) and run it. Models are only fetched when
+     * they are picked, the module itself carries none.
+     * @returns {Promise<boolean>} - False if the file holds no model the module can run
+     */
+    async loadOverdriveModel(url) {
+        const response = await fetch(url);
+        if (!response.ok) throw new Error(`Could not fetch overdrive model ${url} (${response.status})`);
+        const model = await response.arrayBuffer();
+        
+        if (!this.hasOverdrive() || !this.copyOverdriveModel(model)) return false;
+        this.overdriveModel = model;
+        return true;
+    }
+    
+    /**
+     * Hand a compiled model to the module, which keeps a copy of it
+     */
+    copyOverdriveModel(model) {
+        const size = model.byteLength;
+        const ptr = this.wasmModule._malloc(size);
+        if (!ptr) return false;
+        
+        this.wasmModule.HEAPU8.set(new Uint8Array(model), ptr);
+        const success = this.wasmModule.loadOverdriveModel(ptr, size);
+        this.wasmModule._free(ptr);
+        return success === 1;
+    }
+    
+    /**
+     * Switch the overdrive on or off (it stays silent until a model is loaded)
+     */
+    setOverdriveEnabled(enabled) {
+        this.parameters.overdriveEnabled = !!enabled;
+        if (this.hasOverdrive()) this.wasmModule.setOverdriveEnabled(enabled ? 1 : 0);
+    }
+    
+    /**
+     * Set overdrive level (0-1)
+     */
+    setOverdriveLevel(value) {
+        this.parameters.overdriveLevel = Math.max(0, Math.min(1, value));
+        if (this.hasOverdrive()) this.wasmModule.setOverdriveLevel(this.parameters.overdriveLevel);
+    }
+    
+    /**
+     * Set overdrive dry/wet mix (0-1)
+     */
+    setOverdriveDryWet(value) {
+        this.parameters.overdriveDryWet = Math.max(0, Math.min(1, value));
+        if (this.hasOverdrive()) this.wasmModule.setOverdriveDryWet(this.parameters.overdriveDryWet);
+    }
+    
     // ==================== Utility ====================
     
     /**
@@ -386,6 +560,8 @@ class JC303 {
         }
         
         if (this.wasmModule) {
+            if (this.eventBufferPtr) this.wasmModule._free(this.eventBufferPtr);
+            this.eventBufferPtr = 0;
             this.wasmModule.cleanup();
             this.wasmModule = null;
         }
@@ -394,6 +570,26 @@ class JC303 {
     }
 }
 
+// Event types as enum EventType in jc303_events.h, each event takes EVENT_BYTES of WASM memory
+JC303.EVENTS = {
+    NOTE_ON: 1,
+    NOTE_OFF: 2,
+    ALL_NOTES_OFF: 3
+};
+JC303.EVENT_BYTES = 16;
+
+// The most scheduled events applied within one buffer, later ones move to the next buffer
+JC303.MAX_BLOCK_EVENTS = 256;
+
+// Filter modes in the order of TeeBeeFilter::modes (the index is what setFilterMode expects)
+JC303.FILTER_MODES = [
+    'Flat',
+    'LP 6', 'LP 12', 'LP 18', 'LP 24',
+    'HP 6', 'HP 12', 'HP 18', 'HP 24',
+    'BP 12/12', 'BP 6/18', 'BP 18/6', 'BP 6/12', 'BP 12/6', 'BP 6/6',
+    'TB-303'
+];
+
 // Export for different module systems
 if (typeof module !== 'undefined' && module.exports) {
     module.exports = JC303;
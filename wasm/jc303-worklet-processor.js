@@ -9,6 +9,8 @@
 
 // Import the WASM module (will be inlined in jc303_worklet.js)
 import JC303WorkletModule from './jc303_worklet.js';
+// Defines JC303EventRing on the global scope
+import './jc303-event-ring.js';
 
 class JC303Processor extends AudioWorkletProcessor {
     constructor(options) {
@@ -22,7 +24,15 @@ class JC303Processor extends AudioWorkletProcessor {
         this.cachedMemoryBuffer = null;
         this.cachedMemoryView = null;
         
-        // Queue for MIDI events and parameter changes
+        // Notes and parameter changes reach the C++ event queue in WASM memory (see
+        // jc303_events.h) as binary events: from the event ring of the main thread
+        // (JC303EventSender) when it shares one, otherwise from messages. They apply at the start
+        // of the next block, or at the very sample of the time they are scheduled for.
+        this.eventQueueAddress = 0;
+        this.eventRing = null;
+        
+        // Messages arriving before the module is ready, scheduled ones (with a time) and the
+        // ones behind them, or while the event queue is full
         this.messageQueue = [];
         
         // Initialize the WASM module
@@ -42,6 +52,7 @@ class JC303Processor extends AudioWorkletProcessor {
             const success = this.wasmModule.init(sampleRate, 128);
             
             if (success) {
+                this.eventQueueAddress = this.wasmModule.getEventQueue();
                 this.wasmReady = true;
                 this.port.postMessage({ type: 'ready' });
             } else {
@@ -53,91 +64,78 @@ class JC303Processor extends AudioWorkletProcessor {
     }
     
     handleMessage(data) {
-        if (!this.wasmReady) {
-            // Queue the message for later processing
-            this.messageQueue.push(data);
+        if (data.type === 'setEventRing') {
+            this.eventRing = new JC303EventRing(data.buffer);
             return;
         }
         
-        this.processMessage(data);
+        // Queue the message for later processing, behind the ones already waiting
+        if (!this.wasmReady || this.messageQueue.length > 0 || data.time !== undefined || !this.processMessage(data, 0)) {
+            this.messageQueue.push(data);
+        }
     }
     
-    processMessage(data) {
-        if (!this.wasmModule) return;
+    /**
+     * Apply a message at a frame offset of the coming block, returns false if it has to wait for
+     * room in the event queue
+     */
+    processMessage(data, frameOffset) {
+        if (!this.wasmModule) return true;
         
         switch (data.type) {
             case 'noteOn':
-                this.wasmModule.noteOn(data.note, data.velocity);
-                break;
+                return this.queueEvent(JC303EventRing.NOTE_ON, data.note, data.velocity, frameOffset);
                 
             case 'noteOff':
-                this.wasmModule.noteOff(data.note);
-                break;
+                return this.queueEvent(JC303EventRing.NOTE_OFF, data.note, 0, frameOffset);
                 
             case 'allNotesOff':
-                this.wasmModule.allNotesOff();
-                break;
+                return this.queueEvent(JC303EventRing.ALL_NOTES_OFF, 0, 0, frameOffset);
                 
             case 'setParameter':
-                this.setParameter(data.param, data.value);
-                break;
+                return this.setParameter(data.param, data.value, frameOffset);
                 
             case 'setModEnabled':
-                this.wasmModule.setModEnabled(data.enabled ? 1 : 0);
+                return this.setParameter('modEnabled', data.enabled, frameOffset);
+                
+            case 'setLoopCacheEnabled':
+                // allocates when switched on, so it isn't an event of the block
+                this.wasmModule.setLoopCacheEnabled(data.enabled ? 1 : 0);
+                break;
+                
+            case 'loadOverdriveModel':
+                // data.model: the ArrayBuffer of a .jc303model file, best transferred
+                this.port.postMessage({ type: 'overdriveModelLoaded', success: this.loadOverdriveModel(data.model) });
                 break;
         }
+        return true;
     }
     
-    setParameter(param, value) {
-        if (!this.wasmModule) return;
+    queueEvent(type, data, value, frameOffset) {
+        return JC303EventRing.queueEvent(this.wasmModule.HEAP32, this.wasmModule.HEAPF32,
+                                         this.eventQueueAddress, type, data, value, frameOffset);
+    }
+    
+    loadOverdriveModel(model) {
+        if (typeof this.wasmModule.loadOverdriveModel !== 'function' || !model) return false;
         
-        switch (param) {
-            case 'waveform':
-                this.wasmModule.setWaveform(value);
-                break;
-            case 'tuning':
-                this.wasmModule.setTuning(value);
-                break;
-            case 'cutoff':
-                this.wasmModule.setCutoff(value);
-                break;
-            case 'resonance':
-                this.wasmModule.setResonance(value);
-                break;
-            case 'envmod':
-                this.wasmModule.setEnvMod(value);
-                break;
-            case 'decay':
-                this.wasmModule.setDecay(value);
-                break;
-            case 'accent':
-                this.wasmModule.setAccent(value);
-                break;
-            case 'volume':
-                this.wasmModule.setVolume(value);
-                break;
-            case 'normalDecay':
-                this.wasmModule.setNormalDecay(value);
-                break;
-            case 'accentDecay':
-                this.wasmModule.setAccentDecay(value);
-                break;
-            case 'feedbackFilter':
-                this.wasmModule.setFeedbackFilter(value);
-                break;
-            case 'softAttack':
-                this.wasmModule.setSoftAttack(value);
-                break;
-            case 'slideTime':
-                this.wasmModule.setSlideTime(value);
-                break;
-            case 'squareDriver':
-                this.wasmModule.setSquareDriver(value);
-                break;
-            case 'pitchBend':
-                this.wasmModule.setPitchBend(value);
-                break;
-        }
+        // the module keeps a copy, the heap memory is only needed for the call
+        const size = model.byteLength;
+        const ptr = this.wasmModule._malloc(size);
+        if (!ptr) return false;
+        
+        this.wasmModule.HEAPU8.set(new Uint8Array(model), ptr);
+        const success = this.wasmModule.loadOverdriveModel(ptr, size) === 1;
+        this.wasmModule._free(ptr);
+        return success;
+    }
+    
+    setParameter(param, value, frameOffset) {
+        if (!this.wasmModule) return true;
+        
+        const id = JC303EventRing.parameterId(param);
+        if (id < 0) return true;
+        return this.queueEvent(JC303EventRing.PARAMETER, id, typeof value === 'boolean' ? (value ? 1 : 0) : value, frameOffset);
     }
     
     process(inputs, outputs, parameters) {
@@ -148,13 +146,26 @@ class JC303Processor extends AudioWorkletProcessor {
             return true;
         }
         
-        // Process any queued messages
-        while (this.messageQueue.length > 0) {
-            this.processMessage(this.messageQueue.shift());
+        const numSamples = channel.length;
+        
+        // Move the events due in this block into the event queue, from the messages and from the
+        // ring - two separate streams, each in time order, which the render call merges by frame.
+        // Scheduled ones apply at their frame in the block, late ones at its start.
+        let numApplied = 0;
+        while (numApplied < this.messageQueue.length) {
+            const message = this.messageQueue[numApplied];
+            const frameOffset = message.time === undefined ? 0 : Math.round(message.time * sampleRate) - currentFrame;
+            if (frameOffset >= numSamples || !this.processMessage(message, Math.max(0, frameOffset))) break;
+            numApplied++;
+        }
+        if (numApplied > 0) {
+            this.messageQueue.splice(0, numApplied);
+        }
+        if (this.eventRing) {
+            this.eventRing.drainInto(this.wasmModule.HEAP32, this.eventQueueAddress, currentFrame, numSamples);
         }
         
-        // Generate audio samples
-        const numSamples = channel.length;
+        // Generate audio samples, splitting the block at the events
         const bufferPtr = this.wasmModule.process(numSamples);
         
         if (bufferPtr) {
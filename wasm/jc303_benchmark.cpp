@@ -0,0 +1,131 @@
+/**
+ * JC-303 WebAssembly CPU Benchmark
+ *
+ * Renders a 303 line in 128 frame blocks at 48 kHz, as an AudioWorklet does, first with the bare
+ * synth and then through each compiled overdrive model in a folder, and reports the time per
+ * sample and the share of the 2.67 ms a render quantum lasts. Built with -DJC303_WASM_BENCHMARK=ON,
+ * run under node:
+ *
+ *   node jc303_benchmark.js [models folder, default dist/models]
+ *
+ * Licensed under GPL-3.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/dsp/open303/rosic_Open303.h"
+
+#if JC303_WASM_OVERDRIVE
+#include "GuitarMLOverdrive.h"
+#endif
+
+using namespace rosic;
+
+static const double SAMPLE_RATE = 48000.0;
+static const int BLOCK_SIZE = 128;
+static const int NUM_BARS = 8;
+
+struct Result {
+    double nsPerSample;
+    double quantumLoad; // share of the real time a render quantum has
+};
+
+// Renders sixteenth notes at 130 bpm, gated for half a step with a rest every fourth step, so the
+// overdrive sees the silence between notes it sees in a sequence
+template <typename Effect>
+static Result renderLine(Effect&& effect) {
+    static const int notes[] = { 36, 36, 48, 36, 39, 36, 43, 41, 36, 48, 46, 36, 39, 51, 36, 34 };
+    const int samplesPerStep = (int) (SAMPLE_RATE * 60.0 / 130.0 / 4.0);
+    const int numSamples = NUM_BARS * 16 * samplesPerStep;
+
+    Open303 synth;
+    synth.setSampleRate(SAMPLE_RATE);
+    synth.setCutoff(800.0);
+    synth.setResonance(85.0);
+    synth.setEnvMod(60.0);
+    synth.setDecay(400.0);
+    synth.setAccent(70.0);
+
+    std::vector<float> block(BLOCK_SIZE);
+    double seconds = 0.0;
+    int lastNote = -1;
+    for (int start = 0; start < numSamples; start += BLOCK_SIZE) {
+        // note changes on block boundaries are close enough for timing
+        const int step = start / samplesPerStep;
+        const bool gate = (step % 4) != 3 && (start % samplesPerStep) < samplesPerStep / 2;
+        const int note = gate ? notes[step % 16] : -1;
+        if (note != lastNote) {
+            if (lastNote >= 0) synth.noteOn(lastNote, 0, 0.0);
+            if (note >= 0) synth.noteOn(note, (step % 8) == 0 ? 127 : 100, 0.0);
+            lastNote = note;
+        }
+
+        const auto t0 = std::chrono::steady_clock::now();
+        synth.updatePreBlendedWaveform();
+        synth.processBlock(block.data(), BLOCK_SIZE);
+        effect(block.data(), BLOCK_SIZE);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    const double nsPerSample = seconds * 1.0e9 / numSamples;
+    return { nsPerSample, nsPerSample * 1.0e-9 * SAMPLE_RATE };
+}
+
+static void printResult(const std::string& name, const Result& result) {
+    std::printf("%-40s %8.1f ns/sample %6.1f%% of a quantum\n", name.c_str(), result.nsPerSample, 100.0 * result.quantumLoad);
+}
+
+int main(int argc, char** argv) {
+    printResult("synth only", renderLine([](float*, int) {}));
+
+#if JC303_WASM_OVERDRIVE
+    const std::filesystem::path modelsFolder = argc > 1 ? argv[1] : "dist/models";
+    std::vector<std::filesystem::path> modelFiles;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(modelsFolder, error)) {
+        if (entry.path().extension() == ".jc303model") {
+            modelFiles.push_back(entry.path());
+        }
+    }
+    std::sort(modelFiles.begin(), modelFiles.end());
+    if (modelFiles.empty()) {
+        std::printf("no .jc303model files in %s\n", modelsFolder.string().c_str());
+        return 1;
+    }
+
+    double totalLoad = 0.0;
+    int numModels = 0;
+    for (const auto& modelFile : modelFiles) {
+        std::ifstream stream(modelFile, std::ios::binary);
+        const std::vector<char> model((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        GuitarMLOverdrive overdrive;
+        overdrive.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        if (!overdrive.loadModel(model.data(), model.size())) {
+            std::printf("%-40s not supported\n", modelFile.stem().string().c_str());
+            continue;
+        }
+        overdrive.setDrive(0.5f);
+        overdrive.setDryWet(1.0f);
+
+        const auto result = renderLine([&overdrive](float* block, int numSamples) { overdrive.process(block, numSamples); });
+        printResult(modelFile.stem().string(), result);
+        totalLoad += result.quantumLoad;
+        numModels++;
+    }
+    if (numModels > 0) {
+        std::printf("%-40s %8s %16.1f%% of a quantum\n", "mean over the models", "", 100.0 * totalLoad / numModels);
+    }
+#else
+    (void) argc;
+    (void) argv;
+#endif
+    return 0;
+}
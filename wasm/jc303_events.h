@@ -0,0 +1,66 @@
+/**
+ * JC-303 WebAssembly Events
+ *
+ * The binary events the render call applies: notes and parameter changes, 16 bytes each, written
+ * by JavaScript straight into WASM memory (see jc303-event-ring.js for the layout on that side,
+ * which must match this one).
+ *
+ * Licensed under GPL-3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+
+enum EventType : uint32_t {
+    EVENT_NOTE_ON = 1,          // data: note number, value: velocity (0 = note off)
+    EVENT_NOTE_OFF = 2,         // data: note number
+    EVENT_ALL_NOTES_OFF = 3,
+    EVENT_PARAMETER = 4         // data: ParameterId, value: the value the jc303_set function takes
+};
+
+// The parameters in the order of JC303EventRing.PARAMETERS
+enum ParameterId : int32_t {
+    PARAMETER_WAVEFORM = 0,
+    PARAMETER_TUNING,
+    PARAMETER_CUTOFF,
+    PARAMETER_RESONANCE,
+    PARAMETER_ENVMOD,
+    PARAMETER_DECAY,
+    PARAMETER_ACCENT,
+    PARAMETER_VOLUME,
+    PARAMETER_MOD_ENABLED,
+    PARAMETER_NORMAL_DECAY,
+    PARAMETER_ACCENT_DECAY,
+    PARAMETER_FEEDBACK_FILTER,
+    PARAMETER_SOFT_ATTACK,
+    PARAMETER_SLIDE_TIME,
+    PARAMETER_SQUARE_DRIVER,
+    PARAMETER_FILTER_MODE,
+    PARAMETER_PITCH_BEND,
+    PARAMETER_OVERDRIVE_ENABLED,
+    PARAMETER_OVERDRIVE_LEVEL,
+    PARAMETER_OVERDRIVE_DRY_WET,
+    NUM_PARAMETERS
+};
+
+struct Event {
+    uint32_t type;
+    int32_t data;
+    float value;
+    uint32_t frameOffset;       // the sample of the block the event applies at
+};
+
+static_assert(sizeof(Event) == 16, "the JavaScript side writes events as four 32 bit words");
+
+// The events queued for the next render call. JavaScript appends to it on the audio thread (from
+// the shared ring of the main thread, and from messages) and the render call empties it, so it is
+// only ever touched by one thread. Each source appends its events sorted by frame offset, the
+// render call merges them (events on the same frame apply in the order they were queued).
+static const int EVENT_QUEUE_CAPACITY = 1024;
+
+struct EventQueue {
+    uint32_t numEvents;
+    uint32_t capacity;
+    Event events[EVENT_QUEUE_CAPACITY];
+};
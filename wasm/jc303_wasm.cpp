@@ -5,26 +5,94 @@
  * compiled to WebAssembly using Emscripten and used in a browser environment
  * via the Web Audio API.
  * 
+ * The functions without a handle drive the synth jc303_init creates. A page that wants several
+ * synths creates them with jc303_createSynth instead, in this one module, and renders all of them
+ * with a single jc303_renderAll call per block.
+ *
  * Licensed under GPL-3.0
  */
 
 #include <emscripten.h>
 #include <emscripten/bind.h>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <vector>
 
 // Include the Open303 DSP engine
 #include "../src/dsp/open303/rosic_Open303.h"
+#include "jc303_events.h"
+
+#if JC303_WASM_OVERDRIVE
+// The GuitarML overdrive of the plugin, without JUCE
+#include "GuitarMLOverdrive.h"
+#endif
 
 using namespace rosic;
 
-// Global instance of the Open303 synth
-static Open303* g_synth = nullptr;
+// A synth with everything it renders through
+struct SynthInstance {
+    Open303* synth = nullptr;
+
+    // Audio buffer for processing
+    float* outputBuffer = nullptr;
+    int bufferSize = 0;
+
+    // Current mod state for extended decay range
+    bool modEnabled = false;
+
+    // The square wavetable of the pool it reads from, for its square driver setting
+    MipMappedWaveTable* squareTable = nullptr;
+    double squareDrive = 0.0;
+
+    // Notes and parameter changes for the next block, see jc303_events.h
+    EventQueue eventQueue = { 0, EVENT_QUEUE_CAPACITY, {} };
+
+    // Gains into the stereo mix bus of jc303_renderAll, see jc303_setSynthMix
+    float mixLeft = 0.70710678f;
+    float mixRight = 0.70710678f;
+
+#if JC303_WASM_OVERDRIVE
+    // The overdrive after the synth, off by default as in the plugin
+    GuitarMLOverdrive* overdrive = nullptr;
+    bool overdriveEnabled = false;
+#endif
+};
+
+// The synth of the functions without a handle
+static SynthInstance* g_synth = nullptr;
 
-// Audio buffers for processing
-static float* g_outputBuffer = nullptr;
-static int g_bufferSize = 0;
+// The synths of jc303_createSynth, a handle is the index + 1 (0 is no synth). Slots of destroyed
+// synths are reused, so the channels of jc303_renderAll stay where they are.
+static std::vector<SynthInstance*> g_synths;
+
+// The block jc303_renderAll writes, and its mix bus (left, then right) followed by the channel
+// of the synth being rendered. Both are sized for the largest block a synth was created for, when
+// it is created, so that rendering allocates nothing.
+static std::vector<float> g_renderBuffer;
+static std::vector<float> g_mixBuffer;
+static int g_maxBlockSize = 0;
+
+// The wavetables the synths read from instead of the pair each Open303 renders for itself, so
+// that a synth takes no more wavetable memory than the first one: the saw, and a square for each
+// square driver setting in use (the tanh shaper is baked into the table). Nothing writes to a
+// table after it is rendered, a synth changing its square driver switches to another table.
+struct SquareTable {
+    double drive;
+    int numUsers;
+    MipMappedWaveTable* table;
+};
+
+static MipMappedWaveTable* g_sawTable = nullptr;
+static std::vector<SquareTable> g_squareTables;
+
+// The layouts of jc303_renderAll
+enum RenderLayout {
+    RENDER_PLANAR = 0,          // a channel per synth slot, then the mix bus, one after the other
+    RENDER_INTERLEAVED = 1,     // the same channels, interleaved frame by frame
+    RENDER_MIX = 2              // the mix bus only, left then right
+};
 
 // Parameter ranges (matching JC303.cpp)
 struct ParameterRange {
@@ -46,20 +114,154 @@ static const double DEFAULT_ENVMOD = 0.0;        // No modulation
 static const double DEFAULT_DECAY = 0.29;        // 29%
 static const double DEFAULT_ACCENT = 0.78;       // 78%
 static const double DEFAULT_VOLUME = 0.75;       // 75%
+static const double DEFAULT_SQUARE_DRIVE = 36.9; // dB, the original TB-303 value
+
+// The parameter mappings (linToLin, linToExp) are the ones of rosic, from GlobalFunctions.h
+
+#if JC303_WASM_OVERDRIVE
+static const float DEFAULT_OVERDRIVE_LEVEL = 0.25f;
+static const float DEFAULT_OVERDRIVE_DRY_WET = 0.25f;
+#endif
 
-// Utility functions for parameter mapping
-static double linToLin(double in, double inMin, double inMax, double outMin, double outMax) {
-    double tmp = (in - inMin) / (inMax - inMin);
-    return outMin + tmp * (outMax - outMin);
+static void setParameter(SynthInstance& instance, int parameterId, float value);
+static void renderSynth(SynthInstance& instance, const Event* events, int numEvents, float* out, int numSamples);
+
+static SynthInstance* getSynth(int handle) {
+    if (handle <= 0 || handle > (int) g_synths.size()) {
+        return nullptr;
+    }
+    return g_synths[handle - 1];
+}
+
+static MipMappedWaveTable* acquireSquareTable(double drive) {
+    for (SquareTable& entry : g_squareTables) {
+        if (entry.drive == drive) {
+            entry.numUsers++;
+            return entry.table;
+        }
+    }
+
+    MipMappedWaveTable* table = new MipMappedWaveTable();
+    table->setWaveform(MipMappedWaveTable::SQUARE303);
+    table->setTanhShaperDriveFor303Square(drive);
+    g_squareTables.push_back({ drive, 1, table });
+    return table;
+}
+
+static void releaseSquareTable(MipMappedWaveTable* table) {
+    for (size_t i = 0; i < g_squareTables.size(); i++) {
+        if (g_squareTables[i].table == table && --g_squareTables[i].numUsers == 0) {
+            delete table;
+            g_squareTables.erase(g_squareTables.begin() + i);
+            return;
+        }
+    }
+}
+
+// Replaces Open303::setTanhShaperDrive, which would render into the table the other synths read
+static void setSquareDrive(SynthInstance& instance, double drive) {
+    if (instance.squareTable != nullptr && instance.squareDrive == drive) {
+        return;
+    }
+
+    if (g_sawTable == nullptr) {
+        g_sawTable = new MipMappedWaveTable();
+        g_sawTable->setWaveform(MipMappedWaveTable::SAW303);
+    }
+
+    // the old table is only released once the synth no longer reads from it
+    MipMappedWaveTable* previousTable = instance.squareTable;
+    instance.squareTable = acquireSquareTable(drive);
+    instance.squareDrive = drive;
+    instance.synth->setSharedWaveTables(g_sawTable, instance.squareTable);
+    if (previousTable != nullptr) {
+        releaseSquareTable(previousTable);
+    }
 }
 
-static double linToExp(double in, double inMin, double inMax, double outMin, double outMax) {
-    double tmp = (in - inMin) / (inMax - inMin);
-    return outMin * exp(tmp * log(outMax / outMin));
+// Set original TB-303 values for mod parameters
+static void setOriginalModValues(SynthInstance& instance) {
+    instance.synth->setAmpDecay(1230.0);
+    instance.synth->setAccentDecay(200.0);
+    instance.synth->setFeedbackHighpass(150.0);
+    instance.synth->setNormalAttack(3.0);
+    instance.synth->setSlideTime(60.0);
+    setSquareDrive(instance, DEFAULT_SQUARE_DRIVE);
 }
 
-// Current mod state for extended decay range
-static bool g_modEnabled = false;
+static void initSynth(SynthInstance& instance, double sampleRate, int bufferSize) {
+    delete instance.synth;
+    instance.synth = new Open303();
+    instance.synth->setSampleRate(sampleRate);
+
+    // the new synth still reads from its own tables
+    if (instance.squareTable != nullptr) {
+        releaseSquareTable(instance.squareTable);
+        instance.squareTable = nullptr;
+    }
+
+    // Allocate output buffer
+    delete[] instance.outputBuffer;
+    instance.outputBuffer = new float[std::max(bufferSize, 1)];
+    instance.bufferSize = std::max(bufferSize, 1);
+
+    // Set default parameters (matching JC303.cpp defaults)
+    Open303& synth = *instance.synth;
+    synth.setWaveform(DEFAULT_WAVEFORM);
+    synth.setTuning(linToLin(DEFAULT_TUNING, 0.0, 1.0, PARAM_TUNING.min, PARAM_TUNING.max));
+    synth.setCutoff(linToExp(DEFAULT_CUTOFF, 0.0, 1.0, PARAM_CUTOFF.min, PARAM_CUTOFF.max));
+    synth.setResonance(DEFAULT_RESONANCE * 100.0);
+    synth.setEnvMod(DEFAULT_ENVMOD * 100.0);
+    synth.setDecay(linToExp(DEFAULT_DECAY, 0.0, 1.0, PARAM_DECAY_NORMAL.min, PARAM_DECAY_NORMAL.max));
+    synth.setAccent(DEFAULT_ACCENT * 100.0);
+    synth.setVolume(linToLin(DEFAULT_VOLUME, 0.0, 1.0, -60.0, 0.0));
+    setOriginalModValues(instance);
+
+    instance.modEnabled = false;
+    instance.eventQueue.numEvents = 0;
+
+#if JC303_WASM_OVERDRIVE
+    // a loaded model is kept when reinitializing, prepared for the new sample rate
+    if (instance.overdrive == nullptr) {
+        instance.overdrive = new GuitarMLOverdrive();
+        instance.overdrive->setDrive(DEFAULT_OVERDRIVE_LEVEL);
+        instance.overdrive->setDryWet(DEFAULT_OVERDRIVE_DRY_WET);
+    }
+    instance.overdrive->prepare(sampleRate, instance.bufferSize);
+#endif
+}
+
+static void freeSynth(SynthInstance* instance) {
+    if (instance == nullptr) {
+        return;
+    }
+
+    delete instance->synth;
+    if (instance->squareTable != nullptr) {
+        releaseSquareTable(instance->squareTable);
+    }
+    delete[] instance->outputBuffer;
+#if JC303_WASM_OVERDRIVE
+    delete instance->overdrive;
+#endif
+    delete instance;
+}
+
+// Sizes the buffers of jc303_renderAll for blocks of up to maxBlockSize samples of all synth slots
+static void reserveRenderBuffers(int maxBlockSize) {
+    g_maxBlockSize = std::max(g_maxBlockSize, maxBlockSize);
+    g_renderBuffer.resize((g_synths.size() + 2) * (size_t) g_maxBlockSize);
+    g_mixBuffer.resize(3 * (size_t) g_maxBlockSize);
+}
+
+#if JC303_WASM_OVERDRIVE
+static int loadOverdriveModel(SynthInstance* instance, uintptr_t data, int size) {
+    if (instance == nullptr || instance->overdrive == nullptr || data == 0 || size <= 0) {
+        return 0;
+    }
+    return instance->overdrive->loadModel(reinterpret_cast<const void*>(data), static_cast<size_t>(size)) ? 1 : 0;
+}
+#endif
 
 extern "C" {
 
@@ -71,83 +273,76 @@ extern "C" {
  */
 EMSCRIPTEN_KEEPALIVE
 int jc303_init(double sampleRate, int bufferSize) {
-    if (g_synth != nullptr) {
-        delete g_synth;
+    // the synth keeps its address, so does its event queue
+    if (g_synth == nullptr) {
+        g_synth = new SynthInstance();
     }
-    
-    g_synth = new Open303();
-    g_synth->setSampleRate(sampleRate);
-    
-    // Allocate output buffer
-    if (g_outputBuffer != nullptr) {
-        delete[] g_outputBuffer;
-    }
-    g_outputBuffer = new float[bufferSize];
-    g_bufferSize = bufferSize;
-    
-    // Set default parameters (matching JC303.cpp defaults)
-    g_synth->setWaveform(DEFAULT_WAVEFORM);
-    g_synth->setTuning(linToLin(DEFAULT_TUNING, 0.0, 1.0, PARAM_TUNING.min, PARAM_TUNING.max));
-    g_synth->setCutoff(linToExp(DEFAULT_CUTOFF, 0.0, 1.0, PARAM_CUTOFF.min, PARAM_CUTOFF.max));
-    g_synth->setResonance(DEFAULT_RESONANCE * 100.0);
-    g_synth->setEnvMod(DEFAULT_ENVMOD * 100.0);
-    g_synth->setDecay(linToExp(DEFAULT_DECAY, 0.0, 1.0, PARAM_DECAY_NORMAL.min, PARAM_DECAY_NORMAL.max));
-    g_synth->setAccent(DEFAULT_ACCENT * 100.0);
-    g_synth->setVolume(linToLin(DEFAULT_VOLUME, 0.0, 1.0, -60.0, 0.0));
-    
-    // Set original TB-303 values for mod parameters
-    g_synth->setAmpDecay(1230.0);
-    g_synth->setAccentDecay(200.0);
-    g_synth->setFeedbackHighpass(150.0);
-    g_synth->setNormalAttack(3.0);
-    g_synth->setSlideTime(60.0);
-    g_synth->setTanhShaperDrive(36.9);
-    
-    g_modEnabled = false;
-    
+    initSynth(*g_synth, sampleRate, bufferSize);
+
     return 1;
 }
 
 /**
- * Cleanup the synthesizer
+ * Cleanup the synthesizer, and the synths created with jc303_createSynth
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_cleanup() {
-    if (g_synth != nullptr) {
-        delete g_synth;
-        g_synth = nullptr;
-    }
-    if (g_outputBuffer != nullptr) {
-        delete[] g_outputBuffer;
-        g_outputBuffer = nullptr;
+    freeSynth(g_synth);
+    g_synth = nullptr;
+
+    for (SynthInstance* instance : g_synths) {
+        freeSynth(instance);
     }
-    g_bufferSize = 0;
+    g_synths.clear();
+    g_renderBuffer = std::vector<float>();
+    g_mixBuffer = std::vector<float>();
+    g_maxBlockSize = 0;
+
+    // all square tables have been released with their synths
+    delete g_sawTable;
+    g_sawTable = nullptr;
 }
 
 /**
- * Process audio samples
+ * Process audio samples, with sample accurate events: rendering stops at the frame offset of
+ * each event, applies it and carries on, as JC303Line::renderBlock does at the sample positions
+ * of MIDI events. The events queued with jc303_getEventQueue are applied the same way, before
+ * given events of the same offset.
+ * @param events Address of an array of Event (see jc303_events.h) sorted by frame offset, or 0.
+ *               Events before the previous one apply right after it, events past the block at
+ *               its end.
+ * @param numEvents Number of events in the array
  * @param numSamples Number of samples to generate
  * @return Pointer to the output buffer
  */
 EMSCRIPTEN_KEEPALIVE
-float* jc303_process(int numSamples) {
-    if (g_synth == nullptr || g_outputBuffer == nullptr) {
+float* jc303_processWithEvents(uintptr_t events, int numEvents, int numSamples) {
+    if (g_synth == nullptr) {
         return nullptr;
     }
-    
+
     // Ensure buffer is large enough
-    if (numSamples > g_bufferSize) {
-        delete[] g_outputBuffer;
-        g_outputBuffer = new float[numSamples];
-        g_bufferSize = numSamples;
-    }
-    
-    // Generate audio samples
-    for (int i = 0; i < numSamples; i++) {
-        g_outputBuffer[i] = static_cast<float>(g_synth->getSample());
+    SynthInstance& instance = *g_synth;
+    numSamples = std::max(numSamples, 0);
+    if (numSamples > instance.bufferSize) {
+        delete[] instance.outputBuffer;
+        instance.outputBuffer = new float[numSamples];
+        instance.bufferSize = numSamples;
     }
-    
-    return g_outputBuffer;
+
+    renderSynth(instance, reinterpret_cast<const Event*>(events), events != 0 ? numEvents : 0,
+                instance.outputBuffer, numSamples);
+    return instance.outputBuffer;
+}
+
+/**
+ * Process audio samples, applying the queued events
+ * @param numSamples Number of samples to generate
+ * @return Pointer to the output buffer
+ */
+EMSCRIPTEN_KEEPALIVE
+float* jc303_process(int numSamples) {
+    return jc303_processWithEvents(0, 0, numSamples);
 }
 
 /**
@@ -158,7 +353,7 @@ float* jc303_process(int numSamples) {
 EMSCRIPTEN_KEEPALIVE
 void jc303_noteOn(int noteNumber, int velocity) {
     if (g_synth != nullptr) {
-        g_synth->noteOn(noteNumber, velocity, 0.0);
+        g_synth->synth->noteOn(noteNumber, velocity, 0.0);
     }
 }
 
@@ -169,7 +364,7 @@ void jc303_noteOn(int noteNumber, int velocity) {
 EMSCRIPTEN_KEEPALIVE
 void jc303_noteOff(int noteNumber) {
     if (g_synth != nullptr) {
-        g_synth->noteOn(noteNumber, 0, 0.0);
+        g_synth->synth->noteOn(noteNumber, 0, 0.0);
     }
 }
 
@@ -179,28 +374,34 @@ void jc303_noteOff(int noteNumber) {
 EMSCRIPTEN_KEEPALIVE
 void jc303_allNotesOff() {
     if (g_synth != nullptr) {
-        g_synth->allNotesOff();
+        g_synth->synth->allNotesOff();
     }
 }
 
 /**
- * Set waveform (0.0 = saw, 1.0 = square)
+ * Set a parameter by its ParameterId (see jc303_events.h), with the value its jc303_set function takes
  */
 EMSCRIPTEN_KEEPALIVE
-void jc303_setWaveform(float value) {
+void jc303_setParameter(int parameterId, float value) {
     if (g_synth != nullptr) {
-        g_synth->setWaveform(linToLin(value, 0.0, 1.0, 0.0, 1.0));
+        setParameter(*g_synth, parameterId, value);
     }
 }
 
+/**
+ * Set waveform (0.0 = saw, 1.0 = square)
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setWaveform(float value) {
+    jc303_setParameter(PARAMETER_WAVEFORM, value);
+}
+
 /**
  * Set tuning (0.0-1.0 maps to 400-480 Hz for A4)
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setTuning(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setTuning(linToLin(value, 0.0, 1.0, 400.0, 480.0));
-    }
+    jc303_setParameter(PARAMETER_TUNING, value);
 }
 
 /**
@@ -208,9 +409,7 @@ void jc303_setTuning(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setCutoff(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setCutoff(linToExp(value, 0.0, 1.0, 314.0, 2394.0));
-    }
+    jc303_setParameter(PARAMETER_CUTOFF, value);
 }
 
 /**
@@ -218,9 +417,7 @@ void jc303_setCutoff(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setResonance(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setResonance(linToLin(value, 0.0, 1.0, 0.0, 100.0));
-    }
+    jc303_setParameter(PARAMETER_RESONANCE, value);
 }
 
 /**
@@ -228,9 +425,7 @@ void jc303_setResonance(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setEnvMod(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setEnvMod(linToLin(value, 0.0, 1.0, 0.0, 100.0));
-    }
+    jc303_setParameter(PARAMETER_ENVMOD, value);
 }
 
 /**
@@ -238,11 +433,7 @@ void jc303_setEnvMod(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setDecay(float value) {
-    if (g_synth != nullptr) {
-        double min = g_modEnabled ? 30.0 : 200.0;
-        double max = g_modEnabled ? 3000.0 : 2000.0;
-        g_synth->setDecay(linToExp(value, 0.0, 1.0, min, max));
-    }
+    jc303_setParameter(PARAMETER_DECAY, value);
 }
 
 /**
@@ -250,9 +441,7 @@ void jc303_setDecay(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setAccent(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setAccent(linToLin(value, 0.0, 1.0, 0.0, 100.0));
-    }
+    jc303_setParameter(PARAMETER_ACCENT, value);
 }
 
 /**
@@ -260,9 +449,7 @@ void jc303_setAccent(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setVolume(float value) {
-    if (g_synth != nullptr) {
-        g_synth->setVolume(linToLin(value, 0.0, 1.0, -60.0, 0.0));
-    }
+    jc303_setParameter(PARAMETER_VOLUME, value);
 }
 
 /**
@@ -270,19 +457,7 @@ void jc303_setVolume(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setModEnabled(int enabled) {
-    g_modEnabled = (enabled != 0);
-    
-    if (g_synth == nullptr) return;
-    
-    if (!g_modEnabled) {
-        // Restore original TB-303 values
-        g_synth->setAmpDecay(1230.0);
-        g_synth->setAccentDecay(200.0);
-        g_synth->setFeedbackHighpass(150.0);
-        g_synth->setNormalAttack(3.0);
-        g_synth->setSlideTime(60.0);
-        g_synth->setTanhShaperDrive(36.9);
-    }
+    jc303_setParameter(PARAMETER_MOD_ENABLED, enabled != 0 ? 1.0f : 0.0f);
 }
 
 /**
@@ -290,9 +465,7 @@ void jc303_setModEnabled(int enabled) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setNormalDecay(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        g_synth->setAmpDecay(linToLin(value, 0.0, 1.0, 30.0, 3000.0));
-    }
+    jc303_setParameter(PARAMETER_NORMAL_DECAY, value);
 }
 
 /**
@@ -300,9 +473,7 @@ void jc303_setNormalDecay(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setAccentDecay(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        g_synth->setAccentDecay(linToLin(value, 0.0, 1.0, 30.0, 3000.0));
-    }
+    jc303_setParameter(PARAMETER_ACCENT_DECAY, value);
 }
 
 /**
@@ -311,10 +482,7 @@ void jc303_setAccentDecay(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setFeedbackFilter(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        // Inverted range: higher knob position = lower cutoff frequency
-        g_synth->setFeedbackHighpass(linToExp(value, 0.0, 1.0, 350.0, 100.0));
-    }
+    jc303_setParameter(PARAMETER_FEEDBACK_FILTER, value);
 }
 
 /**
@@ -322,9 +490,7 @@ void jc303_setFeedbackFilter(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setSoftAttack(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        g_synth->setNormalAttack(linToExp(value, 0.0, 1.0, 0.3, 3000.0));
-    }
+    jc303_setParameter(PARAMETER_SOFT_ATTACK, value);
 }
 
 /**
@@ -332,9 +498,7 @@ void jc303_setSoftAttack(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setSlideTime(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        g_synth->setSlideTime(linToLin(value, 0.0, 1.0, 2.0, 360.0));
-    }
+    jc303_setParameter(PARAMETER_SLIDE_TIME, value);
 }
 
 /**
@@ -342,9 +506,15 @@ void jc303_setSlideTime(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setSquareDriver(float value) {
-    if (g_synth != nullptr && g_modEnabled) {
-        g_synth->setTanhShaperDrive(linToLin(value, 0.0, 1.0, 25.0, 80.0));
-    }
+    jc303_setParameter(PARAMETER_SQUARE_DRIVER, value);
+}
+
+/**
+ * Set filter mode (index into TeeBeeFilter::modes, 15 = TB-303 which is the default)
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setFilterMode(int mode) {
+    jc303_setParameter(PARAMETER_FILTER_MODE, (float) mode);
 }
 
 /**
@@ -352,17 +522,108 @@ void jc303_setSquareDriver(float value) {
  */
 EMSCRIPTEN_KEEPALIVE
 void jc303_setPitchBend(float semitones) {
+    jc303_setParameter(PARAMETER_PITCH_BEND, semitones);
+}
+
+/**
+ * Switch the loop render cache on or off (off by default): while the sequencer loops a pattern
+ * with unchanged parameters, one cycle of the oscillator and filter is played back from memory.
+ * Switching it on allocates a few megabytes, see Open303::setLoopCacheEnabled.
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setLoopCacheEnabled(int enabled) {
     if (g_synth != nullptr) {
-        g_synth->setPitchBend(semitones);
+        g_synth->synth->setLoopCacheEnabled(enabled != 0);
     }
 }
 
+#if JC303_WASM_OVERDRIVE
+/**
+ * Switch the overdrive on or off. It stays silent until a model is loaded.
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setOverdriveEnabled(int enabled) {
+    jc303_setParameter(PARAMETER_OVERDRIVE_ENABLED, enabled != 0 ? 1.0f : 0.0f);
+}
+
+/**
+ * Set overdrive level (0.0-1.0, the condition of conditioned models, the input gain of the others)
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setOverdriveLevel(float value) {
+    jc303_setParameter(PARAMETER_OVERDRIVE_LEVEL, value);
+}
+
+/**
+ * Set overdrive dry/wet mix (0.0-1.0)
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setOverdriveDryWet(float value) {
+    jc303_setParameter(PARAMETER_OVERDRIVE_DRY_WET, value);
+}
+
+/**
+ * Load an overdrive model compiled to a .jc303model file. The data is copied, the memory
+ * (allocated with _malloc) can be freed right after.
+ * @return 1 on success, 0 when the data holds no model this build can run (the last model is kept)
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_loadOverdriveModel(uintptr_t data, int size) {
+    return loadOverdriveModel(g_synth, data, size);
+}
+#endif
+
+/**
+ * Get the address of the event queue, which JavaScript fills with binary events (see
+ * jc303_events.h) for the next jc303_process call to apply
+ */
+EMSCRIPTEN_KEEPALIVE
+uintptr_t jc303_getEventQueue() {
+    return g_synth != nullptr ? reinterpret_cast<uintptr_t>(&g_synth->eventQueue) : 0;
+}
+
+/**
+ * Get the size in bytes of a state snapshot
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_getStateSize() {
+    return g_synth != nullptr ? g_synth->synth->getStateSize() : 0;
+}
+
+/**
+ * Write a snapshot of the complete engine state (oscillator, filters, envelopes,
+ * sequencer, held notes and parameters) into memory allocated with _malloc.
+ * Restoring it later skips the warm-up of a freshly initialized synth.
+ * @param destination Address of at least jc303_getStateSize() bytes
+ * @return Number of bytes written, 0 when not initialized
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_saveState(uintptr_t destination) {
+    if (g_synth == nullptr || destination == 0) {
+        return 0;
+    }
+    g_synth->synth->saveState(reinterpret_cast<void*>(destination));
+    return g_synth->synth->getStateSize();
+}
+
+/**
+ * Restore a snapshot written by jc303_saveState (of the same module build)
+ * @return 1 on success, 0 when the snapshot doesn't match this build
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_loadState(uintptr_t source) {
+    if (g_synth == nullptr || source == 0) {
+        return 0;
+    }
+    return g_synth->synth->loadState(reinterpret_cast<const void*>(source)) ? 1 : 0;
+}
+
 /**
  * Get the output buffer pointer for direct memory access
  */
 EMSCRIPTEN_KEEPALIVE
 float* jc303_getOutputBuffer() {
-    return g_outputBuffer;
+    return g_synth != nullptr ? g_synth->outputBuffer : nullptr;
 }
 
 /**
@@ -370,16 +631,399 @@ float* jc303_getOutputBuffer() {
  */
 EMSCRIPTEN_KEEPALIVE
 int jc303_getBufferSize() {
-    return g_bufferSize;
+    return g_synth != nullptr ? g_synth->bufferSize : 0;
+}
+
+// ==================== Several synths ====================
+
+/**
+ * Create a synth, with the default parameters of jc303_init. All synths share their wavetables.
+ * @param sampleRate The audio sample rate
+ * @param bufferSize The largest block jc303_renderAll is expected to render, which renders larger
+ *                   ones at the cost of an allocation
+ * @return The handle of the synth, 1 or more
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_createSynth(double sampleRate, int bufferSize) {
+    SynthInstance* instance = new SynthInstance();
+    initSynth(*instance, sampleRate, bufferSize);
+
+    const auto freeSlot = std::find(g_synths.begin(), g_synths.end(), nullptr);
+    if (freeSlot != g_synths.end()) {
+        *freeSlot = instance;
+        reserveRenderBuffers(instance->bufferSize);
+        return (int) (freeSlot - g_synths.begin()) + 1;
+    }
+    g_synths.push_back(instance);
+    reserveRenderBuffers(instance->bufferSize);
+    return (int) g_synths.size();
+}
+
+/**
+ * Destroy a synth of jc303_createSynth. Its channel of jc303_renderAll turns silent (or goes away
+ * when it was the last one) and its handle may be given to the next synth created.
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_destroySynth(int handle) {
+    SynthInstance* instance = getSynth(handle);
+    if (instance == nullptr) {
+        return;
+    }
+
+    freeSynth(instance);
+    g_synths[handle - 1] = nullptr;
+    while (!g_synths.empty() && g_synths.back() == nullptr) {
+        g_synths.pop_back();
+    }
+}
+
+/**
+ * Trigger a note on event on a synth (velocity 0 = note off)
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_synthNoteOn(int handle, int noteNumber, int velocity) {
+    if (SynthInstance* instance = getSynth(handle)) {
+        instance->synth->noteOn(noteNumber, velocity, 0.0);
+    }
+}
+
+/**
+ * Trigger a note off event on a synth
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_synthNoteOff(int handle, int noteNumber) {
+    jc303_synthNoteOn(handle, noteNumber, 0);
+}
+
+/**
+ * Turn all notes of a synth off
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_synthAllNotesOff(int handle) {
+    if (SynthInstance* instance = getSynth(handle)) {
+        instance->synth->allNotesOff();
+    }
+}
+
+/**
+ * Set a parameter of a synth, as jc303_setParameter
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_synthSetParameter(int handle, int parameterId, float value) {
+    if (SynthInstance* instance = getSynth(handle)) {
+        setParameter(*instance, parameterId, value);
+    }
+}
+
+/**
+ * Switch the loop render cache of a synth on or off, as jc303_setLoopCacheEnabled
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_synthSetLoopCacheEnabled(int handle, int enabled) {
+    if (SynthInstance* instance = getSynth(handle)) {
+        instance->synth->setLoopCacheEnabled(enabled != 0);
+    }
+}
+
+/**
+ * Get the address of the event queue of a synth, applied by the next jc303_renderAll call. It
+ * stays at this address for the life of the synth.
+ */
+EMSCRIPTEN_KEEPALIVE
+uintptr_t jc303_synthGetEventQueue(int handle) {
+    SynthInstance* instance = getSynth(handle);
+    return instance != nullptr ? reinterpret_cast<uintptr_t>(&instance->eventQueue) : 0;
+}
+
+#if JC303_WASM_OVERDRIVE
+/**
+ * Load an overdrive model into a synth, as jc303_loadOverdriveModel. Each synth keeps its own copy.
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_synthLoadOverdriveModel(int handle, uintptr_t data, int size) {
+    return loadOverdriveModel(getSynth(handle), data, size);
+}
+#endif
+
+/**
+ * Set how much of a synth goes into the mix bus of jc303_renderAll
+ * @param gain Linear gain, 0 leaves the synth out of the mix
+ * @param pan -1 (left) to 1 (right), with a constant power law: -3 dB on both sides at 0
+ */
+EMSCRIPTEN_KEEPALIVE
+void jc303_setSynthMix(int handle, float gain, float pan) {
+    if (SynthInstance* instance = getSynth(handle)) {
+        const double angle = 0.25 * PI * (clip((double) pan, -1.0, 1.0) + 1.0);
+        instance->mixLeft = (float) (gain * cos(angle));
+        instance->mixRight = (float) (gain * sin(angle));
+    }
+}
+
+/**
+ * Get the number of channels jc303_renderAll writes in a layout: one per synth slot (the highest
+ * handle in use) and the two of the mix bus, or only those two for RENDER_MIX
+ */
+EMSCRIPTEN_KEEPALIVE
+int jc303_getNumChannels(int layout) {
+    return layout == RENDER_MIX ? 2 : (int) g_synths.size() + 2;
+}
+
+/**
+ * Render a block of all synths of jc303_createSynth, each applying the events of its queue, in
+ * a single call. Channel handle - 1 holds the synth of that handle (silence for a destroyed one),
+ * the last two channels the mix bus (see jc303_setSynthMix).
+ * @param numSamples Number of samples to generate
+ * @param layout RENDER_PLANAR (0), RENDER_INTERLEAVED (1) or RENDER_MIX (2)
+ * @return Pointer to jc303_getNumChannels(layout) * numSamples samples, valid until the next call
+ */
+EMSCRIPTEN_KEEPALIVE
+float* jc303_renderAll(int numSamples, int layout) {
+    numSamples = std::max(numSamples, 0);
+    const int numSynths = (int) g_synths.size();
+    const int numChannels = jc303_getNumChannels(layout);
+
+    // only a block larger than any synth was created for allocates here
+    if (numSamples > g_maxBlockSize) {
+        reserveRenderBuffers(numSamples);
+    }
+
+    float* mixLeft = g_mixBuffer.data();
+    float* mixRight = mixLeft + numSamples;
+    float* channelBuffer = mixRight + numSamples;
+    std::fill(mixLeft, mixRight + numSamples, 0.0f);
+
+    float* output = g_renderBuffer.data();
+    for (int channel = 0; channel < numSynths; channel++) {
+        SynthInstance* instance = g_synths[channel];
+        if (instance == nullptr) {
+            // the channel of a destroyed synth is silent
+            if (layout == RENDER_PLANAR) {
+                std::fill(output + (size_t) channel * numSamples, output + (size_t) (channel + 1) * numSamples, 0.0f);
+            } else if (layout == RENDER_INTERLEAVED) {
+                for (int i = 0; i < numSamples; i++) {
+                    output[(size_t) i * numChannels + channel] = 0.0f;
+                }
+            }
+            continue;
+        }
+
+        // planar channels are rendered in place
+        float* out = layout == RENDER_PLANAR ? output + (size_t) channel * numSamples : channelBuffer;
+        renderSynth(*instance, nullptr, 0, out, numSamples);
+        if (instance->mixLeft != 0.0f || instance->mixRight != 0.0f) {
+            for (int i = 0; i < numSamples; i++) {
+                mixLeft[i] += instance->mixLeft * out[i];
+                mixRight[i] += instance->mixRight * out[i];
+            }
+        }
+
+        if (layout == RENDER_INTERLEAVED) {
+            for (int i = 0; i < numSamples; i++) {
+                output[(size_t) i * numChannels + channel] = out[i];
+            }
+        }
+    }
+
+    if (layout == RENDER_PLANAR) {
+        std::memcpy(output + (size_t) numSynths * numSamples, g_mixBuffer.data(), 2 * numSamples * sizeof(float));
+    } else if (layout == RENDER_INTERLEAVED) {
+        for (int i = 0; i < numSamples; i++) {
+            output[(size_t) i * numChannels + numSynths] = mixLeft[i];
+            output[(size_t) i * numChannels + numSynths + 1] = mixRight[i];
+        }
+    } else {
+        return g_mixBuffer.data();
+    }
+    return output;
 }
 
 } // extern "C"
 
+static void setParameter(SynthInstance& instance, int parameterId, float value) {
+    Open303& synth = *instance.synth;
+    switch (parameterId) {
+        case PARAMETER_WAVEFORM:
+            synth.setWaveform(linToLin(value, 0.0, 1.0, 0.0, 1.0));
+            break;
+        case PARAMETER_TUNING:
+            synth.setTuning(linToLin(value, 0.0, 1.0, 400.0, 480.0));
+            break;
+        case PARAMETER_CUTOFF:
+            synth.setCutoff(linToExp(value, 0.0, 1.0, 314.0, 2394.0));
+            break;
+        case PARAMETER_RESONANCE:
+            synth.setResonance(linToLin(value, 0.0, 1.0, 0.0, 100.0));
+            break;
+        case PARAMETER_ENVMOD:
+            synth.setEnvMod(linToLin(value, 0.0, 1.0, 0.0, 100.0));
+            break;
+        case PARAMETER_DECAY: {
+            double min = instance.modEnabled ? 30.0 : 200.0;
+            double max = instance.modEnabled ? 3000.0 : 2000.0;
+            synth.setDecay(linToExp(value, 0.0, 1.0, min, max));
+            break;
+        }
+        case PARAMETER_ACCENT:
+            synth.setAccent(linToLin(value, 0.0, 1.0, 0.0, 100.0));
+            break;
+        case PARAMETER_VOLUME:
+            synth.setVolume(linToLin(value, 0.0, 1.0, -60.0, 0.0));
+            break;
+        case PARAMETER_MOD_ENABLED:
+            instance.modEnabled = (value != 0.0f);
+            if (!instance.modEnabled) {
+                // Restore original TB-303 values
+                setOriginalModValues(instance);
+            }
+            break;
+        case PARAMETER_NORMAL_DECAY:
+            if (instance.modEnabled) {
+                synth.setAmpDecay(linToLin(value, 0.0, 1.0, 30.0, 3000.0));
+            }
+            break;
+        case PARAMETER_ACCENT_DECAY:
+            if (instance.modEnabled) {
+                synth.setAccentDecay(linToLin(value, 0.0, 1.0, 30.0, 3000.0));
+            }
+            break;
+        case PARAMETER_FEEDBACK_FILTER:
+            if (instance.modEnabled) {
+                // Inverted range: higher knob position = lower cutoff frequency
+                synth.setFeedbackHighpass(linToExp(value, 0.0, 1.0, 350.0, 100.0));
+            }
+            break;
+        case PARAMETER_SOFT_ATTACK:
+            if (instance.modEnabled) {
+                synth.setNormalAttack(linToExp(value, 0.0, 1.0, 0.3, 3000.0));
+            }
+            break;
+        case PARAMETER_SLIDE_TIME:
+            if (instance.modEnabled) {
+                synth.setSlideTime(linToLin(value, 0.0, 1.0, 2.0, 360.0));
+            }
+            break;
+        case PARAMETER_SQUARE_DRIVER:
+            if (instance.modEnabled) {
+                setSquareDrive(instance, linToLin(value, 0.0, 1.0, 25.0, 80.0));
+            }
+            break;
+        case PARAMETER_FILTER_MODE:
+            synth.setFilterMode((int) value);
+            break;
+        case PARAMETER_PITCH_BEND:
+            synth.setPitchBend(value);
+            break;
+#if JC303_WASM_OVERDRIVE
+        case PARAMETER_OVERDRIVE_ENABLED: {
+            const bool wasEnabled = instance.overdriveEnabled;
+            instance.overdriveEnabled = (value != 0.0f);
+
+            // start from a clean model state rather than the one it was switched off in
+            if (instance.overdriveEnabled && !wasEnabled) {
+                instance.overdrive->reset();
+            }
+            break;
+        }
+        case PARAMETER_OVERDRIVE_LEVEL:
+            instance.overdrive->setDrive(value);
+            break;
+        case PARAMETER_OVERDRIVE_DRY_WET:
+            instance.overdrive->setDryWet(value);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+static void applyEvent(SynthInstance& instance, const Event& event) {
+    switch (event.type) {
+        case EVENT_NOTE_ON:
+            instance.synth->noteOn(event.data, (int) event.value, 0.0);
+            break;
+        case EVENT_NOTE_OFF:
+            instance.synth->noteOn(event.data, 0, 0.0);
+            break;
+        case EVENT_ALL_NOTES_OFF:
+            instance.synth->allNotesOff();
+            break;
+        case EVENT_PARAMETER:
+            setParameter(instance, event.data, event.value);
+            break;
+        default:
+            break;
+    }
+}
+
+// Renders a stretch of the block between two events
+static void renderSegment(SynthInstance& instance, float* out, int numSamples) {
+    if (numSamples <= 0) {
+        return;
+    }
+
+    // Generate audio samples
+    instance.synth->processBlock(out, numSamples);
+
+#if JC303_WASM_OVERDRIVE
+    if (instance.overdriveEnabled) {
+        instance.overdrive->process(out, numSamples);
+    }
+#endif
+}
+
+// Merges the runs of the event queue, each one sorted by frame offset: an insertion sort, which is
+// stable and next to free on the single run of the usual block
+static void sortByFrameOffset(Event* events, int numEvents) {
+    for (int i = 1; i < numEvents; ++i) {
+        const Event event = events[i];
+        int j = i;
+        for (; j > 0 && events[j - 1].frameOffset > event.frameOffset; --j) {
+            events[j] = events[j - 1];
+        }
+        events[j] = event;
+    }
+}
+
+static void renderWithEvents(SynthInstance& instance, const Event* queued, int numQueued,
+                             const Event* events, int numEvents, float* out, int numSamples) {
+    int position = 0;
+    int q = 0;
+    int e = 0;
+    while (q < numQueued || e < numEvents) {
+        // the queued events go first on equal offsets, they were sent before this call
+        const bool fromQueue = e == numEvents || (q < numQueued && queued[q].frameOffset <= events[e].frameOffset);
+        const Event& event = fromQueue ? queued[q++] : events[e++];
+
+        const int frame = std::max(position, (int) std::min(event.frameOffset, (uint32_t) numSamples));
+        renderSegment(instance, out + position, frame - position);
+        position = frame;
+
+        applyEvent(instance, event);
+    }
+
+    renderSegment(instance, out + position, numSamples - position);
+}
+
+// Renders a block of a synth, applying the events of its queue and the given ones
+static void renderSynth(SynthInstance& instance, const Event* events, int numEvents, float* out, int numSamples) {
+    // The pre-blended wavetable is brought up to date between blocks, once the waveform stays where
+    // it is (this is a no-op unless the waveform or the square shaper changed), and it doesn't
+    // allocate. A waveform event in the block reads both wavetables until the next block.
+    instance.synth->updatePreBlendedWaveform();
+
+    const int numQueued = (int) std::min(instance.eventQueue.numEvents, (uint32_t) EVENT_QUEUE_CAPACITY);
+    sortByFrameOffset(instance.eventQueue.events, numQueued);
+    renderWithEvents(instance, instance.eventQueue.events, numQueued, events, std::max(numEvents, 0),
+                     out, numSamples);
+    instance.eventQueue.numEvents = 0;
+}
+
 // Emscripten bindings for cleaner JavaScript API
 EMSCRIPTEN_BINDINGS(jc303_module) {
     emscripten::function("init", &jc303_init);
     emscripten::function("cleanup", &jc303_cleanup);
     emscripten::function("process", &jc303_process, emscripten::allow_raw_pointers());
+    emscripten::function("processWithEvents", &jc303_processWithEvents, emscripten::allow_raw_pointers());
     emscripten::function("noteOn", &jc303_noteOn);
     emscripten::function("noteOff", &jc303_noteOff);
     emscripten::function("allNotesOff", &jc303_allNotesOff);
@@ -398,7 +1042,32 @@ EMSCRIPTEN_BINDINGS(jc303_module) {
     emscripten::function("setSoftAttack", &jc303_setSoftAttack);
     emscripten::function("setSlideTime", &jc303_setSlideTime);
     emscripten::function("setSquareDriver", &jc303_setSquareDriver);
+    emscripten::function("setFilterMode", &jc303_setFilterMode);
     emscripten::function("setPitchBend", &jc303_setPitchBend);
+    emscripten::function("setLoopCacheEnabled", &jc303_setLoopCacheEnabled);
+#if JC303_WASM_OVERDRIVE
+    emscripten::function("setOverdriveEnabled", &jc303_setOverdriveEnabled);
+    emscripten::function("setOverdriveLevel", &jc303_setOverdriveLevel);
+    emscripten::function("setOverdriveDryWet", &jc303_setOverdriveDryWet);
+    emscripten::function("loadOverdriveModel", &jc303_loadOverdriveModel);
+    emscripten::function("synthLoadOverdriveModel", &jc303_synthLoadOverdriveModel);
+#endif
+    emscripten::function("setParameter", &jc303_setParameter);
+    emscripten::function("getEventQueue", &jc303_getEventQueue);
+    emscripten::function("getStateSize", &jc303_getStateSize);
+    emscripten::function("saveState", &jc303_saveState);
+    emscripten::function("loadState", &jc303_loadState);
     emscripten::function("getOutputBuffer", &jc303_getOutputBuffer, emscripten::allow_raw_pointers());
     emscripten::function("getBufferSize", &jc303_getBufferSize);
+    emscripten::function("createSynth", &jc303_createSynth);
+    emscripten::function("destroySynth", &jc303_destroySynth);
+    emscripten::function("synthNoteOn", &jc303_synthNoteOn);
+    emscripten::function("synthNoteOff", &jc303_synthNoteOff);
+    emscripten::function("synthAllNotesOff", &jc303_synthAllNotesOff);
+    emscripten::function("synthSetParameter", &jc303_synthSetParameter);
+    emscripten::function("synthSetLoopCacheEnabled", &jc303_synthSetLoopCacheEnabled);
+    emscripten::function("synthGetEventQueue", &jc303_synthGetEventQueue);
+    emscripten::function("setSynthMix", &jc303_setSynthMix);
+    emscripten::function("getNumChannels", &jc303_getNumChannels);
+    emscripten::function("renderAll", &jc303_renderAll, emscripten::allow_raw_pointers());
 }